@@ -133,6 +133,7 @@ popd
 
 export DREDD_REPO_ROOT=$(pwd)
 export DREDD_EXECUTABLE=${DREDD_REPO_ROOT}/third_party/clang+llvm/bin/dredd
+export DREDD_INFO_EXECUTABLE=${DREDD_REPO_ROOT}/build/src/dreddinfo/dredd-info
 export PATH=${PATH}:${DREDD_REPO_ROOT}/scripts
 cp build/src/dredd/dredd ${DREDD_EXECUTABLE}
 
@@ -69,6 +69,7 @@ cmake --build build --config Debug
 
 # Check that dredd works on some projects
 DREDD_EXECUTABLE="${DREDD_ROOT}/build/src/dredd/dredd"
+DREDD_INFO_EXECUTABLE="${DREDD_ROOT}/build/src/dreddinfo/dredd-info"
 
 echo "examples/simple/pi.cc: check that we can build the simple example"
 date
@@ -87,7 +88,7 @@ pushd examples/math
   cmake --build build
   ${DREDD_EXECUTABLE} -p build --mutation-info-file mutation-info.json math/src/*.cc
   ./build/mathtest/mathtest
-  NUM_MUTANTS=`python3 ${DREDD_ROOT}/scripts/query_mutant_info.py mutation-info.json --largest-mutant-id`
+  NUM_MUTANTS=`${DREDD_INFO_EXECUTABLE} mutation-info.json --largest-mutant-id`
   EXPECTED_NUM_MUTANTS=1119
   if [ ${NUM_MUTANTS} -ne ${EXPECTED_NUM_MUTANTS} ]
   then
@@ -95,10 +96,10 @@ pushd examples/math
      exit 1
   fi
 
-  # Display info about every mutant, just to check that the script that displays mutant info does not error.
+  # Display info about every mutant, just to check that the tool that displays mutant info does not error.
   for mutant in `seq 0 ${NUM_MUTANTS}`
   do
-    python3 ${DREDD_ROOT}/scripts/query_mutant_info.py mutation-info.json --show-info-for-mutant ${mutant} --path-prefix-replacement ${DREDD_ROOT}/examples/math/math ${DREDD_ROOT}/examples/math/math-original > /dev/null
+    ${DREDD_INFO_EXECUTABLE} mutation-info.json --show-info-for-mutant ${mutant} --path-prefix-replacement ${DREDD_ROOT}/examples/math/math ${DREDD_ROOT}/examples/math/math-original > /dev/null
   done
 popd
 
@@ -150,7 +151,7 @@ pushd SPIRV-Tools
   ./build/test/val/test_val_capability
   ./build/test/val/test_val_fghijklmnop
   ./build/test/val/test_val_rstuvw
-  NUM_MUTANTS=`python3 ${DREDD_ROOT}/scripts/query_mutant_info.py mutation-info.json --largest-mutant-id`
+  NUM_MUTANTS=`${DREDD_INFO_EXECUTABLE} mutation-info.json --largest-mutant-id`
   EXPECTED_NUM_MUTANTS=68191
   if [ ${NUM_MUTANTS} -ne ${EXPECTED_NUM_MUTANTS} ]
   then
@@ -176,7 +177,7 @@ pushd llvm-project
   done
   ${DREDD_EXECUTABLE} --mutation-info-file mutation-info.json -p "${DREDD_ROOT}/llvm-project/build" "${FILES[@]}"
   cmake --build build --target LLVMInstCombine
-  NUM_MUTANTS=`python3 ${DREDD_ROOT}/scripts/query_mutant_info.py mutation-info.json --largest-mutant-id`
+  NUM_MUTANTS=`${DREDD_INFO_EXECUTABLE} mutation-info.json --largest-mutant-id`
   EXPECTED_NUM_MUTANTS=93081
   if [ ${NUM_MUTANTS} -ne ${EXPECTED_NUM_MUTANTS} ]
   then
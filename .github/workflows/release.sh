@@ -72,9 +72,11 @@ BUILD_DIR="b_${CONFIG}"
 cmake -S . -B ${BUILD_DIR} -G Ninja -DCMAKE_BUILD_TYPE=${CMAKE_BUILD_TYPE} -DDREDD_CLANG_LLVM_DIR=/usr/lib/llvm-17
 cmake --build ${BUILD_DIR} --config ${CMAKE_BUILD_TYPE}
 
-# Get the file actually needed for the release: the dredd executable
+# Get the files actually needed for the release: the dredd and dredd-info
+# executables
 mkdir -p dredd/bin
 cp "${BUILD_DIR}/src/dredd/dredd" dredd/bin/dredd
+cp "${BUILD_DIR}/src/dreddinfo/dredd-info" dredd/bin/dredd-info
 DREDD_ZIP_NAME="dredd-${DREDD_RELEASE_OS}-${CONFIG}.zip"
 zip -r "${DREDD_ZIP_NAME}" dredd
 
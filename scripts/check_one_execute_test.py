@@ -23,6 +23,7 @@ from pathlib import Path
 
 DREDD_REPO_ROOT = os.environ['DREDD_REPO_ROOT']
 DREDD_EXECUTABLE = Path(DREDD_REPO_ROOT, 'temp', 'build-Debug', 'src', 'dredd', 'dredd') if 'DREDD_EXECUTABLE' not in os.environ else os.environ['DREDD_EXECUTABLE']
+DREDD_INFO_EXECUTABLE = Path(DREDD_REPO_ROOT, 'temp', 'build-Debug', 'src', 'dreddinfo', 'dredd-info') if 'DREDD_INFO_EXECUTABLE' not in os.environ else os.environ['DREDD_INFO_EXECUTABLE']
 test_directory = Path(DREDD_REPO_ROOT, sys.argv[1])
 test_is_cxx = os.path.exists(test_directory / 'harness.cc')
 extension = 'cc' if test_is_cxx else 'c'
@@ -87,7 +88,7 @@ if expected_original_output != actual_original_output:
     sys.exit(4)
 
 # Get the number of mutants that are available.
-cmd = ['python3', Path(DREDD_REPO_ROOT, 'scripts', 'query_mutant_info.py'), '--largest-mutant-id', 'temp.json']
+cmd = [DREDD_INFO_EXECUTABLE, '--largest-mutant-id', 'temp.json']
 largest_mutant_id_result = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
 if largest_mutant_id_result.returncode != 0:
     print("Error finding largest mutant id.")
@@ -121,6 +122,7 @@ print("Success!")
 os.remove(f'harness.{extension}')
 os.remove(f'tomutate.{extension}')
 os.remove('temp.json')
+os.remove('temp.json.index')
 if os.name == 'nt':
     os.remove('test_executable.exe')
 else:
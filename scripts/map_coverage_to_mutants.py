@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+
+# Copyright 2024 The Dredd Project Authors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     https://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import argparse
+import bisect
+import json
+import os
+import sys
+
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Dict, List, Optional, Tuple
+
+
+# The keys of the source locations that delimit the statement or expression affected by each kind of mutation group.
+MUTATION_GROUP_RANGE_KEYS: Dict[str, Tuple[str, str]] = {
+    "removeStmt": ("start", "end"),
+    "replaceExpr": ("start", "end"),
+    "replaceUnaryOperator": ("exprStart", "exprEnd"),
+    "replaceBinaryOperator": ("exprStart", "exprEnd"),
+}
+
+
+@dataclass
+class MutationSite:
+    filename: str
+    # The line and column at which the mutated statement or expression starts.
+    start: Tuple[int, int]
+    mutants: List[int] = field(default_factory=list)
+
+
+@dataclass
+class FileCoverage:
+    # The positions at which segments start, in order, and the execution count of each segment, or None if the segment
+    # is not part of a code region.
+    positions: List[Tuple[int, int]] = field(default_factory=list)
+    counts: List[Optional[int]] = field(default_factory=list)
+
+
+def normalise_path(path: str) -> str:
+    return os.path.normpath(path).replace('\\', '/')
+
+
+def build_mutation_sites(json_info: Dict, path_prefix_replacements: List[Tuple[str, str]]) -> List[MutationSite]:
+    result: List[MutationSite] = []
+    for file_info in json_info["infoForFiles"]:
+        filename: str = file_info["filename"]
+        for old_prefix, new_prefix in path_prefix_replacements:
+            if filename.startswith(old_prefix):
+                filename = new_prefix + filename[len(old_prefix):]
+                break
+        filename = normalise_path(filename)
+        for mutation_tree_node in file_info["mutationTree"]:
+            for mutation_group in mutation_tree_node.get("mutationGroups", []):
+                assert len(mutation_group) == 1
+                key: str = next(iter(mutation_group))
+                start_key, _ = MUTATION_GROUP_RANGE_KEYS[key]
+                start = mutation_group[key][start_key]
+                site = MutationSite(filename, (start["line"], start["column"]))
+                if key == "removeStmt":
+                    site.mutants.append(mutation_group[key]["mutationId"])
+                else:
+                    site.mutants.extend(instance["mutationId"] for instance in mutation_group[key]["instances"])
+                result.append(site)
+    return result
+
+
+def load_llvm_cov_export(export_file: Path) -> Dict[str, FileCoverage]:
+    # Yields, for each file in an 'llvm-cov export' report, the segments of the file. Each segment is
+    # [line, column, count, has_count, is_region_entry, is_gap_region], and the count applies from the start of the
+    # segment to the start of the next segment. Gap regions, which cover the whitespace between code regions, are
+    # ignored.
+    with open(export_file, 'r') as export_input:
+        export_json = json.load(export_input)
+    result: Dict[str, FileCoverage] = {}
+    for export_data in export_json["data"]:
+        for file_info in export_data["files"]:
+            if "segments" not in file_info:
+                raise ValueError(f"{export_file} has no segments; it must not be exported with -summary-only")
+            coverage = FileCoverage()
+            for segment in file_info["segments"]:
+                if len(segment) > 5 and segment[5]:
+                    continue
+                coverage.positions.append((segment[0], segment[1]))
+                coverage.counts.append(segment[2] if segment[3] else None)
+            result[normalise_path(file_info["filename"])] = coverage
+    return result
+
+
+def find_file_coverage(coverage: Dict[str, FileCoverage], filename: str) -> Optional[FileCoverage]:
+    # Paths are compared exactly if possible; otherwise a file is matched if one of the paths ends with the other.
+    if filename in coverage:
+        return coverage[filename]
+    for coverage_filename, file_coverage in coverage.items():
+        shorter, longer = sorted([coverage_filename, filename], key=len)
+        if longer.endswith('/' + shorter):
+            return file_coverage
+    return None
+
+
+def is_executed(file_coverage: FileCoverage, start: Tuple[int, int]) -> bool:
+    # A statement or expression is executed if the segment in which it starts has a non-zero count. This mirrors the
+    # way that a mutant tracking build records a mutant as reached when evaluation of its statement or expression
+    # begins. If the start does not lie in a code region, e.g. because it is in a macro expansion, the statement or
+    # expression is conservatively regarded as executed.
+    index = bisect.bisect_right(file_coverage.positions, start) - 1
+    if index < 0 or file_coverage.counts[index] is None:
+        return True
+    return file_coverage.counts[index] > 0
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(
+        description="Determines which Dredd mutants are executed by a test suite, using the source-based coverage of a "
+                    "build of the original, unmutated software, as exported by 'llvm-cov export'. This gives "
+                    "mutant-level coverage without a separate build using --only-track-mutant-coverage. For each "
+                    "mutant, the tests that execute the start of its statement or expression are printed, or 'not "
+                    "executed', or 'no coverage' if the coverage does not mention the mutant's file.")
+    parser.add_argument("mutation_info_file",
+                        help="File containing information about mutations, generated when Dredd was used to mutate "
+                             "the source code.",
+                        type=Path)
+    parser.add_argument("--coverage-exports",
+                        help="Files produced by 'llvm-cov export', without -summary-only. Each file can be given as "
+                             "NAME=PATH to name the test or test suite whose coverage it records; by default the name "
+                             "is the stem of the filename.",
+                        nargs='+',
+                        required=True)
+    parser.add_argument("--path-prefix-replacement",
+                        help="Replace a prefix of the filenames in the mutation info file, e.g. to map the checkout "
+                             "that was mutated to the checkout from which coverage was obtained.",
+                        nargs=2,
+                        action='append',
+                        metavar=("OLD_PREFIX", "NEW_PREFIX"),
+                        default=[])
+    parser.add_argument("--covered-mutants-file",
+                        help="Write the ids of the mutants that are executed, or that have no coverage, to this file, "
+                             "one per line, in the format used by DREDD_MUTANT_TRACKING_FILE. The file can be passed "
+                             "to run_mutants.py via --coverage-files.",
+                        type=Path)
+    args = parser.parse_args()
+
+    with open(args.mutation_info_file, 'r') as json_input:
+        json_info = json.load(json_input)
+    sites: List[MutationSite] = build_mutation_sites(json_info, args.path_prefix_replacement)
+
+    exports: List[Tuple[str, Dict[str, FileCoverage]]] = []
+    for coverage_export in args.coverage_exports:
+        name, separator, path = coverage_export.partition('=')
+        if not separator:
+            name, path = Path(coverage_export).stem, coverage_export
+        exports.append((name, load_llvm_cov_export(Path(path))))
+
+    executing_tests: Dict[int, Optional[List[str]]] = {}
+    files_without_coverage = set()
+    for site in sites:
+        tests: Optional[List[str]] = None
+        for name, coverage in exports:
+            file_coverage = find_file_coverage(coverage, site.filename)
+            if file_coverage is None:
+                continue
+            if tests is None:
+                tests = []
+            if is_executed(file_coverage, site.start):
+                tests.append(name)
+        if tests is None:
+            files_without_coverage.add(site.filename)
+        for mutant in site.mutants:
+            executing_tests[mutant] = tests
+
+    for filename in sorted(files_without_coverage):
+        print(f"Warning: no coverage was found for {filename}", file=sys.stderr)
+
+    for mutant in sorted(executing_tests.keys()):
+        tests = executing_tests[mutant]
+        if tests is None:
+            print(f"{mutant}: no coverage")
+        elif not tests:
+            print(f"{mutant}: not executed")
+        else:
+            print(f"{mutant}: {', '.join(tests)}")
+
+    if args.covered_mutants_file is not None:
+        with open(args.covered_mutants_file, 'w') as covered_output:
+            for mutant in sorted(executing_tests.keys()):
+                if executing_tests[mutant] is None or executing_tests[mutant]:
+                    covered_output.write(f"{mutant}\n")
+
+    num_executed = sum(1 for tests in executing_tests.values() if tests)
+    num_not_executed = sum(1 for tests in executing_tests.values() if tests is not None and not tests)
+    print(f"Mutants: {len(executing_tests)}, executed: {num_executed}, not executed: {num_not_executed}, "
+          f"no coverage: {len(executing_tests) - num_executed - num_not_executed}")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
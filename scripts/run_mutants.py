@@ -0,0 +1,358 @@
+#!/usr/bin/env python3
+
+# Copyright 2024 The Dredd Project Authors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     https://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import argparse
+import json
+import math
+import os
+import subprocess
+import sys
+import tempfile
+
+from dataclasses import dataclass, field
+from enum import Enum
+from pathlib import Path
+from typing import Dict, List, Optional, Set
+
+
+# Added to the limit on mutation checks derived via --runtime-budget-factor, so that tests that make few checks are not
+# cut short by small variations in their behaviour.
+RUNTIME_BUDGET_SLACK = 1000
+
+
+class MutantStatus(Enum):
+    KILLED = "killed"
+    SURVIVED = "survived"
+    # The mutant was not reached by any test, according to the coverage data. It therefore survives, but did not need
+    # to be executed.
+    NOT_COVERED = "not covered"
+    # The mutant is nested inside a statement-removal mutant that was not reached, so it cannot have been reached
+    # either. It therefore survives, and it did not need to be run.
+    PRUNED = "pruned"
+    # The mutant was run, but the software reported that the mutant was not reached, so the tests cannot have observed
+    # it. It therefore survives. Only possible if the software was mutated with --report-reached-mutants.
+    NOT_REACHED = "not reached"
+
+
+@dataclass
+class TreeNode:
+    # The ids of statement-removal mutants associated with this node.
+    remove_stmt_mutants: List[int] = field(default_factory=list)
+    # The ids of all other mutants associated with this node.
+    other_mutants: List[int] = field(default_factory=list)
+    children: List[int] = field(default_factory=list)
+
+
+def build_trees(json_info: Dict) -> List[List[TreeNode]]:
+    # Yields, for each mutated file, a list of tree nodes, mirroring the flattened tree of the JSON file. The root of
+    # each tree is the node at index 0.
+    result: List[List[TreeNode]] = []
+    for file_info in json_info["infoForFiles"]:
+        nodes: List[TreeNode] = []
+        for mutation_tree_node in file_info["mutationTree"]:
+            node = TreeNode(children=list(mutation_tree_node.get("children", [])))
+            for mutation_group in mutation_tree_node.get("mutationGroups", []):
+                assert len(mutation_group) == 1
+                key: str = next(iter(mutation_group))
+                if key in ["replaceExpr", "replaceUnaryOperator", "replaceBinaryOperator"]:
+                    for instance in mutation_group[key]["instances"]:
+                        node.other_mutants.append(instance["mutationId"])
+                else:
+                    assert key == "removeStmt"
+                    node.remove_stmt_mutants.append(mutation_group[key]["mutationId"])
+            nodes.append(node)
+        result.append(nodes)
+    return result
+
+
+def load_coverage(coverage_files: List[Path]) -> Set[int]:
+    # Yields the union of the mutants recorded in the given files, each of which should have been produced by running
+    # a mutant tracking version of the software under test, with the DREDD_MUTANT_TRACKING_FILE environment variable
+    # set.
+    result: Set[int] = set()
+    for coverage_file in coverage_files:
+        with open(coverage_file, 'r') as coverage_input:
+            for line in coverage_input:
+                line = line.strip()
+                if line:
+                    result.add(int(line))
+    return result
+
+
+def prune_subtree(nodes: List[TreeNode], root_index: int, resolved: Dict[int, MutantStatus]) -> None:
+    # Resolves as pruned every mutant in the subtree rooted at the given node that has not already been resolved.
+    worklist: List[int] = [root_index]
+    while worklist:
+        node = nodes[worklist.pop()]
+        for mutant in node.remove_stmt_mutants + node.other_mutants:
+            resolved.setdefault(mutant, MutantStatus.PRUNED)
+        worklist.extend(node.children)
+
+
+def resolve_without_execution(trees: List[List[TreeNode]],
+                              covered: Optional[Set[int]]) -> (Dict[int, MutantStatus], List[int]):
+    # Walks the mutation trees, resolving those mutants that cannot be killed, and yielding the remaining mutants,
+    # which need to be executed, in tree order.
+    #
+    # Only statement-removal mutants are used to prune subtrees. Such a mutant is recorded as reached before the
+    # statement executes, so if it is not reached, nothing nested inside the statement can be reached. The same does
+    # not hold for expression mutants, because these are reached only after their operands have been evaluated: an
+    # operand might be reached even though evaluation of the enclosing expression is subsequently abandoned, e.g. due
+    # to an exception.
+    resolved: Dict[int, MutantStatus] = {}
+    to_run: List[int] = []
+    for nodes in trees:
+        if not nodes:
+            continue
+        # An explicit stack is used, rather than recursion, because mutation trees can be very deep.
+        worklist: List[int] = [0]
+        while worklist:
+            node_index = worklist.pop()
+            node = nodes[node_index]
+            if covered is not None and any(mutant not in covered for mutant in node.remove_stmt_mutants):
+                prune_subtree(nodes, node_index, resolved)
+                continue
+            for mutant in node.remove_stmt_mutants + node.other_mutants:
+                if covered is not None and mutant not in covered:
+                    resolved[mutant] = MutantStatus.NOT_COVERED
+                else:
+                    to_run.append(mutant)
+            # Push the children in reverse so that they are processed in order.
+            worklist.extend(reversed(node.children))
+    return resolved, to_run
+
+
+def run_in_tree_order(trees: List[List[TreeNode]], to_run: List[int], resolved: Dict[int, MutantStatus],
+                      test_command: List[str], timeout: Optional[float], extra_env: Dict[str, str]) -> int:
+    # Runs the given mutants against software mutated with --report-reached-mutants, walking the mutation trees so that
+    # the statement-removal mutants of each node are run before the rest of its subtree, and yields the number of runs.
+    #
+    # An enabled mutant has no effect until it is reached, so if a statement-removal mutant is not reached, the tests
+    # behaved exactly as they do with no mutant enabled, and did not execute the statement. Every other mutant nested
+    # inside the statement would therefore not be reached either, so the subtree is pruned without running any of its
+    # mutants.
+    pending: Set[int] = set(to_run)
+    num_runs = 0
+
+    def run(mutant: int) -> MutantStatus:
+        nonlocal num_runs
+        num_runs += 1
+        resolved[mutant] = run_mutant(mutant, test_command, timeout, True, extra_env)
+        return resolved[mutant]
+
+    for nodes in trees:
+        if not nodes:
+            continue
+        worklist: List[int] = [0]
+        while worklist:
+            node_index = worklist.pop()
+            node = nodes[node_index]
+            if any(run(mutant) == MutantStatus.NOT_REACHED for mutant in node.remove_stmt_mutants if mutant in pending):
+                prune_subtree(nodes, node_index, resolved)
+                continue
+            for mutant in node.other_mutants:
+                if mutant in pending:
+                    run(mutant)
+            # Push the children in reverse so that they are processed in order.
+            worklist.extend(reversed(node.children))
+    return num_runs
+
+
+def measure_mutation_checks(test_command: List[str]) -> Optional[int]:
+    # Runs the test command with no mutant enabled, against software mutated with --runtime-budget, and yields the
+    # largest number of mutation checks made by any process, or None if the tests fail.
+    dredd_env = os.environ.copy()
+    with tempfile.TemporaryDirectory() as temp_dir:
+        count_file = Path(temp_dir, 'mutation_checks.count')
+        dredd_env['DREDD_MUTATION_CHECK_COUNT_FILE'] = str(count_file)
+        result = subprocess.run(test_command,
+                                env=dredd_env,
+                                stdout=subprocess.DEVNULL,
+                                stderr=subprocess.DEVNULL)
+        if result.returncode != 0:
+            return None
+        if not count_file.exists():
+            return 0
+        with open(count_file, 'r') as count_input:
+            return max([int(line) for line in count_input if line.strip()], default=0)
+
+
+def run_mutant(mutant: int, test_command: List[str], timeout: Optional[float], check_reached: bool,
+               extra_env: Dict[str, str]) -> MutantStatus:
+    dredd_env = os.environ.copy()
+    dredd_env.update(extra_env)
+    dredd_env['DREDD_ENABLED_MUTATION'] = str(mutant)
+    with tempfile.TemporaryDirectory() as temp_dir:
+        reached_file = Path(temp_dir, 'reached.mutants')
+        if check_reached:
+            dredd_env['DREDD_REACHED_MUTANTS_FILE'] = str(reached_file)
+        try:
+            result = subprocess.run(test_command,
+                                    env=dredd_env,
+                                    stdout=subprocess.DEVNULL,
+                                    stderr=subprocess.DEVNULL,
+                                    timeout=timeout)
+        except subprocess.TimeoutExpired:
+            return MutantStatus.KILLED
+        # A mutant that is not reached cannot affect the behaviour of the tests, so any failure is unrelated to it.
+        if check_reached and (not reached_file.exists() or mutant not in load_coverage([reached_file])):
+            return MutantStatus.NOT_REACHED
+    return MutantStatus.SURVIVED if result.returncode == 0 else MutantStatus.KILLED
+
+
+def run_split_stream(mutants: List[int], test_command: List[str], timeout: Optional[float],
+                     extra_env: Dict[str, str]) -> Optional[Dict[int, MutantStatus]]:
+    # Runs the test command once, with no mutant enabled, against software mutated with --split-stream. Each process
+    # of the software forks a child for each mutant when the mutant first infects the program state, and records the
+    # exit status of the child. A mutant is killed if any child for it exits with a non-zero status; as the output of
+    # each child is discarded, this is the only oracle. A mutant for which no child is recorded does not infect the
+    # program state, so it survives. Yields None if the tests fail when no mutant is enabled.
+    dredd_env = os.environ.copy()
+    dredd_env.update(extra_env)
+    with tempfile.TemporaryDirectory() as temp_dir:
+        results_file = Path(temp_dir, 'split_stream.results')
+        dredd_env['DREDD_SPLIT_STREAM_RESULTS_FILE'] = str(results_file)
+        if timeout is not None:
+            dredd_env['DREDD_SPLIT_STREAM_TIMEOUT'] = str(max(1, math.ceil(timeout)))
+        result = subprocess.run(test_command,
+                                env=dredd_env,
+                                stdout=subprocess.DEVNULL,
+                                stderr=subprocess.DEVNULL)
+        if result.returncode != 0:
+            return None
+        killed: Set[int] = set()
+        if results_file.exists():
+            with open(results_file, 'r') as results_input:
+                for line in results_input:
+                    if line.strip():
+                        mutant, exit_status = line.split()
+                        if int(exit_status) != 0:
+                            killed.add(int(mutant))
+    return {mutant: MutantStatus.KILLED if mutant in killed else MutantStatus.SURVIVED for mutant in mutants}
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(
+        description="Runs a test command against each mutant described by a Dredd mutation info file. Coverage "
+                    "information obtained from a mutant tracking build is combined with the hierarchical structure of "
+                    "the mutation tree to avoid running mutants that cannot be killed.")
+    parser.add_argument("mutation_info_file",
+                        help="File containing information about mutations, generated when Dredd was used to mutate "
+                             "the source code.",
+                        type=Path)
+    parser.add_argument("--coverage-files",
+                        help="Files listing the mutants reached by the tests, obtained by running the tests against a "
+                             "version of the software mutated with --only-track-mutant-coverage, with the "
+                             "DREDD_MUTANT_TRACKING_FILE environment variable set. If omitted, every mutant is run.",
+                        nargs='+',
+                        type=Path)
+    parser.add_argument("--list-mutants-to-run",
+                        help="Rather than running the test command, print the ids of the mutants that would need to "
+                             "be run, one per line. With --check-reached, some of these may be pruned rather than run.",
+                        action='store_true')
+    parser.add_argument("--timeout",
+                        help="Time limit, in seconds, for running the test command against a mutant. A mutant that "
+                             "exceeds this limit is regarded as killed.",
+                        type=float)
+    parser.add_argument("--check-reached",
+                        help="The software was mutated with --report-reached-mutants. Each mutant is run with the "
+                             "DREDD_REACHED_MUTANTS_FILE environment variable set, and is resolved as not reached, "
+                             "rather than as killed or survived, if the tests do not reach it. Mutants are run in the "
+                             "order of the mutation tree, and when the removal of a statement is not reached, the "
+                             "mutants nested inside the statement are pruned without being run.",
+                        action='store_true')
+    parser.add_argument("--split-stream",
+                        help="The software was mutated with --split-stream. Rather than running the test command "
+                             "once per mutant, it is run once, and the software forks a child for each mutant at the "
+                             "point where the mutant first infects the program state. The only oracle is the exit "
+                             "status of each child: the output of a child is discarded, and checks that the test "
+                             "command makes after the software exits, such as comparing its output with expected "
+                             "output, are not applied to the children. Only use this with tests that check their "
+                             "results within the software process itself. The time limit given by --timeout, rounded "
+                             "up to whole seconds, applies to each child.",
+                        action='store_true')
+    parser.add_argument("--runtime-budget-factor",
+                        help="The software was mutated with --runtime-budget. The test command is first run with no "
+                             "mutant enabled to count the checks of whether mutations are enabled, and each mutant "
+                             f"is then limited to this many times that count, plus {RUNTIME_BUDGET_SLACK}, so that a "
+                             "mutant that loops forever is killed as soon as it exceeds the limit.",
+                        type=float)
+    parser.epilog = "The command to run for each mutant should follow '--', and should exit with status 0 if and " \
+                    "only if the tests pass."
+
+    # Everything after '--' is the test command.
+    argv: List[str] = sys.argv[1:]
+    test_command: List[str] = []
+    if '--' in argv:
+        test_command = argv[argv.index('--') + 1:]
+        argv = argv[:argv.index('--')]
+    args = parser.parse_args(argv)
+    if not args.list_mutants_to_run and not test_command:
+        print("No test command specified.")
+        return 1
+    if args.split_stream and args.check_reached:
+        print("--split-stream and --check-reached cannot be combined.")
+        return 1
+
+    with open(args.mutation_info_file, 'r') as json_input:
+        json_info = json.load(json_input)
+    trees: List[List[TreeNode]] = build_trees(json_info)
+    covered: Optional[Set[int]] = None if args.coverage_files is None else load_coverage(args.coverage_files)
+
+    resolved, to_run = resolve_without_execution(trees, covered)
+
+    if args.list_mutants_to_run:
+        for mutant in to_run:
+            print(mutant)
+        return 0
+
+    extra_env: Dict[str, str] = {}
+    if args.runtime_budget_factor is not None:
+        mutation_checks: Optional[int] = measure_mutation_checks(test_command)
+        if mutation_checks is None:
+            print("The test command fails when no mutant is enabled.")
+            return 1
+        extra_env['DREDD_MUTATION_CHECK_LIMIT'] = str(
+            math.ceil(args.runtime_budget_factor * mutation_checks) + RUNTIME_BUDGET_SLACK)
+
+    if args.split_stream:
+        split_stream_statuses: Optional[Dict[int, MutantStatus]] = run_split_stream(to_run, test_command,
+                                                                                    args.timeout, extra_env)
+        if split_stream_statuses is None:
+            print("The test command fails when no mutant is enabled.")
+            return 1
+        resolved.update(split_stream_statuses)
+        num_runs = len(to_run)
+    elif args.check_reached:
+        num_runs = run_in_tree_order(trees, to_run, resolved, test_command, args.timeout, extra_env)
+    else:
+        for mutant in to_run:
+            resolved[mutant] = run_mutant(mutant, test_command, args.timeout, False, extra_env)
+        num_runs = len(to_run)
+
+    for mutant in sorted(resolved.keys()):
+        print(f"{mutant}: {resolved[mutant].value}")
+
+    num_killed = sum(1 for status in resolved.values() if status == MutantStatus.KILLED)
+    print(f"Mutants: {len(resolved)}, executed: {num_runs}, killed: {num_killed}, "
+          f"not covered: {sum(1 for status in resolved.values() if status == MutantStatus.NOT_COVERED)}, "
+          f"pruned: {sum(1 for status in resolved.values() if status == MutantStatus.PRUNED)}, "
+          f"not reached: {sum(1 for status in resolved.values() if status == MutantStatus.NOT_REACHED)}")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <cassert>
+#include <cstdint>
 #include <fstream>
 #include <memory>
 #include <optional>
@@ -27,15 +28,19 @@
 #include "clang/Tooling/CommonOptionsParser.h"
 #include "clang/Tooling/Tooling.h"
 #include "dredd/log_failed_files_diagnostic_consumer.h"
-#include "dredd/protobufs/protobuf_serialization.h"
+#include "libdredd/execution_profile.h"
+#include "libdredd/line_ranges.h"
 #include "libdredd/new_mutate_frontend_action_factory.h"
 #include "libdredd/options.h"
 #include "libdredd/protobufs/dredd_protobufs.h"
+#include "libdredd/protobufs/protobuf_serialization.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -83,6 +88,125 @@ static llvm::cl::opt<bool> show_ast_node_types(
         "In the mutated code, show (via comments) the type of each AST node to "
         "which mutation has been applied; useful for debugging"),
     llvm::cl::cat(mutate_category));
+// NOLINTNEXTLINE
+static llvm::cl::opt<int> statement_schema_threshold(
+    "statement-schema-threshold",
+    llvm::cl::desc(
+        "Mutate each expression or return statement that contains at least "
+        "this many mutation sites via a switch statement over the enabled "
+        "mutant, with a copy of the statement per site. This trades code size "
+        "for reduced overhead when no mutant in the statement is enabled. Zero "
+        "(the default) disables this mode."),
+    llvm::cl::init(0), llvm::cl::cat(mutate_category));
+// NOLINTNEXTLINE
+static llvm::cl::opt<bool> function_dispatch(
+    "function-dispatch",
+    llvm::cl::desc(
+        "Give each mutated function a copy of its original body, which is "
+        "executed when no mutant in the function is enabled. This trades code "
+        "size for reduced overhead in functions without an enabled mutant. "
+        "Cannot be combined with --statement-schema-threshold."),
+    llvm::cl::cat(mutate_category));
+// NOLINTNEXTLINE
+static llvm::cl::opt<double> sample_rate(
+    "sample-rate",
+    llvm::cl::desc(
+        "Proportion, between 0 and 1, of the mutation sites in each file that "
+        "should be instrumented. Sites are sampled deterministically, "
+        "stratified by mutation kind and enclosing function. Sites that are "
+        "not sampled are not instrumented and do not get mutant ids."),
+    llvm::cl::init(1.0), llvm::cl::cat(mutate_category));
+// NOLINTNEXTLINE
+static llvm::cl::opt<int> max_mutation_sites_per_file(
+    "max-mutation-sites-per-file",
+    llvm::cl::desc("Maximum number of mutation sites to instrument in each "
+                   "file, sampled as for --sample-rate; 0 (the default) means "
+                   "that there is no maximum."),
+    llvm::cl::init(0), llvm::cl::cat(mutate_category));
+// NOLINTNEXTLINE
+static llvm::cl::opt<uint64_t> sampling_seed(
+    "sampling-seed",
+    llvm::cl::desc("Seed used when sampling mutation sites; the same seed "
+                   "leads to the same sample for the same source file."),
+    llvm::cl::init(0), llvm::cl::cat(mutate_category));
+// NOLINTNEXTLINE
+static llvm::cl::opt<std::string> line_ranges_file(
+    "line-ranges",
+    llvm::cl::desc(
+        "File containing the output of 'git diff -U0'; only code that overlaps "
+        "the lines added or changed by the diff is mutated, and files that the "
+        "diff does not touch are left unchanged."),
+    llvm::cl::cat(mutate_category));
+// NOLINTNEXTLINE
+static llvm::cl::list<std::string> coverage_files(
+    "coverage-file",
+    llvm::cl::desc(
+        "Coverage report, either the JSON produced by 'llvm-cov export' or a "
+        "'.gcov' file produced by gcov; only code that overlaps the lines "
+        "executed according to the report is mutated, and files without "
+        "executed lines are left unchanged. May be given several times, in "
+        "which case the executed lines of all reports are combined."),
+    llvm::cl::cat(mutate_category));
+// NOLINTNEXTLINE
+static llvm::cl::opt<std::string> hot_site_profile(
+    "hot-site-profile",
+    llvm::cl::desc(
+        "Execution profile, in the JSON format produced by 'llvm-cov export', "
+        "obtained by running the tests on the original program. Sites that the "
+        "profile shows to execute more than --hot-site-threshold times are not "
+        "mutated, and are listed in the mutation info file instead."),
+    llvm::cl::cat(mutate_category));
+// NOLINTNEXTLINE
+static llvm::cl::opt<uint64_t> hot_site_threshold(
+    "hot-site-threshold",
+    llvm::cl::desc("Execution count above which a site is regarded as hot; "
+                   "must be given together with --hot-site-profile."),
+    llvm::cl::init(0), llvm::cl::cat(mutate_category));
+// NOLINTNEXTLINE
+static llvm::cl::opt<bool> report_reached_mutants(
+    "report-reached-mutants",
+    llvm::cl::desc(
+        "Make the mutated program report whether its enabled mutants are "
+        "reached: the id of each enabled mutant is appended to the file named "
+        "by DREDD_REACHED_MUTANTS_FILE when the mutant is first reached. Has no "
+        "effect with --only-track-mutant-coverage."),
+    llvm::cl::cat(mutate_category));
+// NOLINTNEXTLINE
+static llvm::cl::opt<bool> weak_mutation(
+    "weak-mutation",
+    llvm::cl::desc(
+        "Refine --only-track-mutant-coverage so that, where possible, a mutant "
+        "is only recorded if it is reached and its value differs from the "
+        "value of the original code, i.e. if it infects the program state. "
+        "Requires --only-track-mutant-coverage, and the mutated code must be "
+        "compiled with Clang or GCC."),
+    llvm::cl::cat(mutate_category));
+// NOLINTNEXTLINE
+static llvm::cl::opt<bool> split_stream(
+    "split-stream",
+    llvm::cl::desc(
+        "Make the mutated program support split-stream execution, on POSIX "
+        "systems: when run with DREDD_SPLIT_STREAM_RESULTS_FILE set and no "
+        "mutant enabled, the program forks at the first point at which each "
+        "mutant infects the program state, or is reached if this cannot be "
+        "determined in advance. The child continues with the mutant enabled "
+        "and its output discarded, and its exit status, which is the only "
+        "indication of whether the mutant is killed, is appended to the "
+        "results file."),
+    llvm::cl::cat(mutate_category));
+// NOLINTNEXTLINE
+static llvm::cl::opt<bool> runtime_budget(
+    "runtime-budget",
+    llvm::cl::desc(
+        "Make the mutated program count its checks of whether mutations are "
+        "enabled, so that mutants that loop forever are detected quickly: if "
+        "DREDD_MUTATION_CHECK_LIMIT is set, the program exits with status "
+        "DREDD_BUDGET_EXCEEDED_EXIT_CODE, or 124 by default, once the "
+        "program exceeds that many checks, and if "
+        "DREDD_MUTATION_CHECK_COUNT_FILE is set, the number of checks is "
+        "appended to the file on exit. Checks are counted across all mutated "
+        "files in a process, which requires Clang or GCC."),
+    llvm::cl::cat(mutate_category));
 
 #if defined(__clang__)
 #pragma clang diagnostic pop
@@ -105,6 +229,46 @@ int main(int argc, const char** argv) {
     return 1;
   }
 
+  if (sample_rate < 0.0 || sample_rate > 1.0) {
+    llvm::errs() << "--sample-rate must be between 0 and 1.\n";
+    return 1;
+  }
+  if (max_mutation_sites_per_file < 0 || statement_schema_threshold < 0) {
+    llvm::errs() << "--max-mutation-sites-per-file and "
+                    "--statement-schema-threshold must not be negative.\n";
+    return 1;
+  }
+  if (function_dispatch && statement_schema_threshold > 0) {
+    llvm::errs() << "--function-dispatch and --statement-schema-threshold "
+                    "cannot be combined.\n";
+    return 1;
+  }
+  if (hot_site_profile.empty() !=
+      (hot_site_threshold.getNumOccurrences() == 0)) {
+    llvm::errs() << "--hot-site-profile and --hot-site-threshold must be "
+                    "given together.\n";
+    return 1;
+  }
+  if (weak_mutation && !only_track_mutant_coverage) {
+    llvm::errs() << "--weak-mutation requires --only-track-mutant-coverage.\n";
+    return 1;
+  }
+  if (split_stream &&
+      (only_track_mutant_coverage || report_reached_mutants ||
+       function_dispatch || statement_schema_threshold > 0)) {
+    llvm::errs() << "--split-stream cannot be combined with "
+                    "--only-track-mutant-coverage, --report-reached-mutants, "
+                    "--function-dispatch or --statement-schema-threshold.\n";
+    return 1;
+  }
+  if (runtime_budget && (only_track_mutant_coverage || function_dispatch ||
+                         statement_schema_threshold > 0)) {
+    llvm::errs() << "--runtime-budget cannot be combined with "
+                    "--only-track-mutant-coverage, --function-dispatch or "
+                    "--statement-schema-threshold.\n";
+    return 1;
+  }
+
   clang::tooling::ClangTool tool(
       command_line_options.get().getCompilations(),
       command_line_options.get().getSourcePathList());
@@ -141,9 +305,93 @@ int main(int argc, const char** argv) {
     mutation_info = dredd::protobufs::MutationInfo();
   }
 
-  const dredd::Options dredd_options(!no_mutation_opts, dump_asts,
-                                     only_track_mutant_coverage,
-                                     show_ast_node_types);
+  std::optional<dredd::LineRanges> line_ranges;
+  if (!line_ranges_file.empty()) {
+    const llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> diff_buffer =
+        llvm::MemoryBuffer::getFile(line_ranges_file);
+    if (!diff_buffer) {
+      llvm::errs() << "Error reading " << line_ranges_file << ": "
+                   << diff_buffer.getError().message() << "\n";
+      return 1;
+    }
+    std::string error_message;
+    line_ranges = dredd::LineRanges::ParseGitDiff(
+        diff_buffer.get()->getBuffer().str(), error_message);
+    if (!line_ranges.has_value()) {
+      llvm::errs() << "Error parsing " << line_ranges_file << ": "
+                   << error_message << "\n";
+      return 1;
+    }
+  }
+
+  std::optional<dredd::LineRanges> covered_lines;
+  for (const std::string& coverage_file : coverage_files) {
+    const llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> coverage_buffer =
+        llvm::MemoryBuffer::getFile(coverage_file);
+    if (!coverage_buffer) {
+      llvm::errs() << "Error reading " << coverage_file << ": "
+                   << coverage_buffer.getError().message() << "\n";
+      return 1;
+    }
+    // An 'llvm-cov export' report is a JSON object; anything else is treated
+    // as the output of gcov.
+    const llvm::StringRef coverage_text = coverage_buffer.get()->getBuffer();
+    std::string error_message;
+    const std::optional<dredd::LineRanges> report_lines =
+        coverage_text.ltrim().starts_with("{")
+            ? dredd::LineRanges::ParseLlvmCovExport(coverage_text.str(),
+                                                    error_message)
+            : dredd::LineRanges::ParseGcov(coverage_text.str(), error_message);
+    if (!report_lines.has_value()) {
+      llvm::errs() << "Error parsing " << coverage_file << ": "
+                   << error_message << "\n";
+      return 1;
+    }
+    if (covered_lines.has_value()) {
+      covered_lines->Add(report_lines.value());
+    } else {
+      covered_lines = report_lines;
+    }
+  }
+
+  std::optional<dredd::ExecutionProfile> execution_profile;
+  if (!hot_site_profile.empty()) {
+    const llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> profile_buffer =
+        llvm::MemoryBuffer::getFile(hot_site_profile);
+    if (!profile_buffer) {
+      llvm::errs() << "Error reading " << hot_site_profile << ": "
+                   << profile_buffer.getError().message() << "\n";
+      return 1;
+    }
+    std::string error_message;
+    execution_profile = dredd::ExecutionProfile::ParseLlvmCovExport(
+        profile_buffer.get()->getBuffer().str(), error_message);
+    if (!execution_profile.has_value()) {
+      llvm::errs() << "Error parsing " << hot_site_profile << ": "
+                   << error_message << "\n";
+      return 1;
+    }
+  }
+
+  dredd::Options dredd_options;
+  dredd_options.SetOptimiseMutations(!no_mutation_opts)
+      .SetDumpAsts(dump_asts)
+      .SetOnlyTrackMutantCoverage(only_track_mutant_coverage)
+      .SetShowAstNodeTypes(show_ast_node_types)
+      .SetCollectMutationInfo(mutation_info.has_value())
+      .SetStatementSchemaThreshold(statement_schema_threshold)
+      .SetFunctionDispatch(function_dispatch)
+      .SetSampleRate(sample_rate)
+      .SetMaxMutationSitesPerFile(max_mutation_sites_per_file)
+      .SetSamplingSeed(sampling_seed)
+      .SetLineRanges(std::move(line_ranges))
+      .SetCoveredLines(std::move(covered_lines))
+      .SetExecutionProfile(std::move(execution_profile))
+      .SetHotSiteThreshold(hot_site_threshold)
+      .SetReportReachedMutants(report_reached_mutants)
+      .SetWeakMutation(weak_mutation)
+      .SetSplitStream(split_stream)
+      .SetRuntimeBudget(runtime_budget);
 
   const std::unique_ptr<clang::tooling::FrontendActionFactory> factory =
       dredd::NewMutateFrontendActionFactory(dredd_options, mutation_id,
@@ -0,0 +1,115 @@
+// Copyright 2024 The Dredd Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DREDDINFO_MUTANT_INDEX_H
+#define DREDDINFO_MUTANT_INDEX_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "libdredd/protobufs/dredd_protobufs.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace dredd {
+
+// A persistent index from mutant ids to the information that Dredd records
+// about each mutant. The JSON mutation info file for a large project can be
+// very large, so parsing it for every query is slow. Instead, the file is
+// parsed once, and the index is written to disk in a compact binary form that
+// comprises a fixed-size record per mutant id, followed by a table of
+// filenames. Subsequent queries memory-map the index and access the record for
+// a mutant directly, without parsing anything.
+class MutantIndex {
+ public:
+  enum class MutantKind : uint8_t {
+    kRemoveStmt = 0,
+    kReplaceExpr = 1,
+    kReplaceBinaryOperator = 2,
+    kReplaceUnaryOperator = 3,
+  };
+
+  struct SourceRange {
+    uint32_t start_line;
+    uint32_t start_column;
+    uint32_t end_line;
+    uint32_t end_column;
+  };
+
+  struct MutantRecord {
+    // Index of the file in which the mutant occurs, which can be turned into a
+    // filename via GetFilename.
+    uint32_t file_index;
+    // The mutation tree node, mutation group within that node, and instance
+    // within that group, from which the mutant was recorded. The instance index
+    // is 0 for statement removal mutants, which have a single instance.
+    uint32_t node_index;
+    uint32_t group_index;
+    uint32_t instance_index;
+    MutantKind kind;
+    // The action associated with the mutant, which should be interpreted
+    // according to the kind of the mutant, and is 0 for statement removals.
+    uint8_t action;
+    // The source range for the statement or expression being mutated, then the
+    // source ranges for its operands: the lhs and rhs of a binary operator, or
+    // the operand of a unary operator.
+    std::array<SourceRange, 3> ranges;
+  };
+
+  // Yields the hash of the contents of a mutation info file that is recorded
+  // in an index. Unlike a modification time, this changes whenever the contents
+  // of the file change, even if the file is rewritten within the resolution of
+  // the file system's timestamps.
+  static uint64_t HashInfoFileContents(llvm::StringRef contents);
+
+  // Writes an index for |mutation_info| to |index_filename|. The size and
+  // content hash of the mutation info file from which |mutation_info| was
+  // parsed are recorded, so that a stale index can be detected. Returns false
+  // and sets |error_message| if the index cannot be written.
+  static bool Write(const protobufs::MutationInfo& mutation_info,
+                    uint64_t info_file_size, uint64_t info_file_hash,
+                    const std::string& index_filename,
+                    std::string& error_message);
+
+  // Memory-maps the index at |index_filename|. Yields nullptr if the index does
+  // not exist, is malformed, or was built from a mutation info file with a
+  // different size or content hash.
+  static std::unique_ptr<MutantIndex> Open(const std::string& index_filename,
+                                           uint64_t info_file_size,
+                                           uint64_t info_file_hash);
+
+  // Yields -1 if there are no mutants.
+  [[nodiscard]] int GetLargestMutantId() const { return largest_mutant_id_; }
+
+  // Yields the record for the given mutant, or no value if there is no such
+  // mutant.
+  [[nodiscard]] std::optional<MutantRecord> GetMutant(int mutant_id) const;
+
+  [[nodiscard]] llvm::StringRef GetFilename(uint32_t file_index) const;
+
+ private:
+  MutantIndex(std::unique_ptr<llvm::MemoryBuffer> buffer, uint32_t num_files,
+              int largest_mutant_id);
+
+  std::unique_ptr<llvm::MemoryBuffer> buffer_;
+  uint32_t num_files_;
+  int largest_mutant_id_;
+};
+
+}  // namespace dredd
+
+#endif  // DREDDINFO_MUTANT_INDEX_H
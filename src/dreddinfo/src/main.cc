@@ -0,0 +1,521 @@
+// Copyright 2024 The Dredd Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "dreddinfo/mutant_index.h"
+#include "libdredd/protobufs/dredd_protobufs.h"
+#include "libdredd/protobufs/protobuf_serialization.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+#pragma clang diagnostic ignored "-Wglobal-constructors"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#elif defined(_MSC_VER)
+#pragma warning(push)
+#endif
+
+// Set up the command line options
+// NOLINTNEXTLINE
+static llvm::cl::OptionCategory info_category("dredd-info options");
+// NOLINTNEXTLINE
+static llvm::cl::opt<std::string> mutation_info_file(
+    llvm::cl::Positional,
+    llvm::cl::desc("<.json file generated via dredd's --mutation-info-file>"),
+    llvm::cl::Required, llvm::cl::cat(info_category));
+// NOLINTNEXTLINE
+static llvm::cl::opt<std::string> index_file(
+    "index-file",
+    llvm::cl::desc("File in which an index of the mutation info file should "
+                   "be stored; defaults to the name of the mutation info file "
+                   "with '.index' appended. The index is built on first use, "
+                   "and rebuilt if the mutation info file changes."),
+    llvm::cl::cat(info_category));
+// NOLINTNEXTLINE
+static llvm::cl::opt<bool> largest_mutant_id(
+    "largest-mutant-id",
+    llvm::cl::desc("Show the largest id among all mutants that are present. "
+                   "Mutants are normally numbered contiguously starting from "
+                   "0, so this is related to the total number of mutants. "
+                   "Prints -1 if there are no mutants."),
+    llvm::cl::cat(info_category));
+// NOLINTNEXTLINE
+static llvm::cl::opt<int> show_info_for_mutant(
+    "show-info-for-mutant",
+    llvm::cl::desc("Show information about a given mutant"),
+    llvm::cl::cat(info_category));
+// NOLINTNEXTLINE
+static llvm::cl::list<std::string> path_prefix_replacement(
+    "path-prefix-replacement",
+    llvm::cl::desc(
+        "When displaying information about the effect of mutants, we want to "
+        "refer to the non-mutated source code. If the mutated code base is at "
+        "/path/to/somewhere/mutated, and the non-mutated codebase is at "
+        "/path/to/elsewhere/nonmutated, then this pair of prefixes should be "
+        "passed. They allow files in the non-mutated code base to be opened "
+        "when looking for source code contents to display."),
+    llvm::cl::multi_val(2), llvm::cl::cat(info_category));
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#elif defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+namespace {
+
+// The text associated with a source range, in the form needed to describe the
+// effect of a mutant.
+struct SourceRangeText {
+  bool single_line;
+  std::string range_description;
+  // Whitespace corresponding to the column at which the range starts; used to
+  // line up the text of a multi-line range.
+  std::string blank_prefix;
+  std::string text;
+};
+
+// Yields the substring of |str| from |begin| up to |end|, clamping both to the
+// length of |str|.
+std::string Slice(const std::string& str, size_t begin,
+                  size_t end = std::string::npos) {
+  begin = std::min(begin, str.size());
+  end = std::min(end, str.size());
+  return begin < end ? str.substr(begin, end - begin) : "";
+}
+
+// Yields the first |num_lines| lines of the given file, each including its
+// line terminator, or no value if the file cannot be read or has fewer lines.
+std::optional<std::vector<std::string>> ReadLines(const std::string& filename,
+                                                  uint32_t num_lines) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer =
+      llvm::MemoryBuffer::getFile(filename, /*IsText=*/true,
+                                  /*RequiresNullTerminator=*/false);
+  if (!buffer) {
+    return std::nullopt;
+  }
+  llvm::StringRef remaining = buffer.get()->getBuffer();
+  std::vector<std::string> result;
+  while (result.size() < num_lines && !remaining.empty()) {
+    const size_t newline = remaining.find('\n');
+    llvm::StringRef line = remaining.substr(
+        0, newline == llvm::StringRef::npos ? newline : newline + 1);
+    remaining = remaining.drop_front(line.size());
+    std::string line_text = line.str();
+    if (line_text.ends_with("\r\n")) {
+      line_text.erase(line_text.size() - 2, 1);
+    }
+    result.push_back(line_text);
+  }
+  if (result.size() < num_lines) {
+    return std::nullopt;
+  }
+  return result;
+}
+
+SourceRangeText GetTextForSourceRange(
+    const dredd::MutantIndex::SourceRange& range,
+    const std::vector<std::string>& lines,
+    const std::string& filename_without_prefix) {
+  SourceRangeText result;
+  result.range_description =
+      filename_without_prefix + ", " + std::to_string(range.start_line) + ":" +
+      std::to_string(range.start_column) + "--" +
+      std::to_string(range.end_line) + ":" + std::to_string(range.end_column);
+  const size_t start_column = range.start_column - 1;
+  const size_t end_column = range.end_column - 1;
+  if (range.start_line == range.end_line) {
+    result.single_line = true;
+    result.text = Slice(lines[range.start_line - 1], start_column, end_column);
+    return result;
+  }
+  result.single_line = false;
+  result.blank_prefix = std::string(start_column, ' ');
+  result.text = Slice(lines[range.start_line - 1], start_column);
+  for (uint32_t line = range.start_line; line + 1 < range.end_line; line++) {
+    result.text += lines[line];
+  }
+  result.text += Slice(lines[range.end_line - 1], 0, end_column);
+  return result;
+}
+
+std::string ParenthesiseIfNeeded(const std::string& expr_text) {
+  // Do not parenthesise if it is clearly unnecessary, e.g. for identifiers and
+  // numeric literals.
+  if (!expr_text.empty() &&
+      std::all_of(expr_text.begin(), expr_text.end(), [](char character) {
+        return llvm::isAlnum(character) || character == '_' ||
+               character == '\\' || character == '.' ||
+               llvm::isSpace(character);
+      })) {
+    return expr_text;
+  }
+  return "(" + expr_text + ")";
+}
+
+std::string GetReplaceExprText(
+    dredd::protobufs::MutationReplaceExprAction action,
+    const SourceRangeText& expr) {
+  switch (action) {
+    case dredd::protobufs::ReplaceWithZeroFloat:
+      return "0.0";
+    case dredd::protobufs::ReplaceWithOneFloat:
+      return "1.0";
+    case dredd::protobufs::ReplaceWithMinusOneFloat:
+      return "-1.0";
+    case dredd::protobufs::ReplaceWithZeroInt:
+      return "0";
+    case dredd::protobufs::ReplaceWithOneInt:
+      return "1";
+    case dredd::protobufs::ReplaceWithMinusOneInt:
+      return "-1";
+    case dredd::protobufs::ReplaceWithTrue:
+      return "true";
+    case dredd::protobufs::ReplaceWithFalse:
+      return "false";
+    case dredd::protobufs::InsertPreInc:
+      return expr.blank_prefix + "++ " + ParenthesiseIfNeeded(expr.text);
+    case dredd::protobufs::InsertPreDec:
+      return expr.blank_prefix + "-- " + ParenthesiseIfNeeded(expr.text);
+    case dredd::protobufs::InsertLNot:
+      return expr.blank_prefix + "! " + ParenthesiseIfNeeded(expr.text);
+    case dredd::protobufs::InsertNot:
+      return expr.blank_prefix + "~ " + ParenthesiseIfNeeded(expr.text);
+    case dredd::protobufs::InsertMinus:
+      return expr.blank_prefix + "- " + ParenthesiseIfNeeded(expr.text);
+    default:
+      assert(false && "Unknown action.");
+      return "";
+  }
+}
+
+std::string GetReplaceUnaryOperatorText(
+    dredd::protobufs::MutationReplaceUnaryOperatorAction action,
+    const SourceRangeText& operand) {
+  const std::string parenthesised_operand = ParenthesiseIfNeeded(operand.text);
+  switch (action) {
+    case dredd::protobufs::ReplaceWithOperand:
+      return operand.blank_prefix + operand.text;
+    case dredd::protobufs::ReplaceWithMinus:
+      return operand.blank_prefix + "- " + parenthesised_operand;
+    case dredd::protobufs::ReplaceWithNot:
+      return operand.blank_prefix + "~ " + parenthesised_operand;
+    case dredd::protobufs::ReplaceWithPreDec:
+      return operand.blank_prefix + "-- " + parenthesised_operand;
+    case dredd::protobufs::ReplaceWithPreInc:
+      return operand.blank_prefix + "++ " + parenthesised_operand;
+    case dredd::protobufs::ReplaceWithLNot:
+      return operand.blank_prefix + "! " + parenthesised_operand;
+    case dredd::protobufs::ReplaceWithPostDec:
+      return operand.blank_prefix + parenthesised_operand + " --";
+    case dredd::protobufs::ReplaceWithPostInc:
+      return operand.blank_prefix + parenthesised_operand + " ++";
+    default:
+      assert(false && "Unknown action.");
+      return "";
+  }
+}
+
+const char* GetBinaryOperatorText(
+    dredd::protobufs::MutationReplaceBinaryOperatorAction action) {
+  switch (action) {
+    case dredd::protobufs::ReplaceWithAdd:
+      return "+";
+    case dredd::protobufs::ReplaceWithDiv:
+      return "/";
+    case dredd::protobufs::ReplaceWithMul:
+      return "*";
+    case dredd::protobufs::ReplaceWithRem:
+      return "%";
+    case dredd::protobufs::ReplaceWithSub:
+      return "-";
+    case dredd::protobufs::ReplaceWithAddAssign:
+      return "+=";
+    case dredd::protobufs::ReplaceWithAndAssign:
+      return "&=";
+    case dredd::protobufs::ReplaceWithAssign:
+      return "=";
+    case dredd::protobufs::ReplaceWithDivAssign:
+      return "/=";
+    case dredd::protobufs::ReplaceWithMulAssign:
+      return "*=";
+    case dredd::protobufs::ReplaceWithOrAssign:
+      return "|=";
+    case dredd::protobufs::ReplaceWithRemAssign:
+      return "%=";
+    case dredd::protobufs::ReplaceWithShlAssign:
+      return "<<=";
+    case dredd::protobufs::ReplaceWithShrAssign:
+      return ">>=";
+    case dredd::protobufs::ReplaceWithSubAssign:
+      return "-=";
+    case dredd::protobufs::ReplaceWithXorAssign:
+      return "^=";
+    case dredd::protobufs::ReplaceWithAnd:
+      return "&";
+    case dredd::protobufs::ReplaceWithOr:
+      return "|";
+    case dredd::protobufs::ReplaceWithXor:
+      return "^";
+    case dredd::protobufs::ReplaceWithLAnd:
+      return "&&";
+    case dredd::protobufs::ReplaceWithLOr:
+      return "||";
+    case dredd::protobufs::ReplaceWithEQ:
+      return "==";
+    case dredd::protobufs::ReplaceWithGE:
+      return ">=";
+    case dredd::protobufs::ReplaceWithGT:
+      return ">";
+    case dredd::protobufs::ReplaceWithLE:
+      return "<=";
+    case dredd::protobufs::ReplaceWithLT:
+      return "<";
+    case dredd::protobufs::ReplaceWithNE:
+      return "!=";
+    case dredd::protobufs::ReplaceWithShl:
+      return "<<";
+    case dredd::protobufs::ReplaceWithShr:
+      return ">>";
+    default:
+      assert(false && "Unknown action.");
+      return "";
+  }
+}
+
+std::string GetReplaceBinaryOperatorText(
+    dredd::protobufs::MutationReplaceBinaryOperatorAction action,
+    const SourceRangeText& expr, const SourceRangeText& lhs,
+    const SourceRangeText& rhs) {
+  if (action == dredd::protobufs::ReplaceWithLHS) {
+    return lhs.blank_prefix + lhs.text;
+  }
+  if (action == dredd::protobufs::ReplaceWithRHS) {
+    return rhs.blank_prefix + rhs.text;
+  }
+  const std::string separator = expr.single_line ? " " : "\n";
+  return lhs.blank_prefix + ParenthesiseIfNeeded(lhs.text) + separator +
+         GetBinaryOperatorText(action) + separator + rhs.blank_prefix +
+         ParenthesiseIfNeeded(rhs.text);
+}
+
+std::string StripTrailingSeparators(std::string path) {
+  while (path.size() > 1 &&
+         llvm::sys::path::is_separator(path[path.size() - 1])) {
+    path.pop_back();
+  }
+  return path;
+}
+
+int ShowInfoForMutant(const dredd::MutantIndex& index, int mutant_id) {
+  if (path_prefix_replacement.size() != 2) {
+    llvm::outs() << "Missing: path to the root of the mutated code, and path "
+                    "to the root of the non-mutated code. From these prefixes "
+                    "onwards, the source trees should have the same content.\n";
+    return 1;
+  }
+  const std::optional<dredd::MutantIndex::MutantRecord> mutant =
+      index.GetMutant(mutant_id);
+  if (!mutant.has_value()) {
+    llvm::outs() << "Unknown mutant id: " << mutant_id << "\n";
+    return 1;
+  }
+
+  const std::string mutated_prefix =
+      StripTrailingSeparators(path_prefix_replacement[0]);
+  const std::string original_prefix =
+      StripTrailingSeparators(path_prefix_replacement[1]);
+  llvm::StringRef filename_without_prefix =
+      index.GetFilename(mutant->file_index);
+  filename_without_prefix = filename_without_prefix.drop_front(
+      std::min(mutated_prefix.size(), filename_without_prefix.size()));
+  if (!filename_without_prefix.empty() &&
+      llvm::sys::path::is_separator(filename_without_prefix.front())) {
+    filename_without_prefix = filename_without_prefix.drop_front();
+  }
+  const std::string original_source_code_filename =
+      original_prefix + llvm::sys::path::get_separator().str() +
+      filename_without_prefix.str();
+
+  uint32_t num_lines = 0;
+  for (const auto& range : mutant->ranges) {
+    num_lines = std::max(num_lines, range.end_line);
+  }
+  const std::optional<std::vector<std::string>> lines =
+      ReadLines(original_source_code_filename, num_lines);
+  if (!lines.has_value()) {
+    llvm::errs() << "Could not read source code for mutant from "
+                 << original_source_code_filename << "\n";
+    return 1;
+  }
+
+  const SourceRangeText overall = GetTextForSourceRange(
+      mutant->ranges[0], lines.value(), filename_without_prefix.str());
+  switch (mutant->kind) {
+    case dredd::MutantIndex::MutantKind::kRemoveStmt:
+      llvm::outs() << "Remove statement at " << overall.range_description
+                   << "\n\n";
+      llvm::outs() << "This is the removed statement:\n\n";
+      llvm::outs() << overall.blank_prefix << overall.text << "\n";
+      return 0;
+    case dredd::MutantIndex::MutantKind::kReplaceExpr:
+      llvm::outs() << "Replace expression at " << overall.range_description
+                   << "\n\n";
+      llvm::outs() << "Original expression:\n\n";
+      llvm::outs() << overall.blank_prefix << overall.text << "\n\n";
+      llvm::outs() << "Replacement expression:\n\n";
+      llvm::outs() << GetReplaceExprText(
+                          static_cast<dredd::protobufs::MutationReplaceExprAction>(
+                              mutant->action),
+                          overall)
+                   << "\n\n";
+      return 0;
+    case dredd::MutantIndex::MutantKind::kReplaceBinaryOperator: {
+      const SourceRangeText lhs = GetTextForSourceRange(
+          mutant->ranges[1], lines.value(), filename_without_prefix.str());
+      const SourceRangeText rhs = GetTextForSourceRange(
+          mutant->ranges[2], lines.value(), filename_without_prefix.str());
+      llvm::outs() << "Replace binary operator expression at "
+                   << overall.range_description << "\n\n";
+      llvm::outs() << "Original binary operator expression:\n\n";
+      llvm::outs() << overall.blank_prefix << overall.text << "\n\n";
+      llvm::outs() << "Replacement expression:\n\n";
+      llvm::outs() << GetReplaceBinaryOperatorText(
+                          static_cast<dredd::protobufs::
+                                          MutationReplaceBinaryOperatorAction>(
+                              mutant->action),
+                          overall, lhs, rhs)
+                   << "\n\n";
+      return 0;
+    }
+    case dredd::MutantIndex::MutantKind::kReplaceUnaryOperator: {
+      const SourceRangeText operand = GetTextForSourceRange(
+          mutant->ranges[1], lines.value(), filename_without_prefix.str());
+      llvm::outs() << "Replace unary operator expression at "
+                   << overall.range_description << "\n\n";
+      llvm::outs() << "Original unary operator expression:\n\n";
+      llvm::outs() << overall.blank_prefix << overall.text << "\n\n";
+      llvm::outs() << "Replacement expression:\n\n";
+      llvm::outs() << GetReplaceUnaryOperatorText(
+                          static_cast<dredd::protobufs::
+                                          MutationReplaceUnaryOperatorAction>(
+                              mutant->action),
+                          operand)
+                   << "\n\n";
+      return 0;
+    }
+  }
+  assert(false && "Unknown mutant kind.");
+  return 1;
+}
+
+// Opens the index for the mutation info file, building it first if it does not
+// exist or is stale.
+std::unique_ptr<dredd::MutantIndex> GetIndex() {
+  // The mutation info file is memory-mapped, so that its contents can be hashed
+  // to check whether the index is up to date, and parsed in place if not.
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> json_buffer =
+      llvm::MemoryBuffer::getFile(mutation_info_file, /*IsText=*/false,
+                                  /*RequiresNullTerminator=*/false);
+  if (!json_buffer) {
+    llvm::errs() << "Error reading " << mutation_info_file << ": "
+                 << json_buffer.getError().message() << "\n";
+    return nullptr;
+  }
+  const llvm::StringRef json = json_buffer.get()->getBuffer();
+  const uint64_t info_file_size = json.size();
+  const uint64_t info_file_hash =
+      dredd::MutantIndex::HashInfoFileContents(json);
+  const std::string index_filename =
+      index_file.empty() ? mutation_info_file + ".index" : index_file;
+
+  std::unique_ptr<dredd::MutantIndex> result =
+      dredd::MutantIndex::Open(index_filename, info_file_size, info_file_hash);
+  if (result != nullptr) {
+    return result;
+  }
+
+  dredd::protobufs::MutationInfo mutation_info;
+  auto json_parse_status = google::protobuf::util::JsonStringToMessage(
+      {json.data(), json.size()}, &mutation_info);
+  if (!json_parse_status.ok()) {
+    llvm::errs() << "Error parsing JSON data from " << mutation_info_file
+                 << "\n";
+    return nullptr;
+  }
+  std::string error_message;
+  if (!dredd::MutantIndex::Write(mutation_info, info_file_size, info_file_hash,
+                                 index_filename, error_message)) {
+    llvm::errs() << "Error writing index to " << index_filename << ": "
+                 << error_message << "\n";
+    return nullptr;
+  }
+  result =
+      dredd::MutantIndex::Open(index_filename, info_file_size, info_file_hash);
+  if (result == nullptr) {
+    // This can happen if another process replaced the index, having built it
+    // from a different version of the mutation info file.
+    llvm::errs() << "Error opening freshly-written index " << index_filename
+                 << "; " << mutation_info_file
+                 << " may have changed while the index was being built\n";
+  }
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, const char** argv) {
+  llvm::sys::PrintStackTraceOnErrorSignal(argv[0]);
+  llvm::cl::HideUnrelatedOptions(info_category);
+  llvm::cl::ParseCommandLineOptions(
+      argc, argv,
+      "Answers queries about the mutants described by a mutation info file "
+      "generated by dredd.\n");
+
+  const std::unique_ptr<dredd::MutantIndex> index = GetIndex();
+  if (index == nullptr) {
+    return 1;
+  }
+
+  if (largest_mutant_id) {
+    llvm::outs() << index->GetLargestMutantId() << "\n";
+    return 0;
+  }
+
+  if (show_info_for_mutant.getNumOccurrences() > 0) {
+    return ShowInfoForMutant(*index, show_info_for_mutant);
+  }
+
+  llvm::outs() << "No action specified.\n";
+  return 1;
+}
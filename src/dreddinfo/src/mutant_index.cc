@@ -0,0 +1,373 @@
+// Copyright 2024 The Dredd Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dreddinfo/mutant_index.h"
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "libdredd/protobufs/dredd_protobufs.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+namespace dredd {
+
+namespace {
+
+// All integers in the index are stored in little-endian form, so that the
+// index does not depend on the layout that the compiler chooses for
+// MutantIndex::MutantRecord.
+//
+// Header layout:
+//   magic (8 bytes), version (4 bytes), number of files (4 bytes),
+//   mutation info file size (8 bytes), mutation info file content hash
+//   (8 bytes), largest mutant id (4 bytes), reserved (4 bytes).
+//
+// This is followed by one record for each mutant id from 0 to the largest
+// mutant id, then an (offset, length) pair for each filename, then the
+// characters of the filenames.
+const char* const kMagic = "DREDDIDX";
+const size_t kMagicSize = 8;
+const uint32_t kVersion = 2;
+const size_t kHeaderSize = 40;
+
+// Record layout:
+//   file index, node index, group index, instance index (4 bytes each),
+//   present flag, kind, action, reserved (1 byte each),
+//   three source ranges (16 bytes each).
+const size_t kRangesOffset = 20;
+const size_t kRecordSize = kRangesOffset + 3 * 16;
+
+const size_t kFileEntrySize = 16;
+
+void AppendUint32(std::string& buffer, uint32_t value) {
+  std::array<char, sizeof(uint32_t)> bytes{};
+  llvm::support::endian::write32le(bytes.data(), value);
+  buffer.append(bytes.data(), bytes.size());
+}
+
+void AppendUint64(std::string& buffer, uint64_t value) {
+  std::array<char, sizeof(uint64_t)> bytes{};
+  llvm::support::endian::write64le(bytes.data(), value);
+  buffer.append(bytes.data(), bytes.size());
+}
+
+void SetRange(const protobufs::SourceLocation& start,
+              const protobufs::SourceLocation& end,
+              MutantIndex::SourceRange& range) {
+  range.start_line = start.line();
+  range.start_column = start.column();
+  range.end_line = end.line();
+  range.end_column = end.column();
+}
+
+void AppendRecord(const MutantIndex::MutantRecord& record,
+                  std::string& buffer) {
+  AppendUint32(buffer, record.file_index);
+  AppendUint32(buffer, record.node_index);
+  AppendUint32(buffer, record.group_index);
+  AppendUint32(buffer, record.instance_index);
+  buffer.push_back(1);
+  buffer.push_back(static_cast<char>(record.kind));
+  buffer.push_back(static_cast<char>(record.action));
+  buffer.push_back(0);
+  for (const auto& range : record.ranges) {
+    AppendUint32(buffer, range.start_line);
+    AppendUint32(buffer, range.start_column);
+    AppendUint32(buffer, range.end_line);
+    AppendUint32(buffer, range.end_column);
+  }
+}
+
+// Collects a record for every mutant in |mutation_info|, indexed by mutant id.
+std::vector<std::optional<MutantIndex::MutantRecord>> CollectRecords(
+    const protobufs::MutationInfo& mutation_info) {
+  std::vector<std::optional<MutantIndex::MutantRecord>> result;
+  auto add_record = [&result](int mutant_id,
+                              const MutantIndex::MutantRecord& record) -> void {
+    assert(mutant_id >= 0 && "Mutant ids should be non-negative.");
+    const auto index = static_cast<size_t>(mutant_id);
+    if (index >= result.size()) {
+      result.resize(index + 1);
+    }
+    result[index] = record;
+  };
+
+  for (int file_index = 0; file_index < mutation_info.info_for_files_size();
+       file_index++) {
+    const auto& info_for_file = mutation_info.info_for_files(file_index);
+    for (int node_index = 0; node_index < info_for_file.mutation_tree_size();
+         node_index++) {
+      const auto& node = info_for_file.mutation_tree(node_index);
+      for (int group_index = 0; group_index < node.mutation_groups_size();
+           group_index++) {
+        const auto& group = node.mutation_groups(group_index);
+        MutantIndex::MutantRecord record{};
+        record.file_index = static_cast<uint32_t>(file_index);
+        record.node_index = static_cast<uint32_t>(node_index);
+        record.group_index = static_cast<uint32_t>(group_index);
+        switch (group.group_case()) {
+          case protobufs::MutationGroup::kRemoveStmt: {
+            const auto& remove_stmt = group.remove_stmt();
+            record.kind = MutantIndex::MutantKind::kRemoveStmt;
+            SetRange(remove_stmt.start(), remove_stmt.end(), record.ranges[0]);
+            add_record(remove_stmt.mutation_id(), record);
+            break;
+          }
+          case protobufs::MutationGroup::kReplaceExpr: {
+            const auto& replace_expr = group.replace_expr();
+            record.kind = MutantIndex::MutantKind::kReplaceExpr;
+            SetRange(replace_expr.start(), replace_expr.end(),
+                     record.ranges[0]);
+            for (int instance_index = 0;
+                 instance_index < replace_expr.instances_size();
+                 instance_index++) {
+              const auto& instance = replace_expr.instances(instance_index);
+              record.instance_index = static_cast<uint32_t>(instance_index);
+              record.action = static_cast<uint8_t>(instance.action());
+              add_record(instance.mutation_id(), record);
+            }
+            break;
+          }
+          case protobufs::MutationGroup::kReplaceBinaryOperator: {
+            const auto& replace_binary_operator =
+                group.replace_binary_operator();
+            record.kind = MutantIndex::MutantKind::kReplaceBinaryOperator;
+            SetRange(replace_binary_operator.expr_start(),
+                     replace_binary_operator.expr_end(), record.ranges[0]);
+            SetRange(replace_binary_operator.lhs_start(),
+                     replace_binary_operator.lhs_end(), record.ranges[1]);
+            SetRange(replace_binary_operator.rhs_start(),
+                     replace_binary_operator.rhs_end(), record.ranges[2]);
+            for (int instance_index = 0;
+                 instance_index < replace_binary_operator.instances_size();
+                 instance_index++) {
+              const auto& instance =
+                  replace_binary_operator.instances(instance_index);
+              record.instance_index = static_cast<uint32_t>(instance_index);
+              record.action = static_cast<uint8_t>(instance.action());
+              add_record(instance.mutation_id(), record);
+            }
+            break;
+          }
+          case protobufs::MutationGroup::kReplaceUnaryOperator: {
+            const auto& replace_unary_operator = group.replace_unary_operator();
+            record.kind = MutantIndex::MutantKind::kReplaceUnaryOperator;
+            SetRange(replace_unary_operator.expr_start(),
+                     replace_unary_operator.expr_end(), record.ranges[0]);
+            SetRange(replace_unary_operator.operand_start(),
+                     replace_unary_operator.operand_end(), record.ranges[1]);
+            for (int instance_index = 0;
+                 instance_index < replace_unary_operator.instances_size();
+                 instance_index++) {
+              const auto& instance =
+                  replace_unary_operator.instances(instance_index);
+              record.instance_index = static_cast<uint32_t>(instance_index);
+              record.action = static_cast<uint8_t>(instance.action());
+              add_record(instance.mutation_id(), record);
+            }
+            break;
+          }
+          default:
+            assert(false && "Unknown mutation group.");
+            break;
+        }
+      }
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+uint64_t MutantIndex::HashInfoFileContents(llvm::StringRef contents) {
+  return llvm::xxh3_64bits(llvm::arrayRefFromStringRef(contents));
+}
+
+bool MutantIndex::Write(const protobufs::MutationInfo& mutation_info,
+                        uint64_t info_file_size, uint64_t info_file_hash,
+                        const std::string& index_filename,
+                        std::string& error_message) {
+  const std::vector<std::optional<MutantRecord>> records =
+      CollectRecords(mutation_info);
+  const auto num_files =
+      static_cast<uint32_t>(mutation_info.info_for_files_size());
+
+  std::string buffer;
+  buffer.append(kMagic, kMagicSize);
+  AppendUint32(buffer, kVersion);
+  AppendUint32(buffer, num_files);
+  AppendUint64(buffer, info_file_size);
+  AppendUint64(buffer, info_file_hash);
+  AppendUint32(buffer, static_cast<uint32_t>(records.size()) - 1);
+  AppendUint32(buffer, 0);
+  assert(buffer.size() == kHeaderSize && "Unexpected header size.");
+
+  for (const auto& record : records) {
+    if (record.has_value()) {
+      AppendRecord(record.value(), buffer);
+    } else {
+      // A gap in the mutant ids: the present flag, like everything else in the
+      // record, is zero.
+      buffer.append(kRecordSize, 0);
+    }
+  }
+
+  uint64_t filename_offset =
+      buffer.size() + static_cast<uint64_t>(num_files) * kFileEntrySize;
+  for (const auto& info_for_file : mutation_info.info_for_files()) {
+    AppendUint64(buffer, filename_offset);
+    AppendUint64(buffer, info_for_file.filename().size());
+    filename_offset += info_for_file.filename().size();
+  }
+  for (const auto& info_for_file : mutation_info.info_for_files()) {
+    buffer.append(info_for_file.filename());
+  }
+
+  // Another process may be reading (and have memory-mapped) an existing index,
+  // or be building the index concurrently. The index is therefore written to a
+  // uniquely-named temporary file alongside it, which is then renamed into
+  // place, so that readers only ever see a complete index.
+  int temp_fd = -1;
+  llvm::SmallString<128> temp_filename;
+  if (const std::error_code error_code = llvm::sys::fs::createUniqueFile(
+          index_filename + "-%%%%%%%%.tmp", temp_fd, temp_filename)) {
+    error_message = error_code.message();
+    return false;
+  }
+  {
+    llvm::raw_fd_ostream index_file(temp_fd, /*shouldClose=*/true);
+    index_file << buffer;
+    index_file.close();
+    if (index_file.has_error()) {
+      error_message = index_file.error().message();
+      index_file.clear_error();
+      llvm::sys::fs::remove(temp_filename);
+      return false;
+    }
+  }
+  if (const std::error_code error_code =
+          llvm::sys::fs::rename(temp_filename, index_filename)) {
+    error_message = error_code.message();
+    llvm::sys::fs::remove(temp_filename);
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<MutantIndex> MutantIndex::Open(
+    const std::string& index_filename, uint64_t info_file_size,
+    uint64_t info_file_hash) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer =
+      llvm::MemoryBuffer::getFile(index_filename, /*IsText=*/false,
+                                  /*RequiresNullTerminator=*/false);
+  if (!buffer) {
+    return nullptr;
+  }
+  const llvm::StringRef contents = buffer.get()->getBuffer();
+  if (contents.size() < kHeaderSize ||
+      contents.substr(0, kMagicSize) != llvm::StringRef(kMagic, kMagicSize)) {
+    return nullptr;
+  }
+  const char* data = contents.data();
+  if (llvm::support::endian::read32le(data + 8) != kVersion ||
+      llvm::support::endian::read64le(data + 16) != info_file_size ||
+      llvm::support::endian::read64le(data + 24) != info_file_hash) {
+    return nullptr;
+  }
+  const uint32_t num_files = llvm::support::endian::read32le(data + 12);
+  const auto largest_mutant_id =
+      static_cast<int32_t>(llvm::support::endian::read32le(data + 32));
+  const uint64_t file_table_offset =
+      kHeaderSize +
+      static_cast<uint64_t>(static_cast<int64_t>(largest_mutant_id) + 1) *
+          kRecordSize;
+  if (largest_mutant_id < -1 ||
+      file_table_offset + static_cast<uint64_t>(num_files) * kFileEntrySize >
+          contents.size()) {
+    return nullptr;
+  }
+  for (uint32_t file_index = 0; file_index < num_files; file_index++) {
+    const char* entry = data + file_table_offset + file_index * kFileEntrySize;
+    const uint64_t offset = llvm::support::endian::read64le(entry);
+    const uint64_t length = llvm::support::endian::read64le(entry + 8);
+    if (offset > contents.size() || length > contents.size() - offset) {
+      return nullptr;
+    }
+  }
+  return std::unique_ptr<MutantIndex>(
+      new MutantIndex(std::move(buffer.get()), num_files, largest_mutant_id));
+}
+
+MutantIndex::MutantIndex(std::unique_ptr<llvm::MemoryBuffer> buffer,
+                         uint32_t num_files, int largest_mutant_id)
+    : buffer_(std::move(buffer)),
+      num_files_(num_files),
+      largest_mutant_id_(largest_mutant_id) {}
+
+std::optional<MutantIndex::MutantRecord> MutantIndex::GetMutant(
+    int mutant_id) const {
+  if (mutant_id < 0 || mutant_id > largest_mutant_id_) {
+    return std::nullopt;
+  }
+  const char* data = buffer_->getBufferStart() + kHeaderSize +
+                     static_cast<size_t>(mutant_id) * kRecordSize;
+  if (data[16] == 0) {
+    return std::nullopt;
+  }
+  MutantRecord result{};
+  result.file_index = llvm::support::endian::read32le(data);
+  result.node_index = llvm::support::endian::read32le(data + 4);
+  result.group_index = llvm::support::endian::read32le(data + 8);
+  result.instance_index = llvm::support::endian::read32le(data + 12);
+  result.kind = static_cast<MutantKind>(data[17]);
+  result.action = static_cast<uint8_t>(data[18]);
+  const char* range_data = data + kRangesOffset;
+  for (auto& range : result.ranges) {
+    range.start_line = llvm::support::endian::read32le(range_data);
+    range.start_column = llvm::support::endian::read32le(range_data + 4);
+    range.end_line = llvm::support::endian::read32le(range_data + 8);
+    range.end_column = llvm::support::endian::read32le(range_data + 12);
+    range_data += 16;
+  }
+  return result;
+}
+
+llvm::StringRef MutantIndex::GetFilename(uint32_t file_index) const {
+  assert(file_index < num_files_ && "File index out of bounds.");
+  const char* entry =
+      buffer_->getBufferStart() + kHeaderSize +
+      static_cast<size_t>(largest_mutant_id_ + 1) * kRecordSize +
+      static_cast<size_t>(file_index) * kFileEntrySize;
+  const uint64_t offset = llvm::support::endian::read64le(entry);
+  const uint64_t length = llvm::support::endian::read64le(entry + 8);
+  return buffer_->getBuffer().substr(offset, length);
+}
+
+}  // namespace dredd
@@ -0,0 +1,68 @@
+// Copyright 2024 The Dredd Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBDREDD_DREDD_DECLARATIONS_H
+#define LIBDREDD_DREDD_DECLARATIONS_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dredd {
+
+// The declarations, such as mutator functions, that will be added to the start
+// of a source file being mutated. Many mutations in a file give rise to
+// identical mutator functions, so each declaration is keyed on a short string
+// that determines its text, such as the signature of a mutator function. This
+// allows a mutation to check whether its declaration is already present before
+// going to the trouble of generating it.
+class DreddDeclarations {
+ public:
+  DreddDeclarations() = default;
+
+  DreddDeclarations(const DreddDeclarations&) = delete;
+
+  DreddDeclarations& operator=(const DreddDeclarations&) = delete;
+
+  DreddDeclarations(DreddDeclarations&&) = delete;
+
+  DreddDeclarations& operator=(DreddDeclarations&&) = delete;
+
+  // Yields nullptr if there is no declaration with the given key. Otherwise,
+  // yields the actions recorded alongside the declaration, which a mutation can
+  // use to reconstruct the mutation instances associated with the declaration
+  // without regenerating it.
+  [[nodiscard]] const std::vector<int>* Find(const std::string& key) const;
+
+  // Adds a declaration with the given key and text, along with the actions of
+  // the mutation instances that it provides. There must not already be a
+  // declaration with the given key.
+  void Add(const std::string& key, std::string text, std::vector<int> actions);
+
+  // Yields the text of every declaration, ordered by text so that the mutated
+  // file does not depend on the order in which mutations were applied.
+  [[nodiscard]] std::vector<const std::string*> GetSortedDeclarations() const;
+
+ private:
+  struct Declaration {
+    std::string text;
+    std::vector<int> actions;
+  };
+
+  std::unordered_map<std::string, Declaration> declarations_;
+};
+
+}  // namespace dredd
+
+#endif  // LIBDREDD_DREDD_DECLARATIONS_H
@@ -0,0 +1,72 @@
+// Copyright 2024 The Dredd Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBDREDD_EXECUTION_PROFILE_H
+#define LIBDREDD_EXECUTION_PROFILE_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dredd {
+
+// Execution counts for the code of each source file, as recorded by a
+// source-based coverage report.
+class ExecutionProfile {
+ public:
+  // The count of a segment applies from its line and column up to the start of
+  // the next segment of the file.
+  struct Segment {
+    unsigned line;
+    unsigned column;
+    // False if the segment is not part of a code region, e.g. because it lies
+    // between functions or is a gap between regions.
+    bool has_count;
+    uint64_t count;
+  };
+
+  // Parses the JSON produced by 'llvm-cov export'. Yields no value, and sets
+  // |error_message|, if the JSON is malformed or lacks per-file segments, e.g.
+  // because it was exported with '-summary-only'.
+  static std::optional<ExecutionProfile> ParseLlvmCovExport(
+      const std::string& json_text, std::string& error_message);
+
+  // Yields the segments of the given source file, sorted by position, or
+  // nullptr if the profile does not cover the file. As with LineRanges, a file
+  // is matched if its absolute path ends with a path in the profile, and it
+  // is an error, reported via |error_message|, for several paths to match.
+  [[nodiscard]] const std::vector<Segment>* GetSegmentsForFile(
+      const std::string& filename, std::string& error_message) const;
+
+  // Yields the execution count that |segments|, which must be sorted, give for
+  // the given position, or no value if the position is not in a code region.
+  [[nodiscard]] static std::optional<uint64_t> GetCount(
+      const std::vector<Segment>& segments, unsigned line, unsigned column);
+
+  [[nodiscard]] const std::vector<
+      std::pair<std::string, std::vector<Segment>>>&
+  GetSegmentsForFiles() const {
+    return segments_for_files_;
+  }
+
+ private:
+  // Pairs each file's path, as it appears in the report, with its segments.
+  std::vector<std::pair<std::string, std::vector<Segment>>> segments_for_files_;
+};
+
+}  // namespace dredd
+
+#endif  // LIBDREDD_EXECUTION_PROFILE_H
@@ -0,0 +1,88 @@
+// Copyright 2024 The Dredd Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBDREDD_LINE_RANGES_H
+#define LIBDREDD_LINE_RANGES_H
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dredd {
+
+// The lines of each source file that mutation should be restricted to, e.g.
+// because they have been changed by a pull request, or because they are
+// executed by a test suite.
+class LineRanges {
+ public:
+  // An inclusive range of lines, numbered from 1.
+  struct Range {
+    unsigned first_line;
+    unsigned last_line;
+  };
+
+  // Parses the output of 'git diff', e.g. with '-U0', yielding the lines that
+  // are added or changed in the new version of each file. Context lines, hunks
+  // that only delete lines, and deleted files contribute no lines. Yields no
+  // value, and sets |error_message|, if a hunk header is malformed or does not
+  // follow a file header, or if the lines of a hunk do not match the counts in
+  // its header.
+  static std::optional<LineRanges> ParseGitDiff(const std::string& diff_text,
+                                                std::string& error_message);
+
+  // Parses the JSON produced by 'llvm-cov export', yielding the lines of each
+  // source file that overlap a code region with a non-zero execution count.
+  // Yields no value, and sets |error_message|, if the JSON is malformed or
+  // lacks per-file segments, e.g. because it was exported with
+  // '-summary-only'.
+  static std::optional<LineRanges> ParseLlvmCovExport(
+      const std::string& json_text, std::string& error_message);
+
+  // Parses a '.gcov' file produced by gcov, yielding the executed lines of the
+  // source file that it describes. Leading '.' and '..' components of the
+  // source path are dropped, since the path is usually relative to the build
+  // directory. Yields no value, and sets |error_message|, if the file does not
+  // name its source file.
+  static std::optional<LineRanges> ParseGcov(const std::string& gcov_text,
+                                             std::string& error_message);
+
+  // Adds the lines of |other| to these lines.
+  void Add(const LineRanges& other);
+
+  // Yields the ranges of lines for the given source file, sorted and
+  // non-overlapping, or nullptr if the file has no such lines. Paths in a diff
+  // or coverage report may be relative, e.g. to the root of a repository, so a
+  // file is matched if its absolute path ends with such a path. If several
+  // paths match the file, nullptr is yielded and |error_message| is set.
+  [[nodiscard]] const std::vector<Range>* GetRangesForFile(
+      const std::string& filename, std::string& error_message) const;
+
+  // Determines whether any line from |first_line| to |last_line| inclusive is
+  // in |ranges|, which must be sorted and non-overlapping.
+  [[nodiscard]] static bool Overlaps(const std::vector<Range>& ranges,
+                                     unsigned first_line, unsigned last_line);
+
+ private:
+  // Sorts and merges the ranges of each file, discarding files without ranges.
+  void Normalise();
+
+  // Pairs each file's path, as it appears in the diff or coverage report, with
+  // its lines.
+  std::vector<std::pair<std::string, std::vector<Range>>> ranges_for_files_;
+};
+
+}  // namespace dredd
+
+#endif  // LIBDREDD_LINE_RANGES_H
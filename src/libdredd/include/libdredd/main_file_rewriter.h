@@ -0,0 +1,254 @@
+// Copyright 2024 The Dredd Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBDREDD_MAIN_FILE_REWRITER_H
+#define LIBDREDD_MAIN_FILE_REWRITER_H
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "clang/Basic/LangOptions.h"
+#include "clang/Basic/SourceLocation.h"
+#include "clang/Basic/SourceManager.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace dredd {
+
+// Records edits to the main source file and applies them in a single pass.
+//
+// This offers the subset of the clang::Rewriter interface that Dredd uses, with
+// the same semantics for the order of edits at a given location: text inserted
+// before a location precedes text that was previously inserted before it, text
+// inserted after a location follows text that was previously inserted after
+// it, and replacement text follows all insertions at its location. Unlike
+// clang::Rewriter, which maintains a rope of the rewritten text that is updated
+// on every edit, edits are simply recorded, and are sorted by location only
+// when the rewritten text is required.
+//
+// The text replaced by an edit must not be the target of any other edit that
+// applies to the same version of the text. An edit that would break this rule
+// is rejected, as is a copied region (see below) that would overlap another
+// copied region or split an existing edit.
+//
+// In addition, a range of the main file can be replaced by several copies of
+// the range, e.g. the cases of a switch statement. Edits can be made to an
+// alternative version of the text, rather than to the main file itself, and
+// each copy of the range has the edits to one alternative applied, alongside
+// the edits to the main file.
+class MainFileRewriter {
+ public:
+  struct SwitchCase {
+    // The case labels are the consecutive integers starting at |first_label|.
+    int first_label;
+    int num_labels;
+    // The alternative whose edits are applied to the copy of the text.
+    int alternative;
+  };
+
+  MainFileRewriter() = default;
+
+  MainFileRewriter(const clang::SourceManager& source_manager,
+                   const clang::LangOptions& lang_options);
+
+  MainFileRewriter(const MainFileRewriter&) = delete;
+
+  MainFileRewriter& operator=(const MainFileRewriter&) = delete;
+
+  MainFileRewriter(MainFileRewriter&&) = delete;
+
+  MainFileRewriter& operator=(MainFileRewriter&&) = delete;
+
+  void SetSourceManager(const clang::SourceManager& source_manager,
+                        const clang::LangOptions& lang_options);
+
+  // As with clang::Rewriter, the following return true if the edit could not
+  // be made, and false otherwise. An edit cannot be made if the given location
+  // is not in the main file, or if it conflicts with an earlier edit as
+  // described above. A rejected edit has no effect.
+
+  bool InsertTextBefore(clang::SourceLocation location,
+                        const std::string& text);
+
+  bool InsertTextAfterToken(clang::SourceLocation location,
+                            const std::string& text);
+
+  bool ReplaceText(clang::SourceLocation start, unsigned length,
+                   const std::string& text);
+
+  // Replaces the text covered by a token range.
+  bool ReplaceText(clang::SourceRange range, const std::string& text);
+
+  // Until EndAlternative is invoked, subsequent edits are made to a new
+  // alternative version of the text, which is returned.
+  int StartAlternative();
+
+  // Subsequent edits are made to the main file.
+  void EndAlternative();
+
+  // Replaces the text covered by the token range |range| with a switch
+  // statement on |selector|. Each case in |cases| is followed by a copy of the
+  // text in which the edits to the case's alternative, as well as any edits to
+  // the main file, are applied, and then |suffix|. The default case is
+  // followed by a copy in which only the edits to the main file are applied,
+  // and then |suffix|. Insertions to the main file at the very start and end
+  // of the range are placed before and after the switch statement. Returns
+  // true if the range is not in the main file, overlaps another copied region
+  // or splits an edit, and false otherwise.
+  bool ReplaceWithSwitch(clang::SourceRange range, const std::string& selector,
+                         const std::vector<SwitchCase>& cases,
+                         const std::string& suffix);
+
+  // Replaces the text covered by the token range |range| with |prefix|, then a
+  // copy of the text in which only the edits to the main file are applied,
+  // then |infix|, then a copy in which the edits to |alternative| are also
+  // applied, then |suffix|. Insertions to the main file at the very start and
+  // end of the range are treated as for ReplaceWithSwitch. Returns true under
+  // the same conditions as ReplaceWithSwitch, and false otherwise.
+  bool ReplaceWithTwoCopies(clang::SourceRange range, const std::string& prefix,
+                            const std::string& infix, int alternative,
+                            const std::string& suffix);
+
+  // Yields the text of the main file with all edits applied.
+  [[nodiscard]] std::string GetRewrittenText();
+
+  // Overwrites the main file with its rewritten text. Returns true if an error
+  // occurred, as with clang::Rewriter::overwriteChangedFiles.
+  bool OverwriteMainFile();
+
+ private:
+  struct Edit {
+    unsigned offset;
+    // The number of characters of the original text that the edit replaces,
+    // which is 0 for an insertion.
+    unsigned length;
+    // Determines the order of edits at the same offset.
+    int64_t order;
+    // The alternative to which the edit was made, or 0 if the edit was made
+    // to the main file.
+    int alternative;
+    std::string text;
+  };
+
+  // A copy of the text of a region, preceded by some fixed text.
+  struct RegionCopy {
+    std::string preceding_text;
+    int alternative;
+  };
+
+  // A region of the main file that is replaced by several copies of its text.
+  struct CopiedRegion {
+    unsigned begin_offset;
+    unsigned end_offset;
+    std::vector<RegionCopy> copies;
+    // Text that follows the last copy.
+    std::string trailing_text;
+  };
+
+  // The ranges of the original text affected by a set of edits. An insertion
+  // affects an empty range. Two ranges conflict if the interior of one
+  // intersects the other; in particular, an insertion at either end of a
+  // replaced range does not conflict with the replacement.
+  class EditedRanges {
+   public:
+    // Returns true if the range [begin, end) conflicts with a range in the
+    // set.
+    [[nodiscard]] bool Conflicts(unsigned begin, unsigned end) const;
+
+    // Adds the range [begin, end) to the set. Nonempty ranges that conflict
+    // are merged.
+    void Add(unsigned begin, unsigned end);
+
+   private:
+    // Maps the start of each nonempty range to its end.
+    std::map<unsigned, unsigned> ranges_;
+    // The offsets of empty ranges.
+    std::set<unsigned> insertion_offsets_;
+  };
+
+  // Records that an edit affecting the range [begin, end) is to be made to the
+  // current alternative. Returns true, and records nothing, if the edit would
+  // conflict with an edit to the same version of the text or would split a
+  // copied region.
+  bool RecordEditedRange(unsigned begin, unsigned end);
+
+  // Records that the text covered by the token range |range| should be
+  // replaced as described by |copies| and |trailing_text|. Returns true if the
+  // range is not in the main file, or if the region would overlap another
+  // copied region or split an edit.
+  bool AddCopiedRegion(clang::SourceRange range, std::vector<RegionCopy> copies,
+                       std::string trailing_text);
+
+  // Sets |offset| to the offset of |location| in the main file. Returns false
+  // if |location| is not a file location in the main file.
+  bool GetMainFileOffset(clang::SourceLocation location,
+                         unsigned& offset) const;
+
+  void WriteRewrittenText(llvm::raw_ostream& stream);
+
+  // Writes the text of |region|, applying those of |region_edits| that were
+  // made to the main file or to |alternative|.
+  static void WriteRegionCopy(
+      llvm::StringRef original_text, const CopiedRegion& region,
+      const std::vector<const Edit*>& region_edits, int alternative,
+      llvm::raw_ostream& stream);
+
+  const clang::SourceManager* source_manager_ = nullptr;
+
+  const clang::LangOptions* lang_options_ = nullptr;
+
+  std::vector<Edit> edits_;
+
+  // Insertions before a location are given decreasing negative orders, and
+  // insertions after a location are given increasing positive orders.
+  // Replacements are given the largest possible order.
+  int64_t last_insert_before_order_ = 0;
+
+  int64_t last_insert_after_order_ = 0;
+
+  // Records whether |edits_| is known to be sorted.
+  bool edits_sorted_ = true;
+
+  // The alternative to which edits are currently made, or 0 if edits are
+  // currently made to the main file.
+  int current_alternative_ = 0;
+
+  int last_alternative_ = 0;
+
+  // The ranges affected by the edits to each alternative, indexed by
+  // alternative, so that the first element records the edits to the main file.
+  std::vector<EditedRanges> edited_ranges_ = std::vector<EditedRanges>(1);
+
+  // The ranges affected by the edits to all alternatives. An edit to the main
+  // file appears in every copy of a region, so must not conflict with an edit
+  // to any alternative.
+  EditedRanges alternative_edited_ranges_;
+
+  // The ranges covered by copied regions, and the offsets at which they begin
+  // and end, which an edit must not straddle.
+  EditedRanges copied_region_ranges_;
+
+  EditedRanges copied_region_boundaries_;
+
+  // Regions of the main file that are to be replaced by copies of their text,
+  // which must not overlap.
+  std::vector<CopiedRegion> copied_regions_;
+};
+
+}  // namespace dredd
+
+#endif  // LIBDREDD_MAIN_FILE_REWRITER_H
@@ -16,11 +16,11 @@
 #define LIBDREDD_MUTATION_H
 
 #include <string>
-#include <unordered_set>
 
 #include "clang/AST/ASTContext.h"
 #include "clang/Lex/Preprocessor.h"
-#include "clang/Rewrite/Core/Rewriter.h"
+#include "libdredd/dredd_declarations.h"
+#include "libdredd/main_file_rewriter.h"
 #include "libdredd/options.h"
 #include "libdredd/protobufs/dredd_protobufs.h"
 
@@ -46,14 +46,17 @@ class Mutation {
   // a local mutation id with respect to the particular source file being
   // mutated.
   //
-  // The |dredd_declarations| argument provides a set of declarations that will
-  // be added to the start of the source file being mutated. This allows
-  // avoiding redundant repeat declarations.
+  // The |dredd_declarations| argument provides the declarations that will be
+  // added to the start of the source file being mutated. This allows avoiding
+  // redundant repeat declarations.
   virtual protobufs::MutationGroup Apply(
       clang::ASTContext& ast_context, const clang::Preprocessor& preprocessor,
       const Options& options, int first_mutation_id_in_file, int& mutation_id,
-      clang::Rewriter& rewriter,
-      std::unordered_set<std::string>& dredd_declarations) const = 0;
+      MainFileRewriter& rewriter,
+      DreddDeclarations& dredd_declarations) const = 0;
+
+  // Yields the kind of mutation group that applying the mutation produces.
+  [[nodiscard]] virtual protobufs::MutationGroup::GroupCase GetKind() const = 0;
 };
 
 }  // namespace dredd
@@ -16,13 +16,13 @@
 #define LIBDREDD_MUTATION_REMOVE_STMT_H
 
 #include <string>
-#include <unordered_set>
 
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Stmt.h"
 #include "clang/Basic/SourceLocation.h"
 #include "clang/Lex/Preprocessor.h"
-#include "clang/Rewrite/Core/Rewriter.h"
+#include "libdredd/dredd_declarations.h"
+#include "libdredd/main_file_rewriter.h"
 #include "libdredd/mutation.h"
 #include "libdredd/options.h"
 #include "libdredd/protobufs/dredd_protobufs.h"
@@ -32,15 +32,17 @@ namespace dredd {
 
 class MutationRemoveStmt : public Mutation {
  public:
-  MutationRemoveStmt(const clang::Stmt& stmt,
-                     const clang::Preprocessor& preprocessor,
-                     const clang::ASTContext& ast_context);
+  explicit MutationRemoveStmt(const clang::Stmt& stmt);
 
   protobufs::MutationGroup Apply(
       clang::ASTContext& ast_context, const clang::Preprocessor& preprocessor,
       const Options& options, int first_mutation_id_in_file, int& mutation_id,
-      clang::Rewriter& rewriter,
-      std::unordered_set<std::string>& dredd_declarations) const override;
+      MainFileRewriter& rewriter,
+      DreddDeclarations& dredd_declarations) const override;
+
+  [[nodiscard]] protobufs::MutationGroup::GroupCase GetKind() const override {
+    return protobufs::MutationGroup::kRemoveStmt;
+  }
 
  private:
   // Helper method to determine whether the token immediately following the
@@ -52,7 +54,6 @@ class MutationRemoveStmt : public Mutation {
                               const clang::Preprocessor& preprocessor);
 
   const clang::Stmt* stmt_;
-  InfoForSourceRange info_for_source_range_;
 };
 
 }  // namespace dredd
@@ -17,14 +17,14 @@
 
 #include <sstream>
 #include <string>
-#include <unordered_set>
 #include <vector>
 
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Expr.h"
 #include "clang/AST/OperationKinds.h"
 #include "clang/Lex/Preprocessor.h"
-#include "clang/Rewrite/Core/Rewriter.h"
+#include "libdredd/dredd_declarations.h"
+#include "libdredd/main_file_rewriter.h"
 #include "libdredd/mutation.h"
 #include "libdredd/options.h"
 #include "libdredd/protobufs/dredd_protobufs.h"
@@ -34,22 +34,47 @@ namespace dredd {
 
 class MutationReplaceBinaryOperator : public Mutation {
  public:
+  // |expr_evaluation_cache| is used to evaluate expressions when the mutation
+  // is applied, and must outlive the mutation.
   MutationReplaceBinaryOperator(const clang::BinaryOperator& binary_operator,
-                                const clang::Preprocessor& preprocessor,
-                                const clang::ASTContext& ast_context);
+                                ExprEvaluationCache& expr_evaluation_cache);
 
   protobufs::MutationGroup Apply(
       clang::ASTContext& ast_context, const clang::Preprocessor& preprocessor,
       const Options& options, int first_mutation_id_in_file, int& mutation_id,
-      clang::Rewriter& rewriter,
-      std::unordered_set<std::string>& dredd_declarations) const override;
+      MainFileRewriter& rewriter,
+      DreddDeclarations& dredd_declarations) const override;
+
+  [[nodiscard]] protobufs::MutationGroup::GroupCase GetKind() const override {
+    return protobufs::MutationGroup::kReplaceBinaryOperator;
+  }
 
  private:
-  std::string GenerateMutatorFunction(
-      clang::ASTContext& ast_context, const std::string& function_name,
+  // Yields the signature of the mutator function, without a trailing body.
+  // Mutator functions are deduplicated on their signatures, which determine
+  // their bodies.
+  [[nodiscard]] std::string GetMutatorFunctionSignature(
+      const clang::ASTContext& ast_context, const std::string& function_name,
       const std::string& result_type, const std::string& lhs_type,
-      const std::string& rhs_type, bool optimise_mutations,
-      bool only_track_mutant_coverage, int& mutation_id,
+      const std::string& rhs_type) const;
+
+  std::string GenerateMutatorFunction(
+      clang::ASTContext& ast_context, const std::string& signature,
+      bool optimise_mutations, bool only_track_mutant_coverage,
+      int& mutation_id,
+      protobufs::MutationReplaceBinaryOperator& protobuf_message) const;
+
+  // Generates a mutator function for weak mutation: the function evaluates the
+  // original expression and the expression associated with every mutant, and
+  // records each mutant whose value differs from the original value, i.e. that
+  // infects the program state, before returning the original value. If
+  // |split_stream| is true, the function instead applies the first enabled
+  // mutant among those that infect the program state, so that a mutant is only
+  // queried, and thus only split off, when it infects the program state.
+  std::string GenerateWeakMutatorFunction(
+      clang::ASTContext& ast_context, const std::string& signature,
+      const std::string& result_type, bool optimise_mutations,
+      bool split_stream, int& mutation_id,
       protobufs::MutationReplaceBinaryOperator& protobuf_message) const;
 
   void ReplaceOperator(const std::string& lhs_type, const std::string& rhs_type,
@@ -58,7 +83,7 @@ class MutationReplaceBinaryOperator : public Mutation {
                        const clang::Preprocessor& preprocessor,
                        int first_mutation_id_in_file, int mutation_id,
                        bool show_ast_node_types,
-                       clang::Rewriter& rewriter) const;
+                       MainFileRewriter& rewriter) const;
 
   std::string GetFunctionName(bool optimise_mutations,
                               clang::ASTContext& ast_context) const;
@@ -114,8 +139,8 @@ class MutationReplaceBinaryOperator : public Mutation {
       const std::string& new_function_prefix, const std::string& result_type,
       const std::string& lhs_type, const std::string& rhs_type,
       bool only_track_mutant_coverage, int first_mutation_id_in_file,
-      int& mutation_id, clang::Rewriter& rewriter,
-      std::unordered_set<std::string>& dredd_declarations,
+      int& mutation_id, MainFileRewriter& rewriter,
+      DreddDeclarations& dredd_declarations,
       protobufs::MutationReplaceBinaryOperator& protobuf_message) const;
 
   static void AddMutationInstance(
@@ -132,9 +157,7 @@ class MutationReplaceBinaryOperator : public Mutation {
       clang::BinaryOperatorKind operator_kind);
 
   const clang::BinaryOperator* binary_operator_;
-  InfoForSourceRange info_for_overall_expr_;
-  InfoForSourceRange info_for_lhs_;
-  InfoForSourceRange info_for_rhs_;
+  ExprEvaluationCache* expr_evaluation_cache_;
 };
 
 }  // namespace dredd
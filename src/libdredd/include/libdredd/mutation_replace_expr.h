@@ -17,13 +17,13 @@
 
 #include <sstream>
 #include <string>
-#include <unordered_set>
 
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Expr.h"
 #include "clang/AST/OperationKinds.h"
 #include "clang/Lex/Preprocessor.h"
-#include "clang/Rewrite/Core/Rewriter.h"
+#include "libdredd/dredd_declarations.h"
+#include "libdredd/main_file_rewriter.h"
 #include "libdredd/mutation.h"
 #include "libdredd/options.h"
 #include "libdredd/protobufs/dredd_protobufs.h"
@@ -33,15 +33,34 @@ namespace dredd {
 
 class MutationReplaceExpr : public Mutation {
  public:
-  MutationReplaceExpr(const clang::Expr& expr,
-                      const clang::Preprocessor& preprocessor,
-                      const clang::ASTContext& ast_context);
+  // |binary_operator_parent| should be the parent of |expr| if that parent is a
+  // binary operator, and null otherwise. |initializer_list_implicit_cast|
+  // should be the implicit cast applied to |expr|, or to the parenthesized
+  // expression that encloses it, as an element of an initializer list, and
+  // null if there is no such cast. These are known to the caller from its
+  // traversal of the AST, and are captured here so that parents never need to
+  // be looked up in the AST context, which would require a map of all parents
+  // to be built.
+  //
+  // If |expr| is an l-value, it must satisfy CanMutateLValue.
+  //
+  // |expr_evaluation_cache| is used to evaluate expressions when the mutation
+  // is applied, and must outlive the mutation.
+  MutationReplaceExpr(
+      const clang::Expr& expr,
+      const clang::BinaryOperator* binary_operator_parent,
+      const clang::ImplicitCastExpr* initializer_list_implicit_cast,
+      ExprEvaluationCache& expr_evaluation_cache);
 
   protobufs::MutationGroup Apply(
       clang::ASTContext& ast_context, const clang::Preprocessor& preprocessor,
       const Options& options, int first_mutation_id_in_file, int& mutation_id,
-      clang::Rewriter& rewriter,
-      std::unordered_set<std::string>& dredd_declarations) const override;
+      MainFileRewriter& rewriter,
+      DreddDeclarations& dredd_declarations) const override;
+
+  [[nodiscard]] protobufs::MutationGroup::GroupCase GetKind() const override {
+    return protobufs::MutationGroup::kReplaceExpr;
+  }
 
   static void ApplyCppTypeModifiers(const clang::Expr& expr, std::string& type);
 
@@ -49,11 +68,16 @@ class MutationReplaceExpr : public Mutation {
 
   // Check if an expression is equivalent to a constant.
   static bool ExprIsEquivalentToInt(const clang::Expr& expr, int constant,
-                                    const clang::ASTContext& ast_context);
-  static bool ExprIsEquivalentToFloat(const clang::Expr& expr, double constant,
-                                      const clang::ASTContext& ast_context);
-  static bool ExprIsEquivalentToBool(const clang::Expr& expr, bool constant,
-                                     const clang::ASTContext& ast_context);
+                                    const clang::ASTContext& ast_context,
+                                    ExprEvaluationCache& expr_evaluation_cache);
+  static bool ExprIsEquivalentToFloat(
+      const clang::Expr& expr, double constant,
+      const clang::ASTContext& ast_context,
+      ExprEvaluationCache& expr_evaluation_cache);
+  static bool ExprIsEquivalentToBool(
+      const clang::Expr& expr, bool constant,
+      const clang::ASTContext& ast_context,
+      ExprEvaluationCache& expr_evaluation_cache);
 
   // L-value expressions can be mutated via insertion of the ++ and -- prefix
   // operators. This is only done when an l-value is about to be implicitly
@@ -62,9 +86,11 @@ class MutationReplaceExpr : public Mutation {
   // of l-values for C++.
   //
   // This helper function determines when an l-value expression is suitable for
-  // such a mutation.
-  static bool CanMutateLValue(clang::ASTContext& ast_context,
-                              const clang::Expr& expr);
+  // such a mutation. |implicit_cast_parent| should be the parent of |expr| if
+  // that parent is an implicit cast, and null otherwise.
+  static bool CanMutateLValue(
+      const clang::Expr& expr,
+      const clang::ImplicitCastExpr* implicit_cast_parent);
 
  private:
   [[nodiscard]] bool IsRedundantOperatorInsertion(
@@ -78,7 +104,7 @@ class MutationReplaceExpr : public Mutation {
       const clang::ASTContext& ast_context) const;
 
   [[nodiscard]] bool IsRedundantOperatorInsertionBeforeLogicalOperatorArgument(
-      clang::ASTContext& ast_context) const;
+      const clang::ASTContext& ast_context) const;
 
   [[nodiscard]] bool IsRedundantUnaryLogicalNotInsertion(
       const clang::ASTContext& ast_context) const;
@@ -138,12 +164,30 @@ class MutationReplaceExpr : public Mutation {
       std::stringstream& new_function, int& mutation_id_offset,
       protobufs::MutationReplaceExpr& protobuf_message) const;
 
+  // Yields the signature of the mutator function, without a trailing body.
+  // Mutator functions are deduplicated on their signatures, which determine
+  // their bodies.
+  [[nodiscard]] std::string GetMutatorFunctionSignature(
+      const clang::ASTContext& ast_context, const std::string& function_name,
+      const std::string& result_type, const std::string& input_type) const;
+
   std::string GenerateMutatorFunction(
-      clang::ASTContext& ast_context, const std::string& function_name,
-      const std::string& result_type, const std::string& input_type,
+      clang::ASTContext& ast_context, const std::string& signature,
       bool optimise_mutations, bool only_track_mutant_coverage,
       int& mutation_id, protobufs::MutationReplaceExpr& protobuf_message) const;
 
+  // Generates a mutator function for weak mutation: the function evaluates the
+  // expression once, compares its value with the value associated with every
+  // mutant, and records each mutant whose value differs, i.e. that infects the
+  // program state, before returning the original value. If |split_stream| is
+  // true, the function instead applies the first enabled mutant among those
+  // that infect the program state, as for binary operators.
+  std::string GenerateWeakMutatorFunction(
+      clang::ASTContext& ast_context, const std::string& signature,
+      const std::string& result_type, bool optimise_mutations,
+      bool split_stream, int& mutation_id,
+      protobufs::MutationReplaceExpr& protobuf_message) const;
+
   [[nodiscard]] std::string GetFunctionName(
       bool optimise_mutations, clang::ASTContext& ast_context) const;
 
@@ -153,23 +197,17 @@ class MutationReplaceExpr : public Mutation {
                                    clang::ASTContext& ast_context,
                                    const clang::Preprocessor& preprocessor,
                                    bool show_ast_node_types,
-                                   clang::Rewriter& rewriter) const;
+                                   MainFileRewriter& rewriter) const;
 
   static void AddMutationInstance(
       int mutation_id_base, protobufs::MutationReplaceExprAction action,
       int& mutation_id_offset,
       protobufs::MutationReplaceExpr& protobuf_message);
 
-  // Determines whether the given expression is the child of both an implicit
-  // cast expression and an initializer list expression. In the presence of
-  // templates, such an expression may have more than two parents, because it
-  // may have the initializer list for the non-instantiated template as a
-  // parent, as well as the initializer list for the instantiated template.
-  static bool IsSubjectToImplicitCastInInitializerList(
-      const clang::Expr& expr, clang::ASTContext& ast_context);
-
   const clang::Expr* expr_;
-  InfoForSourceRange info_for_source_range_;
+  const clang::BinaryOperator* binary_operator_parent_;
+  const clang::ImplicitCastExpr* initializer_list_implicit_cast_;
+  ExprEvaluationCache* expr_evaluation_cache_;
 };
 
 }  // namespace dredd
@@ -17,13 +17,13 @@
 
 #include <sstream>
 #include <string>
-#include <unordered_set>
 
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Expr.h"
 #include "clang/AST/OperationKinds.h"
 #include "clang/Lex/Preprocessor.h"
-#include "clang/Rewrite/Core/Rewriter.h"
+#include "libdredd/dredd_declarations.h"
+#include "libdredd/main_file_rewriter.h"
 #include "libdredd/mutation.h"
 #include "libdredd/options.h"
 #include "libdredd/protobufs/dredd_protobufs.h"
@@ -33,20 +33,31 @@ namespace dredd {
 
 class MutationReplaceUnaryOperator : public Mutation {
  public:
+  // |expr_evaluation_cache| is used to evaluate expressions when the mutation
+  // is applied, and must outlive the mutation.
   MutationReplaceUnaryOperator(const clang::UnaryOperator& unary_operator,
-                               const clang::Preprocessor& preprocessor,
-                               const clang::ASTContext& ast_context);
+                               ExprEvaluationCache& expr_evaluation_cache);
 
   protobufs::MutationGroup Apply(
       clang::ASTContext& ast_context, const clang::Preprocessor& preprocessor,
       const Options& options, int first_mutation_id_in_file, int& mutation_id,
-      clang::Rewriter& rewriter,
-      std::unordered_set<std::string>& dredd_declarations) const override;
+      MainFileRewriter& rewriter,
+      DreddDeclarations& dredd_declarations) const override;
+
+  [[nodiscard]] protobufs::MutationGroup::GroupCase GetKind() const override {
+    return protobufs::MutationGroup::kReplaceUnaryOperator;
+  }
 
  private:
+  // Yields the signature of the mutator function, without a trailing body.
+  // Mutator functions are deduplicated on their signatures, which determine
+  // their bodies.
+  [[nodiscard]] std::string GetMutatorFunctionSignature(
+      const clang::ASTContext& ast_context, const std::string& function_name,
+      const std::string& result_type, const std::string& input_type) const;
+
   std::string GenerateMutatorFunction(
-      clang::ASTContext& ast_context, const std::string& function_name,
-      const std::string& result_type, const std::string& input_type,
+      clang::ASTContext& ast_context, const std::string& signature,
       bool optimise_mutations, bool only_track_mutant_coverage,
       int& mutation_id,
       protobufs::MutationReplaceUnaryOperator& protobuf_message) const;
@@ -87,8 +98,7 @@ class MutationReplaceUnaryOperator : public Mutation {
       clang::UnaryOperatorKind operator_kind);
 
   const clang::UnaryOperator* unary_operator_;
-  InfoForSourceRange info_for_overall_expr_;
-  InfoForSourceRange info_for_sub_expr_;
+  ExprEvaluationCache* expr_evaluation_cache_;
 };
 
 }  // namespace dredd
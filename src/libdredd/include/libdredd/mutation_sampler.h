@@ -0,0 +1,66 @@
+// Copyright 2024 The Dredd Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBDREDD_MUTATION_SAMPLER_H
+#define LIBDREDD_MUTATION_SAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "clang/AST/DeclBase.h"
+#include "libdredd/mutation.h"
+#include "libdredd/protobufs/dredd_protobufs.h"
+
+namespace dredd {
+
+// Selects a deterministic sample of the mutations found in a source file, so
+// that only the selected mutations are instrumented. Mutations are grouped into
+// strata according to their kind and the function in which they occur, and
+// each stratum is sampled at the same rate, so that the sample is not biased
+// towards the kinds of mutation and the functions that dominate the file.
+class MutationSampler {
+ public:
+  // Records that |mutation| occurs in |enclosing_function|, which is null if
+  // the mutation does not occur in a function.
+  void AddMutation(const Mutation& mutation,
+                   const clang::Decl* enclosing_function);
+
+  // Selects a proportion |sample_rate| of the recorded mutations, capped at
+  // |max_mutations| if that is positive. The selection is determined by
+  // |seed| and |filename|, and by the order in which mutations were recorded.
+  [[nodiscard]] std::unordered_set<const Mutation*> Select(
+      double sample_rate, int max_mutations, uint64_t seed,
+      const std::string& filename) const;
+
+ private:
+  // The strata, in the order in which they were first encountered.
+  std::vector<std::vector<const Mutation*>> strata_;
+
+  // Maps the kind and enclosing function of a mutation to the index of its
+  // stratum.
+  std::map<std::pair<protobufs::MutationGroup::GroupCase, const clang::Decl*>,
+           size_t>
+      stratum_indices_;
+
+  size_t num_mutations_ = 0;
+};
+
+}  // namespace dredd
+
+#endif  // LIBDREDD_MUTATION_SAMPLER_H
@@ -15,18 +15,112 @@
 #ifndef LIBDREDD_OPTIONS_H
 #define LIBDREDD_OPTIONS_H
 
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+#include "libdredd/execution_profile.h"
+#include "libdredd/line_ranges.h"
+
 namespace dredd {
 
 class Options {
  public:
-  Options(bool optimise_mutations, bool dump_asts,
-          bool only_track_mutant_coverage, bool show_ast_node_types)
-      : optimise_mutations_(optimise_mutations),
-        dump_asts_(dump_asts),
-        only_track_mutant_coverage_(only_track_mutant_coverage),
-        show_ast_node_types_(show_ast_node_types) {}
+  // Options are created with their default values and changed via the
+  // setters below, each of which returns the options so that calls can be
+  // chained, e.g. Options().SetDumpAsts(true).SetShowAstNodeTypes(true).
+  Options() = default;
+
+  Options& SetOptimiseMutations(bool optimise_mutations) {
+    optimise_mutations_ = optimise_mutations;
+    return *this;
+  }
+
+  Options& SetDumpAsts(bool dump_asts) {
+    dump_asts_ = dump_asts;
+    return *this;
+  }
+
+  Options& SetOnlyTrackMutantCoverage(bool only_track_mutant_coverage) {
+    only_track_mutant_coverage_ = only_track_mutant_coverage;
+    return *this;
+  }
+
+  Options& SetShowAstNodeTypes(bool show_ast_node_types) {
+    show_ast_node_types_ = show_ast_node_types;
+    return *this;
+  }
+
+  Options& SetCollectMutationInfo(bool collect_mutation_info) {
+    collect_mutation_info_ = collect_mutation_info;
+    return *this;
+  }
+
+  Options& SetStatementSchemaThreshold(int statement_schema_threshold) {
+    statement_schema_threshold_ = statement_schema_threshold;
+    return *this;
+  }
+
+  Options& SetFunctionDispatch(bool function_dispatch) {
+    function_dispatch_ = function_dispatch;
+    return *this;
+  }
+
+  Options& SetSampleRate(double sample_rate) {
+    sample_rate_ = sample_rate;
+    return *this;
+  }
+
+  Options& SetMaxMutationSitesPerFile(int max_mutation_sites_per_file) {
+    max_mutation_sites_per_file_ = max_mutation_sites_per_file;
+    return *this;
+  }
+
+  Options& SetSamplingSeed(uint64_t sampling_seed) {
+    sampling_seed_ = sampling_seed;
+    return *this;
+  }
+
+  Options& SetLineRanges(std::optional<LineRanges> line_ranges) {
+    line_ranges_ = std::move(line_ranges);
+    return *this;
+  }
 
-  Options() : Options(true, false, false, false) {}
+  Options& SetCoveredLines(std::optional<LineRanges> covered_lines) {
+    covered_lines_ = std::move(covered_lines);
+    return *this;
+  }
+
+  Options& SetExecutionProfile(
+      std::optional<ExecutionProfile> execution_profile) {
+    execution_profile_ = std::move(execution_profile);
+    return *this;
+  }
+
+  Options& SetHotSiteThreshold(uint64_t hot_site_threshold) {
+    hot_site_threshold_ = hot_site_threshold;
+    return *this;
+  }
+
+  Options& SetReportReachedMutants(bool report_reached_mutants) {
+    report_reached_mutants_ = report_reached_mutants;
+    return *this;
+  }
+
+  Options& SetWeakMutation(bool weak_mutation) {
+    weak_mutation_ = weak_mutation;
+    return *this;
+  }
+
+  Options& SetSplitStream(bool split_stream) {
+    split_stream_ = split_stream;
+    return *this;
+  }
+
+  Options& SetRuntimeBudget(bool runtime_budget) {
+    runtime_budget_ = runtime_budget;
+    return *this;
+  }
 
   [[nodiscard]] bool GetOptimiseMutations() const {
     return optimise_mutations_;
@@ -42,21 +136,143 @@ class Options {
     return show_ast_node_types_;
   }
 
+  [[nodiscard]] bool GetCollectMutationInfo() const {
+    return collect_mutation_info_;
+  }
+
+  [[nodiscard]] int GetStatementSchemaThreshold() const {
+    return statement_schema_threshold_;
+  }
+
+  [[nodiscard]] bool GetFunctionDispatch() const { return function_dispatch_; }
+
+  [[nodiscard]] double GetSampleRate() const { return sample_rate_; }
+
+  [[nodiscard]] int GetMaxMutationSitesPerFile() const {
+    return max_mutation_sites_per_file_;
+  }
+
+  [[nodiscard]] uint64_t GetSamplingSeed() const { return sampling_seed_; }
+
+  [[nodiscard]] const std::optional<LineRanges>& GetLineRanges() const {
+    return line_ranges_;
+  }
+
+  [[nodiscard]] const std::optional<LineRanges>& GetCoveredLines() const {
+    return covered_lines_;
+  }
+
+  [[nodiscard]] const std::optional<ExecutionProfile>& GetExecutionProfile()
+      const {
+    return execution_profile_;
+  }
+
+  [[nodiscard]] uint64_t GetHotSiteThreshold() const {
+    return hot_site_threshold_;
+  }
+
+  [[nodiscard]] bool GetReportReachedMutants() const {
+    return report_reached_mutants_;
+  }
+
+  [[nodiscard]] bool GetWeakMutation() const { return weak_mutation_; }
+
+  [[nodiscard]] bool GetSplitStream() const { return split_stream_; }
+
+  [[nodiscard]] bool GetRuntimeBudget() const { return runtime_budget_; }
+
+  // True if and only if only a sample of the mutation sites in each file
+  // should be instrumented.
+  [[nodiscard]] bool IsSamplingEnabled() const {
+    return sample_rate_ < 1.0 || max_mutation_sites_per_file_ > 0;
+  }
+
  private:
   // True if and only if Dredd's optimisations are enabled.
-  bool optimise_mutations_;
+  bool optimise_mutations_ = true;
 
   // True if and only if the AST being consumed should be dumped; useful for
   // debugging.
-  bool dump_asts_;
+  bool dump_asts_ = false;
 
   // True if and only if instrumentation should track whether mutants are
   // reached, rather than allowing mutants to be enabled.
-  bool only_track_mutant_coverage_;
+  bool only_track_mutant_coverage_ = false;
 
   // True if and only if a comment showing the type of each mutated AST node
   // should be emitted. This is useful for debugging.
-  bool show_ast_node_types_;
+  bool show_ast_node_types_ = false;
+
+  // True if and only if information about each mutation, such as its source
+  // location and a snippet of the code being mutated, should be collected.
+  // This is only required when a mutation info file has been requested.
+  bool collect_mutation_info_ = true;
+
+  // If positive, an expression or return statement containing at least this
+  // many mutation sites is mutated via a switch statement that chooses between
+  // copies of the statement, one per site, with only the mutations at that
+  // site applied. This avoids deeply nested calls to mutator functions, at the
+  // expense of code size. If zero, every statement is mutated in place.
+  int statement_schema_threshold_ = 0;
+
+  // True if and only if the body of each mutated function should be replaced
+  // by a check of whether any mutant in the function is enabled, choosing
+  // between a copy of the original body and a copy of the mutated body. This
+  // lets functions that contain no enabled mutant run at native speed, at the
+  // expense of code size. Cannot be combined with statement schemas.
+  bool function_dispatch_ = false;
+
+  // The proportion, between 0 and 1, of the mutation sites in each file that
+  // should be instrumented. The sample is stratified by the kind of mutation
+  // and the enclosing function. Sites that are not sampled are not
+  // instrumented at all, so they do not get mutant ids.
+  double sample_rate_ = 1.0;
+
+  // If positive, at most this many mutation sites are instrumented per file.
+  int max_mutation_sites_per_file_ = 0;
+
+  // Combined with the name of each file to seed the sampling of its mutation
+  // sites, so that sampling is deterministic.
+  uint64_t sampling_seed_ = 0;
+
+  // If present, only AST nodes that overlap these lines are mutated, and
+  // files without any such lines are not mutated at all.
+  std::optional<LineRanges> line_ranges_;
+
+  // If present, the lines executed by a test suite according to a coverage
+  // report. Only AST nodes that overlap these lines are mutated, and files
+  // without any executed lines are not mutated at all.
+  std::optional<LineRanges> covered_lines_;
+
+  // If present, execution counts for the code being mutated. Mutation sites
+  // whose execution count exceeds |hot_site_threshold_| are not instrumented,
+  // so that they do not make the mutated program unduly slow, and are instead
+  // reported in the mutation info.
+  std::optional<ExecutionProfile> execution_profile_;
+
+  uint64_t hot_site_threshold_ = 0;
+
+  // True if and only if the instrumentation should report, when the mutated
+  // program runs, whether the code of an enabled mutant was reached. Has no
+  // effect if only mutant coverage is being tracked.
+  bool report_reached_mutants_ = false;
+
+  // Only relevant when mutant coverage is being tracked. If true, a mutant is
+  // only recorded as covered if evaluating it would change the value computed
+  // by the code being mutated, i.e. if it infects the program state.
+  bool weak_mutation_ = false;
+
+  // If true, the mutated program supports split-stream execution: when run
+  // with no mutant enabled, it forks a child process that continues with a
+  // mutant enabled the first time that the mutant infects the program state,
+  // or, for mutants whose effect cannot be evaluated in advance, the first time
+  // that the mutant is reached.
+  bool split_stream_ = false;
+
+  // If true, the mutated program counts the number of times it checks whether
+  // a mutation is enabled, and exits with a distinctive status once a limit is
+  // exceeded, so that mutants that cause infinite loops are detected quickly.
+  bool runtime_budget_ = false;
 };
 
 }  // namespace dredd
@@ -12,8 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#ifndef DREDD_PROTOBUFS_PROTOBUF_SERIALIZATION_H
-#define DREDD_PROTOBUFS_PROTOBUF_SERIALIZATION_H
+#ifndef LIBDREDD_PROTOBUFS_PROTOBUF_SERIALIZATION_H
+#define LIBDREDD_PROTOBUFS_PROTOBUF_SERIALIZATION_H
 
 #if defined(__clang__)
 #pragma clang diagnostic push
@@ -46,4 +46,4 @@
 #pragma warning(pop)
 #endif
 
-#endif  // DREDD_PROTOBUFS_PROTOBUF_SERIALIZATION_H
+#endif  // LIBDREDD_PROTOBUFS_PROTOBUF_SERIALIZATION_H
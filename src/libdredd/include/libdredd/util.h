@@ -15,11 +15,14 @@
 #ifndef LIBDREDD_UTIL_H
 #define LIBDREDD_UTIL_H
 
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Expr.h"
-#include "clang/AST/ParentMapContext.h"
 #include "clang/AST/Stmt.h"
 #include "clang/Basic/SourceLocation.h"
 #include "clang/Lex/Preprocessor.h"
@@ -51,6 +54,49 @@ class InfoForSourceRange {
 
 std::string SpaceToUnderscore(const std::string& input);
 
+// Yields the first statement of a mutator function that handles
+// |num_mutations| mutations, starting at its |local_mutation_id| parameter:
+// the function returns |original| straight away if no mutation in the file is
+// enabled, or if its mutations lie outside the smallest range containing every
+// enabled mutation, so that the individual mutations need not be looked up.
+std::string GetMutatorFunctionFastPath(int num_mutations,
+                                       const std::string& original);
+
+// Yields |filename| as an absolute path, without '.' or '..' components, and
+// with forward slashes as separators.
+std::string GetNormalisedAbsolutePath(const std::string& filename);
+
+// Determines whether |path|, normalised as above, is the file that a report,
+// such as a diff or a coverage report, names as |report_path|. Paths in reports
+// may be relative, e.g. to the root of a repository, so |path| matches if it
+// ends with |report_path| at a directory boundary.
+bool MatchesReportPath(const std::string& path, const std::string& report_path);
+
+// Yields the data that |entries|, which pair paths as they appear in a report
+// with data, hold for the source file |filename|, or nullptr if no path in the
+// report matches the file. If several paths match, e.g. "a.c" and "src/a.c"
+// for "/repo/src/a.c", the report is ambiguous: nullptr is yielded and
+// |error_message| is set.
+template <typename T>
+const T* FindReportEntry(const std::vector<std::pair<std::string, T>>& entries,
+                         const std::string& filename,
+                         std::string& error_message) {
+  const std::string path = GetNormalisedAbsolutePath(filename);
+  const std::pair<std::string, T>* result = nullptr;
+  for (const auto& entry : entries) {
+    if (!MatchesReportPath(path, entry.first)) {
+      continue;
+    }
+    if (result != nullptr) {
+      error_message = "Both '" + result->first + "' and '" + entry.first +
+                      "' in the report match " + path + ".";
+      return nullptr;
+    }
+    result = &entry;
+  }
+  return result == nullptr ? nullptr : &result->second;
+}
+
 [[nodiscard]] clang::SourceRange GetSourceRangeInMainFile(
     const clang::Preprocessor& preprocessor,
     const clang::SourceRange& source_range);
@@ -85,29 +131,52 @@ bool EvaluateAsFloat(const clang::Expr& expr,
                      const clang::ASTContext& ast_context,
                      llvm::APFloat& result);
 
+// The constant evaluator is invoked many times on the same expressions: the
+// visitor and each mutation ask whether operands are equivalent to 0, 1 or -1,
+// and whether they have side effects. This class memoises the results of
+// EvaluateAsBooleanCondition, EvaluateAsInt, EvaluateAsFloat and
+// Expr::HasSideEffects, keyed by expression, so that each query is answered at
+// most once per expression. Only the queried expression's result is memoised:
+// when the evaluator recurses into subexpressions it does not consult the
+// cache, so querying an expression and then a larger expression that contains
+// it evaluates the subexpression twice. An instance should be used for a single
+// translation unit, whose AST must not change while the instance is in use.
+class ExprEvaluationCache {
+ public:
+  bool EvaluateAsBooleanCondition(const clang::Expr& expr,
+                                  const clang::ASTContext& ast_context,
+                                  bool& result);
+
+  bool EvaluateAsInt(const clang::Expr& expr,
+                     const clang::ASTContext& ast_context,
+                     clang::Expr::EvalResult& result);
+
+  bool EvaluateAsFloat(const clang::Expr& expr,
+                       const clang::ASTContext& ast_context,
+                       llvm::APFloat& result);
+
+  bool HasSideEffects(const clang::Expr& expr,
+                      const clang::ASTContext& ast_context);
+
+ private:
+  // For each kind of query, no value means that the query has not yet been
+  // made; otherwise the value records the result of the query.
+  struct Entry {
+    std::optional<std::optional<bool>> boolean_condition;
+    std::optional<std::optional<clang::Expr::EvalResult>> int_result;
+    std::optional<std::optional<llvm::APFloat>> float_result;
+    std::optional<bool> has_side_effects;
+  };
+
+  std::unordered_map<const clang::Expr*, Entry> entries_;
+};
+
 // A wrapper for Expr::isCXX11ConstantExpr that first checks whether the
 // expression is value-dependent (isCXX11ConstantExpr fails an assertion if the
 // expression is value-dependent).
 bool IsCxx11ConstantExpr(const clang::Expr& expr,
                          const clang::ASTContext& ast_context);
 
-// It is often necessary to ask whether a given statement (which includes
-// expressions) has a parent of a given type. This helper returns nullptr if
-// the given statement has no parent of the template parameter type, and
-// otherwise returns the first parent that does have the template parameter
-// type.
-template <typename RequiredParentT>
-const RequiredParentT* GetFirstParentOfType(const clang::Stmt& stmt,
-                                            clang::ASTContext& ast_context) {
-  for (const auto& parent : ast_context.getParents(stmt)) {
-    const auto* candidate_result = parent.template get<RequiredParentT>();
-    if (candidate_result != nullptr) {
-      return candidate_result;
-    }
-  }
-  return nullptr;
-}
-
 }  // namespace dredd
 
 #endif  // LIBDREDD_UTIL_H
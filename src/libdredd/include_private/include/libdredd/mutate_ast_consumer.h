@@ -20,13 +20,17 @@
 #include <optional>
 #include <string>
 #include <unordered_set>
+#include <vector>
 
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/ASTContext.h"
+#include "clang/AST/DeclBase.h"
 #include "clang/AST/Expr.h"
 #include "clang/Frontend/CompilerInstance.h"
-#include "clang/Rewrite/Core/Rewriter.h"
+#include "libdredd/dredd_declarations.h"
+#include "libdredd/main_file_rewriter.h"
 #include "libdredd/mutate_visitor.h"
+#include "libdredd/mutation.h"
 #include "libdredd/mutation_tree_node.h"
 #include "libdredd/options.h"
 #include "libdredd/protobufs/dredd_protobufs.h"
@@ -46,6 +50,14 @@ class MutateAstConsumer : public clang::ASTConsumer {
 
   void HandleTranslationUnit(clang::ASTContext& ast_context) override;
 
+  // Only code in the main file is mutated, so there is no need for the bodies
+  // of functions defined in other files to be parsed and analysed. This is
+  // only consulted if function body skipping is enabled in the frontend
+  // options, which MutateFrontendAction does. Clang itself never skips bodies
+  // that may be needed, such as those of constexpr functions and of functions
+  // with deduced return types.
+  bool shouldSkipFunctionBody(clang::Decl* decl) override;
+
  private:
   [[nodiscard]] std::string GetDreddPreludeCpp(int initial_mutation_id) const;
 
@@ -69,11 +81,24 @@ class MutateAstConsumer : public clang::ASTConsumer {
                                                     uint64_t integer_constant);
 
   void ApplyMutations(
+      const MutationTree& dredd_mutation_tree,
       const MutationTreeNode& dredd_mutation_tree_node, int initial_mutation_id,
       clang::ASTContext& context,
       protobufs::MutationInfoForFile& protobufs_mutation_info_for_file,
       protobufs::MutationTreeNode& protobufs_mutation_tree_node,
-      std::unordered_set<std::string>& dredd_declarations, bool build_tree);
+      DreddDeclarations& dredd_declarations, bool build_tree);
+
+  // Adds the sites that the visitor excluded from mutation because they are
+  // hot to the mutation info for the main file.
+  void RecordExcludedHotSites(
+      clang::ASTContext& ast_context,
+      protobufs::MutationInfoForFile& protobufs_mutation_info_for_file) const;
+
+  // Determines whether the subtree rooted at the given node should be applied
+  // to copies of a statement, selected between by a switch statement.
+  [[nodiscard]] bool ShouldUseStatementSchema(
+      const MutationTree& dredd_mutation_tree,
+      const MutationTreeNode& dredd_mutation_tree_node) const;
 
   const clang::CompilerInstance* compiler_instance_;
 
@@ -81,13 +106,32 @@ class MutateAstConsumer : public clang::ASTConsumer {
 
   std::unique_ptr<MutateVisitor> visitor_;
 
-  clang::Rewriter rewriter_;
+  MainFileRewriter rewriter_;
 
   // Counter used to give each mutation a unique id; shared among AST consumers
   // for different translation units.
   int* mutation_id_;
 
   std::optional<protobufs::MutationInfo>* mutation_info_;
+
+  // If sampling is enabled, the mutations that have been selected for
+  // instrumentation; all other mutations are ignored.
+  std::optional<std::unordered_set<const Mutation*>> selected_mutations_;
+
+  // While the mutations of a statement are being applied to copies of the
+  // statement, this records a case of the resulting switch statement per
+  // mutation that had an effect. It is null at all other times.
+  std::vector<MainFileRewriter::SwitchCase>* statement_schema_cases_ = nullptr;
+
+  // Records whether any statement of the translation unit has been replaced by
+  // a switch statement, in which case the prelude must provide the function
+  // that the switch statements use to select a case.
+  bool statement_schema_used_ = false;
+
+  // Records whether any function of the translation unit has been given
+  // separate original and mutated copies of its body, in which case the
+  // prelude must provide the function that chooses between them.
+  bool function_dispatch_used_ = false;
 };
 
 }  // namespace dredd
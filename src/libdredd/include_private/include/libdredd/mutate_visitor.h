@@ -16,9 +16,11 @@
 #define LIBDREDD_MUTATE_VISITOR_H
 
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <optional>
-#include <set>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -36,9 +38,14 @@
 #include "clang/AST/TypeLoc.h"
 #include "clang/Basic/SourceLocation.h"
 #include "clang/Frontend/CompilerInstance.h"
+#include "libdredd/execution_profile.h"
+#include "libdredd/line_ranges.h"
 #include "libdredd/mutation.h"
+#include "libdredd/mutation_sampler.h"
 #include "libdredd/mutation_tree_node.h"
 #include "libdredd/options.h"
+#include "libdredd/util.h"
+#include "llvm/Support/Casting.h"
 
 namespace dredd {
 
@@ -57,6 +64,10 @@ class MutateVisitor : public clang::RecursiveASTVisitor<MutateVisitor> {
   // statements.
   bool TraverseCaseStmt(clang::CaseStmt* case_stmt);
 
+  // Overridden to keep track of the fact that statements occurring inside types
+  // are not children of the enclosing statement.
+  bool TraverseTypeLoc(clang::TypeLoc type_loc);
+
   // Overridden to avoid mutating constant array size expressions.
   bool TraverseConstantArrayTypeLoc(
       clang::ConstantArrayTypeLoc constant_array_type_loc);
@@ -104,8 +115,23 @@ class MutateVisitor : public clang::RecursiveASTVisitor<MutateVisitor> {
 
   // Should only be called after visitation is complete. Yields the tree of
   // mutations for the translation unit.
-  [[nodiscard]] const MutationTreeNode& GetMutations() const {
-    return mutation_tree_root_;
+  [[nodiscard]] const MutationTree& GetMutations() const {
+    return mutation_tree_;
+  }
+
+  // Should only be called after visitation is complete. Yields a sampler that
+  // has recorded every mutation, if sampling is enabled.
+  [[nodiscard]] const MutationSampler& GetMutationSampler() const {
+    return mutation_sampler_;
+  }
+
+  // Should only be called after visitation is complete. Yields the main file
+  // source ranges of the statements and expressions that were not mutated
+  // because the execution profile showed them to be hot, each paired with its
+  // execution count, in the order in which they were encountered.
+  [[nodiscard]] const std::vector<std::pair<clang::SourceRange, uint64_t>>&
+  GetExcludedHotSites() const {
+    return excluded_hot_sites_;
   }
 
   // Yields the C++ constant-sized arrays, whose size expressions need to be
@@ -147,13 +173,10 @@ class MutateVisitor : public clang::RecursiveASTVisitor<MutateVisitor> {
    public:
     explicit PushMutationTreeRAII(MutateVisitor& mutate_visitor)
         : mutate_visitor_(&mutate_visitor) {
-      auto child = std::make_unique<MutationTreeNode>();
-      auto* child_ptr = child.get();
-      mutate_visitor_->mutation_tree_path_.back()->AddChild(std::move(child));
-      mutate_visitor_->mutation_tree_path_.push_back(child_ptr);
+      mutate_visitor_->mutation_tree_.PushNode();
     }
 
-    ~PushMutationTreeRAII() { mutate_visitor_->mutation_tree_path_.pop_back(); }
+    ~PushMutationTreeRAII() { mutate_visitor_->mutation_tree_.PopNode(); }
 
     PushMutationTreeRAII(const PushMutationTreeRAII&) = delete;
 
@@ -167,6 +190,21 @@ class MutateVisitor : public clang::RecursiveASTVisitor<MutateVisitor> {
     MutateVisitor* mutate_visitor_;
   };
 
+  // Yields the parent of the given statement if the parent is a statement of
+  // type ParentT, and nullptr otherwise. The given statement must be on the
+  // stack of statements currently being traversed; in practice it is the
+  // statement being visited or one of its close ancestors, so the search is
+  // fast.
+  template <typename ParentT>
+  const ParentT* GetParentOfType(const clang::Stmt& stmt) const {
+    for (size_t index = stmt_ancestors_.size(); index > 1; index--) {
+      if (stmt_ancestors_[index - 1] == &stmt) {
+        return llvm::dyn_cast_or_null<ParentT>(stmt_ancestors_[index - 2]);
+      }
+    }
+    return nullptr;
+  }
+
   void HandleUnaryOperator(clang::UnaryOperator* unary_operator);
 
   void HandleBinaryOperator(clang::BinaryOperator* binary_operator);
@@ -199,14 +237,47 @@ class MutateVisitor : public clang::RecursiveASTVisitor<MutateVisitor> {
   // }
   bool IsInFunction();
 
+  // Yields the innermost function declaration being traversed, or nullptr if
+  // there is none.
+  [[nodiscard]] const clang::Decl* GetEnclosingFunction() const;
+
   // Mutating an enum constant can be problematic when the enum constant is used
   // to implicitly construct a C++ object. This helper method allows detecting
   // this special case, so that it can be ignored.
   bool IsConversionOfEnumToConstructor(const clang::Expr& expr) const;
 
+  // Constants that are used in an initializer list may be implicitly cast in a
+  // manner that is allowed for constants but not for non-constants, so an
+  // explicit cast must be inserted when such an expression is mutated. This
+  // yields the implicit cast that is applied to the given expression (or to the
+  // parenthesized expression that encloses it) as an element of an initializer
+  // list, or nullptr if there is no such cast.
+  [[nodiscard]] const clang::ImplicitCastExpr* GetInitializerListImplicitCast(
+      const clang::Expr& expr) const;
+
   // Adds details of a mutation that can be applied, and performs associated
   // bookkeeping.
-  void AddMutation(std::unique_ptr<Mutation> mutation);
+  void AddMutation(const clang::Stmt& mutated_stmt,
+                   std::unique_ptr<Mutation> mutation);
+
+  // Determines whether the given statement overlaps the lines to which
+  // mutation has been restricted, if any, and the lines that are covered
+  // according to a coverage report, if one was provided.
+  bool OverlapsLineRanges(const clang::Stmt& stmt);
+
+  // Determines whether the execution profile, if one was provided, shows the
+  // given statement to be executed more often than the hot site threshold
+  // allows. If so, the statement is recorded as an excluded hot site the first
+  // time this is determined.
+  bool IsHotSite(const clang::Stmt& stmt);
+
+  // Determines whether the given lines of the main file overlap the ranges
+  // that |line_ranges| gives for the main file, which are looked up and cached
+  // in |main_file_ranges| on first use. Yields true if |line_ranges| is absent.
+  bool OverlapsMainFileRanges(
+      const std::optional<LineRanges>& line_ranges,
+      std::optional<const std::vector<LineRanges::Range>*>& main_file_ranges,
+      unsigned first_line, unsigned last_line) const;
 
   // Determines whether the parent of the given expression is a call expression
   // that uses argument-dependent lookup.
@@ -239,8 +310,11 @@ class MutateVisitor : public clang::RecursiveASTVisitor<MutateVisitor> {
   // cast that turns the array reference into a value), the temporary object
   // will be destroyed too early.
   //
-  // This function checks for such cases.
-  static bool MayDependOnLifetimeOfMaterializedTemporaryStorage(
+  // This function checks for such cases. The result for each member and call
+  // expression is memoised, because the function recurses through the bases of
+  // member expressions and the arguments of calls, and is invoked on every
+  // expression that is visited.
+  bool MayDependOnLifetimeOfMaterializedTemporaryStorage(
       const clang::Expr& expr);
 
   // Recursively saves constant template arguments that need to be rewritten
@@ -248,6 +322,17 @@ class MutateVisitor : public clang::RecursiveASTVisitor<MutateVisitor> {
   void SaveConstantTemplateArgumentForRewrite(
       const clang::TemplateSpecializationType* template_specialization_type);
 
+  // Determines whether the given sub-statement of a compound statement could
+  // be mutated via a switch over copies of the statement, before the
+  // statement's subexpressions have been traversed.
+  [[nodiscard]] bool IsStatementSchemaCandidate(const clang::Stmt& stmt) const;
+
+  // Determines whether the given statement, whose parent statement is
+  // |parent|, is the body of a function that could be given separate original
+  // and mutated copies of its body, before the body has been traversed.
+  [[nodiscard]] bool IsFunctionDispatchCandidate(
+      const clang::Stmt& stmt, const clang::Stmt* parent) const;
+
   const clang::CompilerInstance* compiler_instance_;
   const Options* options_;
 
@@ -262,21 +347,66 @@ class MutateVisitor : public clang::RecursiveASTVisitor<MutateVisitor> {
   // e.g. putting a Dredd function inside a class or function.
   std::vector<const clang::Decl*> enclosing_decls_;
 
-  // These fields track whether a statement contains some sub-statement that
-  // might cause control to branch outside of the statement. This needs to be
-  // tracked to determine when it is legitimate to move a statement into a
-  // lambda to simulate statement removal.
-  std::unordered_set<clang::Stmt*> contains_return_goto_or_label_;
-  std::unordered_set<clang::Stmt*> contains_break_for_enclosing_loop_or_switch_;
-  std::unordered_set<clang::Stmt*> contains_continue_for_enclosing_loop_;
-  std::unordered_set<clang::Stmt*> contains_case_for_enclosing_switch_;
-
-  // Records the mutations that can be applied, in a hierarchical manner.
-  MutationTreeNode mutation_tree_root_;
-
-  // Used to keep track of how mutations are hierarchically organised while the
-  // AST is being visited.
-  std::vector<MutationTreeNode*> mutation_tree_path_;
+  // The statements currently being traversed, outermost first. A null entry
+  // indicates that traversal has passed through a declaration or type, so that
+  // the statement above the null entry is not the parent of the statement below
+  // it. This allows the parent of a statement to be determined cheaply, without
+  // requiring the AST context to build a map from AST nodes to their parents.
+  std::vector<const clang::Stmt*> stmt_ancestors_;
+
+  // Memoises constant evaluation and side effect queries on the expressions of
+  // the translation unit. It is shared with every mutation that the visitor
+  // creates, so it is declared before the mutation tree that owns the
+  // mutations.
+  ExprEvaluationCache expr_evaluation_cache_;
+
+  // Records the mutations that can be applied, in a hierarchical manner. The
+  // tree also keeps track of how mutations are hierarchically organised while
+  // the AST is being visited.
+  MutationTree mutation_tree_;
+
+  // Records the kind and enclosing function of every mutation, so that a
+  // stratified sample of the mutations can be selected. Only used if sampling
+  // is enabled.
+  MutationSampler mutation_sampler_;
+
+  // If mutation has been restricted to certain lines, the lines of the main
+  // file to which it has been restricted, or nullptr if there are none. This is
+  // looked up on first use.
+  std::optional<const std::vector<LineRanges::Range>*> main_file_line_ranges_;
+
+  // Similarly, if a coverage report was provided, the lines of the main file
+  // that it records as executed, or nullptr if there are none.
+  std::optional<const std::vector<LineRanges::Range>*> main_file_covered_lines_;
+
+  // Similarly, if an execution profile was provided, the segments that it
+  // records for the main file, or nullptr if there are none.
+  std::optional<const std::vector<ExecutionProfile::Segment>*>
+      main_file_profile_segments_;
+
+  // The statements that were found to be hot, so that each is reported once
+  // even if several mutations of it are rejected, and the main file source
+  // ranges and execution counts of those statements.
+  std::unordered_set<const clang::Stmt*> hot_stmts_;
+  std::vector<std::pair<clang::SourceRange, uint64_t>> excluded_hot_sites_;
+
+  // True while traversing a statement that is a candidate for being mutated
+  // via a switch over copies of the statement. Such statements are not nested.
+  bool in_statement_schema_candidate_ = false;
+
+  // Becomes false if, while traversing a candidate for being mutated via a
+  // switch, a construct is encountered that cannot be duplicated within a
+  // function, such as a label inside a statement expression.
+  bool statement_schema_candidate_is_valid_ = false;
+
+  // True while traversing a function body that is a candidate for having
+  // separate original and mutated copies. Such bodies are not nested.
+  bool in_function_dispatch_candidate_ = false;
+
+  // Becomes false if, while traversing a candidate function body, a construct
+  // is encountered that cannot be duplicated within the function, such as a
+  // label or a static local variable.
+  bool function_dispatch_candidate_is_valid_ = false;
 
   // In C++, it is common to introduce a variable in a boolean guard via "auto",
   // and have the guard evaluate to the variable:
@@ -292,8 +422,17 @@ class MutateVisitor : public clang::RecursiveASTVisitor<MutateVisitor> {
   //
   // To avoid this, the set of all source locations for variable declarations is
   // tracked, and mutations are not applied to expression nodes whose start
-  // location is one of these locations.
-  std::set<clang::SourceLocation> var_decl_source_locations_;
+  // location is one of these locations. Variable declarations are mostly
+  // visited in source order, so the locations are kept in a sorted vector, to
+  // which they can usually be appended, rather than in a node-based set.
+  std::vector<clang::SourceLocation> var_decl_source_locations_;
+
+  // Memoises the results of MayDependOnLifetimeOfMaterializedTemporaryStorage
+  // for member and call expressions. Because expressions are visited bottom-up,
+  // the result for an expression is usually computed directly from the
+  // memoised results for its subexpressions.
+  std::unordered_map<const clang::Expr*, bool>
+      may_depend_on_lifetime_of_materialized_temporary_storage_;
 
   // This records C++ constant-sized array declarations, so that size
   // expressions can be rewritten with the integers to which they evaluate.
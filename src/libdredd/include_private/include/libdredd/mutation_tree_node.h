@@ -15,28 +15,25 @@
 #ifndef LIBDREDD_MUTATION_TREE_NODE_H
 #define LIBDREDD_MUTATION_TREE_NODE_H
 
+#include <cassert>
+#include <cstddef>
 #include <memory>
 #include <vector>
 
+#include "clang/AST/Stmt.h"
 #include "libdredd/mutation.h"
 
 namespace dredd {
 
 // Used to track the hierarchical structure between mutations as they are
-// created during the traversal of an abstract syntax tree. Subsequently, the
-// root MutationTreeNode for a translation unit is turned into a
-// MutationIdTreeNode, which just captures the ids associated with the sets of
-// mutations instantiated by each Mutation object.
+// created during the traversal of an abstract syntax tree. Nodes are owned by
+// a MutationTree, and refer to their children via indices into that tree.
 class MutationTreeNode {
  public:
-  // Adds the given mutation to this tree node.
-  void AddMutation(std::unique_ptr<Mutation> mutation);
-
-  // Moves the given subtree into this tree node as a child.
-  void AddChild(std::unique_ptr<MutationTreeNode> node);
-
-  // Yields the children of this tree node.
-  [[nodiscard]] std::vector<const MutationTreeNode*> GetChildren() const;
+  // Yields the indices, in the owning tree, of the children of this tree node.
+  [[nodiscard]] const std::vector<size_t>& GetChildren() const {
+    return children_;
+  }
 
   // Yields the mutations associated with this tree node.
   [[nodiscard]] const std::vector<std::unique_ptr<Mutation>>& GetMutations()
@@ -44,25 +41,101 @@ class MutationTreeNode {
     return mutations_;
   }
 
-  // Once the tree has been built, this method should be invoked to make it
-  // simpler, without losing any relationship between mutations. This includes,
-  // for example, pruning empty subtrees.
+  // Returns true if and only if this node has no mutations and no children.
+  // Because a MutationTree prunes empty subtrees as it is built, this means
+  // that every node in the subtree rooted at this node contains no mutations.
+  [[nodiscard]] bool IsEmpty() const {
+    return mutations_.empty() && children_.empty();
+  }
+
+  // Yields the statement whose mutations are captured by the subtree rooted at
+  // this node, if that statement is a candidate for being mutated via a switch
+  // over copies of the statement, and nullptr otherwise.
+  [[nodiscard]] const clang::Stmt* GetStatementSchemaStmt() const {
+    return statement_schema_stmt_;
+  }
+
+  // Yields the body of the function whose mutations are captured by the
+  // subtree rooted at this node, if that function is a candidate for having
+  // separate original and mutated copies of its body, and nullptr otherwise.
+  [[nodiscard]] const clang::CompoundStmt* GetFunctionDispatchBody() const {
+    return function_dispatch_body_;
+  }
+
+  // Determines whether this node has been marked as grouping the mutations of
+  // a statement or function body that might be copied, which prevents the
+  // node from being bypassed.
+  [[nodiscard]] bool IsMarkedForCopying() const {
+    return statement_schema_stmt_ != nullptr ||
+           function_dispatch_body_ != nullptr;
+  }
+
+ private:
+  friend class MutationTree;
+
+  std::vector<std::unique_ptr<Mutation>> mutations_;
+  std::vector<size_t> children_;
+  const clang::Stmt* statement_schema_stmt_ = nullptr;
+  const clang::CompoundStmt* function_dispatch_body_ = nullptr;
+};
+
+// A tree of mutations, built during a single traversal of an abstract syntax
+// tree. All nodes are stored contiguously, and the tree is simplified as it is
+// built: when a node is finished, it is discarded if it turned out to hold no
+// mutations, and it is replaced by its only child if it holds no mutations and
+// has exactly one child. This avoids separately allocating every node, and
+// avoids having to walk the tree again to simplify it.
+class MutationTree {
+ public:
+  MutationTree();
+
+  // Starts a new node, as the last child of the current node, and makes it the
+  // current node.
+  void PushNode();
+
+  // Finishes the current node, simplifying it if possible, and makes its parent
+  // the current node.
+  void PopNode();
+
+  // Adds the given mutation to the current node.
+  void AddMutation(std::unique_ptr<Mutation> mutation);
+
+  // Records that the mutations in the current node's subtree all arise from
+  // the given statement, and that the statement may be mutated via a switch
+  // over copies of the statement. Such a node is never bypassed by PopNode,
+  // so that the statement's mutations remain grouped together.
+  void SetCurrentStatementSchemaStmt(const clang::Stmt& stmt);
+
+  // Records that the mutations in the current node's subtree all arise from
+  // the given function body, and that the function may be given separate
+  // original and mutated copies of its body. As above, such a node is never
+  // bypassed.
+  void SetCurrentFunctionDispatchBody(const clang::CompoundStmt& body);
+
+  // Once the tree has been built, this method should be invoked to squash any
+  // chain of nodes at the root that hold no mutations and only have one child.
+  // Every other node will already have been simplified by PopNode.
   void TidyUp();
 
-  // Returns true if and only if every node in the subtree rooted at this node
-  // contains no mutations.
-  [[nodiscard]] bool IsEmpty() const;
+  [[nodiscard]] const MutationTreeNode& GetRoot() const {
+    return nodes_[root_];
+  }
+
+  [[nodiscard]] const MutationTreeNode& GetNode(size_t index) const {
+    assert(index < nodes_.size() && "Node index out of range.");
+    return nodes_[index];
+  }
 
  private:
-  // Used by "TidyUp" to squash chains of nodes that hold no mutations and only
-  // have one child.
-  void Compress();
+  std::vector<MutationTreeNode> nodes_;
 
-  // Used by "TidyUp" to eliminate empty subtrees.
-  void PruneEmptySubtrees();
+  // The indices of the nodes that have been started but not yet finished,
+  // outermost first.
+  std::vector<size_t> path_;
 
-  std::vector<std::unique_ptr<Mutation>> mutations_;
-  std::vector<std::unique_ptr<MutationTreeNode>> children_;
+  // The index of the root node, which changes if TidyUp squashes nodes at the
+  // root.
+  size_t root_;
 };
 
 }  // namespace dredd
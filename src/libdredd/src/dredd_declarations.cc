@@ -0,0 +1,57 @@
+// Copyright 2024 The Dredd Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libdredd/dredd_declarations.h"
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dredd {
+
+const std::vector<int>* DreddDeclarations::Find(const std::string& key) const {
+  auto iterator = declarations_.find(key);
+  if (iterator == declarations_.end()) {
+    return nullptr;
+  }
+  return &iterator->second.actions;
+}
+
+void DreddDeclarations::Add(const std::string& key, std::string text,
+                            std::vector<int> actions) {
+  const bool inserted =
+      declarations_
+          .emplace(key, Declaration{std::move(text), std::move(actions)})
+          .second;
+  (void)inserted;  // Keep release-mode compilers happy.
+  assert(inserted && "A declaration with this key already exists.");
+}
+
+std::vector<const std::string*> DreddDeclarations::GetSortedDeclarations()
+    const {
+  std::vector<const std::string*> result;
+  result.reserve(declarations_.size());
+  for (const auto& entry : declarations_) {
+    result.push_back(&entry.second.text);
+  }
+  std::sort(result.begin(), result.end(),
+            [](const std::string* first, const std::string* second) -> bool {
+              return *first < *second;
+            });
+  return result;
+}
+
+}  // namespace dredd
@@ -0,0 +1,133 @@
+// Copyright 2024 The Dredd Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libdredd/execution_profile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "libdredd/util.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/Path.h"
+
+namespace dredd {
+
+std::optional<ExecutionProfile> ExecutionProfile::ParseLlvmCovExport(
+    const std::string& json_text, std::string& error_message) {
+  llvm::Expected<llvm::json::Value> json = llvm::json::parse(json_text);
+  if (!json) {
+    error_message = llvm::toString(json.takeError());
+    return std::nullopt;
+  }
+  const llvm::json::Object* root = json->getAsObject();
+  const llvm::json::Array* data =
+      root == nullptr ? nullptr : root->getArray("data");
+  if (data == nullptr) {
+    error_message = "Expected an object with a \"data\" array.";
+    return std::nullopt;
+  }
+  ExecutionProfile result;
+  for (const llvm::json::Value& export_object : *data) {
+    const llvm::json::Object* export_data = export_object.getAsObject();
+    const llvm::json::Array* files =
+        export_data == nullptr ? nullptr : export_data->getArray("files");
+    if (files == nullptr) {
+      error_message = "Expected each element of \"data\" to have a \"files\" "
+                      "array.";
+      return std::nullopt;
+    }
+    for (const llvm::json::Value& file_value : *files) {
+      const llvm::json::Object* file = file_value.getAsObject();
+      const std::optional<llvm::StringRef> filename =
+          file == nullptr ? std::nullopt : file->getString("filename");
+      const llvm::json::Array* segments =
+          file == nullptr ? nullptr : file->getArray("segments");
+      if (!filename.has_value() || segments == nullptr) {
+        error_message = "Expected each file to have a \"filename\" and "
+                        "\"segments\"; the coverage must not be exported with "
+                        "-summary-only.";
+        return std::nullopt;
+      }
+      std::vector<Segment> file_segments;
+      // Each segment is [line, column, count, has_count, is_region_entry,
+      // is_gap_region].
+      for (const llvm::json::Value& segment_value : *segments) {
+        const llvm::json::Array* segment = segment_value.getAsArray();
+        if (segment == nullptr || segment->size() < 4) {
+          error_message = "Malformed segment for " + filename->str() + ".";
+          return std::nullopt;
+        }
+        const std::optional<int64_t> line = (*segment)[0].getAsInteger();
+        const std::optional<int64_t> column = (*segment)[1].getAsInteger();
+        const std::optional<double> count = (*segment)[2].getAsNumber();
+        const std::optional<bool> has_count = (*segment)[3].getAsBoolean();
+        if (!line.has_value() || *line < 1 || !column.has_value() ||
+            *column < 1 || !count.has_value() || *count < 0 ||
+            !has_count.has_value()) {
+          error_message = "Malformed segment for " + filename->str() + ".";
+          return std::nullopt;
+        }
+        const bool is_gap_region =
+            segment->size() > 5 &&
+            (*segment)[5].getAsBoolean().value_or(false);
+        file_segments.push_back({static_cast<unsigned>(*line),
+                                 static_cast<unsigned>(*column),
+                                 *has_count && !is_gap_region,
+                                 static_cast<uint64_t>(*count)});
+      }
+      std::stable_sort(file_segments.begin(), file_segments.end(),
+                       [](const Segment& first, const Segment& second) -> bool {
+                         return std::make_pair(first.line, first.column) <
+                                std::make_pair(second.line, second.column);
+                       });
+      result.segments_for_files_.emplace_back(
+          llvm::sys::path::convert_to_slash(*filename),
+          std::move(file_segments));
+    }
+  }
+  return result;
+}
+
+const std::vector<ExecutionProfile::Segment>*
+ExecutionProfile::GetSegmentsForFile(const std::string& filename,
+                                     std::string& error_message) const {
+  return FindReportEntry(segments_for_files_, filename, error_message);
+}
+
+std::optional<uint64_t> ExecutionProfile::GetCount(
+    const std::vector<Segment>& segments, unsigned line, unsigned column) {
+  // Find the last segment that starts at or before the position.
+  auto iterator = std::upper_bound(
+      segments.begin(), segments.end(), std::make_pair(line, column),
+      [](const std::pair<unsigned, unsigned>& position,
+         const Segment& segment) -> bool {
+        return position < std::make_pair(segment.line, segment.column);
+      });
+  if (iterator == segments.begin()) {
+    return std::nullopt;
+  }
+  --iterator;
+  if (!iterator->has_count) {
+    return std::nullopt;
+  }
+  return iterator->count;
+}
+
+}  // namespace dredd
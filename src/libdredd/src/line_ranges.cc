@@ -0,0 +1,290 @@
+// Copyright 2024 The Dredd Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libdredd/line_ranges.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "libdredd/execution_profile.h"
+#include "libdredd/util.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Path.h"
+
+namespace dredd {
+
+namespace {
+
+// Parses a "-start[,count]" or "+start[,count]" component of a hunk header,
+// where the count is 1 if omitted.
+bool ParseHunkRange(llvm::StringRef& text, llvm::StringRef prefix,
+                    unsigned& start, unsigned& count) {
+  if (!text.consume_front(prefix) || text.consumeInteger(10, start)) {
+    return false;
+  }
+  count = 1;
+  return !(text.consume_front(",") && text.consumeInteger(10, count));
+}
+
+// Parses a hunk header of the form "@@ -start[,count] +start[,count] @@",
+// yielding the number of lines of the old version of the file that the hunk
+// covers, and the first line and number of lines of the new version that it
+// covers.
+bool ParseHunkHeader(llvm::StringRef hunk_header, unsigned& old_count,
+                     unsigned& new_start, unsigned& new_count) {
+  unsigned old_start = 0;
+  return ParseHunkRange(hunk_header, "@@ -", old_start, old_count) &&
+         ParseHunkRange(hunk_header, " +", new_start, new_count) &&
+         hunk_header.starts_with(" @@");
+}
+
+}  // namespace
+
+std::optional<LineRanges> LineRanges::ParseGitDiff(const std::string& diff_text,
+                                                   std::string& error_message) {
+  LineRanges result;
+  // Null while in the header of a file that does not exist in the new version.
+  std::vector<Range>* current_ranges = nullptr;
+  bool in_file = false;
+  // The number of lines of the old and new versions of the file that the
+  // current hunk is yet to cover, and the line of the new version that the next
+  // line of the hunk corresponds to. The lines of a hunk are counted, rather
+  // than recognised by their prefix, because a removed line such as "-- x" or
+  // an added line such as "++ y" could otherwise be mistaken for a file header.
+  unsigned old_lines_remaining = 0;
+  unsigned new_lines_remaining = 0;
+  unsigned new_line = 0;
+  llvm::StringRef remaining_text(diff_text);
+  while (!remaining_text.empty()) {
+    llvm::StringRef line;
+    std::tie(line, remaining_text) = remaining_text.split('\n');
+    line = line.rtrim("\r");
+    if (line.starts_with("\\")) {
+      // A remark such as "\ No newline at end of file".
+      continue;
+    }
+    if (old_lines_remaining > 0 || new_lines_remaining > 0) {
+      if (line.starts_with("-") && old_lines_remaining > 0) {
+        old_lines_remaining--;
+      } else if (line.starts_with("+") && new_lines_remaining > 0) {
+        if (current_ranges != nullptr) {
+          if (!current_ranges->empty() &&
+              current_ranges->back().last_line + 1 == new_line) {
+            current_ranges->back().last_line = new_line;
+          } else {
+            current_ranges->push_back({new_line, new_line});
+          }
+        }
+        new_lines_remaining--;
+        new_line++;
+      } else if ((line.empty() || line.starts_with(" ")) &&
+                 old_lines_remaining > 0 && new_lines_remaining > 0) {
+        // A context line, which is present in both versions and so is not
+        // changed. Some tools strip the space from an empty context line.
+        old_lines_remaining--;
+        new_lines_remaining--;
+        new_line++;
+      } else {
+        error_message = "Hunk does not match its header at line: " + line.str();
+        return std::nullopt;
+      }
+      continue;
+    }
+    if (in_file && !line.starts_with("+++ ") && !line.starts_with("--- ") &&
+        (line.starts_with("+") || line.starts_with("-") ||
+         line.starts_with(" "))) {
+      // A line of a hunk beyond the lines counted by its header.
+      error_message = "Hunk does not match its header at line: " + line.str();
+      return std::nullopt;
+    }
+    if (line.consume_front("+++ ")) {
+      in_file = true;
+      current_ranges = nullptr;
+      if (line != "/dev/null") {
+        line.consume_front("b/");
+        result.ranges_for_files_.emplace_back(line.str(),
+                                              std::vector<Range>());
+        current_ranges = &result.ranges_for_files_.back().second;
+      }
+      continue;
+    }
+    if (!line.starts_with("@@ ")) {
+      continue;
+    }
+    if (!ParseHunkHeader(line, old_lines_remaining, new_line,
+                         new_lines_remaining)) {
+      error_message = "Malformed hunk header: " + line.str();
+      return std::nullopt;
+    }
+    if (!in_file) {
+      error_message = "Hunk header without a preceding file header: " +
+                      line.str();
+      return std::nullopt;
+    }
+  }
+  if (old_lines_remaining > 0 || new_lines_remaining > 0) {
+    error_message = "The diff ends in the middle of a hunk.";
+    return std::nullopt;
+  }
+
+  result.Normalise();
+  return result;
+}
+
+std::optional<LineRanges> LineRanges::ParseLlvmCovExport(
+    const std::string& json_text, std::string& error_message) {
+  const std::optional<ExecutionProfile> execution_profile =
+      ExecutionProfile::ParseLlvmCovExport(json_text, error_message);
+  if (!execution_profile.has_value()) {
+    return std::nullopt;
+  }
+  LineRanges result;
+  for (const auto& [filename, segments] :
+       execution_profile->GetSegmentsForFiles()) {
+    std::vector<Range> ranges;
+    for (size_t index = 0; index < segments.size(); index++) {
+      const ExecutionProfile::Segment& segment = segments[index];
+      if (!segment.has_count || segment.count == 0) {
+        continue;
+      }
+      unsigned last_line = segment.line;
+      if (index + 1 < segments.size()) {
+        // The executed code extends to the start of the next segment, which
+        // does not cover its line if it starts at the first column.
+        const ExecutionProfile::Segment& next_segment = segments[index + 1];
+        last_line = std::max(last_line, next_segment.column > 1
+                                            ? next_segment.line
+                                            : next_segment.line - 1);
+      }
+      ranges.push_back({segment.line, last_line});
+    }
+    result.ranges_for_files_.emplace_back(filename, std::move(ranges));
+  }
+  result.Normalise();
+  return result;
+}
+
+std::optional<LineRanges> LineRanges::ParseGcov(const std::string& gcov_text,
+                                                std::string& error_message) {
+  std::optional<std::string> source_path;
+  std::vector<Range> ranges;
+  llvm::StringRef remaining_text(gcov_text);
+  while (!remaining_text.empty()) {
+    llvm::StringRef line;
+    std::tie(line, remaining_text) = remaining_text.split('\n');
+    line = line.rtrim("\r");
+    // Lines describing source code have the form "count:line_number:source".
+    // Other lines, e.g. describing calls and branches, are ignored.
+    auto [count, rest] = line.split(':');
+    auto [line_number_text, source] = rest.split(':');
+    count = count.trim();
+    unsigned line_number = 0;
+    if (line_number_text.trim().getAsInteger(10, line_number)) {
+      continue;
+    }
+    if (line_number == 0) {
+      if (source.consume_front("Source:")) {
+        llvm::StringRef path(source);
+        while (path.consume_front("./") || path.consume_front("../")) {
+          // Keep dropping leading components.
+        }
+        source_path = llvm::sys::path::convert_to_slash(path);
+      }
+      continue;
+    }
+    // A count of "-" denotes a line without code, and "#####" or "=====" a line
+    // that was not executed; otherwise the count is a positive number, possibly
+    // with a suffix such as "*" or "k".
+    count.consume_back("*");
+    if (count.empty() || count == "-" || count.starts_with("#####") ||
+        count.starts_with("=====") || count == "0") {
+      continue;
+    }
+    ranges.push_back({line_number, line_number});
+  }
+  if (!source_path.has_value()) {
+    error_message = "No source file is named.";
+    return std::nullopt;
+  }
+  LineRanges result;
+  result.ranges_for_files_.emplace_back(*source_path, std::move(ranges));
+  result.Normalise();
+  return result;
+}
+
+void LineRanges::Add(const LineRanges& other) {
+  for (const auto& other_ranges_for_file : other.ranges_for_files_) {
+    auto iterator = std::find_if(
+        ranges_for_files_.begin(), ranges_for_files_.end(),
+        [&other_ranges_for_file](const auto& ranges_for_file) -> bool {
+          return ranges_for_file.first == other_ranges_for_file.first;
+        });
+    if (iterator == ranges_for_files_.end()) {
+      ranges_for_files_.push_back(other_ranges_for_file);
+    } else {
+      iterator->second.insert(iterator->second.end(),
+                              other_ranges_for_file.second.begin(),
+                              other_ranges_for_file.second.end());
+    }
+  }
+  Normalise();
+}
+
+void LineRanges::Normalise() {
+  std::erase_if(ranges_for_files_, [](const auto& ranges_for_file) {
+    return ranges_for_file.second.empty();
+  });
+  for (auto& ranges_for_file : ranges_for_files_) {
+    std::vector<Range>& ranges = ranges_for_file.second;
+    std::sort(ranges.begin(), ranges.end(),
+              [](const Range& first, const Range& second) -> bool {
+                return first.first_line < second.first_line;
+              });
+    std::vector<Range> merged_ranges;
+    for (const auto& range : ranges) {
+      if (!merged_ranges.empty() &&
+          range.first_line <= merged_ranges.back().last_line + 1) {
+        merged_ranges.back().last_line =
+            std::max(merged_ranges.back().last_line, range.last_line);
+      } else {
+        merged_ranges.push_back(range);
+      }
+    }
+    ranges = std::move(merged_ranges);
+  }
+}
+
+const std::vector<LineRanges::Range>* LineRanges::GetRangesForFile(
+    const std::string& filename, std::string& error_message) const {
+  return FindReportEntry(ranges_for_files_, filename, error_message);
+}
+
+bool LineRanges::Overlaps(const std::vector<Range>& ranges,
+                          unsigned first_line, unsigned last_line) {
+  // Find the first range that ends at or after |first_line|; the lines overlap
+  // the ranges if and only if that range starts at or before |last_line|.
+  auto iterator = std::lower_bound(
+      ranges.begin(), ranges.end(), first_line,
+      [](const Range& range, unsigned line) -> bool {
+        return range.last_line < line;
+      });
+  return iterator != ranges.end() && iterator->first_line <= last_line;
+}
+
+}  // namespace dredd
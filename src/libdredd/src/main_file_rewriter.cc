@@ -0,0 +1,366 @@
+// Copyright 2024 The Dredd Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libdredd/main_file_rewriter.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "clang/Basic/FileEntry.h"
+#include "clang/Basic/LangOptions.h"
+#include "clang/Basic/SourceLocation.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Lex/Lexer.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace dredd {
+
+MainFileRewriter::MainFileRewriter(const clang::SourceManager& source_manager,
+                                   const clang::LangOptions& lang_options)
+    : source_manager_(&source_manager), lang_options_(&lang_options) {}
+
+void MainFileRewriter::SetSourceManager(
+    const clang::SourceManager& source_manager,
+    const clang::LangOptions& lang_options) {
+  assert(edits_.empty() &&
+         "The source manager should not change once edits have been made.");
+  source_manager_ = &source_manager;
+  lang_options_ = &lang_options;
+}
+
+bool MainFileRewriter::InsertTextBefore(clang::SourceLocation location,
+                                        const std::string& text) {
+  unsigned offset = 0;
+  if (!GetMainFileOffset(location, offset) ||
+      RecordEditedRange(offset, offset)) {
+    return true;
+  }
+  edits_.push_back(
+      {offset, 0, --last_insert_before_order_, current_alternative_, text});
+  edits_sorted_ = false;
+  return false;
+}
+
+bool MainFileRewriter::InsertTextAfterToken(clang::SourceLocation location,
+                                            const std::string& text) {
+  unsigned offset = 0;
+  if (!GetMainFileOffset(location, offset)) {
+    return true;
+  }
+  offset += clang::Lexer::MeasureTokenLength(location, *source_manager_,
+                                             *lang_options_);
+  if (RecordEditedRange(offset, offset)) {
+    return true;
+  }
+  edits_.push_back(
+      {offset, 0, ++last_insert_after_order_, current_alternative_, text});
+  edits_sorted_ = false;
+  return false;
+}
+
+bool MainFileRewriter::ReplaceText(clang::SourceLocation start,
+                                   unsigned length, const std::string& text) {
+  unsigned offset = 0;
+  if (!GetMainFileOffset(start, offset) ||
+      RecordEditedRange(offset, offset + length)) {
+    return true;
+  }
+  edits_.push_back({offset, length, std::numeric_limits<int64_t>::max(),
+                    current_alternative_, text});
+  edits_sorted_ = false;
+  return false;
+}
+
+bool MainFileRewriter::ReplaceText(clang::SourceRange range,
+                                   const std::string& text) {
+  unsigned start_offset = 0;
+  unsigned end_offset = 0;
+  if (!GetMainFileOffset(range.getBegin(), start_offset) ||
+      !GetMainFileOffset(range.getEnd(), end_offset)) {
+    return true;
+  }
+  end_offset += clang::Lexer::MeasureTokenLength(
+      range.getEnd(), *source_manager_, *lang_options_);
+  if (start_offset > end_offset) {
+    // As with clang::Rewriter, a malformed range cannot be replaced.
+    return true;
+  }
+  return ReplaceText(range.getBegin(), end_offset - start_offset, text);
+}
+
+int MainFileRewriter::StartAlternative() {
+  assert(current_alternative_ == 0 && "Alternatives should not be nested.");
+  current_alternative_ = ++last_alternative_;
+  edited_ranges_.emplace_back();
+  return current_alternative_;
+}
+
+void MainFileRewriter::EndAlternative() {
+  assert(current_alternative_ != 0 && "No alternative has been started.");
+  current_alternative_ = 0;
+}
+
+bool MainFileRewriter::ReplaceWithSwitch(
+    clang::SourceRange range, const std::string& selector,
+    const std::vector<SwitchCase>& cases, const std::string& suffix) {
+  std::vector<RegionCopy> copies;
+  std::string preceding_text = "switch (" + selector + ") {";
+  for (const auto& switch_case : cases) {
+    for (int label = switch_case.first_label;
+         label < switch_case.first_label + switch_case.num_labels; label++) {
+      preceding_text += " case " + std::to_string(label) + ":";
+    }
+    preceding_text += " { ";
+    copies.push_back({preceding_text, switch_case.alternative});
+    preceding_text = suffix + " } break;";
+  }
+  copies.push_back({preceding_text + " default: { ", 0});
+  return AddCopiedRegion(range, std::move(copies), suffix + " } }");
+}
+
+bool MainFileRewriter::ReplaceWithTwoCopies(clang::SourceRange range,
+                                            const std::string& prefix,
+                                            const std::string& infix,
+                                            int alternative,
+                                            const std::string& suffix) {
+  return AddCopiedRegion(range, {{prefix, 0}, {infix, alternative}}, suffix);
+}
+
+bool MainFileRewriter::AddCopiedRegion(clang::SourceRange range,
+                                       std::vector<RegionCopy> copies,
+                                       std::string trailing_text) {
+  unsigned begin_offset = 0;
+  unsigned end_offset = 0;
+  if (!GetMainFileOffset(range.getBegin(), begin_offset) ||
+      !GetMainFileOffset(range.getEnd(), end_offset)) {
+    return true;
+  }
+  end_offset += clang::Lexer::MeasureTokenLength(
+      range.getEnd(), *source_manager_, *lang_options_);
+  if (begin_offset >= end_offset ||
+      copied_region_ranges_.Conflicts(begin_offset, end_offset)) {
+    return true;
+  }
+  for (const unsigned boundary : {begin_offset, end_offset}) {
+    // Edits to the main file are applied on both sides of the boundary, and
+    // edits to an alternative are applied only inside the region, so no edit
+    // may straddle the boundary.
+    if (edited_ranges_[0].Conflicts(boundary, boundary) ||
+        alternative_edited_ranges_.Conflicts(boundary, boundary)) {
+      return true;
+    }
+  }
+  copied_region_ranges_.Add(begin_offset, end_offset);
+  copied_region_boundaries_.Add(begin_offset, begin_offset);
+  copied_region_boundaries_.Add(end_offset, end_offset);
+  copied_regions_.push_back({begin_offset, end_offset, std::move(copies),
+                             std::move(trailing_text)});
+  return false;
+}
+
+bool MainFileRewriter::EditedRanges::Conflicts(unsigned begin,
+                                               unsigned end) const {
+  // Nonempty ranges in the set do not conflict with one another, so the
+  // nonempty range that starts closest before |end| is the one that extends
+  // furthest, and it is the only one that needs to be checked.
+  auto range = ranges_.lower_bound(end);
+  if (range != ranges_.begin() && std::prev(range)->second > begin) {
+    return true;
+  }
+  auto insertion_offset = insertion_offsets_.upper_bound(begin);
+  return insertion_offset != insertion_offsets_.end() &&
+         *insertion_offset < end;
+}
+
+void MainFileRewriter::EditedRanges::Add(unsigned begin, unsigned end) {
+  if (begin == end) {
+    insertion_offsets_.insert(begin);
+    return;
+  }
+  auto range = ranges_.lower_bound(end);
+  while (range != ranges_.begin() && std::prev(range)->second > begin) {
+    --range;
+    begin = std::min(begin, range->first);
+    end = std::max(end, range->second);
+    range = ranges_.erase(range);
+  }
+  ranges_.emplace(begin, end);
+}
+
+bool MainFileRewriter::RecordEditedRange(unsigned begin, unsigned end) {
+  // An edit to an alternative is applied alongside the edits to the main file,
+  // while an edit to the main file is applied alongside the edits to every
+  // alternative.
+  EditedRanges& own_ranges = edited_ranges_[current_alternative_];
+  const EditedRanges& other_ranges = current_alternative_ == 0
+                                         ? alternative_edited_ranges_
+                                         : edited_ranges_[0];
+  if (own_ranges.Conflicts(begin, end) || other_ranges.Conflicts(begin, end) ||
+      copied_region_boundaries_.Conflicts(begin, end)) {
+    return true;
+  }
+  own_ranges.Add(begin, end);
+  if (current_alternative_ != 0) {
+    alternative_edited_ranges_.Add(begin, end);
+  }
+  return false;
+}
+
+std::string MainFileRewriter::GetRewrittenText() {
+  std::string result;
+  llvm::raw_string_ostream stream(result);
+  WriteRewrittenText(stream);
+  stream.flush();
+  return result;
+}
+
+bool MainFileRewriter::OverwriteMainFile() {
+  const clang::OptionalFileEntryRef main_file =
+      source_manager_->getFileEntryRefForID(source_manager_->getMainFileID());
+  assert(main_file.has_value() && "The main file should be a file on disk.");
+  // The rewritten text is streamed to a temporary file, which then replaces
+  // the main file. The original text remains available throughout, since it is
+  // held by the source manager.
+  llvm::Error error = llvm::writeToOutput(
+      main_file->getName(), [this](llvm::raw_ostream& stream) -> llvm::Error {
+        WriteRewrittenText(stream);
+        return llvm::Error::success();
+      });
+  if (error) {
+    llvm::errs() << "Error writing " << main_file->getName() << ": "
+                 << llvm::toString(std::move(error)) << "\n";
+    return true;
+  }
+  return false;
+}
+
+bool MainFileRewriter::GetMainFileOffset(clang::SourceLocation location,
+                                         unsigned& offset) const {
+  assert(source_manager_ != nullptr && "No source manager has been set.");
+  if (!location.isFileID()) {
+    return false;
+  }
+  const std::pair<clang::FileID, unsigned> decomposed_location =
+      source_manager_->getDecomposedLoc(location);
+  if (decomposed_location.first != source_manager_->getMainFileID()) {
+    return false;
+  }
+  offset = decomposed_location.second;
+  return true;
+}
+
+void MainFileRewriter::WriteRewrittenText(llvm::raw_ostream& stream) {
+  if (!edits_sorted_) {
+    std::sort(edits_.begin(), edits_.end(),
+              [](const Edit& first, const Edit& second) -> bool {
+                if (first.offset != second.offset) {
+                  return first.offset < second.offset;
+                }
+                return first.order < second.order;
+              });
+    edits_sorted_ = true;
+  }
+  std::sort(copied_regions_.begin(), copied_regions_.end(),
+            [](const CopiedRegion& first, const CopiedRegion& second) -> bool {
+              return first.begin_offset < second.begin_offset;
+            });
+  const llvm::StringRef original_text =
+      source_manager_->getBufferData(source_manager_->getMainFileID());
+  // The offset into the original text up to which it has been written.
+  unsigned position = 0;
+  auto write_edit = [&original_text, &position, &stream](const Edit& edit) {
+    if (edit.alternative != 0) {
+      // The edit was made to an alternative that is not used by any copied
+      // region, so it is discarded.
+      return;
+    }
+    assert(edit.offset >= position &&
+           "An edit targets text that has been replaced.");
+    assert(edit.offset + edit.length <= original_text.size() &&
+           "An edit is out of bounds.");
+    stream << original_text.slice(position, edit.offset) << edit.text;
+    position = edit.offset + edit.length;
+  };
+  size_t edit_index = 0;
+  for (const auto& region : copied_regions_) {
+    assert(region.begin_offset >= position &&
+           "Copied regions should not overlap.");
+    // Edits inside the region are applied to the copies of its text. Edits
+    // made to the main file that insert text at the very start or end of the
+    // region are kept outside the copies: these arise from mutations of the
+    // enclosing code, such as removal of the entire statement.
+    std::vector<const Edit*> region_edits;
+    std::vector<const Edit*> trailing_edits;
+    for (; edit_index < edits_.size() &&
+           edits_[edit_index].offset <= region.end_offset;
+         ++edit_index) {
+      const Edit& edit = edits_[edit_index];
+      if (edit.offset < region.begin_offset ||
+          (edit.offset == region.begin_offset && edit.alternative == 0 &&
+           edit.length == 0)) {
+        write_edit(edit);
+      } else if (edit.offset == region.end_offset && edit.alternative == 0) {
+        trailing_edits.push_back(&edit);
+      } else {
+        assert(edit.offset + edit.length <= region.end_offset &&
+               "An edit straddles the end of a copied region.");
+        region_edits.push_back(&edit);
+      }
+    }
+    stream << original_text.slice(position, region.begin_offset);
+    for (const auto& copy : region.copies) {
+      stream << copy.preceding_text;
+      WriteRegionCopy(original_text, region, region_edits, copy.alternative,
+                      stream);
+    }
+    stream << region.trailing_text;
+    position = region.end_offset;
+    for (const auto* edit : trailing_edits) {
+      write_edit(*edit);
+    }
+  }
+  for (; edit_index < edits_.size(); ++edit_index) {
+    write_edit(edits_[edit_index]);
+  }
+  stream << original_text.substr(position);
+}
+
+void MainFileRewriter::WriteRegionCopy(
+    llvm::StringRef original_text, const CopiedRegion& region,
+    const std::vector<const Edit*>& region_edits, int alternative,
+    llvm::raw_ostream& stream) {
+  unsigned position = region.begin_offset;
+  for (const auto* edit : region_edits) {
+    if (edit->alternative != 0 && edit->alternative != alternative) {
+      continue;
+    }
+    assert(edit->offset >= position &&
+           "An edit targets text that has been replaced.");
+    stream << original_text.slice(position, edit->offset) << edit->text;
+    position = edit->offset + edit->length;
+  }
+  stream << original_text.slice(position, region.end_offset);
+}
+
+}  // namespace dredd
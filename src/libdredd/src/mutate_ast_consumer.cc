@@ -15,15 +15,17 @@
 #include "libdredd/mutate_ast_consumer.h"
 
 #include <cassert>
+#include <cstddef>
 #include <optional>
-#include <set>
 #include <sstream>
 #include <string>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Decl.h"
+#include "clang/AST/DeclBase.h"
 #include "clang/AST/DeclCXX.h"
 #include "clang/AST/Expr.h"
 #include "clang/AST/Type.h"
@@ -34,7 +36,8 @@
 #include "clang/Basic/SourceLocation.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Frontend/CompilerInstance.h"
-#include "clang/Rewrite/Core/Rewriter.h"
+#include "libdredd/dredd_declarations.h"
+#include "libdredd/main_file_rewriter.h"
 #include "libdredd/mutation.h"
 #include "libdredd/util.h"
 #include "llvm/ADT/APInt.h"
@@ -71,8 +74,436 @@ const char* const kDreddPreludeHeadersC =
     "#include <stdio.h>\n"
     "#include <stdlib.h>\n"
     "#include <string.h>\n";
+
+// Additional headers needed to support split-stream execution.
+const char* const kDreddSplitStreamHeadersCpp =
+    "#include <cerrno>\n"
+    "#include <fcntl.h>\n"
+    "#include <sys/types.h>\n"
+    "#include <sys/wait.h>\n"
+    "#include <unistd.h>\n";
+
+const char* const kDreddSplitStreamHeadersC =
+    "#include <errno.h>\n"
+    "#include <fcntl.h>\n"
+    "#include <sys/types.h>\n"
+    "#include <sys/wait.h>\n"
+    "#include <unistd.h>\n";
+
+// Used by mutator functions, and by the functions below, which check ranges of
+// mutations, to skip the mutations that lie outside the smallest range
+// containing all enabled mutations. Until the enabled mutations have been
+// determined, the range covers every mutation in the file, so that
+// __dredd_enabled_mutation gets invoked. This is valid in both C and C++.
+const char* const kDreddEnabledMutationRangeDeclarations =
+    "static thread_local int __dredd_enabled_mutation_range_begin = 0;\n"
+    "static thread_local int __dredd_enabled_mutation_range_end = ";
+
+// The name of the function that determines whether a mutation is enabled. If
+// reached mutants are reported, or split-stream execution is supported,
+// __dredd_enabled_mutation also acts on the mutation being reached, so the
+// functions below, which check whole ranges of mutations before any of them is
+// reached, use the underlying lookup instead.
+const char* GetEnabledMutationLookupFunction(const Options& options) {
+  return options.GetReportReachedMutants() || options.GetSplitStream()
+             ? "__dredd_lookup_enabled_mutation"
+             : "__dredd_enabled_mutation";
+}
+
+// Used by switch statements that choose between copies of a statement to
+// which different mutations have been applied: yields the first enabled
+// mutation in the given range, or -1 if there is none. This is valid in both C
+// and C++.
+std::string GetDreddFirstEnabledMutationFunction(const Options& options) {
+  std::stringstream result;
+  result << "static int __dredd_first_enabled_mutation(int "
+            "first_local_mutation_id, int num_mutations) {\n";
+  result << "  if (!__dredd_some_mutation_enabled) return -1;\n";
+  result << "  int begin = first_local_mutation_id > "
+            "__dredd_enabled_mutation_range_begin ? first_local_mutation_id : "
+            "__dredd_enabled_mutation_range_begin;\n";
+  result << "  int end = first_local_mutation_id + num_mutations < "
+            "__dredd_enabled_mutation_range_end ? first_local_mutation_id + "
+            "num_mutations : __dredd_enabled_mutation_range_end;\n";
+  result << "  for (int i = begin; i < end; i++) {\n";
+  result << "    if (" << GetEnabledMutationLookupFunction(options)
+         << "(i)) return i;\n";
+  result << "  }\n";
+  result << "  return -1;\n";
+  result << "}\n\n";
+  return result.str();
+}
+
+// Used by functions that have separate original and mutated copies of their
+// bodies: determines whether any mutation in the given range is enabled. The
+// result is cached by the caller, as the enabled mutations do not change once
+// they have been determined. This is valid in both C and C++.
+std::string GetDreddMutationEnabledInRangeFunction(const Options& options) {
+  std::stringstream result;
+  result << "static bool __dredd_mutation_enabled_in_range(int "
+            "first_local_mutation_id, int num_mutations, int* cached_result) "
+            "{\n";
+  result << "  if (!__dredd_some_mutation_enabled) return false;\n";
+  result << "  if (*cached_result < 0) {\n";
+  result << "    int begin = first_local_mutation_id > "
+            "__dredd_enabled_mutation_range_begin ? first_local_mutation_id : "
+            "__dredd_enabled_mutation_range_begin;\n";
+  result << "    int end = first_local_mutation_id + num_mutations < "
+            "__dredd_enabled_mutation_range_end ? first_local_mutation_id + "
+            "num_mutations : __dredd_enabled_mutation_range_end;\n";
+  result << "    *cached_result = 0;\n";
+  result << "    for (int i = begin; i < end; i++) {\n";
+  result << "      if (" << GetEnabledMutationLookupFunction(options)
+         << "(i)) {\n";
+  result << "        *cached_result = 1;\n";
+  result << "        break;\n";
+  result << "      }\n";
+  result << "    }\n";
+  result << "  }\n";
+  result << "  return *cached_result != 0;\n";
+  result << "}\n\n";
+  return result.str();
+}
+
+// Used when reached mutants are reported: __dredd_enabled_mutation wraps the
+// lookup of whether a mutation is enabled, and records each enabled mutation
+// the first time that it is reached, i.e. the first time that the branch that
+// applies it is taken. The id of the mutation is appended to the file named by
+// DREDD_REACHED_MUTANTS_FILE, if set, as soon as it is reached, so that this
+// information survives crashes and timeouts. An enabled mutation whose id is
+// absent from the file when the program finishes was not reached. Nothing is
+// done at exit, so the exit handlers and destructors of the program run as
+// usual.
+std::string GetReachedMutantReportingCpp(int initial_mutation_id,
+                                         int num_mutations) {
+  std::stringstream result;
+  result << "static void __dredd_record_reached_mutant(int local_mutation_id) "
+            "{\n";
+  result << "  static std::atomic<bool> already_recorded[" << num_mutations
+         << "];\n";
+  result << "  if (already_recorded[local_mutation_id].load(std::memory_order_"
+            "relaxed) || already_recorded[local_mutation_id].exchange(true)) "
+            "return;\n";
+  result << "  const char* dredd_reached_environment_variable = "
+            "std::getenv(\"DREDD_REACHED_MUTANTS_FILE\");\n";
+  result << "  if (dredd_reached_environment_variable == nullptr) return;\n";
+  result << "  std::ofstream output_file;\n";
+  result << "  output_file.open(dredd_reached_environment_variable, "
+            "std::ios_base::app);\n";
+  result << "  output_file << (" << initial_mutation_id
+         << " + local_mutation_id) << \"\\n\";\n";
+  result << "}\n\n";
+  result << "static bool __dredd_enabled_mutation(int local_mutation_id) {\n";
+  result << "  if (!__dredd_lookup_enabled_mutation(local_mutation_id)) "
+            "return false;\n";
+  result << "  __dredd_record_reached_mutant(local_mutation_id);\n";
+  result << "  return true;\n";
+  result << "}\n\n";
+  return result.str();
+}
+
+// A straightforward port of GetReachedMutantReportingCpp to C.
+std::string GetReachedMutantReportingC(int initial_mutation_id,
+                                       int num_mutations) {
+  std::stringstream result;
+  result << "static void __dredd_record_reached_mutant(int local_mutation_id) "
+            "{\n";
+  result << "  static atomic_bool already_recorded[" << num_mutations
+         << "];\n";
+  result << "  if (atomic_load_explicit(&already_recorded[local_mutation_id], "
+            "memory_order_relaxed) || "
+            "atomic_exchange(&already_recorded[local_mutation_id], 1)) "
+            "return;\n";
+  result << "  const char* dredd_reached_environment_variable = "
+            "getenv(\"DREDD_REACHED_MUTANTS_FILE\");\n";
+  result << "  if (!dredd_reached_environment_variable) return;\n";
+  result << "  FILE* fp = fopen(dredd_reached_environment_variable, \"a\");\n";
+  result << "  if (!fp) return;\n";
+  result << R"(  fprintf(fp, "%d\n", )" << initial_mutation_id
+         << " + local_mutation_id);\n";
+  result << "  fclose(fp);\n";
+  result << "}\n\n";
+  result << "static bool __dredd_enabled_mutation(int local_mutation_id) {\n";
+  result << "  if (!__dredd_lookup_enabled_mutation(local_mutation_id)) "
+            "return 0;\n";
+  result << "  __dredd_record_reached_mutant(local_mutation_id);\n";
+  result << "  return 1;\n";
+  result << "}\n\n";
+  return result.str();
+}
+
+// Used for split-stream execution, which relies on POSIX process creation: the
+// program is run with no mutation enabled, and __dredd_enabled_mutation wraps
+// the lookup of whether a mutation is enabled so that, the first time each
+// mutation is queried, the process forks. Mutator functions that can evaluate
+// their mutants only query a mutation once it infects the program state. The
+// child continues with the mutation enabled, with its output discarded, and
+// the parent waits for it and appends the id of the mutation and the exit
+// status of the child to the file named by DREDD_SPLIT_STREAM_RESULTS_FILE,
+// before continuing with the original program. The exit status of the child is
+// therefore the only indication of whether the mutation was detected. A child
+// never forks, which is recorded in a weak variable shared by all mutated
+// files. Each mutation is claimed atomically, so that two threads that reach it
+// at once do not both fork. If
+// DREDD_SPLIT_STREAM_TIMEOUT is set, a child that runs for longer than the
+// given number of seconds is killed by SIGALRM.
+std::string GetSplitStreamCpp(int initial_mutation_id, int num_mutations) {
+  std::stringstream result;
+  result << "extern \"C\" {\n";
+  result << "__attribute__((weak)) int __dredd_split_stream_child = 0;\n";
+  result << "}\n";
+  result << "static int __dredd_split_stream_mutation = -1;\n";
+  result << "static void __dredd_split_stream(int local_mutation_id) {\n";
+  result << "  static std::atomic<bool> already_split[" << num_mutations
+         << "];\n";
+  result << "  if (__dredd_split_stream_child || "
+            "already_split[local_mutation_id].exchange(true)) return;\n";
+  result << "  const char* dredd_results_environment_variable = "
+            "std::getenv(\"DREDD_SPLIT_STREAM_RESULTS_FILE\");\n";
+  result << "  if (dredd_results_environment_variable == nullptr) return;\n";
+  // Output that is buffered before forking would otherwise be written by both
+  // processes.
+  result << "  std::fflush(nullptr);\n";
+  result << "  pid_t pid = fork();\n";
+  result << "  if (pid == 0) {\n";
+  result << "    __dredd_split_stream_child = 1;\n";
+  result << "    __dredd_split_stream_mutation = local_mutation_id;\n";
+  result << "    __dredd_some_mutation_enabled = true;\n";
+  // Mutated programs that the child starts should not split.
+  result << "    unsetenv(\"DREDD_SPLIT_STREAM_RESULTS_FILE\");\n";
+  result << "    int null_fd = open(\"/dev/null\", O_WRONLY);\n";
+  result << "    if (null_fd >= 0) {\n";
+  result << "      dup2(null_fd, 1);\n";
+  result << "      dup2(null_fd, 2);\n";
+  result << "      close(null_fd);\n";
+  result << "    }\n";
+  result << "    const char* dredd_timeout_environment_variable = "
+            "std::getenv(\"DREDD_SPLIT_STREAM_TIMEOUT\");\n";
+  result << "    if (dredd_timeout_environment_variable != nullptr) "
+            "alarm(static_cast<unsigned>(std::atoi("
+            "dredd_timeout_environment_variable)));\n";
+  result << "    return;\n";
+  result << "  }\n";
+  result << "  if (pid < 0) return;\n";
+  result << "  int status = 0;\n";
+  result << "  while (waitpid(pid, &status, 0) < 0) {\n";
+  result << "    if (errno != EINTR) return;\n";
+  result << "  }\n";
+  result << "  std::ofstream output_file;\n";
+  result << "  output_file.open(dredd_results_environment_variable, "
+            "std::ios_base::app);\n";
+  result << "  output_file << (" << initial_mutation_id
+         << " + local_mutation_id) << \" \" << (WIFEXITED(status) ? "
+            "WEXITSTATUS(status) : 128 + WTERMSIG(status)) << \"\\n\";\n";
+  result << "}\n\n";
+  // The lookup comes first, so that the mutations enabled in this file are
+  // determined before a child can be forked.
+  result << "static bool __dredd_enabled_mutation(int local_mutation_id) {\n";
+  result << "  const bool enabled = "
+            "__dredd_lookup_enabled_mutation(local_mutation_id);\n";
+  result << "  __dredd_split_stream(local_mutation_id);\n";
+  result << "  return enabled || local_mutation_id == "
+            "__dredd_split_stream_mutation;\n";
+  result << "}\n\n";
+  return result.str();
+}
+
+// A straightforward port of GetSplitStreamCpp to C.
+std::string GetSplitStreamC(int initial_mutation_id, int num_mutations) {
+  std::stringstream result;
+  result << "__attribute__((weak)) int __dredd_split_stream_child = 0;\n";
+  result << "static int __dredd_split_stream_mutation = -1;\n";
+  result << "static void __dredd_split_stream(int local_mutation_id) {\n";
+  result << "  static atomic_bool already_split[" << num_mutations << "];\n";
+  result << "  if (__dredd_split_stream_child || "
+            "atomic_exchange(&already_split[local_mutation_id], 1)) return;\n";
+  result << "  const char* dredd_results_environment_variable = "
+            "getenv(\"DREDD_SPLIT_STREAM_RESULTS_FILE\");\n";
+  result << "  if (!dredd_results_environment_variable) return;\n";
+  result << "  fflush(NULL);\n";
+  result << "  pid_t pid = fork();\n";
+  result << "  if (pid == 0) {\n";
+  result << "    __dredd_split_stream_child = 1;\n";
+  result << "    __dredd_split_stream_mutation = local_mutation_id;\n";
+  result << "    __dredd_some_mutation_enabled = 1;\n";
+  result << "    unsetenv(\"DREDD_SPLIT_STREAM_RESULTS_FILE\");\n";
+  result << "    int null_fd = open(\"/dev/null\", O_WRONLY);\n";
+  result << "    if (null_fd >= 0) {\n";
+  result << "      dup2(null_fd, 1);\n";
+  result << "      dup2(null_fd, 2);\n";
+  result << "      close(null_fd);\n";
+  result << "    }\n";
+  result << "    const char* dredd_timeout_environment_variable = "
+            "getenv(\"DREDD_SPLIT_STREAM_TIMEOUT\");\n";
+  result << "    if (dredd_timeout_environment_variable) "
+            "alarm((unsigned) atoi(dredd_timeout_environment_variable));\n";
+  result << "    return;\n";
+  result << "  }\n";
+  result << "  if (pid < 0) return;\n";
+  result << "  int status = 0;\n";
+  result << "  while (waitpid(pid, &status, 0) < 0) {\n";
+  result << "    if (errno != EINTR) return;\n";
+  result << "  }\n";
+  result << "  FILE* fp = fopen(dredd_results_environment_variable, \"a\");\n";
+  result << "  if (!fp) return;\n";
+  result << R"(  fprintf(fp, "%d %d\n", )" << initial_mutation_id
+         << " + local_mutation_id, WIFEXITED(status) ? WEXITSTATUS(status) : "
+            "128 + WTERMSIG(status));\n";
+  result << "  fclose(fp);\n";
+  result << "}\n\n";
+  result << "static bool __dredd_enabled_mutation(int local_mutation_id) {\n";
+  result << "  bool enabled = "
+            "__dredd_lookup_enabled_mutation(local_mutation_id);\n";
+  result << "  __dredd_split_stream(local_mutation_id);\n";
+  result << "  return enabled || local_mutation_id == "
+            "__dredd_split_stream_mutation;\n";
+  result << "}\n\n";
+  return result.str();
+}
+
+// Used to detect mutants that cause infinite loops: every check of whether a
+// mutation is enabled is counted. If DREDD_MUTATION_CHECK_LIMIT is set and the
+// number of checks exceeds it, the program exits immediately with the status
+// given by DREDD_BUDGET_EXCEEDED_EXIT_CODE, or 124 by default, which is the
+// status used by the 'timeout' command. If DREDD_MUTATION_CHECK_COUNT_FILE is
+// set, the number of checks is appended to the named file when the program
+// exits, so that a limit can be derived from a run of the original program.
+// Checks are counted per process, in a weak variable shared by all mutated
+// files, and the first mutated file whose exit handler runs reports the count,
+// which is recorded in another weak variable. When either environment variable
+// is set, every check is counted, including those made by files that have no
+// enabled mutation.
+std::string GetRuntimeBudgetCpp() {
+  std::stringstream result;
+  result << "extern \"C\" {\n";
+  result << "__attribute__((weak)) unsigned long long "
+            "__dredd_mutation_check_count = 0;\n";
+  result << "__attribute__((weak)) int __dredd_mutation_check_count_reported = "
+            "0;\n";
+  result << "}\n";
+  result << "static long long __dredd_read_mutation_check_limit() {\n";
+  result << "  const char* dredd_limit_environment_variable = "
+            "std::getenv(\"DREDD_MUTATION_CHECK_LIMIT\");\n";
+  result << "  return dredd_limit_environment_variable == nullptr ? -1 : "
+            "std::atoll(dredd_limit_environment_variable);\n";
+  result << "}\n\n";
+  result << "static void __dredd_count_mutation_check() {\n";
+  result << "  static const long long limit = "
+            "__dredd_read_mutation_check_limit();\n";
+  result << "  const unsigned long long count = "
+            "__atomic_fetch_add(&__dredd_mutation_check_count, 1, "
+            "__ATOMIC_RELAXED) + 1;\n";
+  result << "  if (limit < 0 || count <= static_cast<unsigned long "
+            "long>(limit)) return;\n";
+  result << "  const char* dredd_exit_code_environment_variable = "
+            "std::getenv(\"DREDD_BUDGET_EXCEEDED_EXIT_CODE\");\n";
+  result << "  std::fflush(nullptr);\n";
+  result << "  std::_Exit(dredd_exit_code_environment_variable == nullptr ? "
+            "124 : std::atoi(dredd_exit_code_environment_variable));\n";
+  result << "}\n\n";
+  result << "static void __dredd_report_mutation_check_count() {\n";
+  result << "  const char* dredd_count_environment_variable = "
+            "std::getenv(\"DREDD_MUTATION_CHECK_COUNT_FILE\");\n";
+  result << "  if (dredd_count_environment_variable == nullptr || "
+            "__atomic_exchange_n(&__dredd_mutation_check_count_reported, 1, "
+            "__ATOMIC_RELAXED)) return;\n";
+  result << "  const unsigned long long count = "
+            "__atomic_load_n(&__dredd_mutation_check_count, "
+            "__ATOMIC_RELAXED);\n";
+  result << "  if (count == 0) return;\n";
+  result << "  std::ofstream output_file;\n";
+  result << "  output_file.open(dredd_count_environment_variable, "
+            "std::ios_base::app);\n";
+  result << "  output_file << count << \"\\n\";\n";
+  result << "}\n\n";
+  result << "static struct __dredd_mutation_check_count_registration {\n";
+  result << "  __dredd_mutation_check_count_registration() { "
+            "std::atexit(__dredd_report_mutation_check_count); }\n";
+  result << "} __dredd_mutation_check_count_registration_instance;\n\n";
+  return result.str();
+}
+
+// A straightforward port of GetRuntimeBudgetCpp to C.
+std::string GetRuntimeBudgetC() {
+  std::stringstream result;
+  result << "__attribute__((weak)) unsigned long long "
+            "__dredd_mutation_check_count = 0;\n";
+  result << "__attribute__((weak)) int __dredd_mutation_check_count_reported = "
+            "0;\n";
+  result << "static void __dredd_count_mutation_check(void) {\n";
+  result << "  static atomic_llong limit = -2;\n";
+  result << "  long long current_limit = atomic_load_explicit(&limit, "
+            "memory_order_relaxed);\n";
+  result << "  if (current_limit == -2) {\n";
+  result << "    const char* dredd_limit_environment_variable = "
+            "getenv(\"DREDD_MUTATION_CHECK_LIMIT\");\n";
+  result << "    current_limit = dredd_limit_environment_variable ? "
+            "atoll(dredd_limit_environment_variable) : -1;\n";
+  result << "    atomic_store_explicit(&limit, current_limit, "
+            "memory_order_relaxed);\n";
+  result << "  }\n";
+  result << "  unsigned long long count = "
+            "__atomic_fetch_add(&__dredd_mutation_check_count, 1, "
+            "__ATOMIC_RELAXED) + 1;\n";
+  result << "  if (current_limit < 0 || count <= (unsigned long long) "
+            "current_limit) return;\n";
+  result << "  const char* dredd_exit_code_environment_variable = "
+            "getenv(\"DREDD_BUDGET_EXCEEDED_EXIT_CODE\");\n";
+  result << "  fflush(NULL);\n";
+  result << "  _Exit(dredd_exit_code_environment_variable ? "
+            "atoi(dredd_exit_code_environment_variable) : 124);\n";
+  result << "}\n\n";
+  result << "static void __dredd_report_mutation_check_count(void) {\n";
+  result << "  const char* dredd_count_environment_variable = "
+            "getenv(\"DREDD_MUTATION_CHECK_COUNT_FILE\");\n";
+  result << "  if (!dredd_count_environment_variable || "
+            "__atomic_exchange_n(&__dredd_mutation_check_count_reported, 1, "
+            "__ATOMIC_RELAXED)) return;\n";
+  result << "  unsigned long long count = "
+            "__atomic_load_n(&__dredd_mutation_check_count, "
+            "__ATOMIC_RELAXED);\n";
+  result << "  if (count == 0) return;\n";
+  result << "  FILE* fp = fopen(dredd_count_environment_variable, \"a\");\n";
+  result << "  if (!fp) return;\n";
+  result << R"(  fprintf(fp, "%llu\n", count);)" << "\n";
+  result << "  fclose(fp);\n";
+  result << "}\n\n";
+  result << "__attribute__((constructor)) static void "
+            "__dredd_register_mutation_check_count_report(void) {\n";
+  result << "  atexit(__dredd_report_mutation_check_count);\n";
+  result << "}\n\n";
+  return result.str();
+}
+
+// Counts the mutations in the given subtree, ignoring those that have not been
+// selected if only some mutations have been selected.
+size_t CountMutations(
+    const MutationTree& mutation_tree,
+    const MutationTreeNode& mutation_tree_node,
+    const std::optional<std::unordered_set<const Mutation*>>&
+        selected_mutations) {
+  size_t result = 0;
+  for (const auto& mutation : mutation_tree_node.GetMutations()) {
+    if (!selected_mutations.has_value() ||
+        selected_mutations->contains(mutation.get())) {
+      result++;
+    }
+  }
+  for (const size_t child_index : mutation_tree_node.GetChildren()) {
+    result += CountMutations(mutation_tree, mutation_tree.GetNode(child_index),
+                             selected_mutations);
+  }
+  return result;
+}
 }  // namespace
 
+bool MutateAstConsumer::shouldSkipFunctionBody(clang::Decl* decl) {
+  const clang::SourceManager& source_manager =
+      compiler_instance_->getSourceManager();
+  return source_manager.getFileID(source_manager.getExpansionLoc(
+             decl->getBeginLoc())) != source_manager.getMainFileID();
+}
+
 void MutateAstConsumer::HandleTranslationUnit(clang::ASTContext& ast_context) {
   const std::string filename =
       ast_context.getSourceManager()
@@ -87,6 +518,38 @@ void MutateAstConsumer::HandleTranslationUnit(clang::ASTContext& ast_context) {
     return;
   }
 
+  // The reports that restrict mutation must each name this file at most once;
+  // the visitor relies on this having been checked, so that its own lookups
+  // cannot fail.
+  std::string error_message;
+  const bool outside_line_ranges =
+      options_->GetLineRanges().has_value() &&
+      options_->GetLineRanges()->GetRangesForFile(filename, error_message) ==
+          nullptr;
+  const bool outside_covered_lines =
+      options_->GetCoveredLines().has_value() &&
+      options_->GetCoveredLines()->GetRangesForFile(filename, error_message) ==
+          nullptr;
+  if (options_->GetExecutionProfile().has_value()) {
+    (void)options_->GetExecutionProfile()->GetSegmentsForFile(filename,
+                                                              error_message);
+  }
+  if (!error_message.empty()) {
+    clang::DiagnosticsEngine& diagnostics = ast_context.getDiagnostics();
+    diagnostics.Report(
+        ast_context.getSourceManager().getLocForStartOfFile(
+            ast_context.getSourceManager().getMainFileID()),
+        diagnostics.getCustomDiagID(clang::DiagnosticsEngine::Error, "%0"))
+        << error_message;
+    return;
+  }
+  if (outside_line_ranges || outside_covered_lines) {
+    // None of the lines to which mutation is restricted are in this file, so
+    // it is left untouched, without even a prelude.
+    llvm::errs() << "Skipping as no lines of the file are to be mutated\n";
+    return;
+  }
+
   if (options_->GetDumpAsts()) {
     llvm::errs() << "AST:\n";
     ast_context.getTranslationUnitDecl()->dump();
@@ -94,8 +557,14 @@ void MutateAstConsumer::HandleTranslationUnit(clang::ASTContext& ast_context) {
   }
   visitor_->TraverseDecl(ast_context.getTranslationUnitDecl());
 
-  rewriter_.setSourceMgr(compiler_instance_->getSourceManager(),
-                         compiler_instance_->getLangOpts());
+  rewriter_.SetSourceManager(compiler_instance_->getSourceManager(),
+                             compiler_instance_->getLangOpts());
+
+  if (options_->IsSamplingEnabled()) {
+    selected_mutations_ = visitor_->GetMutationSampler().Select(
+        options_->GetSampleRate(), options_->GetMaxMutationSitesPerFile(),
+        options_->GetSamplingSeed(), filename);
+  }
 
   // Recording this makes it possible to keep track of how many mutations have
   // been applied to an individual source file, which allows mutations within
@@ -106,28 +575,26 @@ void MutateAstConsumer::HandleTranslationUnit(clang::ASTContext& ast_context) {
 
   // This is used to collect the various declarations that are introduced by
   // mutations in a manner that avoids duplicates, after which they can be added
-  // to the start of the source file. As lots of duplicates are expected, an
-  // unordered set is used to facilitate efficient lookup. Later, this is
-  // converted to an ordered set so that declarations can be added to the source
-  // file in a deterministic order.
-  std::unordered_set<std::string> dredd_declarations;
+  // to the start of the source file. As lots of duplicates are expected,
+  // declarations are keyed so that a mutation can cheaply determine that its
+  // declaration already exists, without generating it again.
+  DreddDeclarations dredd_declarations;
 
   protobufs::MutationInfoForFile mutation_info_for_file;
 
   protobufs::MutationTreeNode* root_protobuf_mutation_tree_node =
       mutation_info_for_file.add_mutation_tree();
-  ApplyMutations(visitor_->GetMutations(), initial_mutation_id, ast_context,
+  ApplyMutations(visitor_->GetMutations(), visitor_->GetMutations().GetRoot(),
+                 initial_mutation_id, ast_context,
                  mutation_info_for_file, *root_protobuf_mutation_tree_node,
                  dredd_declarations, mutation_info_->has_value());
 
-  if (initial_mutation_id == *mutation_id_) {
-    // No possibilities for mutation were found; nothing else to do.
-    return;
-  }
-
-  RewriteExpressionsInMainFile();
-
-  if (mutation_info_->has_value()) {
+  // Mutation info is recorded for a file that has no mutations if hot sites
+  // were excluded from it, so that it is clear why the file was not mutated.
+  if (mutation_info_->has_value() &&
+      (initial_mutation_id != *mutation_id_ ||
+       !visitor_->GetExcludedHotSites().empty())) {
+    RecordExcludedHotSites(ast_context, mutation_info_for_file);
     mutation_info_for_file.set_filename(
         ast_context.getSourceManager()
             .getFileEntryForID(ast_context.getSourceManager().getMainFileID())
@@ -136,6 +603,13 @@ void MutateAstConsumer::HandleTranslationUnit(clang::ASTContext& ast_context) {
     *mutation_info_->value().add_info_for_files() = mutation_info_for_file;
   }
 
+  if (initial_mutation_id == *mutation_id_) {
+    // No possibilities for mutation were found; nothing else to do.
+    return;
+  }
+
+  RewriteExpressionsInMainFile();
+
   auto& source_manager = ast_context.getSourceManager();
   const clang::SourceLocation start_of_source_file =
       source_manager.translateLineCol(source_manager.getMainFileID(), 1, 1);
@@ -147,14 +621,11 @@ void MutateAstConsumer::HandleTranslationUnit(clang::ASTContext& ast_context) {
          "There is at least one mutation, therefore there must be at least one "
          "function.");
 
-  // Convert the unordered set Dredd declarations into an ordered set and add
-  // them to the source file before the first declaration.
-  std::set<std::string> sorted_dredd_declarations;
-  sorted_dredd_declarations.insert(dredd_declarations.begin(),
-                                   dredd_declarations.end());
-  for (const auto& decl : sorted_dredd_declarations) {
+  // Add the Dredd declarations to the source file before the first
+  // declaration, in sorted order.
+  for (const auto* decl : dredd_declarations.GetSortedDeclarations()) {
     const bool rewriter_result =
-        rewriter_.InsertTextBefore(dredd_prelude_start_location, decl);
+        rewriter_.InsertTextBefore(dredd_prelude_start_location, *decl);
     (void)rewriter_result;  // Keep release-mode compilers happy.
     assert(!rewriter_result && "Rewrite failed.\n");
   }
@@ -169,7 +640,7 @@ void MutateAstConsumer::HandleTranslationUnit(clang::ASTContext& ast_context) {
   (void)rewriter_result;  // Keep release-mode compilers happy.
   assert(!rewriter_result && "Rewrite failed.\n");
 
-  rewriter_result = rewriter_.overwriteChangedFiles();
+  rewriter_result = rewriter_.OverwriteMainFile();
   (void)rewriter_result;  // Keep release mode compilers happy
   assert(!rewriter_result && "Something went wrong emitting rewritten files.");
 }
@@ -264,6 +735,14 @@ std::string MutateAstConsumer::GetRegularDreddPreludeCpp(
 
   std::stringstream result;
   result << kDreddPreludeHeadersCpp;
+  if (options_->GetReportReachedMutants() || options_->GetSplitStream() ||
+      options_->GetRuntimeBudget()) {
+    result << "#include <cstdio>\n";
+    result << "#include <cstdlib>\n";
+  }
+  if (options_->GetSplitStream()) {
+    result << kDreddSplitStreamHeadersCpp;
+  }
   result << "\n";
   result << "#ifdef _MSC_VER\n";
   result << "#define thread_local __declspec(thread)\n";
@@ -276,7 +755,15 @@ std::string MutateAstConsumer::GetRegularDreddPreludeCpp(
   // invoked the first time enabledness is queried. At that point it will get
   // set to false if no mutations are actually enabled.
   result << "static thread_local bool __dredd_some_mutation_enabled = true;\n";
-  result << "static bool __dredd_enabled_mutation(int local_mutation_id) {\n";
+  // The smallest range containing all enabled mutations is also recorded, so
+  // that mutator functions, and ranges of mutations, that do not overlap it can
+  // be skipped cheaply.
+  result << kDreddEnabledMutationRangeDeclarations << num_mutations << ";\n";
+  if (options_->GetRuntimeBudget()) {
+    result << GetRuntimeBudgetCpp();
+  }
+  result << "static bool " << GetEnabledMutationLookupFunction(*options_)
+         << "(int local_mutation_id) {\n";
   result << "  static thread_local bool initialized = false;\n";
   // Array of booleans, one per mutation in this file, determining whether they
   // are enabled.
@@ -285,6 +772,9 @@ std::string MutateAstConsumer::GetRegularDreddPreludeCpp(
   result << "  if (!initialized) {\n";
   // Record locally whether some mutation is enabled.
   result << "    bool some_mutation_enabled = false;\n";
+  result << "    int enabled_mutation_range_begin = " << num_mutations
+         << ";\n";
+  result << "    int enabled_mutation_range_end = 0;\n";
   result << "    const char* dredd_environment_variable = "
             "std::getenv(\"DREDD_ENABLED_MUTATION\");\n";
   result << "    if (dredd_environment_variable != nullptr) {\n";
@@ -320,6 +810,11 @@ std::string MutateAstConsumer::GetRegularDreddPreludeCpp(
             "(local_value % 64));\n";
   // Note that at least one enabled mutation has been encountered.
   result << "            some_mutation_enabled = true;\n";
+  // Widen the range of enabled mutations to include this one.
+  result << "            if (local_value < enabled_mutation_range_begin) "
+            "enabled_mutation_range_begin = local_value;\n";
+  result << "            if (local_value >= enabled_mutation_range_end) "
+            "enabled_mutation_range_end = local_value + 1;\n";
   result << "          }\n";
   result << "        }\n";
   // If the end of the string has been reached, exit the parsing loop.
@@ -333,14 +828,54 @@ std::string MutateAstConsumer::GetRegularDreddPreludeCpp(
   // Initialisation is now complete, and whether at least one mutation is
   // enabled is known.
   result << "    initialized = true;\n";
+  // With split-stream execution, or when mutation checks are being counted or
+  // limited, every mutation is queried even if none is enabled, so that the
+  // program can split when it reaches them, or so that every check is counted.
+  if (options_->GetSplitStream() || options_->GetRuntimeBudget()) {
+    result << "    if (";
+    if (options_->GetSplitStream()) {
+      result << "std::getenv(\"DREDD_SPLIT_STREAM_RESULTS_FILE\") != nullptr";
+    }
+    if (options_->GetSplitStream() && options_->GetRuntimeBudget()) {
+      result << " || ";
+    }
+    if (options_->GetRuntimeBudget()) {
+      result << "std::getenv(\"DREDD_MUTATION_CHECK_COUNT_FILE\") != nullptr "
+                "|| std::getenv(\"DREDD_MUTATION_CHECK_LIMIT\") != nullptr";
+    }
+    result << ") {\n";
+    result << "      some_mutation_enabled = true;\n";
+    result << "      enabled_mutation_range_begin = 0;\n";
+    result << "      enabled_mutation_range_end = " << num_mutations << ";\n";
+    result << "    }\n";
+  }
   result << "    __dredd_some_mutation_enabled = some_mutation_enabled;\n";
+  result << "    __dredd_enabled_mutation_range_begin = "
+            "enabled_mutation_range_begin;\n";
+  result << "    __dredd_enabled_mutation_range_end = "
+            "enabled_mutation_range_end;\n";
   result << "  }\n";
+  if (options_->GetRuntimeBudget()) {
+    result << "  __dredd_count_mutation_check();\n";
+  }
   // Similar to the above, a combination of division, modulo and bit-shifting
   // is used to look up whether this mutant is enabled in the bitset.
   result << "  return (enabled_bitset[local_mutation_id / 64] & "
             "(static_cast<uint64_t>(1) << "
             "(local_mutation_id % 64))) != 0;\n";
   result << "}\n\n";
+  if (options_->GetReportReachedMutants()) {
+    result << GetReachedMutantReportingCpp(initial_mutation_id, num_mutations);
+  }
+  if (options_->GetSplitStream()) {
+    result << GetSplitStreamCpp(initial_mutation_id, num_mutations);
+  }
+  if (statement_schema_used_) {
+    result << GetDreddFirstEnabledMutationFunction(*options_);
+  }
+  if (function_dispatch_used_) {
+    result << GetDreddMutationEnabledInRangeFunction(*options_);
+  }
   return result.str();
 }
 
@@ -391,6 +926,9 @@ std::string MutateAstConsumer::GetRegularDreddPreludeC(
 
   std::stringstream result;
   result << kDreddPreludeHeadersC;
+  if (options_->GetSplitStream()) {
+    result << kDreddSplitStreamHeadersC;
+  }
   result << "\n";
   result << "#ifdef _MSC_VER\n";
   result << "#define thread_local __declspec(thread)\n";
@@ -401,12 +939,20 @@ std::string MutateAstConsumer::GetRegularDreddPreludeC(
   result << "#endif\n";
   result << "\n";
   result << "static thread_local int __dredd_some_mutation_enabled = 1;\n";
-  result << "static bool __dredd_enabled_mutation(int local_mutation_id) {\n";
+  result << kDreddEnabledMutationRangeDeclarations << num_mutations << ";\n";
+  if (options_->GetRuntimeBudget()) {
+    result << GetRuntimeBudgetC();
+  }
+  result << "static bool " << GetEnabledMutationLookupFunction(*options_)
+         << "(int local_mutation_id) {\n";
   result << "  static thread_local int initialized = 0;\n";
   result << "  static thread_local uint64_t enabled_bitset["
          << num_64_bit_words_required << "];\n";
   result << "  if (!initialized) {\n";
   result << "    int some_mutation_enabled = 0;\n";
+  result << "    int enabled_mutation_range_begin = " << num_mutations
+         << ";\n";
+  result << "    int enabled_mutation_range_end = 0;\n";
   result << "    const char* dredd_environment_variable = "
             "getenv(\"DREDD_ENABLED_MUTATION\");\n";
   result << "    if (dredd_environment_variable) {\n";
@@ -424,18 +970,59 @@ std::string MutateAstConsumer::GetRegularDreddPreludeC(
   result << "          enabled_bitset[local_value / 64] |= ((uint64_t) 1 << "
             "(local_value % 64));\n";
   result << "          some_mutation_enabled = 1;\n";
+  result << "          if (local_value < enabled_mutation_range_begin) "
+            "enabled_mutation_range_begin = local_value;\n";
+  result << "          if (local_value >= enabled_mutation_range_end) "
+            "enabled_mutation_range_end = local_value + 1;\n";
   result << "        }\n";
   result << "        token = strtok(NULL, \",\");\n";
   result << "      }\n";
   result << "      free(temp);\n";
   result << "    }\n";
   result << "    initialized = 1;\n";
+  if (options_->GetSplitStream() || options_->GetRuntimeBudget()) {
+    result << "    if (";
+    if (options_->GetSplitStream()) {
+      result << "getenv(\"DREDD_SPLIT_STREAM_RESULTS_FILE\") != NULL";
+    }
+    if (options_->GetSplitStream() && options_->GetRuntimeBudget()) {
+      result << " || ";
+    }
+    if (options_->GetRuntimeBudget()) {
+      result << "getenv(\"DREDD_MUTATION_CHECK_COUNT_FILE\") != NULL || "
+                "getenv(\"DREDD_MUTATION_CHECK_LIMIT\") != NULL";
+    }
+    result << ") {\n";
+    result << "      some_mutation_enabled = 1;\n";
+    result << "      enabled_mutation_range_begin = 0;\n";
+    result << "      enabled_mutation_range_end = " << num_mutations << ";\n";
+    result << "    }\n";
+  }
   result << "    __dredd_some_mutation_enabled = some_mutation_enabled;\n";
+  result << "    __dredd_enabled_mutation_range_begin = "
+            "enabled_mutation_range_begin;\n";
+  result << "    __dredd_enabled_mutation_range_end = "
+            "enabled_mutation_range_end;\n";
   result << "  }\n";
+  if (options_->GetRuntimeBudget()) {
+    result << "  __dredd_count_mutation_check();\n";
+  }
   result
       << "  return enabled_bitset[local_mutation_id / 64] & ((uint64_t) 1 << "
          "(local_mutation_id % 64));\n";
   result << "}\n\n";
+  if (options_->GetReportReachedMutants()) {
+    result << GetReachedMutantReportingC(initial_mutation_id, num_mutations);
+  }
+  if (options_->GetSplitStream()) {
+    result << GetSplitStreamC(initial_mutation_id, num_mutations);
+  }
+  if (statement_schema_used_) {
+    result << GetDreddFirstEnabledMutationFunction(*options_);
+  }
+  if (function_dispatch_used_) {
+    result << GetDreddMutationEnabledInRangeFunction(*options_);
+  }
   return result.str();
 }
 
@@ -473,36 +1060,161 @@ std::string MutateAstConsumer::GetDreddPreludeC(int initial_mutation_id) const {
 }
 
 void MutateAstConsumer::ApplyMutations(
+    const MutationTree& dredd_mutation_tree,
     const MutationTreeNode& dredd_mutation_tree_node, int initial_mutation_id,
     clang::ASTContext& context,
     protobufs::MutationInfoForFile& protobufs_mutation_info_for_file,
     protobufs::MutationTreeNode& protobufs_mutation_tree_node,
-    std::unordered_set<std::string>& dredd_declarations, bool build_tree) {
-  assert(!(dredd_mutation_tree_node.IsEmpty() &&
-           dredd_mutation_tree_node.GetChildren().size() == 1) &&
+    DreddDeclarations& dredd_declarations, bool build_tree) {
+  assert((dredd_mutation_tree_node.IsMarkedForCopying() ||
+          !(dredd_mutation_tree_node.GetMutations().empty() &&
+            dredd_mutation_tree_node.GetChildren().size() == 1)) &&
          "The mutation tree should already be compressed.");
-  for (const auto& child : dredd_mutation_tree_node.GetChildren()) {
-    assert(!child->IsEmpty() &&
+
+  // If the node captures the mutations of a statement that contains enough
+  // mutation sites, each mutation in the subtree is applied to its own copy of
+  // the statement, and the statement is replaced by a switch on the enabled
+  // mutation. This avoids evaluating the nested mutator function calls of the
+  // statement when none of its mutations is enabled.
+  const bool use_statement_schema =
+      ShouldUseStatementSchema(dredd_mutation_tree, dredd_mutation_tree_node);
+  std::vector<MainFileRewriter::SwitchCase> statement_schema_cases;
+  const int statement_schema_first_mutation_id = *mutation_id_;
+  if (use_statement_schema) {
+    statement_schema_cases_ = &statement_schema_cases;
+  }
+
+  // If the node captures the mutations of a function body, all of the
+  // mutations in the subtree are applied to one alternative copy of the body,
+  // and the body is replaced by a check that chooses between this copy and a
+  // copy of the original body. This lets the function run without the
+  // overhead of its mutator function calls when none of its mutations is
+  // enabled.
+  const clang::CompoundStmt* function_dispatch_body =
+      dredd_mutation_tree_node.GetFunctionDispatchBody();
+  const int function_dispatch_first_mutation_id = *mutation_id_;
+  const int function_dispatch_alternative =
+      function_dispatch_body == nullptr ? 0 : rewriter_.StartAlternative();
+
+  for (const size_t child_index : dredd_mutation_tree_node.GetChildren()) {
+    const MutationTreeNode& child = dredd_mutation_tree.GetNode(child_index);
+    assert(!child.IsEmpty() &&
            "The mutation tree should not have empty subtrees.");
     protobufs_mutation_tree_node.add_children(static_cast<uint32_t>(
         protobufs_mutation_info_for_file.mutation_tree_size()));
     protobufs::MutationTreeNode* new_protobufs_mutation_tree_node =
         protobufs_mutation_info_for_file.add_mutation_tree();
-    ApplyMutations(
-        *child, initial_mutation_id, context, protobufs_mutation_info_for_file,
-        *new_protobufs_mutation_tree_node, dredd_declarations, build_tree);
+    ApplyMutations(dredd_mutation_tree, child, initial_mutation_id, context,
+                   protobufs_mutation_info_for_file,
+                   *new_protobufs_mutation_tree_node, dredd_declarations,
+                   build_tree);
   }
 
+  // Mutations are applied serially, in tree order: applying a mutation edits
+  // the shared rewriter and claims the next mutation ids, so the order of
+  // application determines both the rewritten file and the ids of mutants,
+  // which must follow the order of the mutation tree.
   for (const auto& mutation : dredd_mutation_tree_node.GetMutations()) {
+    if (selected_mutations_.has_value() &&
+        !selected_mutations_->contains(mutation.get())) {
+      // The mutation was not sampled, so it is not instrumented.
+      continue;
+    }
     const int mutation_id_old = *mutation_id_;
-    const auto mutation_group = mutation->Apply(
+    const int alternative = statement_schema_cases_ == nullptr
+                                ? 0
+                                : rewriter_.StartAlternative();
+    auto mutation_group = mutation->Apply(
         context, compiler_instance_->getPreprocessor(), *options_,
         initial_mutation_id, *mutation_id_, rewriter_, dredd_declarations);
+    if (alternative != 0) {
+      rewriter_.EndAlternative();
+      if (*mutation_id_ > mutation_id_old) {
+        statement_schema_cases_->push_back(
+            {mutation_id_old - initial_mutation_id,
+             *mutation_id_ - mutation_id_old, alternative});
+      }
+    }
     if (build_tree && *mutation_id_ > mutation_id_old) {
       // Only add the result of applying the mutation if it had an effect.
-      *protobufs_mutation_tree_node.add_mutation_groups() = mutation_group;
+      *protobufs_mutation_tree_node.add_mutation_groups() =
+          std::move(mutation_group);
+    }
+  }
+
+  if (use_statement_schema) {
+    statement_schema_cases_ = nullptr;
+    if (!statement_schema_cases.empty()) {
+      const int first_local_mutation_id =
+          statement_schema_first_mutation_id - initial_mutation_id;
+      const int num_mutations =
+          *mutation_id_ - statement_schema_first_mutation_id;
+      const bool rewriter_result = rewriter_.ReplaceWithSwitch(
+          GetSourceRangeInMainFile(
+              compiler_instance_->getPreprocessor(),
+              *dredd_mutation_tree_node.GetStatementSchemaStmt()),
+          "__dredd_first_enabled_mutation(" +
+              std::to_string(first_local_mutation_id) + ", " +
+              std::to_string(num_mutations) + ")",
+          statement_schema_cases, ";");
+      (void)rewriter_result;  // Keep release-mode compilers happy.
+      assert(!rewriter_result && "Rewrite failed.\n");
+      statement_schema_used_ = true;
     }
   }
+
+  if (function_dispatch_body != nullptr) {
+    rewriter_.EndAlternative();
+    if (*mutation_id_ > function_dispatch_first_mutation_id) {
+      const bool rewriter_result = rewriter_.ReplaceWithTwoCopies(
+          GetSourceRangeInMainFile(compiler_instance_->getPreprocessor(),
+                                   *function_dispatch_body),
+          "{ static thread_local int __dredd_function_state = -1; if "
+          "(!__dredd_mutation_enabled_in_range(" +
+              std::to_string(function_dispatch_first_mutation_id -
+                             initial_mutation_id) +
+              ", " +
+              std::to_string(*mutation_id_ -
+                             function_dispatch_first_mutation_id) +
+              ", &__dredd_function_state)) ",
+          " else ", function_dispatch_alternative, " }");
+      (void)rewriter_result;  // Keep release-mode compilers happy.
+      assert(!rewriter_result && "Rewrite failed.\n");
+      function_dispatch_used_ = true;
+    }
+  }
+}
+
+void MutateAstConsumer::RecordExcludedHotSites(
+    clang::ASTContext& ast_context,
+    protobufs::MutationInfoForFile& protobufs_mutation_info_for_file) const {
+  for (const auto& [source_range, execution_count] :
+       visitor_->GetExcludedHotSites()) {
+    const InfoForSourceRange info_for_source_range(source_range, ast_context);
+    protobufs::ExcludedHotSite* excluded_hot_site =
+        protobufs_mutation_info_for_file.add_excluded_hot_sites();
+    excluded_hot_site->mutable_start()->set_line(
+        info_for_source_range.GetStartLine());
+    excluded_hot_site->mutable_start()->set_column(
+        info_for_source_range.GetStartColumn());
+    excluded_hot_site->mutable_end()->set_line(
+        info_for_source_range.GetEndLine());
+    excluded_hot_site->mutable_end()->set_column(
+        info_for_source_range.GetEndColumn());
+    excluded_hot_site->set_execution_count(execution_count);
+  }
+}
+
+bool MutateAstConsumer::ShouldUseStatementSchema(
+    const MutationTree& dredd_mutation_tree,
+    const MutationTreeNode& dredd_mutation_tree_node) const {
+  if (statement_schema_cases_ != nullptr ||
+      dredd_mutation_tree_node.GetStatementSchemaStmt() == nullptr) {
+    return false;
+  }
+  return CountMutations(dredd_mutation_tree, dredd_mutation_tree_node,
+                        selected_mutations_) >=
+         static_cast<size_t>(options_->GetStatementSchemaThreshold());
 }
 
 }  // namespace dredd
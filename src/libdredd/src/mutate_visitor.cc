@@ -16,11 +16,14 @@
 
 #include <llvm/ADT/ArrayRef.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
+#include <vector>
 
 #include "clang/AST/Attrs.inc"
 #include "clang/AST/Decl.h"
@@ -38,8 +41,10 @@
 #include "clang/Basic/Builtins.h"
 #include "clang/Basic/LangOptions.h"
 #include "clang/Basic/SourceLocation.h"
+#include "clang/Basic/SourceManager.h"
 #include "clang/Basic/TypeTraits.h"
 #include "clang/Frontend/CompilerInstance.h"
+#include "libdredd/execution_profile.h"
 #include "libdredd/mutation.h"
 #include "libdredd/mutation_remove_stmt.h"
 #include "libdredd/mutation_replace_binary_operator.h"
@@ -54,11 +59,7 @@ namespace dredd {
 
 MutateVisitor::MutateVisitor(const clang::CompilerInstance& compiler_instance,
                              const Options& options)
-    : compiler_instance_(&compiler_instance),
-      options_(&options),
-      mutation_tree_root_() {
-  mutation_tree_path_.push_back(&mutation_tree_root_);
-}
+    : compiler_instance_(&compiler_instance), options_(&options) {}
 
 bool MutateVisitor::IsTypeSupported(const clang::QualType qual_type) {
   if (qual_type.isNull()) {
@@ -98,13 +99,49 @@ bool MutateVisitor::TraverseDecl(clang::Decl* decl) {
     // "catch (...)" leads to a null catch expression.
     return true;
   }
-  if (llvm::dyn_cast<clang::TranslationUnitDecl>(decl) != nullptr) {
+  if (in_function_dispatch_candidate_) {
+    if (const auto* var_decl = llvm::dyn_cast<clang::VarDecl>(decl);
+        var_decl != nullptr && var_decl->isStaticLocal()) {
+      // Each copy of the function body would have its own instance of the
+      // static variable.
+      function_dispatch_candidate_is_valid_ = false;
+    }
+  }
+  if (const auto* translation_unit_decl =
+          llvm::dyn_cast<clang::TranslationUnitDecl>(decl)) {
     // This is the top-level translation unit declaration, so descend into it.
-    const bool result = RecursiveASTVisitor::TraverseDecl(decl);
+    // Only top-level declarations that start in the main file can be mutated,
+    // and typically most top-level declarations come from included files.
+    // Checking where a declaration starts is much cheaper than computing its
+    // source range in the main file, so the declarations from other files are
+    // filtered out here, without being traversed.
+    const clang::SourceManager& source_manager =
+        compiler_instance_->getSourceManager();
+    bool result = true;
+    for (auto* child : translation_unit_decl->decls()) {
+      if (source_manager.getFileID(source_manager.getExpansionLoc(
+              child->getBeginLoc())) != source_manager.getMainFileID()) {
+        continue;
+      }
+      // As in RecursiveASTVisitor, blocks, captured declarations and lambda
+      // classes are not traversed directly, but via the expressions that
+      // introduce them.
+      if (llvm::isa<clang::BlockDecl, clang::CapturedDecl>(child)) {
+        continue;
+      }
+      if (const auto* record_decl = llvm::dyn_cast<clang::CXXRecordDecl>(child);
+          record_decl != nullptr && record_decl->isLambda()) {
+        continue;
+      }
+      if (!TraverseDecl(child)) {
+        result = false;
+        break;
+      }
+    }
     // At this point the translation unit has been fully visited, so the
     // mutation tree that has been built can be made simpler, in preparation for
     // later turning it into a JSON summary.
-    mutation_tree_root_.TidyUp();
+    mutation_tree_.TidyUp();
     return result;
   }
   auto source_range_in_main_file =
@@ -156,8 +193,12 @@ bool MutateVisitor::TraverseDecl(clang::Decl* decl) {
   }
 
   enclosing_decls_.push_back(decl);
+  // Statements nested inside the declaration do not have the current statement
+  // (if any) as their parent.
+  stmt_ancestors_.push_back(nullptr);
   // Consider the declaration for mutation.
   RecursiveASTVisitor::TraverseDecl(decl);
+  stmt_ancestors_.pop_back();
   enclosing_decls_.pop_back();
 
   return true;
@@ -213,6 +254,23 @@ bool MutateVisitor::TraverseStmt(clang::Stmt* stmt) {
     return true;
   }
 
+  if (in_statement_schema_candidate_ &&
+      (llvm::dyn_cast<clang::StmtExpr>(stmt) != nullptr ||
+       llvm::dyn_cast<clang::LabelStmt>(stmt) != nullptr)) {
+    // A label would be duplicated if the enclosing statement were copied, and
+    // statement expressions are an unusual enough construct that it is simplest
+    // to avoid copying them.
+    statement_schema_candidate_is_valid_ = false;
+  }
+
+  if (in_function_dispatch_candidate_ &&
+      (llvm::dyn_cast<clang::LabelStmt>(stmt) != nullptr ||
+       llvm::dyn_cast<clang::AsmStmt>(stmt) != nullptr)) {
+    // Labels, and any labels defined by inline assembly, would be duplicated
+    // if the function body were copied.
+    function_dispatch_candidate_is_valid_ = false;
+  }
+
   // Do not mutate user defined literals.
   // TODO(https://github.com/mc-imperial/dredd/issues/223): Consider supporting
   // them.
@@ -232,13 +290,17 @@ bool MutateVisitor::TraverseStmt(clang::Stmt* stmt) {
     return true;
   }
 
+  // The statement has not yet been pushed on to the stack of ancestors, so the
+  // top of the stack is its parent (or null if the parent is not a statement).
+  const clang::Stmt* parent =
+      stmt_ancestors_.empty() ? nullptr : stmt_ancestors_.back();
+
   // Do not mutate under 'sizeof' or 'alignof', as this is guaranteed to yield
   // equivalent mutants. Note that we *do* want to mutate above these
   // expressions, hence we ignore children of such expressions, rather than
   // ignoring the expressions themselves.
   if (const auto* unary_expr_or_type_trait_parent =
-          GetFirstParentOfType<clang::UnaryExprOrTypeTraitExpr>(
-              *stmt, compiler_instance_->getASTContext())) {
+          llvm::dyn_cast_or_null<clang::UnaryExprOrTypeTraitExpr>(parent)) {
     const auto kind = unary_expr_or_type_trait_parent->getKind();
     if (kind == clang::UETT_SizeOf || kind == clang::UETT_AlignOf) {
       return true;
@@ -246,8 +308,7 @@ bool MutateVisitor::TraverseStmt(clang::Stmt* stmt) {
   }
 
   // Do not mutate the condition of a constexpr if statement.
-  if (const auto* if_stmt = GetFirstParentOfType<clang::IfStmt>(
-          *stmt, compiler_instance_->getASTContext())) {
+  if (const auto* if_stmt = llvm::dyn_cast_or_null<clang::IfStmt>(parent)) {
     if (if_stmt->isConstexpr() && if_stmt->getCond() == stmt) {
       return true;
     }
@@ -256,8 +317,8 @@ bool MutateVisitor::TraverseStmt(clang::Stmt* stmt) {
   // Do not mutate the array size expression of C++'s NewExpr.
   // For instance, we do not want to mutate `2` in new `a[2]{3, 4}`,
   // as doing so requires type `a` to have zero-argument constructor.
-  if (const auto* cxx_new_expr = GetFirstParentOfType<clang::CXXNewExpr>(
-          *stmt, compiler_instance_->getASTContext())) {
+  if (const auto* cxx_new_expr =
+          llvm::dyn_cast_or_null<clang::CXXNewExpr>(parent)) {
     if (cxx_new_expr->getArraySize() == stmt) {
       return true;
     }
@@ -288,7 +349,26 @@ bool MutateVisitor::TraverseStmt(clang::Stmt* stmt) {
   // Add a node to the mutation tree to capture any mutations beneath this
   // statement.
   const PushMutationTreeRAII push_mutation_tree(*this);
-  return RecursiveASTVisitor::TraverseStmt(stmt);
+  const bool is_function_dispatch_candidate =
+      IsFunctionDispatchCandidate(*stmt, parent);
+  if (is_function_dispatch_candidate) {
+    in_function_dispatch_candidate_ = true;
+    function_dispatch_candidate_is_valid_ = true;
+  }
+  stmt_ancestors_.push_back(stmt);
+  const bool result = RecursiveASTVisitor::TraverseStmt(stmt);
+  stmt_ancestors_.pop_back();
+  if (is_function_dispatch_candidate) {
+    in_function_dispatch_candidate_ = false;
+    if (function_dispatch_candidate_is_valid_) {
+      // The node that was pushed for the function body captures all of the
+      // mutations in the body; mark it so that the consumer can give the
+      // function separate original and mutated copies of its body.
+      mutation_tree_.SetCurrentFunctionDispatchBody(
+          *llvm::cast<clang::CompoundStmt>(stmt));
+    }
+  }
+  return result;
 }
 
 bool MutateVisitor::TraverseCaseStmt(clang::CaseStmt* case_stmt) {
@@ -298,6 +378,15 @@ bool MutateVisitor::TraverseCaseStmt(clang::CaseStmt* case_stmt) {
   return TraverseStmt(case_stmt->getSubStmt());
 }
 
+bool MutateVisitor::TraverseTypeLoc(clang::TypeLoc type_loc) {
+  // Statements nested inside a type, such as the size expression of a
+  // variable-length array, do not have the current statement as their parent.
+  stmt_ancestors_.push_back(nullptr);
+  const bool result = RecursiveASTVisitor::TraverseTypeLoc(type_loc);
+  stmt_ancestors_.pop_back();
+  return result;
+}
+
 bool MutateVisitor::TraverseConstantArrayTypeLoc(
     clang::ConstantArrayTypeLoc constant_array_type_loc) {
   // Prevent compilers complaining that this method could be made static, and
@@ -399,33 +488,32 @@ void MutateVisitor::HandleUnaryOperator(clang::UnaryOperator* unary_operator) {
     if (unary_operator->getOpcode() == clang::UO_Minus &&
         (MutationReplaceExpr::ExprIsEquivalentToInt(
              *unary_operator->getSubExpr(), 1,
-             compiler_instance_->getASTContext()) ||
+             compiler_instance_->getASTContext(), expr_evaluation_cache_) ||
          MutationReplaceExpr::ExprIsEquivalentToFloat(
              *unary_operator->getSubExpr(), 1.0,
-             compiler_instance_->getASTContext()))) {
+             compiler_instance_->getASTContext(), expr_evaluation_cache_))) {
       return;
     }
 
     if (unary_operator->getOpcode() == clang::UO_Not &&
         (MutationReplaceExpr::ExprIsEquivalentToInt(
              *unary_operator->getSubExpr(), 0,
-             compiler_instance_->getASTContext()) ||
+             compiler_instance_->getASTContext(), expr_evaluation_cache_) ||
          MutationReplaceExpr::ExprIsEquivalentToFloat(
              *unary_operator->getSubExpr(), 0.0,
-             compiler_instance_->getASTContext()) ||
+             compiler_instance_->getASTContext(), expr_evaluation_cache_) ||
          MutationReplaceExpr::ExprIsEquivalentToInt(
              *unary_operator->getSubExpr(), 1,
-             compiler_instance_->getASTContext()) ||
+             compiler_instance_->getASTContext(), expr_evaluation_cache_) ||
          MutationReplaceExpr::ExprIsEquivalentToFloat(
              *unary_operator->getSubExpr(), 1.0,
-             compiler_instance_->getASTContext()))) {
+             compiler_instance_->getASTContext(), expr_evaluation_cache_))) {
       return;
     }
   }
 
-  AddMutation(std::make_unique<MutationReplaceUnaryOperator>(
-      *unary_operator, compiler_instance_->getPreprocessor(),
-      compiler_instance_->getASTContext()));
+  AddMutation(*unary_operator, std::make_unique<MutationReplaceUnaryOperator>(
+                                   *unary_operator, expr_evaluation_cache_));
 }
 
 void MutateVisitor::HandleBinaryOperator(
@@ -471,31 +559,34 @@ void MutateVisitor::HandleBinaryOperator(
   // replacement with a constant in all cases.
   if (options_->GetOptimiseMutations() &&
       (MutationReplaceExpr::ExprIsEquivalentToInt(
-           *binary_operator->getLHS(), 0,
-           compiler_instance_->getASTContext()) ||
+           *binary_operator->getLHS(), 0, compiler_instance_->getASTContext(),
+           expr_evaluation_cache_) ||
        MutationReplaceExpr::ExprIsEquivalentToFloat(
-           *binary_operator->getLHS(), 0.0,
-           compiler_instance_->getASTContext())) &&
+           *binary_operator->getLHS(), 0.0, compiler_instance_->getASTContext(),
+           expr_evaluation_cache_)) &&
       (MutationReplaceExpr::ExprIsEquivalentToInt(
-           *binary_operator->getRHS(), 1,
-           compiler_instance_->getASTContext()) ||
+           *binary_operator->getRHS(), 1, compiler_instance_->getASTContext(),
+           expr_evaluation_cache_) ||
        MutationReplaceExpr::ExprIsEquivalentToFloat(
-           *binary_operator->getRHS(), 1.0,
-           compiler_instance_->getASTContext()))) {
+           *binary_operator->getRHS(), 1.0, compiler_instance_->getASTContext(),
+           expr_evaluation_cache_))) {
     return;
   }
 
-  AddMutation(std::make_unique<MutationReplaceBinaryOperator>(
-      *binary_operator, compiler_instance_->getPreprocessor(),
-      compiler_instance_->getASTContext()));
+  AddMutation(*binary_operator,
+              std::make_unique<MutationReplaceBinaryOperator>(
+                  *binary_operator, expr_evaluation_cache_));
 }
 
 void MutateVisitor::HandleExpr(clang::Expr* expr) {
   // L-values are only mutated by inserting the prefix operators ++ and --, and
   // only under specific circumstances as documented by
   // MutationReplaceExpr::CanMutateLValue.
-  if (expr->isLValue() && !MutationReplaceExpr::CanMutateLValue(
-                              compiler_instance_->getASTContext(), *expr)) {
+  // The parent of the expression is known from the traversal, so there is no
+  // need for the parent to be looked up in the AST context.
+  if (expr->isLValue() &&
+      !MutationReplaceExpr::CanMutateLValue(
+          *expr, GetParentOfType<clang::ImplicitCastExpr>(*expr))) {
     return;
   }
 
@@ -511,8 +602,7 @@ void MutateVisitor::HandleExpr(clang::Expr* expr) {
           compiler_instance_->getASTContext(),
           clang::Expr::NullPointerConstantValueDependence()) !=
       clang::Expr::NPCK_NotNull) {
-    if (const auto* cast_parent = GetFirstParentOfType<clang::CastExpr>(
-            *expr, compiler_instance_->getASTContext())) {
+    if (const auto* cast_parent = GetParentOfType<clang::CastExpr>(*expr)) {
       if (cast_parent->getType()->isAnyPointerType()) {
         return;
       }
@@ -530,8 +620,7 @@ void MutateVisitor::HandleExpr(clang::Expr* expr) {
   // reference can bind to it.
   if (const auto* cast_expr = llvm::dyn_cast<clang::CastExpr>(expr)) {
     if (cast_expr->getSubExpr()->refersToBitField() &&
-        GetFirstParentOfType<clang::MaterializeTemporaryExpr>(
-            *expr, compiler_instance_->getASTContext()) != nullptr) {
+        GetParentOfType<clang::MaterializeTemporaryExpr>(*expr) != nullptr) {
       return;
     }
   }
@@ -546,11 +635,9 @@ void MutateVisitor::HandleExpr(clang::Expr* expr) {
     // arising due to a change of type are unlikely to be all that interesting,
     // and r-value to r-value implicit casts are very common, e.g. occurring
     // whenever a signed literal, such as `1`, is used in an unsigned context.
-    if (const auto* cast_parent = GetFirstParentOfType<clang::CastExpr>(
-            *expr, compiler_instance_->getASTContext())) {
+    if (const auto* cast_parent = GetParentOfType<clang::CastExpr>(*expr)) {
       if (cast_parent->isLValue() == expr->isLValue() &&
-          GetFirstParentOfType<clang::InitListExpr>(
-              *expr, compiler_instance_->getASTContext()) == nullptr) {
+          GetParentOfType<clang::InitListExpr>(*expr) == nullptr) {
         // However, this optimization shouldn't be performed on expressions
         // under Initializer List. This is because: (1) Dredd won't act on the
         // outer implicit cast under Initializer List. (2)  Bypassing this
@@ -569,17 +656,19 @@ void MutateVisitor::HandleExpr(clang::Expr* expr) {
     // captured by inserting an increment before a future use of the l-value (it
     // is not exactly the same, because the future use could be dynamically
     // reached in different manners compared with this statement).
-    if (GetFirstParentOfType<clang::CompoundStmt>(
-            *expr, compiler_instance_->getASTContext()) != nullptr ||
-        GetFirstParentOfType<clang::SwitchCase>(
-            *expr, compiler_instance_->getASTContext()) != nullptr) {
+    if (GetParentOfType<clang::CompoundStmt>(*expr) != nullptr ||
+        GetParentOfType<clang::SwitchCase>(*expr) != nullptr) {
       return;
     }
   }
 
-  AddMutation(std::make_unique<MutationReplaceExpr>(
-      *expr, compiler_instance_->getPreprocessor(),
-      compiler_instance_->getASTContext()));
+  // The parents that the mutation depends on are known from the traversal, so
+  // they are captured now rather than being looked up in the AST context when
+  // the mutation is applied.
+  AddMutation(*expr, std::make_unique<MutationReplaceExpr>(
+                         *expr, GetParentOfType<clang::BinaryOperator>(*expr),
+                         GetInitializerListImplicitCast(*expr),
+                         expr_evaluation_cache_));
 }
 
 bool MutateVisitor::VisitExpr(clang::Expr* expr) {
@@ -603,7 +692,9 @@ bool MutateVisitor::VisitExpr(clang::Expr* expr) {
     return true;
   }
 
-  if (var_decl_source_locations_.contains(expr->getBeginLoc())) {
+  if (std::binary_search(var_decl_source_locations_.begin(),
+                         var_decl_source_locations_.end(),
+                         expr->getBeginLoc())) {
     // The start of the expression coincides with the source location of a
     // variable declaration. This happens when the expression has the form:
     // "auto v = ...", e.g. occurring in "if (auto v = ...)". Here, the source
@@ -677,7 +768,8 @@ bool MutateVisitor::TraverseCompoundStmt(clang::CompoundStmt* compound_stmt) {
     }
     if (options_->GetOptimiseMutations()) {
       if (const auto* expr = llvm::dyn_cast<clang::Expr>(target_stmt)) {
-        if (!expr->HasSideEffects(compiler_instance_->getASTContext())) {
+        if (!expr_evaluation_cache_.HasSideEffects(
+                *expr, compiler_instance_->getASTContext())) {
           // There is no point mutating a side-effect free expression statement.
           continue;
         }
@@ -688,7 +780,22 @@ bool MutateVisitor::TraverseCompoundStmt(clang::CompoundStmt* compound_stmt) {
     // mutations recorded in sibling subtrees of the mutation tree, a mutation
     // tree node is pushed per sub-statement.
     const PushMutationTreeRAII push_mutation_tree(*this);
-    TraverseStmt(target_stmt);
+    if (IsStatementSchemaCandidate(*target_stmt)) {
+      // The mutations arising from the statement's subexpressions are grouped
+      // in a node of their own, so that they can be applied to copies of the
+      // statement. The removal of the statement, added below, is kept apart
+      // from this node, since it applies to the statement as a whole.
+      const PushMutationTreeRAII push_statement_schema_node(*this);
+      in_statement_schema_candidate_ = true;
+      statement_schema_candidate_is_valid_ = true;
+      TraverseStmt(target_stmt);
+      in_statement_schema_candidate_ = false;
+      if (statement_schema_candidate_is_valid_) {
+        mutation_tree_.SetCurrentStatementSchemaStmt(*target_stmt);
+      }
+    } else {
+      TraverseStmt(target_stmt);
+    }
 
     assert(llvm::dyn_cast<clang::SwitchCase>(target_stmt) == nullptr &&
            "target_stmt isn't a SwitchCase due to previous AST traversal.");
@@ -712,19 +819,185 @@ bool MutateVisitor::TraverseCompoundStmt(clang::CompoundStmt* compound_stmt) {
     assert(!enclosing_decls_.empty() &&
            "Statements can only be removed if they are nested in some "
            "declaration.");
-    AddMutation(std::make_unique<MutationRemoveStmt>(
-        *target_stmt, compiler_instance_->getPreprocessor(),
-        compiler_instance_->getASTContext()));
+    AddMutation(*target_stmt,
+                std::make_unique<MutationRemoveStmt>(*target_stmt));
+  }
+  return true;
+}
+
+bool MutateVisitor::IsStatementSchemaCandidate(const clang::Stmt& stmt) const {
+  if (options_->GetStatementSchemaThreshold() <= 0 ||
+      options_->GetOnlyTrackMutantCoverage() ||
+      in_statement_schema_candidate_) {
+    return false;
+  }
+  if (llvm::dyn_cast<clang::Expr>(&stmt) == nullptr &&
+      llvm::dyn_cast<clang::ReturnStmt>(&stmt) == nullptr) {
+    // Copies of the statement are placed in the cases of a switch statement,
+    // which would change the scope of any declaration, and would interfere
+    // with control flow statements such as 'break'.
+    return false;
+  }
+  return GetSourceRangeInMainFile(compiler_instance_->getPreprocessor(), stmt)
+      .isValid();
+}
+
+bool MutateVisitor::IsFunctionDispatchCandidate(
+    const clang::Stmt& stmt, const clang::Stmt* parent) const {
+  if (!options_->GetFunctionDispatch() ||
+      options_->GetOnlyTrackMutantCoverage() ||
+      in_function_dispatch_candidate_ || parent != nullptr ||
+      llvm::dyn_cast<clang::CompoundStmt>(&stmt) == nullptr ||
+      enclosing_decls_.empty()) {
+    return false;
+  }
+  // Only plain compound bodies are considered: the bodies of coroutines and
+  // function-try-blocks are represented by other kinds of statement.
+  const auto* function_decl =
+      llvm::dyn_cast<clang::FunctionDecl>(enclosing_decls_.back());
+  if (function_decl == nullptr || function_decl->getBody() != &stmt) {
+    return false;
+  }
+  if (!compiler_instance_->getLangOpts().CPlusPlus &&
+      function_decl->isInlined() &&
+      function_decl->hasExternalFormalLinkage()) {
+    // The dispatch code declares a static variable in the function body, which
+    // C does not allow in an inline function with external linkage.
+    return false;
+  }
+  return GetSourceRangeInMainFile(compiler_instance_->getPreprocessor(), stmt)
+      .isValid();
+}
+
+bool MutateVisitor::OverlapsLineRanges(const clang::Stmt& stmt) {
+  if (!options_->GetLineRanges().has_value() &&
+      !options_->GetCoveredLines().has_value()) {
+    return true;
+  }
+  const clang::SourceManager& source_manager =
+      compiler_instance_->getSourceManager();
+  const clang::SourceRange source_range =
+      GetSourceRangeInMainFile(compiler_instance_->getPreprocessor(), stmt);
+  if (source_range.isInvalid()) {
+    return false;
+  }
+  const unsigned first_line =
+      source_manager.getSpellingLineNumber(source_range.getBegin());
+  const unsigned last_line =
+      source_manager.getSpellingLineNumber(source_range.getEnd());
+  return OverlapsMainFileRanges(options_->GetLineRanges(),
+                                main_file_line_ranges_, first_line,
+                                last_line) &&
+         OverlapsMainFileRanges(options_->GetCoveredLines(),
+                                main_file_covered_lines_, first_line,
+                                last_line);
+}
+
+bool MutateVisitor::IsHotSite(const clang::Stmt& stmt) {
+  const std::optional<ExecutionProfile>& execution_profile =
+      options_->GetExecutionProfile();
+  if (!execution_profile.has_value()) {
+    return false;
+  }
+  if (hot_stmts_.contains(&stmt)) {
+    return true;
+  }
+  const clang::SourceManager& source_manager =
+      compiler_instance_->getSourceManager();
+  if (!main_file_profile_segments_.has_value()) {
+    std::string error_message;
+    main_file_profile_segments_ = execution_profile->GetSegmentsForFile(
+        source_manager.getFileEntryForID(source_manager.getMainFileID())
+            ->getName()
+            .str(),
+        error_message);
+    assert(error_message.empty() &&
+           "An ambiguous profile should have been rejected by the consumer.");
+  }
+  if (main_file_profile_segments_.value() == nullptr) {
+    // The profile does not cover the main file, so nothing is known to be hot.
+    return false;
   }
+  const clang::SourceRange source_range =
+      GetSourceRangeInMainFile(compiler_instance_->getPreprocessor(), stmt);
+  if (source_range.isInvalid()) {
+    return false;
+  }
+  // As with coverage, a statement or expression is regarded as executed as
+  // often as the code region in which it starts.
+  const std::optional<uint64_t> count = ExecutionProfile::GetCount(
+      *main_file_profile_segments_.value(),
+      source_manager.getSpellingLineNumber(source_range.getBegin()),
+      source_manager.getSpellingColumnNumber(source_range.getBegin()));
+  if (!count.has_value() || count.value() <= options_->GetHotSiteThreshold()) {
+    return false;
+  }
+  hot_stmts_.insert(&stmt);
+  excluded_hot_sites_.emplace_back(source_range, count.value());
   return true;
 }
 
-void MutateVisitor::AddMutation(std::unique_ptr<Mutation> mutation) {
-  mutation_tree_path_.back()->AddMutation(std::move(mutation));
+bool MutateVisitor::OverlapsMainFileRanges(
+    const std::optional<LineRanges>& line_ranges,
+    std::optional<const std::vector<LineRanges::Range>*>& main_file_ranges,
+    unsigned first_line, unsigned last_line) const {
+  if (!line_ranges.has_value()) {
+    return true;
+  }
+  if (!main_file_ranges.has_value()) {
+    const clang::SourceManager& source_manager =
+        compiler_instance_->getSourceManager();
+    std::string error_message;
+    main_file_ranges = line_ranges->GetRangesForFile(
+        source_manager.getFileEntryForID(source_manager.getMainFileID())
+            ->getName()
+            .str(),
+        error_message);
+    assert(error_message.empty() &&
+           "Ambiguous line ranges should have been rejected by the consumer.");
+  }
+  return main_file_ranges.value() != nullptr &&
+         LineRanges::Overlaps(*main_file_ranges.value(), first_line,
+                              last_line);
+}
+
+const clang::Decl* MutateVisitor::GetEnclosingFunction() const {
+  for (auto iterator = enclosing_decls_.rbegin();
+       iterator != enclosing_decls_.rend(); ++iterator) {
+    if (llvm::dyn_cast<clang::FunctionDecl>(*iterator) != nullptr) {
+      return *iterator;
+    }
+  }
+  return nullptr;
+}
+
+void MutateVisitor::AddMutation(const clang::Stmt& mutated_stmt,
+                                std::unique_ptr<Mutation> mutation) {
+  if (!OverlapsLineRanges(mutated_stmt)) {
+    return;
+  }
+  if (IsHotSite(mutated_stmt)) {
+    return;
+  }
+  if (options_->IsSamplingEnabled()) {
+    mutation_sampler_.AddMutation(*mutation, GetEnclosingFunction());
+  }
+  mutation_tree_.AddMutation(std::move(mutation));
 }
 
 bool MutateVisitor::VisitVarDecl(clang::VarDecl* var_decl) {
-  var_decl_source_locations_.insert(var_decl->getLocation());
+  const clang::SourceLocation location = var_decl->getLocation();
+  if (var_decl_source_locations_.empty() ||
+      var_decl_source_locations_.back() < location) {
+    var_decl_source_locations_.push_back(location);
+    return true;
+  }
+  auto insertion_point =
+      std::lower_bound(var_decl_source_locations_.begin(),
+                       var_decl_source_locations_.end(), location);
+  if (*insertion_point != location) {
+    var_decl_source_locations_.insert(insertion_point, location);
+  }
   return true;
 }
 
@@ -749,8 +1022,7 @@ bool MutateVisitor::IsConversionOfEnumToConstructor(
     return false;
   }
   // Check whether the parent expression is a C++ constructor.
-  if (GetFirstParentOfType<clang::CXXConstructExpr>(
-          expr, compiler_instance_->getASTContext()) == nullptr) {
+  if (GetParentOfType<clang::CXXConstructExpr>(expr) == nullptr) {
     return false;
   }
   // Check whether there is an enum constant under the implicit cast.
@@ -762,10 +1034,47 @@ bool MutateVisitor::IsConversionOfEnumToConstructor(
   return llvm::dyn_cast<clang::EnumConstantDecl>(decl_ref_expr->getDecl()) !=
          nullptr;
 }
+const clang::ImplicitCastExpr* MutateVisitor::GetInitializerListImplicitCast(
+    const clang::Expr& expr) const {
+  // Move up through any enclosing parentheses.
+  const clang::Expr* deparenthesized_expr = &expr;
+  while (const auto* paren_expr =
+             GetParentOfType<clang::ParenExpr>(*deparenthesized_expr)) {
+    deparenthesized_expr = paren_expr;
+  }
+  const auto* init_list_expr =
+      GetParentOfType<clang::InitListExpr>(*deparenthesized_expr);
+  if (init_list_expr == nullptr) {
+    return nullptr;
+  }
+  // Only the syntactic form of an initializer list is traversed, and the
+  // implicit casts applied to its elements appear in its semantic form. Due to
+  // brace elision, the semantic form may group the elements into nested
+  // initializer lists that do not appear in the source code.
+  std::vector<const clang::InitListExpr*> semantic_forms = {
+      init_list_expr->isSemanticForm() ? init_list_expr
+                                       : init_list_expr->getSemanticForm()};
+  while (!semantic_forms.empty()) {
+    const clang::InitListExpr* semantic_form = semantic_forms.back();
+    semantic_forms.pop_back();
+    for (const clang::Expr* init : semantic_form->inits()) {
+      if (const auto* implicit_cast_expr =
+              llvm::dyn_cast_or_null<clang::ImplicitCastExpr>(init)) {
+        if (implicit_cast_expr->getSubExpr() == deparenthesized_expr) {
+          return implicit_cast_expr;
+        }
+      } else if (const auto* nested_init_list_expr =
+                     llvm::dyn_cast_or_null<clang::InitListExpr>(init)) {
+        semantic_forms.push_back(nested_init_list_expr);
+      }
+    }
+  }
+  return nullptr;
+}
+
 bool MutateVisitor::IsArgumentToArgumentDependentLookupCall(
     const clang::Expr& expr) const {
-  const auto* call_expr = GetFirstParentOfType<clang::CallExpr>(
-      expr, compiler_instance_->getASTContext());
+  const auto* call_expr = GetParentOfType<clang::CallExpr>(expr);
   return call_expr != nullptr && call_expr->usesADL();
 }
 
@@ -809,9 +1118,8 @@ bool MutateVisitor::MutatingMayAffectArgumentDependentLookup(
           llvm::dyn_cast<clang::CXXMemberCallExpr>(&expr)) {
     const clang::Expr* possible_adl_call_argument = member_call_expr;
     if (const auto* implicit_cast =
-            GetFirstParentOfType<clang::ImplicitCastExpr>(
-                *possible_adl_call_argument,
-                compiler_instance_->getASTContext())) {
+            GetParentOfType<clang::ImplicitCastExpr>(
+                *possible_adl_call_argument)) {
       possible_adl_call_argument = implicit_cast;
     }
     if (IsArgumentToArgumentDependentLookupCall(*possible_adl_call_argument)) {
@@ -829,36 +1137,49 @@ bool MutateVisitor::MayDependOnLifetimeOfMaterializedTemporaryStorage(
     return true;
   }
 
+  if (llvm::dyn_cast<clang::MemberExpr>(&expr) == nullptr &&
+      llvm::dyn_cast<clang::CallExpr>(&expr) == nullptr) {
+    return false;
+  }
+
+  auto memoised_result =
+      may_depend_on_lifetime_of_materialized_temporary_storage_.find(&expr);
+  if (memoised_result !=
+      may_depend_on_lifetime_of_materialized_temporary_storage_.end()) {
+    return memoised_result->second;
+  }
+
+  bool result = false;
   if (const auto* member_expr = llvm::dyn_cast<clang::MemberExpr>(&expr)) {
     // Consider a member expression whose base expression may depend on the
     // lifetime of a materialized temporary. If the member expression yields
     // an lvalue or a pointer, then the member expression itself may depend on
     // the lifetime of the materialized temporary.
     if (member_expr->isLValue() || member_expr->getType()->isPointerType()) {
-      return MayDependOnLifetimeOfMaterializedTemporaryStorage(
+      result = MayDependOnLifetimeOfMaterializedTemporaryStorage(
           *member_expr->getBase());
     }
-    return false;
-  }
-
-  if (const auto* call_expr = llvm::dyn_cast<clang::CallExpr>(&expr)) {
+  } else {
     // Consider a calll expression that returns an lvalue or pointer. If some
     // argument to the call depends on the lifetime of a materialized temporary
     // then the overall call expression may do so too. In practice this occurs
     // in the context of the [] operator on a std::vector. When the target
     // vector is a temporary, the [] operator may yield a reference into
     // storage owned by the temporary.
+    const auto* call_expr = llvm::cast<clang::CallExpr>(&expr);
     if (call_expr->isLValue() || call_expr->getType()->isPointerType()) {
       for (const auto* arg : call_expr->arguments()) {
         if (MayDependOnLifetimeOfMaterializedTemporaryStorage(*arg)) {
-          return true;
+          result = true;
+          break;
         }
       }
     }
-    return false;
   }
 
-  return false;
+  may_depend_on_lifetime_of_materialized_temporary_storage_.insert(
+      {&expr, result});
+  return result;
 }
 
 void MutateVisitor::SaveConstantTemplateArgumentForRewrite(
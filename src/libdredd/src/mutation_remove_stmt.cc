@@ -17,7 +17,7 @@
 #include <cassert>
 #include <sstream>
 #include <string>
-#include <unordered_set>
+#include <utility>
 
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Stmt.h"
@@ -26,37 +26,39 @@
 #include "clang/Lex/Lexer.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Lex/Token.h"
-#include "clang/Rewrite/Core/Rewriter.h"
 #include "clang/Tooling/Transformer/SourceCode.h"
+#include "libdredd/main_file_rewriter.h"
 #include "libdredd/options.h"
 #include "libdredd/util.h"
 
 namespace dredd {
 
-MutationRemoveStmt::MutationRemoveStmt(const clang::Stmt& stmt,
-                                       const clang::Preprocessor& preprocessor,
-                                       const clang::ASTContext& ast_context)
-    : stmt_(&stmt),
-      info_for_source_range_(GetSourceRangeInMainFile(preprocessor, stmt),
-                             ast_context) {}
+MutationRemoveStmt::MutationRemoveStmt(const clang::Stmt& stmt)
+    : stmt_(&stmt) {}
 
 protobufs::MutationGroup MutationRemoveStmt::Apply(
     clang::ASTContext& ast_context, const clang::Preprocessor& preprocessor,
     const Options& options, int first_mutation_id_in_file, int& mutation_id,
-    clang::Rewriter& rewriter,
-    std::unordered_set<std::string>& dredd_declarations) const {
+    MainFileRewriter& rewriter,
+    DreddDeclarations& dredd_declarations) const {
   (void)dredd_declarations;  // Unused.
 
   // The protobuf object for the mutation, which will be wrapped in a
   // MutationGroup.
   protobufs::MutationRemoveStmt inner_result;
   inner_result.set_mutation_id(mutation_id);
-  inner_result.mutable_start()->set_line(info_for_source_range_.GetStartLine());
-  inner_result.mutable_start()->set_column(
-      info_for_source_range_.GetStartColumn());
-  inner_result.mutable_end()->set_line(info_for_source_range_.GetEndLine());
-  inner_result.mutable_end()->set_column(info_for_source_range_.GetEndColumn());
-  *inner_result.mutable_snippet() = info_for_source_range_.GetSnippet();
+  if (options.GetCollectMutationInfo()) {
+    const InfoForSourceRange info_for_source_range(
+        GetSourceRangeInMainFile(preprocessor, *stmt_), ast_context);
+    inner_result.mutable_start()->set_line(
+        info_for_source_range.GetStartLine());
+    inner_result.mutable_start()->set_column(
+        info_for_source_range.GetStartColumn());
+    inner_result.mutable_end()->set_line(info_for_source_range.GetEndLine());
+    inner_result.mutable_end()->set_column(
+        info_for_source_range.GetEndColumn());
+    *inner_result.mutable_snippet() = info_for_source_range.GetSnippet();
+  }
 
   clang::CharSourceRange source_range = clang::CharSourceRange::getTokenRange(
       GetSourceRangeInMainFile(preprocessor, *stmt_));
@@ -156,7 +158,7 @@ protobufs::MutationGroup MutationRemoveStmt::Apply(
   mutation_id++;
 
   protobufs::MutationGroup result;
-  *result.mutable_remove_stmt() = inner_result;
+  *result.mutable_remove_stmt() = std::move(inner_result);
   return result;
 }
 
@@ -16,10 +16,11 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <initializer_list>
 #include <sstream>
 #include <string>
-#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "clang/AST/ASTContext.h"
@@ -29,7 +30,8 @@
 #include "clang/Basic/LangOptions.h"
 #include "clang/Basic/SourceLocation.h"
 #include "clang/Lex/Preprocessor.h"
-#include "clang/Rewrite/Core/Rewriter.h"
+#include "libdredd/dredd_declarations.h"
+#include "libdredd/main_file_rewriter.h"
 #include "libdredd/mutation_replace_expr.h"
 #include "libdredd/options.h"
 #include "libdredd/util.h"
@@ -39,17 +41,9 @@ namespace dredd {
 
 MutationReplaceBinaryOperator::MutationReplaceBinaryOperator(
     const clang::BinaryOperator& binary_operator,
-    const clang::Preprocessor& preprocessor,
-    const clang::ASTContext& ast_context)
+    ExprEvaluationCache& expr_evaluation_cache)
     : binary_operator_(&binary_operator),
-      info_for_overall_expr_(
-          GetSourceRangeInMainFile(preprocessor, binary_operator), ast_context),
-      info_for_lhs_(
-          GetSourceRangeInMainFile(preprocessor, *binary_operator.getLHS()),
-          ast_context),
-      info_for_rhs_(
-          GetSourceRangeInMainFile(preprocessor, *binary_operator.getRHS()),
-          ast_context) {}
+      expr_evaluation_cache_(&expr_evaluation_cache) {}
 
 bool MutationReplaceBinaryOperator::IsRedundantReplacementOperator(
     clang::BinaryOperatorKind operator_kind,
@@ -218,36 +212,48 @@ std::string MutationReplaceBinaryOperator::GetFunctionName(
   // be optimised.
   if (optimise_mutations && !binary_operator_->isAssignmentOp()) {
     if (MutationReplaceExpr::ExprIsEquivalentToInt(*binary_operator_->getRHS(),
-                                                   0, ast_context) ||
+                                                   0, ast_context,
+                                                   *expr_evaluation_cache_) ||
         MutationReplaceExpr::ExprIsEquivalentToFloat(
-            *binary_operator_->getRHS(), 0.0, ast_context)) {
+            *binary_operator_->getRHS(), 0.0, ast_context,
+            *expr_evaluation_cache_)) {
       result += "_rhs_zero";
     } else if (MutationReplaceExpr::ExprIsEquivalentToInt(
-                   *binary_operator_->getRHS(), 1, ast_context) ||
+                   *binary_operator_->getRHS(), 1, ast_context,
+                   *expr_evaluation_cache_) ||
                MutationReplaceExpr::ExprIsEquivalentToFloat(
-                   *binary_operator_->getRHS(), 1.0, ast_context)) {
+                   *binary_operator_->getRHS(), 1.0, ast_context,
+                   *expr_evaluation_cache_)) {
       result += "_rhs_one";
     } else if (MutationReplaceExpr::ExprIsEquivalentToInt(
-                   *binary_operator_->getRHS(), -1, ast_context) ||
+                   *binary_operator_->getRHS(), -1, ast_context,
+                   *expr_evaluation_cache_) ||
                MutationReplaceExpr::ExprIsEquivalentToFloat(
-                   *binary_operator_->getRHS(), -1.0, ast_context)) {
+                   *binary_operator_->getRHS(), -1.0, ast_context,
+                   *expr_evaluation_cache_)) {
       result += "_rhs_minus_one";
     }
 
     if (MutationReplaceExpr::ExprIsEquivalentToInt(*binary_operator_->getLHS(),
-                                                   0, ast_context) ||
+                                                   0, ast_context,
+                                                   *expr_evaluation_cache_) ||
         MutationReplaceExpr::ExprIsEquivalentToFloat(
-            *binary_operator_->getLHS(), 0.0, ast_context)) {
+            *binary_operator_->getLHS(), 0.0, ast_context,
+            *expr_evaluation_cache_)) {
       result += "_lhs_zero";
     } else if (MutationReplaceExpr::ExprIsEquivalentToInt(
-                   *binary_operator_->getLHS(), 1, ast_context) ||
+                   *binary_operator_->getLHS(), 1, ast_context,
+                   *expr_evaluation_cache_) ||
                MutationReplaceExpr::ExprIsEquivalentToFloat(
-                   *binary_operator_->getLHS(), 1.0, ast_context)) {
+                   *binary_operator_->getLHS(), 1.0, ast_context,
+                   *expr_evaluation_cache_)) {
       result += "_lhs_one";
     } else if (MutationReplaceExpr::ExprIsEquivalentToInt(
-                   *binary_operator_->getLHS(), -1, ast_context) ||
+                   *binary_operator_->getLHS(), -1, ast_context,
+                   *expr_evaluation_cache_) ||
                MutationReplaceExpr::ExprIsEquivalentToFloat(
-                   *binary_operator_->getLHS(), -1.0, ast_context)) {
+                   *binary_operator_->getLHS(), -1.0, ast_context,
+                   *expr_evaluation_cache_)) {
       result += "_lhs_minus_one";
     }
   }
@@ -291,17 +297,23 @@ void MutationReplaceBinaryOperator::GenerateArgumentReplacement(
   // constants
   if (!optimise_mutations ||
       !(MutationReplaceExpr::ExprIsEquivalentToInt(*binary_operator_->getLHS(),
-                                                   0, ast_context) ||
+                                                   0, ast_context,
+                                                   *expr_evaluation_cache_) ||
         MutationReplaceExpr::ExprIsEquivalentToFloat(
-            *binary_operator_->getLHS(), 0.0, ast_context) ||
+            *binary_operator_->getLHS(), 0.0, ast_context,
+            *expr_evaluation_cache_) ||
         MutationReplaceExpr::ExprIsEquivalentToInt(*binary_operator_->getLHS(),
-                                                   1, ast_context) ||
+                                                   1, ast_context,
+                                                   *expr_evaluation_cache_) ||
         MutationReplaceExpr::ExprIsEquivalentToFloat(
-            *binary_operator_->getLHS(), 1.0, ast_context) ||
+            *binary_operator_->getLHS(), 1.0, ast_context,
+            *expr_evaluation_cache_) ||
         MutationReplaceExpr::ExprIsEquivalentToInt(*binary_operator_->getLHS(),
-                                                   -1, ast_context) ||
+                                                   -1, ast_context,
+                                                   *expr_evaluation_cache_) ||
         MutationReplaceExpr::ExprIsEquivalentToFloat(
-            *binary_operator_->getLHS(), -1.0, ast_context))) {
+            *binary_operator_->getLHS(), -1.0, ast_context,
+            *expr_evaluation_cache_))) {
     if (!only_track_mutant_coverage) {
       new_function << "  if (__dredd_enabled_mutation(local_mutation_id + "
                    << mutation_id_offset << ")) return " << arg1_evaluated
@@ -318,17 +330,23 @@ void MutationReplaceBinaryOperator::GenerateArgumentReplacement(
   // constants
   if (!optimise_mutations ||
       !(MutationReplaceExpr::ExprIsEquivalentToInt(*binary_operator_->getRHS(),
-                                                   0, ast_context) ||
+                                                   0, ast_context,
+                                                   *expr_evaluation_cache_) ||
         MutationReplaceExpr::ExprIsEquivalentToFloat(
-            *binary_operator_->getRHS(), 0.0, ast_context) ||
+            *binary_operator_->getRHS(), 0.0, ast_context,
+            *expr_evaluation_cache_) ||
         MutationReplaceExpr::ExprIsEquivalentToInt(*binary_operator_->getRHS(),
-                                                   1, ast_context) ||
+                                                   1, ast_context,
+                                                   *expr_evaluation_cache_) ||
         MutationReplaceExpr::ExprIsEquivalentToFloat(
-            *binary_operator_->getRHS(), 1.0, ast_context) ||
+            *binary_operator_->getRHS(), 1.0, ast_context,
+            *expr_evaluation_cache_) ||
         MutationReplaceExpr::ExprIsEquivalentToInt(*binary_operator_->getRHS(),
-                                                   -1, ast_context) ||
+                                                   -1, ast_context,
+                                                   *expr_evaluation_cache_) ||
         MutationReplaceExpr::ExprIsEquivalentToFloat(
-            *binary_operator_->getRHS(), -1.0, ast_context))) {
+            *binary_operator_->getRHS(), -1.0, ast_context,
+            *expr_evaluation_cache_))) {
     if (!only_track_mutant_coverage) {
       new_function << "  if (__dredd_enabled_mutation(local_mutation_id + "
                    << mutation_id_offset << ")) return " << arg2_evaluated
@@ -435,38 +453,48 @@ MutationReplaceBinaryOperator::GetReplacementOperators(
   return result;
 }
 
-std::string MutationReplaceBinaryOperator::GenerateMutatorFunction(
-    clang::ASTContext& ast_context, const std::string& function_name,
+std::string MutationReplaceBinaryOperator::GetMutatorFunctionSignature(
+    const clang::ASTContext& ast_context, const std::string& function_name,
     const std::string& result_type, const std::string& lhs_type,
-    const std::string& rhs_type, bool optimise_mutations,
-    bool only_track_mutant_coverage, int& mutation_id,
-    protobufs::MutationReplaceBinaryOperator& protobuf_message) const {
-  std::stringstream new_function;
-  new_function << "static " << result_type << " " << function_name << "(";
+    const std::string& rhs_type) const {
+  std::stringstream signature;
+  signature << "static " << result_type << " " << function_name << "(";
 
   if (ast_context.getLangOpts().CPlusPlus &&
-      binary_operator_->getLHS()->HasSideEffects(ast_context)) {
-    new_function << "std::function<" << lhs_type << "()>";
+      expr_evaluation_cache_->HasSideEffects(*binary_operator_->getLHS(),
+                                             ast_context)) {
+    signature << "std::function<" << lhs_type << "()>";
   } else {
-    new_function << lhs_type;
+    signature << lhs_type;
   }
-  new_function << " arg1, ";
+  signature << " arg1, ";
 
   if (ast_context.getLangOpts().CPlusPlus &&
       (binary_operator_->isLogicalOp() ||
-       binary_operator_->getRHS()->HasSideEffects(ast_context))) {
-    new_function << "std::function<" << rhs_type << "()>";
+       expr_evaluation_cache_->HasSideEffects(*binary_operator_->getRHS(),
+                                              ast_context))) {
+    signature << "std::function<" << rhs_type << "()>";
   } else {
-    new_function << rhs_type;
+    signature << rhs_type;
   }
 
-  new_function << " arg2, int local_mutation_id) {\n";
+  signature << " arg2, int local_mutation_id)";
+  return signature.str();
+}
+
+std::string MutationReplaceBinaryOperator::GenerateMutatorFunction(
+    clang::ASTContext& ast_context, const std::string& signature,
+    bool optimise_mutations, bool only_track_mutant_coverage, int& mutation_id,
+    protobufs::MutationReplaceBinaryOperator& protobuf_message) const {
+  std::stringstream new_function;
+  new_function << signature << " {\n";
 
   int mutation_id_offset = 0;
 
   std::string arg1_evaluated("arg1");
   if (ast_context.getLangOpts().CPlusPlus &&
-      binary_operator_->getLHS()->HasSideEffects(ast_context)) {
+      expr_evaluation_cache_->HasSideEffects(*binary_operator_->getLHS(),
+                                             ast_context)) {
     arg1_evaluated += "()";
   }
   if (!ast_context.getLangOpts().CPlusPlus &&
@@ -477,44 +505,229 @@ std::string MutationReplaceBinaryOperator::GenerateMutatorFunction(
   std::string arg2_evaluated("arg2");
   if (ast_context.getLangOpts().CPlusPlus &&
       (binary_operator_->isLogicalOp() ||
-       binary_operator_->getRHS()->HasSideEffects(ast_context))) {
+       expr_evaluation_cache_->HasSideEffects(*binary_operator_->getRHS(),
+                                              ast_context))) {
     arg2_evaluated += "()";
   }
 
-  if (!only_track_mutant_coverage) {
-    // Quickly apply the original operator if no mutant is enabled (which will
-    // be the common case).
-    new_function << "  if (!__dredd_some_mutation_enabled) return "
-                 << arg1_evaluated << " "
-                 << clang::BinaryOperator::getOpcodeStr(
-                        binary_operator_->getOpcode())
-                        .str()
-                 << " " << arg2_evaluated << ";\n";
-  }
-
+  // The mutations are generated first, so that the fast path below knows how
+  // many of them there are.
+  std::stringstream mutations;
   GenerateBinaryOperatorReplacement(
       arg1_evaluated, arg2_evaluated, ast_context, optimise_mutations,
-      only_track_mutant_coverage, mutation_id, new_function, mutation_id_offset,
+      only_track_mutant_coverage, mutation_id, mutations, mutation_id_offset,
       protobuf_message);
   GenerateArgumentReplacement(arg1_evaluated, arg2_evaluated, ast_context,
                               optimise_mutations, only_track_mutant_coverage,
-                              mutation_id, new_function, mutation_id_offset,
+                              mutation_id, mutations, mutation_id_offset,
                               protobuf_message);
 
+  const std::string original =
+      arg1_evaluated + " " +
+      clang::BinaryOperator::getOpcodeStr(binary_operator_->getOpcode()).str() +
+      " " + arg2_evaluated;
+
+  if (!only_track_mutant_coverage) {
+    // Quickly apply the original operator if no mutant is enabled (which will
+    // be the common case).
+    new_function << GetMutatorFunctionFastPath(mutation_id_offset, original);
+  }
+  new_function << mutations.str();
+
   if (only_track_mutant_coverage) {
     new_function << "  __dredd_record_covered_mutants(local_mutation_id, " +
                         std::to_string(mutation_id_offset) + ");\n";
   }
-  new_function << "  return " << arg1_evaluated << " "
+  new_function << "  return " << original << ";\n";
+
+  new_function << "}\n\n";
+
+  // The function captures |mutation_id_offset| different mutations, so bump up
+  // the mutation id accordingly.
+  mutation_id += mutation_id_offset;
+
+  return new_function.str();
+}
+
+std::string MutationReplaceBinaryOperator::GenerateWeakMutatorFunction(
+    clang::ASTContext& ast_context, const std::string& signature,
+    const std::string& result_type, bool optimise_mutations, bool split_stream,
+    int& mutation_id,
+    protobufs::MutationReplaceBinaryOperator& protobuf_message) const {
+  if (binary_operator_->isAssignmentOp() || binary_operator_->isLogicalOp()) {
+    // Evaluating the alternatives to an assignment would repeat its side
+    // effect, and the alternatives to a logical operator may evaluate an
+    // operand that the original operator skips. Such mutants are therefore
+    // conservatively regarded as infecting whenever they are reached.
+    return GenerateMutatorFunction(ast_context, signature, optimise_mutations,
+                                   !split_stream, mutation_id,
+                                   protobuf_message);
+  }
+
+  std::stringstream new_function;
+  new_function << signature << " {\n";
+
+  // Each operand is evaluated exactly once, as in the original expression.
+  std::string lhs("arg1");
+  if (ast_context.getLangOpts().CPlusPlus &&
+      expr_evaluation_cache_->HasSideEffects(*binary_operator_->getLHS(),
+                                             ast_context)) {
+    new_function << "  auto arg1_value = arg1();\n";
+    lhs = "arg1_value";
+  }
+  std::string rhs("arg2");
+  if (ast_context.getLangOpts().CPlusPlus &&
+      expr_evaluation_cache_->HasSideEffects(*binary_operator_->getRHS(),
+                                             ast_context)) {
+    new_function << "  auto arg2_value = arg2();\n";
+    rhs = "arg2_value";
+  }
+  new_function << "  " << result_type << " original = " << lhs << " "
                << clang::BinaryOperator::getOpcodeStr(
                       binary_operator_->getOpcode())
                       .str()
-               << " " << arg2_evaluated << ";\n";
+               << " " << rhs << ";\n";
 
+  // The mutants are determined exactly as for the regular mutator function;
+  // the operator replacements come first, in the order of
+  // GetReplacementOperators, followed by the argument replacements.
+  int mutation_id_offset = 0;
+  std::stringstream unused_function;
+  GenerateBinaryOperatorReplacement(lhs, rhs, ast_context, optimise_mutations,
+                                    true, mutation_id, unused_function,
+                                    mutation_id_offset, protobuf_message);
+  GenerateArgumentReplacement(lhs, rhs, ast_context, optimise_mutations, true,
+                              mutation_id, unused_function, mutation_id_offset,
+                              protobuf_message);
+  if (split_stream) {
+    new_function << GetMutatorFunctionFastPath(mutation_id_offset, "original");
+  }
+  const std::vector<clang::BinaryOperatorKind> replacement_operators =
+      GetReplacementOperators(optimise_mutations, ast_context);
+
+  const clang::QualType lhs_type = binary_operator_->getLHS()->getType();
+  const clang::QualType rhs_type = binary_operator_->getRHS()->getType();
+  // Pointer arithmetic that leaves the bounds of an object, and the relational
+  // comparison of pointers to different objects, are undefined, and whether
+  // they would occur cannot be checked.
+  const bool has_pointer_operand =
+      lhs_type->isPointerType() || rhs_type->isPointerType();
+  // The operands of an arithmetic operator, and the left operand of a shift
+  // operator, are converted to the type of its result. Replacing the operator
+  // does not change this type.
+  const clang::QualType result_qual_type = binary_operator_->getType();
+  const bool result_is_signed_integer =
+      result_qual_type->isSignedIntegerType();
+  if (result_is_signed_integer && !has_pointer_operand &&
+      std::any_of(replacement_operators.begin(), replacement_operators.end(),
+                  [](clang::BinaryOperatorKind operator_kind) -> bool {
+                    return operator_kind == clang::BO_Add ||
+                           operator_kind == clang::BO_Sub ||
+                           operator_kind == clang::BO_Mul;
+                  })) {
+    new_function << "  " << result_type << " overflow_result;\n";
+  }
+
+  for (int index = 0; index < mutation_id_offset; index++) {
+    std::string replacement;
+    // The value that is compared with the original value to determine whether
+    // the mutant infects the program state.
+    std::string replacement_value;
+    // A mutant that would trap, or whose value is undefined, is regarded as
+    // infecting without being evaluated. An operator replacement with a
+    // pointer operand is always regarded as infecting.
+    std::string undefined_condition;
+    bool always_infected = false;
+    if (static_cast<size_t>(index) < replacement_operators.size()) {
+      const clang::BinaryOperatorKind operator_kind =
+          replacement_operators[static_cast<size_t>(index)];
+      replacement = lhs + " " +
+                    clang::BinaryOperator::getOpcodeStr(operator_kind).str() +
+                    " " + rhs;
+      if (has_pointer_operand) {
+        always_infected = true;
+      } else if ((operator_kind == clang::BO_Add ||
+                  operator_kind == clang::BO_Sub ||
+                  operator_kind == clang::BO_Mul) &&
+                 result_is_signed_integer) {
+        // Signed overflow is undefined. The builtin computes the result as if
+        // with infinite precision, and reports whether it fits in the result
+        // type; if it does, it is the value of the mutant.
+        std::string builtin;
+        if (operator_kind == clang::BO_Add) {
+          builtin = "__builtin_add_overflow";
+        } else if (operator_kind == clang::BO_Sub) {
+          builtin = "__builtin_sub_overflow";
+        } else {
+          builtin = "__builtin_mul_overflow";
+        }
+        undefined_condition =
+            builtin + "(" + lhs + ", " + rhs + ", &overflow_result)";
+        replacement_value = "overflow_result";
+      } else if ((operator_kind == clang::BO_Div ||
+                  operator_kind == clang::BO_Rem) &&
+                 rhs_type->isIntegerType()) {
+        undefined_condition = rhs + " == 0";
+        if (rhs_type->isSignedIntegerType()) {
+          undefined_condition += " || " + rhs + " == -1";
+        }
+      } else if (operator_kind == clang::BO_Shl ||
+                 operator_kind == clang::BO_Shr) {
+        if (!rhs_type->isBooleanType()) {
+          if (rhs_type->isSignedIntegerType()) {
+            undefined_condition = rhs + " < 0 || " + rhs +
+                                  " >= (int)(sizeof(" + lhs + ") * 8)";
+          } else {
+            undefined_condition = rhs + " >= sizeof(" + lhs + ") * 8";
+          }
+        }
+        if (operator_kind == clang::BO_Shl && result_is_signed_integer) {
+          // Shifting a negative value left, or shifting a 1 bit into or
+          // beyond the sign bit, is undefined. The shift amount is known to
+          // be in range by this point.
+          if (!undefined_condition.empty()) {
+            undefined_condition += " || ";
+          }
+          undefined_condition +=
+              lhs + " < 0 || (" + lhs + " >> (" +
+              std::to_string(ast_context.getIntWidth(result_qual_type) - 1) +
+              " - " + rhs + ")) != 0";
+        }
+      }
+    } else {
+      replacement = protobuf_message.instances(index).action() ==
+                            protobufs::MutationReplaceBinaryOperatorAction::
+                                ReplaceWithLHS
+                        ? lhs
+                        : rhs;
+    }
+    if (replacement_value.empty()) {
+      replacement_value = "(" + result_type + ")(" + replacement + ")";
+    }
+    std::stringstream infected;
+    if (!undefined_condition.empty()) {
+      infected << undefined_condition << " || ";
+    }
+    infected << replacement_value << " != original";
+    if (split_stream) {
+      new_function << "  if (";
+      if (!always_infected) {
+        new_function << "(" << infected.str() << ") && ";
+      }
+      new_function << "__dredd_enabled_mutation(local_mutation_id + " << index
+                   << ")) return " << replacement << ";\n";
+    } else {
+      new_function << "  ";
+      if (!always_infected) {
+        new_function << "if (" << infected.str() << ") ";
+      }
+      new_function << "__dredd_record_covered_mutants(local_mutation_id + "
+                   << index << ", 1);\n";
+    }
+  }
+  new_function << "  return original;\n";
   new_function << "}\n\n";
 
-  // The function captures |mutation_id_offset| different mutations, so bump up
-  // the mutation id accordingly.
   mutation_id += mutation_id_offset;
 
   return new_function.str();
@@ -523,8 +736,8 @@ std::string MutationReplaceBinaryOperator::GenerateMutatorFunction(
 protobufs::MutationGroup MutationReplaceBinaryOperator::Apply(
     clang::ASTContext& ast_context, const clang::Preprocessor& preprocessor,
     const Options& options, int first_mutation_id_in_file, int& mutation_id,
-    clang::Rewriter& rewriter,
-    std::unordered_set<std::string>& dredd_declarations) const {
+    MainFileRewriter& rewriter,
+    DreddDeclarations& dredd_declarations) const {
   // The protobuf object for the mutation, which will be wrapped in a
   // MutationGroup.
   protobufs::MutationReplaceBinaryOperator inner_result;
@@ -532,27 +745,39 @@ protobufs::MutationGroup MutationReplaceBinaryOperator::Apply(
   inner_result.set_operator_(
       ClangOperatorKindToProtobufOperatorKind(binary_operator_->getOpcode()));
 
-  inner_result.mutable_expr_start()->set_line(
-      info_for_overall_expr_.GetStartLine());
-  inner_result.mutable_expr_start()->set_column(
-      info_for_overall_expr_.GetStartColumn());
-  inner_result.mutable_expr_end()->set_line(
-      info_for_overall_expr_.GetEndLine());
-  inner_result.mutable_expr_end()->set_column(
-      info_for_overall_expr_.GetEndColumn());
-  *inner_result.mutable_expr_snippet() = info_for_overall_expr_.GetSnippet();
-
-  inner_result.mutable_lhs_start()->set_line(info_for_lhs_.GetStartLine());
-  inner_result.mutable_lhs_start()->set_column(info_for_lhs_.GetStartColumn());
-  inner_result.mutable_lhs_end()->set_line(info_for_lhs_.GetEndLine());
-  inner_result.mutable_lhs_end()->set_column(info_for_lhs_.GetEndColumn());
-  *inner_result.mutable_lhs_snippet() = info_for_lhs_.GetSnippet();
-
-  inner_result.mutable_rhs_start()->set_line(info_for_rhs_.GetStartLine());
-  inner_result.mutable_rhs_start()->set_column(info_for_rhs_.GetStartColumn());
-  inner_result.mutable_rhs_end()->set_line(info_for_rhs_.GetEndLine());
-  inner_result.mutable_rhs_end()->set_column(info_for_rhs_.GetEndColumn());
-  *inner_result.mutable_rhs_snippet() = info_for_rhs_.GetSnippet();
+  if (options.GetCollectMutationInfo()) {
+    const InfoForSourceRange info_for_overall_expr(
+        GetSourceRangeInMainFile(preprocessor, *binary_operator_), ast_context);
+    inner_result.mutable_expr_start()->set_line(
+        info_for_overall_expr.GetStartLine());
+    inner_result.mutable_expr_start()->set_column(
+        info_for_overall_expr.GetStartColumn());
+    inner_result.mutable_expr_end()->set_line(
+        info_for_overall_expr.GetEndLine());
+    inner_result.mutable_expr_end()->set_column(
+        info_for_overall_expr.GetEndColumn());
+    *inner_result.mutable_expr_snippet() = info_for_overall_expr.GetSnippet();
+
+    const InfoForSourceRange info_for_lhs(
+        GetSourceRangeInMainFile(preprocessor, *binary_operator_->getLHS()),
+        ast_context);
+    inner_result.mutable_lhs_start()->set_line(info_for_lhs.GetStartLine());
+    inner_result.mutable_lhs_start()->set_column(
+        info_for_lhs.GetStartColumn());
+    inner_result.mutable_lhs_end()->set_line(info_for_lhs.GetEndLine());
+    inner_result.mutable_lhs_end()->set_column(info_for_lhs.GetEndColumn());
+    *inner_result.mutable_lhs_snippet() = info_for_lhs.GetSnippet();
+
+    const InfoForSourceRange info_for_rhs(
+        GetSourceRangeInMainFile(preprocessor, *binary_operator_->getRHS()),
+        ast_context);
+    inner_result.mutable_rhs_start()->set_line(info_for_rhs.GetStartLine());
+    inner_result.mutable_rhs_start()->set_column(
+        info_for_rhs.GetStartColumn());
+    inner_result.mutable_rhs_end()->set_line(info_for_rhs.GetEndLine());
+    inner_result.mutable_rhs_end()->set_column(info_for_rhs.GetEndColumn());
+    *inner_result.mutable_rhs_snippet() = info_for_rhs.GetSnippet();
+  }
 
   const std::string new_function_name =
       GetFunctionName(options.GetOptimiseMutations(), ast_context);
@@ -582,7 +807,7 @@ protobufs::MutationGroup MutationReplaceBinaryOperator::Apply(
         mutation_id, rewriter, dredd_declarations, inner_result);
 
     protobufs::MutationGroup result;
-    *result.mutable_replace_binary_operator() = inner_result;
+    *result.mutable_replace_binary_operator() = std::move(inner_result);
     return result;
   }
 
@@ -609,18 +834,43 @@ protobufs::MutationGroup MutationReplaceBinaryOperator::Apply(
                   preprocessor, first_mutation_id_in_file, mutation_id,
                   options.GetShowAstNodeTypes(), rewriter);
 
-  const std::string new_function = GenerateMutatorFunction(
-      ast_context, new_function_name, result_type, lhs_type, rhs_type,
-      options.GetOptimiseMutations(), options.GetOnlyTrackMutantCoverage(),
-      mutation_id, inner_result);
-  assert(!new_function.empty() && "Unsupported opcode.");
-
-  // Add the mutation function to the set of Dredd declarations - there may
-  // already be a matching function, in which case duplication will be avoided.
-  dredd_declarations.insert(new_function);
+  // There may already be a matching mutator function, in which case it is not
+  // generated again; it suffices to record the mutation instances that it
+  // provides, as its body is determined by its signature.
+  const std::string signature = GetMutatorFunctionSignature(
+      ast_context, new_function_name, result_type, lhs_type, rhs_type);
+  if (const std::vector<int>* actions = dredd_declarations.Find(signature)) {
+    int mutation_id_offset = 0;
+    for (const int action : *actions) {
+      AddMutationInstance(
+          mutation_id,
+          static_cast<protobufs::MutationReplaceBinaryOperatorAction>(action),
+          mutation_id_offset, inner_result);
+    }
+    mutation_id += mutation_id_offset;
+  } else {
+    std::string new_function =
+        options.GetWeakMutation() || options.GetSplitStream()
+            ? GenerateWeakMutatorFunction(
+                  ast_context, signature, result_type,
+                  options.GetOptimiseMutations(), options.GetSplitStream(),
+                  mutation_id, inner_result)
+            : GenerateMutatorFunction(ast_context, signature,
+                                      options.GetOptimiseMutations(),
+                                      options.GetOnlyTrackMutantCoverage(),
+                                      mutation_id, inner_result);
+    assert(!new_function.empty() && "Unsupported opcode.");
+    std::vector<int> new_actions;
+    new_actions.reserve(static_cast<size_t>(inner_result.instances_size()));
+    for (const auto& instance : inner_result.instances()) {
+      new_actions.push_back(instance.action());
+    }
+    dredd_declarations.Add(signature, std::move(new_function),
+                           std::move(new_actions));
+  }
 
   protobufs::MutationGroup result;
-  *result.mutable_replace_binary_operator() = inner_result;
+  *result.mutable_replace_binary_operator() = std::move(inner_result);
   return result;
 }
 
@@ -629,7 +879,7 @@ void MutationReplaceBinaryOperator::ReplaceOperator(
     const std::string& new_function_name, clang::ASTContext& ast_context,
     const clang::Preprocessor& preprocessor, int first_mutation_id_in_file,
     int mutation_id, bool show_ast_node_types,
-    clang::Rewriter& rewriter) const {
+    MainFileRewriter& rewriter) const {
   const clang::SourceRange lhs_source_range_in_main_file =
       GetSourceRangeInMainFile(preprocessor, *binary_operator_->getLHS());
   assert(lhs_source_range_in_main_file.isValid() && "Invalid source range.");
@@ -676,13 +926,15 @@ void MutationReplaceBinaryOperator::ReplaceOperator(
   std::string rhs_suffix;
 
   if (ast_context.getLangOpts().CPlusPlus) {
-    if (binary_operator_->getLHS()->HasSideEffects(ast_context)) {
+    if (expr_evaluation_cache_->HasSideEffects(*binary_operator_->getLHS(),
+                                               ast_context)) {
       lhs_prefix.append("[&]() -> " + lhs_type + " { return static_cast<" +
                         lhs_type + ">(");
       lhs_suffix.append("); }");
     }
     if (binary_operator_->isLogicalOp() ||
-        binary_operator_->getRHS()->HasSideEffects(ast_context)) {
+        expr_evaluation_cache_->HasSideEffects(*binary_operator_->getRHS(),
+                                               ast_context)) {
       rhs_prefix.append("[&]() -> " + rhs_type + " { return static_cast<" +
                         rhs_type + ">(");
       rhs_suffix.append("); }");
@@ -716,8 +968,8 @@ void MutationReplaceBinaryOperator::HandleCLogicalOperator(
     const std::string& new_function_prefix, const std::string& result_type,
     const std::string& lhs_type, const std::string& rhs_type,
     bool only_track_mutant_coverage, int first_mutation_id_in_file,
-    int& mutation_id, clang::Rewriter& rewriter,
-    std::unordered_set<std::string>& dredd_declarations,
+    int& mutation_id, MainFileRewriter& rewriter,
+    DreddDeclarations& dredd_declarations,
     protobufs::MutationReplaceBinaryOperator& protobuf_message) const {
   // A C logical operator "op" is handled by transforming:
   //
@@ -753,34 +1005,41 @@ void MutationReplaceBinaryOperator::HandleCLogicalOperator(
           source_range_lhs.getEnd(),
           ", " + std::to_string(mutation_id - first_mutation_id_in_file) + ")");
 
-      std::stringstream lhs_function;
-      lhs_function << "static " << lhs_type << " " << lhs_function_name << "("
-                   << lhs_type << " arg, int local_mutation_id) {\n";
-      lhs_function << "  if (!__dredd_some_mutation_enabled) return arg;\n";
-      // Case 0: swapping the operator.
-      // Replacing && with || is achieved by negating the whole expression, and
-      // negating each of the LHS and RHS. The same holds for replacing || with
-      // &&. This case handles negating the LHS.
-      lhs_function << "  if (__dredd_enabled_mutation(local_mutation_id + 0)) "
-                      "return !arg;\n";
-
-      // Case 1: replacing with LHS: no action is needed here.
-
-      // Case 2: replacing with RHS.
-      if (binary_operator_->getOpcode() == clang::BinaryOperatorKind::BO_LAnd) {
-        // Replacing "a && b" with "b" is achieved by replacing "a" with "1".
-        lhs_function
-            << "  if (__dredd_enabled_mutation(local_mutation_id + 2)) "
-               "return 1;\n";
-      } else {
-        // Replacing "a || b" with "b" is achieved by replacing "a" with "0".
+      const std::string lhs_signature = "static " + lhs_type + " " +
+                                        lhs_function_name + "(" + lhs_type +
+                                        " arg, int local_mutation_id)";
+      if (dredd_declarations.Find(lhs_signature) == nullptr) {
+        std::stringstream lhs_function;
+        lhs_function << lhs_signature << " {\n";
+        // The mutations handled here have offsets 0 and 2.
+        lhs_function << GetMutatorFunctionFastPath(3, "arg");
+        // Case 0: swapping the operator.
+        // Replacing && with || is achieved by negating the whole expression,
+        // and negating each of the LHS and RHS. The same holds for replacing ||
+        // with &&. This case handles negating the LHS.
         lhs_function
-            << "  if (__dredd_enabled_mutation(local_mutation_id + 2)) "
-               "return 0;\n";
+            << "  if (__dredd_enabled_mutation(local_mutation_id + 0)) "
+               "return !arg;\n";
+
+        // Case 1: replacing with LHS: no action is needed here.
+
+        // Case 2: replacing with RHS.
+        if (binary_operator_->getOpcode() ==
+            clang::BinaryOperatorKind::BO_LAnd) {
+          // Replacing "a && b" with "b" is achieved by replacing "a" with "1".
+          lhs_function
+              << "  if (__dredd_enabled_mutation(local_mutation_id + 2)) "
+                 "return 1;\n";
+        } else {
+          // Replacing "a || b" with "b" is achieved by replacing "a" with "0".
+          lhs_function
+              << "  if (__dredd_enabled_mutation(local_mutation_id + 2)) "
+                 "return 0;\n";
+        }
+        lhs_function << "  return arg;\n";
+        lhs_function << "}\n";
+        dredd_declarations.Add(lhs_signature, lhs_function.str(), {});
       }
-      lhs_function << "  return arg;\n";
-      lhs_function << "}\n";
-      dredd_declarations.insert(lhs_function.str());
     }
 
     {
@@ -795,35 +1054,42 @@ void MutationReplaceBinaryOperator::HandleCLogicalOperator(
           source_range_rhs.getEnd(),
           ", " + std::to_string(mutation_id - first_mutation_id_in_file) + ")");
 
-      std::stringstream rhs_function;
-      rhs_function << "static " << rhs_type << " " << rhs_function_name << "("
-                   << rhs_type << " arg, int local_mutation_id) {\n";
-      rhs_function << "  if (!__dredd_some_mutation_enabled) return arg;\n";
-      // Case 0: swapping the operator.
-      // Replacing && with || is achieved by negating the whole expression, and
-      // negating each of the LHS and RHS. The same holds for replacing || with
-      // &&. This case handles negating the RHS.
-      rhs_function << "  if (__dredd_enabled_mutation(local_mutation_id + 0)) "
-                      "return !arg;\n";
-
-      // Case 1: replacing with LHS.
-      if (binary_operator_->getOpcode() == clang::BinaryOperatorKind::BO_LAnd) {
-        // Replacing "a && b" with "a" is achieved by replacing "b" with "1".
+      const std::string rhs_signature = "static " + rhs_type + " " +
+                                        rhs_function_name + "(" + rhs_type +
+                                        " arg, int local_mutation_id)";
+      if (dredd_declarations.Find(rhs_signature) == nullptr) {
+        std::stringstream rhs_function;
+        rhs_function << rhs_signature << " {\n";
+        // The mutations handled here have offsets 0 and 1.
+        rhs_function << GetMutatorFunctionFastPath(2, "arg");
+        // Case 0: swapping the operator.
+        // Replacing && with || is achieved by negating the whole expression,
+        // and negating each of the LHS and RHS. The same holds for replacing ||
+        // with &&. This case handles negating the RHS.
         rhs_function
-            << "  if (__dredd_enabled_mutation(local_mutation_id + 1)) "
-               "return 1;\n";
-      } else {
-        // Replacing "a || b" with "a" is achieved by replacing "b" with "0".
-        rhs_function
-            << "  if (__dredd_enabled_mutation(local_mutation_id + 1)) "
-               "return 0;\n";
+            << "  if (__dredd_enabled_mutation(local_mutation_id + 0)) "
+               "return !arg;\n";
+
+        // Case 1: replacing with LHS.
+        if (binary_operator_->getOpcode() ==
+            clang::BinaryOperatorKind::BO_LAnd) {
+          // Replacing "a && b" with "a" is achieved by replacing "b" with "1".
+          rhs_function
+              << "  if (__dredd_enabled_mutation(local_mutation_id + 1)) "
+                 "return 1;\n";
+        } else {
+          // Replacing "a || b" with "a" is achieved by replacing "b" with "0".
+          rhs_function
+              << "  if (__dredd_enabled_mutation(local_mutation_id + 1)) "
+                 "return 0;\n";
+        }
+
+        // Case 2: replacing with RHS: no action is needed here.
+
+        rhs_function << "  return arg;\n";
+        rhs_function << "}\n";
+        dredd_declarations.Add(rhs_signature, rhs_function.str(), {});
       }
-
-      // Case 2: replacing with RHS: no action is needed here.
-
-      rhs_function << "  return arg;\n";
-      rhs_function << "}\n";
-      dredd_declarations.insert(rhs_function.str());
     }
   }
 
@@ -838,34 +1104,39 @@ void MutationReplaceBinaryOperator::HandleCLogicalOperator(
         source_range_binary_operator.getEnd(),
         ", " + std::to_string(mutation_id - first_mutation_id_in_file) + ")");
 
-    std::stringstream outer_function;
-    outer_function << "static " << result_type << " " << outer_function_name
-                   << "(" << result_type << " arg, int local_mutation_id) {\n";
-    if (!only_track_mutant_coverage) {
-      // Case 0: swapping the operator.
-      // Replacing && with || is achieved by negating the whole expression, and
-      // negating each of the LHS and RHS. The same holds for replacing || with
-      // &&. This case handles negating the whole expression.
-      outer_function
-          << "  if (__dredd_enabled_mutation(local_mutation_id + 0)) "
-             "return !arg;\n";
-
-      // Case 1: replacing with LHS: no action is needed here.
-
-      // Case 2: replacing with RHS: no action is needed here.
-    }
-    if (only_track_mutant_coverage) {
-      // The fact that three mutants are covered is recorded, to reflect
-      // swapping the operator, replacing with LHS and replacing with RHS.
-      // It does not matter in which function this is recorded, but intuitively
-      // it seems most elegant for the function enclosing the whole expression
-      // to take care of it.
-      outer_function
-          << "  __dredd_record_covered_mutants(local_mutation_id, 3);\n";
+    const std::string outer_signature = "static " + result_type + " " +
+                                        outer_function_name + "(" +
+                                        result_type +
+                                        " arg, int local_mutation_id)";
+    if (dredd_declarations.Find(outer_signature) == nullptr) {
+      std::stringstream outer_function;
+      outer_function << outer_signature << " {\n";
+      if (!only_track_mutant_coverage) {
+        // Case 0: swapping the operator.
+        // Replacing && with || is achieved by negating the whole expression,
+        // and negating each of the LHS and RHS. The same holds for replacing ||
+        // with &&. This case handles negating the whole expression.
+        outer_function
+            << "  if (__dredd_enabled_mutation(local_mutation_id + 0)) "
+               "return !arg;\n";
+
+        // Case 1: replacing with LHS: no action is needed here.
+
+        // Case 2: replacing with RHS: no action is needed here.
+      }
+      if (only_track_mutant_coverage) {
+        // The fact that three mutants are covered is recorded, to reflect
+        // swapping the operator, replacing with LHS and replacing with RHS.
+        // It does not matter in which function this is recorded, but
+        // intuitively it seems most elegant for the function enclosing the
+        // whole expression to take care of it.
+        outer_function
+            << "  __dredd_record_covered_mutants(local_mutation_id, 3);\n";
+      }
+      outer_function << "  return arg;\n";
+      outer_function << "}\n";
+      dredd_declarations.Add(outer_signature, outer_function.str(), {});
     }
-    outer_function << "  return arg;\n";
-    outer_function << "}\n";
-    dredd_declarations.insert(outer_function.str());
   }
 
   // Record the mutations in the associated protobuf object:
@@ -1087,13 +1358,17 @@ bool MutationReplaceBinaryOperator::IsRedundantReplacementForArithmeticOperator(
   // In the case where both operands are 0, the only case that isn't covered
   // by constant replacement is undefined behaviour, this is achieved by /.
   if ((MutationReplaceExpr::ExprIsEquivalentToInt(*binary_operator_->getLHS(),
-                                                  0, ast_context) ||
+                                                  0, ast_context,
+                                                  *expr_evaluation_cache_) ||
        MutationReplaceExpr::ExprIsEquivalentToFloat(*binary_operator_->getLHS(),
-                                                    0.0, ast_context)) &&
+                                                    0.0, ast_context,
+                                                    *expr_evaluation_cache_)) &&
       (MutationReplaceExpr::ExprIsEquivalentToInt(*binary_operator_->getRHS(),
-                                                  0, ast_context) ||
+                                                  0, ast_context,
+                                                  *expr_evaluation_cache_) ||
        MutationReplaceExpr::ExprIsEquivalentToFloat(*binary_operator_->getRHS(),
-                                                    0.0, ast_context))) {
+                                                    0.0, ast_context,
+                                                    *expr_evaluation_cache_))) {
     if (operator_kind == clang::BO_Div) {
       return false;
     }
@@ -1102,9 +1377,11 @@ bool MutationReplaceBinaryOperator::IsRedundantReplacementForArithmeticOperator(
   // In the following cases, the replacement is equivalent to either replacement
   // with a constant or argument replacement.
   if ((MutationReplaceExpr::ExprIsEquivalentToInt(*binary_operator_->getRHS(),
-                                                  0, ast_context) ||
+                                                  0, ast_context,
+                                                  *expr_evaluation_cache_) ||
        MutationReplaceExpr::ExprIsEquivalentToFloat(*binary_operator_->getRHS(),
-                                                    0.0, ast_context))) {
+                                                    0.0, ast_context,
+                                                    *expr_evaluation_cache_))) {
     // When the right operand is 0: +, -, << and >> are all equivalent to
     // replacement with the right operand; * is equivalent to replacement with
     // the constant 0 and % is equivalent to replacement with / in that both
@@ -1117,9 +1394,11 @@ bool MutationReplaceBinaryOperator::IsRedundantReplacementForArithmeticOperator(
   }
 
   if ((MutationReplaceExpr::ExprIsEquivalentToInt(*binary_operator_->getRHS(),
-                                                  1, ast_context) ||
+                                                  1, ast_context,
+                                                  *expr_evaluation_cache_) ||
        MutationReplaceExpr::ExprIsEquivalentToFloat(*binary_operator_->getRHS(),
-                                                    1.0, ast_context))) {
+                                                    1.0, ast_context,
+                                                    *expr_evaluation_cache_))) {
     // When the right operand is 1: * and / are equivalent to replacement by
     // the left operand.
     if (operator_kind == clang::BO_Mul || operator_kind == clang::BO_Div) {
@@ -1128,9 +1407,11 @@ bool MutationReplaceBinaryOperator::IsRedundantReplacementForArithmeticOperator(
   }
 
   if ((MutationReplaceExpr::ExprIsEquivalentToInt(*binary_operator_->getLHS(),
-                                                  0, ast_context) ||
+                                                  0, ast_context,
+                                                  *expr_evaluation_cache_) ||
        MutationReplaceExpr::ExprIsEquivalentToFloat(*binary_operator_->getLHS(),
-                                                    0.0, ast_context))) {
+                                                    0.0, ast_context,
+                                                    *expr_evaluation_cache_))) {
     // When the left operand is 0: *, /, %, << and >> are equivalent to
     // replacement by the constant 0 and + is equivalent to replacement by the
     // right operand.
@@ -1142,9 +1423,11 @@ bool MutationReplaceBinaryOperator::IsRedundantReplacementForArithmeticOperator(
   }
 
   if ((MutationReplaceExpr::ExprIsEquivalentToInt(*binary_operator_->getLHS(),
-                                                  1, ast_context) ||
+                                                  1, ast_context,
+                                                  *expr_evaluation_cache_) ||
        MutationReplaceExpr::ExprIsEquivalentToFloat(*binary_operator_->getLHS(),
-                                                    1.0, ast_context)) &&
+                                                    1.0, ast_context,
+                                                    *expr_evaluation_cache_)) &&
       operator_kind == clang::BO_Mul) {
     // When the left operand is 1: * is equivalent to replacement by the right
     // operand.
@@ -16,20 +16,23 @@
 
 #include <cassert>
 #include <cctype>
+#include <cstddef>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 #include "clang/AST/APValue.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/ASTTypeTraits.h"
 #include "clang/AST/Expr.h"
 #include "clang/AST/OperationKinds.h"
-#include "clang/AST/ParentMapContext.h"
 #include "clang/AST/Type.h"
 #include "clang/Basic/LangOptions.h"
 #include "clang/Basic/SourceLocation.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Lex/Preprocessor.h"
-#include "clang/Rewrite/Core/Rewriter.h"
+#include "libdredd/dredd_declarations.h"
+#include "libdredd/main_file_rewriter.h"
 #include "libdredd/options.h"
 #include "libdredd/util.h"
 #include "llvm/ADT/APFloat.h"
@@ -59,11 +62,14 @@ bool PrecedingCharacterIsIdentifierCharacter(
 
 namespace dredd {
 dredd::MutationReplaceExpr::MutationReplaceExpr(
-    const clang::Expr& expr, const clang::Preprocessor& preprocessor,
-    const clang::ASTContext& ast_context)
+    const clang::Expr& expr,
+    const clang::BinaryOperator* binary_operator_parent,
+    const clang::ImplicitCastExpr* initializer_list_implicit_cast,
+    ExprEvaluationCache& expr_evaluation_cache)
     : expr_(&expr),
-      info_for_source_range_(GetSourceRangeInMainFile(preprocessor, expr),
-                             ast_context) {}
+      binary_operator_parent_(binary_operator_parent),
+      initializer_list_implicit_cast_(initializer_list_implicit_cast),
+      expr_evaluation_cache_(&expr_evaluation_cache) {}
 
 std::string MutationReplaceExpr::GetFunctionName(
     bool optimise_mutations, clang::ASTContext& ast_context) const {
@@ -104,24 +110,33 @@ void MutationReplaceExpr::AddOptimisationSpecifier(
   if ((expr_->getType()->isIntegerType() &&
        !expr_->getType()->isBooleanType()) ||
       expr_->getType()->isFloatingType()) {
-    if (ExprIsEquivalentToInt(*expr_, 0, ast_context) ||
-        ExprIsEquivalentToFloat(*expr_, 0.0, ast_context)) {
+    if (ExprIsEquivalentToInt(*expr_, 0, ast_context,
+                              *expr_evaluation_cache_) ||
+        ExprIsEquivalentToFloat(*expr_, 0.0, ast_context,
+                                *expr_evaluation_cache_)) {
       function_name += "_zero";
-    } else if (ExprIsEquivalentToInt(*expr_, 1, ast_context) ||
-               ExprIsEquivalentToFloat(*expr_, 1.0, ast_context)) {
+    } else if (ExprIsEquivalentToInt(*expr_, 1, ast_context,
+                                     *expr_evaluation_cache_) ||
+               ExprIsEquivalentToFloat(*expr_, 1.0, ast_context,
+                                       *expr_evaluation_cache_)) {
       function_name += "_one";
-    } else if (ExprIsEquivalentToInt(*expr_, -1, ast_context) ||
-               ExprIsEquivalentToFloat(*expr_, -1.0, ast_context)) {
+    } else if (ExprIsEquivalentToInt(*expr_, -1, ast_context,
+                                     *expr_evaluation_cache_) ||
+               ExprIsEquivalentToFloat(*expr_, -1.0, ast_context,
+                                       *expr_evaluation_cache_)) {
       function_name += "_minus_one";
-    } else if (EvaluateAsInt(*expr_, ast_context, unused_eval_result)) {
+    } else if (expr_evaluation_cache_->EvaluateAsInt(*expr_, ast_context,
+                                                     unused_eval_result)) {
       function_name += "_constant";
     }
   }
 
   if (expr_->getType()->isBooleanType()) {
-    if (ExprIsEquivalentToBool(*expr_, true, ast_context)) {
+    if (ExprIsEquivalentToBool(*expr_, true, ast_context,
+                               *expr_evaluation_cache_)) {
       function_name += "_true";
-    } else if (ExprIsEquivalentToBool(*expr_, false, ast_context)) {
+    } else if (ExprIsEquivalentToBool(*expr_, false, ast_context,
+                                      *expr_evaluation_cache_)) {
       function_name += "_false";
     }
   }
@@ -141,10 +156,11 @@ void MutationReplaceExpr::AddOptimisationSpecifier(
 
 bool MutationReplaceExpr::ExprIsEquivalentToInt(
     const clang::Expr& expr, int constant,
-    const clang::ASTContext& ast_context) {
+    const clang::ASTContext& ast_context,
+    ExprEvaluationCache& expr_evaluation_cache) {
   clang::Expr::EvalResult int_eval_result;
   if (expr.getType()->isIntegerType() &&
-      EvaluateAsInt(expr, ast_context, int_eval_result)) {
+      expr_evaluation_cache.EvaluateAsInt(expr, ast_context, int_eval_result)) {
     return llvm::APSInt::isSameValue(int_eval_result.Val.getInt(),
                                      llvm::APSInt::get(constant));
   }
@@ -154,10 +170,12 @@ bool MutationReplaceExpr::ExprIsEquivalentToInt(
 
 bool MutationReplaceExpr::ExprIsEquivalentToFloat(
     const clang::Expr& expr, double constant,
-    const clang::ASTContext& ast_context) {
+    const clang::ASTContext& ast_context,
+    ExprEvaluationCache& expr_evaluation_cache) {
   llvm::APFloat float_eval_result(static_cast<double>(0));
   if (expr.getType()->isFloatingType() &&
-      EvaluateAsFloat(expr, ast_context, float_eval_result)) {
+      expr_evaluation_cache.EvaluateAsFloat(expr, ast_context,
+                                            float_eval_result)) {
     return float_eval_result.isExactlyValue(constant);
   }
 
@@ -166,10 +184,12 @@ bool MutationReplaceExpr::ExprIsEquivalentToFloat(
 
 bool MutationReplaceExpr::ExprIsEquivalentToBool(
     const clang::Expr& expr, bool constant,
-    const clang::ASTContext& ast_context) {
+    const clang::ASTContext& ast_context,
+    ExprEvaluationCache& expr_evaluation_cache) {
   bool bool_eval_result = false;
   if (expr.getType()->isBooleanType() &&
-      EvaluateAsBooleanCondition(expr, ast_context, bool_eval_result)) {
+      expr_evaluation_cache.EvaluateAsBooleanCondition(expr, ast_context,
+                                                       bool_eval_result)) {
     return bool_eval_result == constant;
   }
 
@@ -205,7 +225,7 @@ void MutationReplaceExpr::GenerateUnaryOperatorInsertionBeforeLValue(
     bool only_track_mutant_coverage, int mutation_id_base,
     std::stringstream& new_function, int& mutation_id_offset,
     protobufs::MutationReplaceExpr& protobuf_message) const {
-  if (!expr_->isLValue() || !CanMutateLValue(ast_context, *expr_)) {
+  if (!expr_->isLValue()) {
     return;
   }
   if (!only_track_mutant_coverage) {
@@ -326,7 +346,8 @@ void MutationReplaceExpr::GenerateFloatConstantReplacement(
       *expr_->getType()->getAs<clang::BuiltinType>();
   if (exprType.isFloatingPoint()) {
     if (!optimise_mutations ||
-        !ExprIsEquivalentToFloat(*expr_, 0.0, ast_context)) {
+        !ExprIsEquivalentToFloat(*expr_, 0.0, ast_context,
+                                 *expr_evaluation_cache_)) {
       // Replace floating point expression with 0.0
       if (!only_track_mutant_coverage) {
         new_function << "  if (__dredd_enabled_mutation(local_mutation_id + "
@@ -339,7 +360,8 @@ void MutationReplaceExpr::GenerateFloatConstantReplacement(
     }
 
     if (!optimise_mutations ||
-        !ExprIsEquivalentToFloat(*expr_, 1.0, ast_context)) {
+        !ExprIsEquivalentToFloat(*expr_, 1.0, ast_context,
+                                 *expr_evaluation_cache_)) {
       // Replace floating point expression with 1.0
       if (!only_track_mutant_coverage) {
         new_function << "  if (__dredd_enabled_mutation(local_mutation_id + "
@@ -352,7 +374,8 @@ void MutationReplaceExpr::GenerateFloatConstantReplacement(
     }
 
     if (!optimise_mutations ||
-        !ExprIsEquivalentToFloat(*expr_, -1.0, ast_context)) {
+        !ExprIsEquivalentToFloat(*expr_, -1.0, ast_context,
+                                 *expr_evaluation_cache_)) {
       // Replace floating point expression with -1.0
       if (!only_track_mutant_coverage) {
         new_function << "  if (__dredd_enabled_mutation(local_mutation_id + "
@@ -373,7 +396,9 @@ void MutationReplaceExpr::GenerateIntegerConstantReplacement(
   const clang::BuiltinType& exprType =
       *expr_->getType()->getAs<clang::BuiltinType>();
   if (exprType.isInteger() && !exprType.isBooleanType()) {
-    if (!optimise_mutations || !ExprIsEquivalentToInt(*expr_, 0, ast_context)) {
+    if (!optimise_mutations ||
+        !ExprIsEquivalentToInt(*expr_, 0, ast_context,
+                               *expr_evaluation_cache_)) {
       // Replace expression with 0
       if (!only_track_mutant_coverage) {
         new_function << "  if (__dredd_enabled_mutation(local_mutation_id + "
@@ -385,7 +410,9 @@ void MutationReplaceExpr::GenerateIntegerConstantReplacement(
           mutation_id_offset, protobuf_message);
     }
 
-    if (!optimise_mutations || !ExprIsEquivalentToInt(*expr_, 1, ast_context)) {
+    if (!optimise_mutations ||
+        !ExprIsEquivalentToInt(*expr_, 1, ast_context,
+                               *expr_evaluation_cache_)) {
       // Replace expression with 1
       if (!only_track_mutant_coverage) {
         new_function << "  if (__dredd_enabled_mutation(local_mutation_id + "
@@ -400,7 +427,8 @@ void MutationReplaceExpr::GenerateIntegerConstantReplacement(
 
   if (exprType.isSignedInteger()) {
     if (!optimise_mutations ||
-        !ExprIsEquivalentToInt(*expr_, -1, ast_context)) {
+        !ExprIsEquivalentToInt(*expr_, -1, ast_context,
+                               *expr_evaluation_cache_)) {
       // Replace signed integer expression with -1
       if (!only_track_mutant_coverage) {
         new_function << "  if (__dredd_enabled_mutation(local_mutation_id + "
@@ -422,7 +450,8 @@ void MutationReplaceExpr::GenerateBooleanConstantReplacement(
       *expr_->getType()->getAs<clang::BuiltinType>();
   if (exprType.isBooleanType()) {
     if (!optimise_mutations ||
-        (!ExprIsEquivalentToBool(*expr_, true, ast_context) &&
+        (!ExprIsEquivalentToBool(*expr_, true, ast_context,
+                                 *expr_evaluation_cache_) &&
          !IsBooleanReplacementRedundantForBinaryOperator(true, ast_context))) {
       // Replace expression with true
       if (!only_track_mutant_coverage) {
@@ -437,7 +466,8 @@ void MutationReplaceExpr::GenerateBooleanConstantReplacement(
     }
 
     if (!optimise_mutations ||
-        (!ExprIsEquivalentToBool(*expr_, false, ast_context) &&
+        (!ExprIsEquivalentToBool(*expr_, false, ast_context,
+                                 *expr_evaluation_cache_) &&
          !IsBooleanReplacementRedundantForBinaryOperator(false, ast_context))) {
       // Replace expression with false
       if (!only_track_mutant_coverage) {
@@ -454,24 +484,31 @@ void MutationReplaceExpr::GenerateBooleanConstantReplacement(
   }
 }
 
+std::string MutationReplaceExpr::GetMutatorFunctionSignature(
+    const clang::ASTContext& ast_context, const std::string& function_name,
+    const std::string& result_type, const std::string& input_type) const {
+  std::stringstream signature;
+  signature << "static " << result_type << " " << function_name << "(";
+  if (ast_context.getLangOpts().CPlusPlus &&
+      expr_evaluation_cache_->HasSideEffects(*expr_, ast_context)) {
+    signature << "std::function<" << input_type << "()>";
+  } else {
+    signature << input_type;
+  }
+  signature << " arg, int local_mutation_id)";
+  return signature.str();
+}
+
 std::string MutationReplaceExpr::GenerateMutatorFunction(
-    clang::ASTContext& ast_context, const std::string& function_name,
-    const std::string& result_type, const std::string& input_type,
+    clang::ASTContext& ast_context, const std::string& signature,
     bool optimise_mutations, bool only_track_mutant_coverage, int& mutation_id,
     protobufs::MutationReplaceExpr& protobuf_message) const {
   std::stringstream new_function;
-  new_function << "static " << result_type << " " << function_name << "(";
-  if (ast_context.getLangOpts().CPlusPlus &&
-      expr_->HasSideEffects(ast_context)) {
-    new_function << "std::function<" << input_type << "()>";
-  } else {
-    new_function << input_type;
-  }
-  new_function << " arg, int local_mutation_id) {\n";
+  new_function << signature << " {\n";
 
   std::string arg_evaluated = "arg";
   if (ast_context.getLangOpts().CPlusPlus &&
-      expr_->HasSideEffects(ast_context)) {
+      expr_evaluation_cache_->HasSideEffects(*expr_, ast_context)) {
     arg_evaluated += "()";
   }
 
@@ -479,22 +516,25 @@ std::string MutationReplaceExpr::GenerateMutatorFunction(
     arg_evaluated = "(*" + arg_evaluated + ")";
   }
 
-  if (!only_track_mutant_coverage) {
-    // Quickly apply the original operator if no mutant is enabled (which will
-    // be the common case).
-    new_function << "  if (!__dredd_some_mutation_enabled) return "
-                 << arg_evaluated << ";\n";
-  }
-
+  // The mutations are generated first, so that the fast path below knows how
+  // many of them there are.
   int mutation_id_offset = 0;
-
+  std::stringstream mutations;
   GenerateUnaryOperatorInsertion(arg_evaluated, ast_context, optimise_mutations,
                                  only_track_mutant_coverage, mutation_id,
-                                 new_function, mutation_id_offset,
+                                 mutations, mutation_id_offset,
                                  protobuf_message);
-  GenerateConstantReplacement(
-      ast_context, optimise_mutations, only_track_mutant_coverage, mutation_id,
-      new_function, mutation_id_offset, protobuf_message);
+  GenerateConstantReplacement(ast_context, optimise_mutations,
+                              only_track_mutant_coverage, mutation_id,
+                              mutations, mutation_id_offset, protobuf_message);
+
+  if (!only_track_mutant_coverage) {
+    // Quickly apply the original operator if no mutant is enabled (which will
+    // be the common case).
+    new_function << GetMutatorFunctionFastPath(mutation_id_offset,
+                                               arg_evaluated);
+  }
+  new_function << mutations.str();
 
   if (only_track_mutant_coverage) {
     new_function << "  __dredd_record_covered_mutants(local_mutation_id, " +
@@ -509,6 +549,109 @@ std::string MutationReplaceExpr::GenerateMutatorFunction(
   return new_function.str();
 }
 
+std::string MutationReplaceExpr::GenerateWeakMutatorFunction(
+    clang::ASTContext& ast_context, const std::string& signature,
+    const std::string& result_type, bool optimise_mutations, bool split_stream,
+    int& mutation_id, protobufs::MutationReplaceExpr& protobuf_message) const {
+  if (expr_->isLValue()) {
+    // The only mutations of an l-value are the insertion of ++ and --, which
+    // would modify the l-value if evaluated. These mutants are therefore
+    // conservatively regarded as infecting whenever they are reached.
+    return GenerateMutatorFunction(ast_context, signature, optimise_mutations,
+                                   !split_stream, mutation_id,
+                                   protobuf_message);
+  }
+
+  // As for the regular mutator function, an expression with side effects is
+  // passed via a lambda in C++.
+  const bool arg_is_lambda =
+      ast_context.getLangOpts().CPlusPlus &&
+      expr_evaluation_cache_->HasSideEffects(*expr_, ast_context);
+  std::stringstream new_function;
+  new_function << signature << " {\n";
+  new_function << "  " << result_type
+               << " original = " << (arg_is_lambda ? "arg()" : "arg") << ";\n";
+
+  // The mutants are determined exactly as for the regular mutator function.
+  int mutation_id_offset = 0;
+  std::stringstream unused_function;
+  GenerateUnaryOperatorInsertion("original", ast_context, optimise_mutations,
+                                 true, mutation_id, unused_function,
+                                 mutation_id_offset, protobuf_message);
+  GenerateConstantReplacement(ast_context, optimise_mutations, true,
+                              mutation_id, unused_function, mutation_id_offset,
+                              protobuf_message);
+  if (split_stream) {
+    new_function << GetMutatorFunctionFastPath(mutation_id_offset, "original");
+  }
+
+  const bool is_cpp = ast_context.getLangOpts().CPlusPlus;
+  for (int index = 0; index < mutation_id_offset; index++) {
+    std::string replacement;
+    switch (protobuf_message.instances(index).action()) {
+      case protobufs::MutationReplaceExprAction::InsertLNot:
+        replacement = "!(original)";
+        break;
+      case protobufs::MutationReplaceExprAction::InsertNot:
+        replacement = "~(original)";
+        break;
+      case protobufs::MutationReplaceExprAction::InsertMinus:
+        // Negation changes every value except zero. Comparing with zero,
+        // below, avoids evaluating the negation unless the mutant is applied,
+        // as it is undefined for the minimum value of a signed integer type.
+        replacement = "-(original)";
+        break;
+      case protobufs::MutationReplaceExprAction::ReplaceWithZeroFloat:
+        replacement = "0.0";
+        break;
+      case protobufs::MutationReplaceExprAction::ReplaceWithOneFloat:
+        replacement = "1.0";
+        break;
+      case protobufs::MutationReplaceExprAction::ReplaceWithMinusOneFloat:
+        replacement = "-1.0";
+        break;
+      case protobufs::MutationReplaceExprAction::ReplaceWithZeroInt:
+        replacement = "0";
+        break;
+      case protobufs::MutationReplaceExprAction::ReplaceWithOneInt:
+        replacement = "1";
+        break;
+      case protobufs::MutationReplaceExprAction::ReplaceWithMinusOneInt:
+        replacement = "-1";
+        break;
+      case protobufs::MutationReplaceExprAction::ReplaceWithTrue:
+        replacement = is_cpp ? "true" : "1";
+        break;
+      case protobufs::MutationReplaceExprAction::ReplaceWithFalse:
+        replacement = is_cpp ? "false" : "0";
+        break;
+      default:
+        assert(false && "Unexpected mutation of an r-value.");
+        break;
+    }
+    const std::string infected =
+        protobuf_message.instances(index).action() ==
+                protobufs::MutationReplaceExprAction::InsertMinus
+            ? "original != 0"
+            : "(" + result_type + ")(" + replacement + ") != original";
+    if (split_stream) {
+      new_function << "  if (" << infected
+                   << " && __dredd_enabled_mutation(local_mutation_id + "
+                   << index << ")) return " << replacement << ";\n";
+    } else {
+      new_function << "  if (" << infected
+                   << ") __dredd_record_covered_mutants(local_mutation_id + "
+                   << index << ", 1);\n";
+    }
+  }
+  new_function << "  return original;\n";
+  new_function << "}\n\n";
+
+  mutation_id += mutation_id_offset;
+
+  return new_function.str();
+}
+
 void MutationReplaceExpr::ApplyCppTypeModifiers(const clang::Expr& expr,
                                                 std::string& type) {
   if (expr.isLValue()) {
@@ -539,7 +682,7 @@ void MutationReplaceExpr::ReplaceExprWithFunctionCall(
     const std::string& new_function_name, const std::string& input_type,
     int local_mutation_id, clang::ASTContext& ast_context,
     const clang::Preprocessor& preprocessor, bool show_ast_node_types,
-    clang::Rewriter& rewriter) const {
+    MainFileRewriter& rewriter) const {
   // Replacement of an expression with a function call is simulated by
   // Inserting suitable text before and after the expression.
   // This is preferable over the (otherwise more intuitive) approach of directly
@@ -561,7 +704,7 @@ void MutationReplaceExpr::ReplaceExprWithFunctionCall(
   std::string suffix;
 
   if (ast_context.getLangOpts().CPlusPlus &&
-      expr_->HasSideEffects(ast_context)) {
+      expr_evaluation_cache_->HasSideEffects(*expr_, ast_context)) {
     prefix.append(+"[&]() -> " + input_type + " { return " +
                   // We don't need to static cast constant expressions
                   (IsCxx11ConstantExpr(*expr_, ast_context)
@@ -593,21 +736,10 @@ void MutationReplaceExpr::ReplaceExprWithFunctionCall(
   // cast. There are cases where such implicit casts are allowed for constants
   // but not for non-constants. This is catered for by inserting an explicit
   // cast.
-  // For the following check to work, we need to move up any enclosing
-  // parentheses.
-  const auto* deparenthesis_expr = expr_;
-  while (const auto* paren_expr = GetFirstParentOfType<clang::ParenExpr>(
-             *deparenthesis_expr, ast_context)) {
-    deparenthesis_expr = paren_expr;
-  }
-  if (IsSubjectToImplicitCastInInitializerList(*deparenthesis_expr,
-                                               ast_context)) {
-    // Add an explicit cast to the result type of the explicit cast.
-    const auto* implicit_cast_expr =
-        GetFirstParentOfType<clang::ImplicitCastExpr>(*deparenthesis_expr,
-                                                      ast_context);
+  if (initializer_list_implicit_cast_ != nullptr) {
+    // Add an explicit cast to the result type of the implicit cast.
     prefix = "static_cast<" +
-             implicit_cast_expr->getType()
+             initializer_list_implicit_cast_->getType()
                  ->getAs<clang::BuiltinType>()
                  ->getName(ast_context.getPrintingPolicy())
                  .str() +
@@ -641,18 +773,24 @@ void MutationReplaceExpr::ReplaceExprWithFunctionCall(
 protobufs::MutationGroup MutationReplaceExpr::Apply(
     clang::ASTContext& ast_context, const clang::Preprocessor& preprocessor,
     const Options& options, int first_mutation_id_in_file, int& mutation_id,
-    clang::Rewriter& rewriter,
-    std::unordered_set<std::string>& dredd_declarations) const {
+    MainFileRewriter& rewriter,
+    DreddDeclarations& dredd_declarations) const {
   // The protobuf object for the mutation, which will be wrapped in a
   // MutationGroup.
   protobufs::MutationReplaceExpr inner_result;
 
-  inner_result.mutable_start()->set_line(info_for_source_range_.GetStartLine());
-  inner_result.mutable_start()->set_column(
-      info_for_source_range_.GetStartColumn());
-  inner_result.mutable_end()->set_line(info_for_source_range_.GetEndLine());
-  inner_result.mutable_end()->set_column(info_for_source_range_.GetEndColumn());
-  *inner_result.mutable_snippet() = info_for_source_range_.GetSnippet();
+  if (options.GetCollectMutationInfo()) {
+    const InfoForSourceRange info_for_source_range(
+        GetSourceRangeInMainFile(preprocessor, *expr_), ast_context);
+    inner_result.mutable_start()->set_line(
+        info_for_source_range.GetStartLine());
+    inner_result.mutable_start()->set_column(
+        info_for_source_range.GetStartColumn());
+    inner_result.mutable_end()->set_line(info_for_source_range.GetEndLine());
+    inner_result.mutable_end()->set_column(
+        info_for_source_range.GetEndColumn());
+    *inner_result.mutable_snippet() = info_for_source_range.GetSnippet();
+  }
 
   const std::string new_function_name =
       GetFunctionName(options.GetOptimiseMutations(), ast_context);
@@ -679,21 +817,49 @@ protobufs::MutationGroup MutationReplaceExpr::Apply(
       new_function_name, input_type, mutation_id - first_mutation_id_in_file,
       ast_context, preprocessor, options.GetShowAstNodeTypes(), rewriter);
 
-  const std::string new_function = GenerateMutatorFunction(
-      ast_context, new_function_name, result_type, input_type,
-      options.GetOptimiseMutations(), options.GetOnlyTrackMutantCoverage(),
-      mutation_id, inner_result);
-  assert(!new_function.empty() && "Unsupported expression.");
-
-  dredd_declarations.insert(new_function);
+  const std::string signature = GetMutatorFunctionSignature(
+      ast_context, new_function_name, result_type, input_type);
+  if (const std::vector<int>* actions = dredd_declarations.Find(signature)) {
+    // A mutator function with this signature has already been generated, and
+    // its body is determined by its signature, so it suffices to record the
+    // mutation instances that it provides.
+    int mutation_id_offset = 0;
+    for (const int action : *actions) {
+      AddMutationInstance(
+          mutation_id,
+          static_cast<protobufs::MutationReplaceExprAction>(action),
+          mutation_id_offset, inner_result);
+    }
+    mutation_id += mutation_id_offset;
+  } else {
+    std::string new_function =
+        options.GetWeakMutation() || options.GetSplitStream()
+            ? GenerateWeakMutatorFunction(
+                  ast_context, signature, result_type,
+                  options.GetOptimiseMutations(), options.GetSplitStream(),
+                  mutation_id, inner_result)
+            : GenerateMutatorFunction(ast_context, signature,
+                                      options.GetOptimiseMutations(),
+                                      options.GetOnlyTrackMutantCoverage(),
+                                      mutation_id, inner_result);
+    assert(!new_function.empty() && "Unsupported expression.");
+    std::vector<int> new_actions;
+    new_actions.reserve(static_cast<size_t>(inner_result.instances_size()));
+    for (const auto& instance : inner_result.instances()) {
+      new_actions.push_back(instance.action());
+    }
+    dredd_declarations.Add(signature, std::move(new_function),
+                           std::move(new_actions));
+  }
 
   protobufs::MutationGroup result;
-  *result.mutable_replace_expr() = inner_result;
+  *result.mutable_replace_expr() = std::move(inner_result);
   return result;
 }
 
-bool MutationReplaceExpr::CanMutateLValue(clang::ASTContext& ast_context,
-                                          const clang::Expr& expr) {
+bool MutationReplaceExpr::CanMutateLValue(
+    const clang::Expr& expr,
+    const clang::ImplicitCastExpr* implicit_cast_parent) {
   assert(expr.isLValue() &&
          "Method should only be invoked on an l-value expression.");
   if (expr.getType().isConstQualified() || expr.getType()->isBooleanType()) {
@@ -707,12 +873,7 @@ bool MutationReplaceExpr::CanMutateLValue(clang::ASTContext& ast_context,
   }
   // The following checks that `expr` is the child of an ImplicitCastExpr that
   // yields an r-value.
-  const auto* implicit_cast_expr =
-      GetFirstParentOfType<clang::ImplicitCastExpr>(expr, ast_context);
-  if (implicit_cast_expr == nullptr || implicit_cast_expr->isLValue()) {
-    return false;
-  }
-  return true;
+  return implicit_cast_parent != nullptr && !implicit_cast_parent->isLValue();
 }
 
 void MutationReplaceExpr::AddMutationInstance(
@@ -763,8 +924,9 @@ bool MutationReplaceExpr::IsRedundantUnaryMinusInsertion(
   // It never makes sense to insert '-' before 0 as this would lead to an
   // equivalent mutant. (Technically this may not be true for floating-point
   // due to two values of 0, but the mutant is likely to be equivalent.)
-  if (ExprIsEquivalentToInt(*expr_, 0, ast_context) ||
-      ExprIsEquivalentToFloat(*expr_, 0.0, ast_context)) {
+  if (ExprIsEquivalentToInt(*expr_, 0, ast_context, *expr_evaluation_cache_) ||
+      ExprIsEquivalentToFloat(*expr_, 0.0, ast_context,
+                              *expr_evaluation_cache_)) {
     return true;
   }
 
@@ -772,12 +934,15 @@ bool MutationReplaceExpr::IsRedundantUnaryMinusInsertion(
   // to insert '-' before 1 or -1, as these cases are captured by
   // replacement with -1 and 1, respectively.
   if (expr_->getType()->isSignedIntegerType() &&
-      (ExprIsEquivalentToInt(*expr_, 1, ast_context) ||
-       ExprIsEquivalentToInt(*expr_, -1, ast_context))) {
+      (ExprIsEquivalentToInt(*expr_, 1, ast_context, *expr_evaluation_cache_) ||
+       ExprIsEquivalentToInt(*expr_, -1, ast_context,
+                             *expr_evaluation_cache_))) {
     return true;
   }
-  if (ExprIsEquivalentToFloat(*expr_, 1.0, ast_context) ||
-      ExprIsEquivalentToFloat(*expr_, -1.0, ast_context)) {
+  if (ExprIsEquivalentToFloat(*expr_, 1.0, ast_context,
+                              *expr_evaluation_cache_) ||
+      ExprIsEquivalentToFloat(*expr_, -1.0, ast_context,
+                              *expr_evaluation_cache_)) {
     return true;
   }
   return false;
@@ -789,8 +954,9 @@ bool MutationReplaceExpr::IsRedundantUnaryNotInsertion(
   // before 0 or -1, as these cases are captured by replacement with -1 and
   // 0, respectively.
   if (expr_->getType()->isSignedIntegerType() &&
-      (ExprIsEquivalentToInt(*expr_, 0, ast_context) ||
-       ExprIsEquivalentToInt(*expr_, -1, ast_context))) {
+      (ExprIsEquivalentToInt(*expr_, 0, ast_context, *expr_evaluation_cache_) ||
+       ExprIsEquivalentToInt(*expr_, -1, ast_context,
+                             *expr_evaluation_cache_))) {
     return true;
   }
   return false;
@@ -807,7 +973,8 @@ bool MutationReplaceExpr::IsRedundantUnaryLogicalNotInsertion(
   // value because either way, operator insertion would be redundant.
   bool unused_bool_value;
   if (expr_->getType()->isBooleanType() &&
-      EvaluateAsBooleanCondition(*expr_, ast_context, unused_bool_value)) {
+      expr_evaluation_cache_->EvaluateAsBooleanCondition(*expr_, ast_context,
+                                                         unused_bool_value)) {
     return true;
   }
 
@@ -818,7 +985,8 @@ bool MutationReplaceExpr::IsRedundantUnaryLogicalNotInsertion(
   // Similarly, this value is not used as it does not matter which constant
   // integer the expression evaluates to.
   clang::Expr::EvalResult unused_result_value;
-  if (EvaluateAsInt(*expr_, ast_context, unused_result_value)) {
+  if (expr_evaluation_cache_->EvaluateAsInt(*expr_, ast_context,
+                                            unused_result_value)) {
     return true;
   }
 
@@ -863,7 +1031,7 @@ bool MutationReplaceExpr::IsRedundantOperatorInsertionBeforeBinaryExpr(
 
 bool MutationReplaceExpr::
     IsRedundantOperatorInsertionBeforeLogicalOperatorArgument(
-        clang::ASTContext& ast_context) const {
+        const clang::ASTContext& ast_context) const {
   // From
   // https://people.cs.umass.edu/~rjust/publ/non_redundant_mutants_jstvr_2014.pdf:
   // Do not replace `a && b` with `!a && b` or `a && !b`, similar for logical
@@ -875,35 +1043,10 @@ bool MutationReplaceExpr::
     return false;
   }
 
-  if (const auto* binary_operator =
-          GetFirstParentOfType<clang::BinaryOperator>(*expr_, ast_context)) {
-    if (binary_operator->isLogicalOp() &&
-        (binary_operator->getLHS() == expr_ ||
-         binary_operator->getRHS() == expr_)) {
-      return true;
-    }
-  }
-  return false;
-}
-
-bool MutationReplaceExpr::IsSubjectToImplicitCastInInitializerList(
-    const clang::Expr& expr, clang::ASTContext& ast_context) {
-  // The expression that occurs in an initializer list and is then subject to an
-  // explicit cast will have at least two parents: the initializer list and the
-  // implicit cast. (This is probably due to implicit casts being treated as
-  // invisible nodes in the AST.) In the presence of templates there may in
-  // fact be multiple parents of type InitListExpr - one for the uninstantiated
-  // version of the initializer list, and one for the instantiated version.
-  bool found_implicit_cast_parent = false;
-  bool found_initializer_list_parent = false;
-  for (const auto& parent : ast_context.getParents<clang::Expr>(expr)) {
-    if (parent.get<clang::ImplicitCastExpr>() != nullptr) {
-      found_implicit_cast_parent = true;
-    } else if (parent.get<clang::InitListExpr>() != nullptr) {
-      found_initializer_list_parent = true;
-    }
-  }
-  return found_implicit_cast_parent && found_initializer_list_parent;
+  return binary_operator_parent_ != nullptr &&
+         binary_operator_parent_->isLogicalOp() &&
+         (binary_operator_parent_->getLHS() == expr_ ||
+          binary_operator_parent_->getRHS() == expr_);
 }
 
 }  // namespace dredd
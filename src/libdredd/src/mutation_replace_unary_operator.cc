@@ -15,7 +15,9 @@
 #include "libdredd/mutation_replace_unary_operator.h"
 
 #include <cassert>
+#include <cstddef>
 #include <sstream>
+#include <utility>
 #include <vector>
 
 #include "clang/AST/ASTContext.h"
@@ -25,7 +27,8 @@
 #include "clang/Basic/LangOptions.h"
 #include "clang/Basic/SourceLocation.h"
 #include "clang/Lex/Preprocessor.h"
-#include "clang/Rewrite/Core/Rewriter.h"
+#include "libdredd/dredd_declarations.h"
+#include "libdredd/main_file_rewriter.h"
 #include "libdredd/mutation_replace_expr.h"
 #include "libdredd/options.h"
 #include "libdredd/util.h"
@@ -35,14 +38,9 @@ namespace dredd {
 
 MutationReplaceUnaryOperator::MutationReplaceUnaryOperator(
     const clang::UnaryOperator& unary_operator,
-    const clang::Preprocessor& preprocessor,
-    const clang::ASTContext& ast_context)
+    ExprEvaluationCache& expr_evaluation_cache)
     : unary_operator_(&unary_operator),
-      info_for_overall_expr_(
-          GetSourceRangeInMainFile(preprocessor, unary_operator), ast_context),
-      info_for_sub_expr_(
-          GetSourceRangeInMainFile(preprocessor, *unary_operator.getSubExpr()),
-          ast_context) {}
+      expr_evaluation_cache_(&expr_evaluation_cache) {}
 
 bool MutationReplaceUnaryOperator::IsPrefix(
     clang::UnaryOperatorKind operator_kind) {
@@ -155,23 +153,29 @@ std::string MutationReplaceUnaryOperator::GetFunctionName(
   // be optimised.
   if (optimise_mutations) {
     if (MutationReplaceExpr::ExprIsEquivalentToInt(
-            *unary_operator_->getSubExpr(), 0, ast_context) ||
+            *unary_operator_->getSubExpr(), 0, ast_context,
+            *expr_evaluation_cache_) ||
         MutationReplaceExpr::ExprIsEquivalentToFloat(
-            *unary_operator_->getSubExpr(), 0.0, ast_context)) {
+            *unary_operator_->getSubExpr(), 0.0, ast_context,
+            *expr_evaluation_cache_)) {
       result += "_zero";
     }
 
     if (MutationReplaceExpr::ExprIsEquivalentToInt(
-            *unary_operator_->getSubExpr(), 1, ast_context) ||
+            *unary_operator_->getSubExpr(), 1, ast_context,
+            *expr_evaluation_cache_) ||
         MutationReplaceExpr::ExprIsEquivalentToFloat(
-            *unary_operator_->getSubExpr(), 1.0, ast_context)) {
+            *unary_operator_->getSubExpr(), 1.0, ast_context,
+            *expr_evaluation_cache_)) {
       result += "_one";
     }
 
     if (MutationReplaceExpr::ExprIsEquivalentToInt(
-            *unary_operator_->getSubExpr(), -1, ast_context) ||
+            *unary_operator_->getSubExpr(), -1, ast_context,
+            *expr_evaluation_cache_) ||
         MutationReplaceExpr::ExprIsEquivalentToFloat(
-            *unary_operator_->getSubExpr(), -1.0, ast_context)) {
+            *unary_operator_->getSubExpr(), -1.0, ast_context,
+            *expr_evaluation_cache_)) {
       result += "_minus_one";
     }
   }
@@ -179,24 +183,31 @@ std::string MutationReplaceUnaryOperator::GetFunctionName(
   return result;
 }
 
+std::string MutationReplaceUnaryOperator::GetMutatorFunctionSignature(
+    const clang::ASTContext& ast_context, const std::string& function_name,
+    const std::string& result_type, const std::string& input_type) const {
+  std::stringstream signature;
+  signature << "static " << result_type << " " << function_name << "(";
+  if (ast_context.getLangOpts().CPlusPlus &&
+      expr_evaluation_cache_->HasSideEffects(*unary_operator_, ast_context)) {
+    signature << "std::function<" << input_type << "()>";
+  } else {
+    signature << input_type;
+  }
+  signature << " arg, int local_mutation_id)";
+  return signature.str();
+}
+
 std::string MutationReplaceUnaryOperator::GenerateMutatorFunction(
-    clang::ASTContext& ast_context, const std::string& function_name,
-    const std::string& result_type, const std::string& input_type,
+    clang::ASTContext& ast_context, const std::string& signature,
     bool optimise_mutations, bool only_track_mutant_coverage, int& mutation_id,
     protobufs::MutationReplaceUnaryOperator& protobuf_message) const {
   std::stringstream new_function;
-  new_function << "static " << result_type << " " << function_name << "(";
-  if (ast_context.getLangOpts().CPlusPlus &&
-      unary_operator_->HasSideEffects(ast_context)) {
-    new_function << "std::function<" << input_type << "()>";
-  } else {
-    new_function << input_type;
-  }
-  new_function << " arg, int local_mutation_id) {\n";
+  new_function << signature << " {\n";
 
   std::string arg_evaluated = "arg";
   if (ast_context.getLangOpts().CPlusPlus &&
-      unary_operator_->HasSideEffects(ast_context)) {
+      expr_evaluation_cache_->HasSideEffects(*unary_operator_, ast_context)) {
     arg_evaluated += "()";
   }
 
@@ -205,42 +216,35 @@ std::string MutationReplaceUnaryOperator::GenerateMutatorFunction(
     arg_evaluated = "(*" + arg_evaluated + ")";
   }
 
+  // The mutations are generated first, so that the fast path below knows how
+  // many of them there are.
+  int mutation_id_offset = 0;
+  std::stringstream mutations;
+  GenerateUnaryOperatorReplacement(arg_evaluated, ast_context,
+                                   optimise_mutations,
+                                   only_track_mutant_coverage, mutation_id,
+                                   mutations, mutation_id_offset,
+                                   protobuf_message);
+
+  const std::string opcode_string =
+      clang::UnaryOperator::getOpcodeStr(unary_operator_->getOpcode()).str();
+  const std::string original =
+      IsPrefix(unary_operator_->getOpcode()) ? opcode_string + arg_evaluated
+                                             : arg_evaluated + opcode_string;
+
   if (!only_track_mutant_coverage) {
     // Quickly apply the original operator if no mutant is enabled (which will
     // be the common case).
-    new_function << "  if (!__dredd_some_mutation_enabled) return ";
-    if (IsPrefix(unary_operator_->getOpcode())) {
-      new_function << clang::UnaryOperator::getOpcodeStr(
-                          unary_operator_->getOpcode())
-                          .str()
-                   << arg_evaluated + ";\n";
-    } else {
-      new_function << arg_evaluated
-                   << clang::UnaryOperator::getOpcodeStr(
-                          unary_operator_->getOpcode())
-                          .str()
-                   << ";\n";
-    }
+    new_function << GetMutatorFunctionFastPath(mutation_id_offset, original);
   }
-
-  int mutation_id_offset = 0;
-  GenerateUnaryOperatorReplacement(
-      arg_evaluated, ast_context, optimise_mutations,
-      only_track_mutant_coverage, mutation_id, new_function, mutation_id_offset,
-      protobuf_message);
+  new_function << mutations.str();
 
   if (only_track_mutant_coverage) {
     new_function << "  __dredd_record_covered_mutants(local_mutation_id, " +
                         std::to_string(mutation_id_offset) + ");\n";
   }
 
-  const std::string opcode_string =
-      clang::UnaryOperator::getOpcodeStr(unary_operator_->getOpcode()).str();
-  new_function << "  return "
-               << (IsPrefix(unary_operator_->getOpcode()) ? opcode_string : "")
-               << arg_evaluated
-               << (IsPrefix(unary_operator_->getOpcode()) ? "" : opcode_string)
-               << ";\n";
+  new_function << "  return " << original << ";\n";
 
   new_function << "}\n\n";
 
@@ -258,13 +262,17 @@ bool MutationReplaceUnaryOperator::IsRedundantReplacementOperator(
   // equivalent to replacement with 1. When the operand is 1: - is equivalent to
   // replacement with -1 and ! is equivalent to replacement with 0.
   if (MutationReplaceExpr::ExprIsEquivalentToInt(*unary_operator_->getSubExpr(),
-                                                 0, ast_context) ||
+                                                 0, ast_context,
+                                                 *expr_evaluation_cache_) ||
       MutationReplaceExpr::ExprIsEquivalentToFloat(
-          *unary_operator_->getSubExpr(), 0.0, ast_context) ||
+          *unary_operator_->getSubExpr(), 0.0, ast_context,
+          *expr_evaluation_cache_) ||
       MutationReplaceExpr::ExprIsEquivalentToInt(*unary_operator_->getSubExpr(),
-                                                 1, ast_context) ||
+                                                 1, ast_context,
+                                                 *expr_evaluation_cache_) ||
       MutationReplaceExpr::ExprIsEquivalentToFloat(
-          *unary_operator_->getSubExpr(), 1.0, ast_context)) {
+          *unary_operator_->getSubExpr(), 1.0, ast_context,
+          *expr_evaluation_cache_)) {
     if (operator_kind == clang::UO_Minus || operator_kind == clang::UO_LNot) {
       return true;
     }
@@ -272,9 +280,11 @@ bool MutationReplaceUnaryOperator::IsRedundantReplacementOperator(
 
   // When the operand is -1: - is equivalent to replacement with 1.
   if ((MutationReplaceExpr::ExprIsEquivalentToInt(
-           *unary_operator_->getSubExpr(), -1, ast_context) ||
+           *unary_operator_->getSubExpr(), -1, ast_context,
+           *expr_evaluation_cache_) ||
        MutationReplaceExpr::ExprIsEquivalentToFloat(
-           *unary_operator_->getSubExpr(), -1.0, ast_context)) &&
+           *unary_operator_->getSubExpr(), -1.0, ast_context,
+           *expr_evaluation_cache_)) &&
       operator_kind == clang::UO_Minus) {
     return true;
   }
@@ -339,8 +349,8 @@ void MutationReplaceUnaryOperator::GenerateUnaryOperatorReplacement(
 protobufs::MutationGroup MutationReplaceUnaryOperator::Apply(
     clang::ASTContext& ast_context, const clang::Preprocessor& preprocessor,
     const Options& options, int first_mutation_id_in_file, int& mutation_id,
-    clang::Rewriter& rewriter,
-    std::unordered_set<std::string>& dredd_declarations) const {
+    MainFileRewriter& rewriter,
+    DreddDeclarations& dredd_declarations) const {
   // The protobuf object for the mutation, which will be wrapped in a
   // MutationGroup.
   protobufs::MutationReplaceUnaryOperator inner_result;
@@ -348,24 +358,32 @@ protobufs::MutationGroup MutationReplaceUnaryOperator::Apply(
   inner_result.set_operator_(
       ClangOperatorKindToProtobufOperatorKind(unary_operator_->getOpcode()));
 
-  inner_result.mutable_expr_start()->set_line(
-      info_for_overall_expr_.GetStartLine());
-  inner_result.mutable_expr_start()->set_column(
-      info_for_overall_expr_.GetStartColumn());
-  inner_result.mutable_expr_end()->set_line(
-      info_for_overall_expr_.GetEndLine());
-  inner_result.mutable_expr_end()->set_column(
-      info_for_overall_expr_.GetEndColumn());
-  *inner_result.mutable_expr_snippet() = info_for_overall_expr_.GetSnippet();
-
-  inner_result.mutable_operand_start()->set_line(
-      info_for_sub_expr_.GetStartLine());
-  inner_result.mutable_operand_start()->set_column(
-      info_for_sub_expr_.GetStartColumn());
-  inner_result.mutable_operand_end()->set_line(info_for_sub_expr_.GetEndLine());
-  inner_result.mutable_operand_end()->set_column(
-      info_for_sub_expr_.GetEndColumn());
-  *inner_result.mutable_operand_snippet() = info_for_sub_expr_.GetSnippet();
+  if (options.GetCollectMutationInfo()) {
+    const InfoForSourceRange info_for_overall_expr(
+        GetSourceRangeInMainFile(preprocessor, *unary_operator_), ast_context);
+    inner_result.mutable_expr_start()->set_line(
+        info_for_overall_expr.GetStartLine());
+    inner_result.mutable_expr_start()->set_column(
+        info_for_overall_expr.GetStartColumn());
+    inner_result.mutable_expr_end()->set_line(
+        info_for_overall_expr.GetEndLine());
+    inner_result.mutable_expr_end()->set_column(
+        info_for_overall_expr.GetEndColumn());
+    *inner_result.mutable_expr_snippet() = info_for_overall_expr.GetSnippet();
+
+    const InfoForSourceRange info_for_sub_expr(
+        GetSourceRangeInMainFile(preprocessor, *unary_operator_->getSubExpr()),
+        ast_context);
+    inner_result.mutable_operand_start()->set_line(
+        info_for_sub_expr.GetStartLine());
+    inner_result.mutable_operand_start()->set_column(
+        info_for_sub_expr.GetStartColumn());
+    inner_result.mutable_operand_end()->set_line(
+        info_for_sub_expr.GetEndLine());
+    inner_result.mutable_operand_end()->set_column(
+        info_for_sub_expr.GetEndColumn());
+    *inner_result.mutable_operand_snippet() = info_for_sub_expr.GetSnippet();
+  }
 
   const std::string new_function_name =
       GetFunctionName(options.GetOptimiseMutations(), ast_context);
@@ -427,7 +445,7 @@ protobufs::MutationGroup MutationReplaceUnaryOperator::Apply(
   prefix += "(";
   std::string suffix;
   if (ast_context.getLangOpts().CPlusPlus &&
-      unary_operator_->HasSideEffects(ast_context)) {
+      expr_evaluation_cache_->HasSideEffects(*unary_operator_, ast_context)) {
     prefix.append(
         "[&]() -> " + input_type + " { return " +
         // We don't need to static cast constant expressions
@@ -456,16 +474,36 @@ protobufs::MutationGroup MutationReplaceUnaryOperator::Apply(
   assert(!rewriter_result && "Rewrite failed.\n");
   (void)rewriter_result;  // Keep release-mode compilers happy.
 
-  const std::string new_function = GenerateMutatorFunction(
-      ast_context, new_function_name, result_type, input_type,
-      options.GetOptimiseMutations(), options.GetOnlyTrackMutantCoverage(),
-      mutation_id, inner_result);
-  assert(!new_function.empty() && "Unsupported opcode.");
-
-  dredd_declarations.insert(new_function);
+  const std::string signature = GetMutatorFunctionSignature(
+      ast_context, new_function_name, result_type, input_type);
+  if (const std::vector<int>* actions = dredd_declarations.Find(signature)) {
+    // A mutator function with this signature has already been generated, and
+    // its body is determined by its signature, so it suffices to record the
+    // mutation instances that it provides.
+    int mutation_id_offset = 0;
+    for (const int action : *actions) {
+      AddMutationInstance(
+          mutation_id,
+          static_cast<protobufs::MutationReplaceUnaryOperatorAction>(action),
+          mutation_id_offset, inner_result);
+    }
+    mutation_id += mutation_id_offset;
+  } else {
+    std::string new_function = GenerateMutatorFunction(
+        ast_context, signature, options.GetOptimiseMutations(),
+        options.GetOnlyTrackMutantCoverage(), mutation_id, inner_result);
+    assert(!new_function.empty() && "Unsupported opcode.");
+    std::vector<int> new_actions;
+    new_actions.reserve(static_cast<size_t>(inner_result.instances_size()));
+    for (const auto& instance : inner_result.instances()) {
+      new_actions.push_back(instance.action());
+    }
+    dredd_declarations.Add(signature, std::move(new_function),
+                           std::move(new_actions));
+  }
 
   protobufs::MutationGroup result;
-  *result.mutable_replace_unary_operator() = inner_result;
+  *result.mutable_replace_unary_operator() = std::move(inner_result);
   return result;
 }
 
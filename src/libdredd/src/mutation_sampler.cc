@@ -0,0 +1,125 @@
+// Copyright 2024 The Dredd Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libdredd/mutation_sampler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "clang/AST/DeclBase.h"
+#include "libdredd/mutation.h"
+
+namespace dredd {
+
+namespace {
+
+// A hash of the given string that, unlike std::hash, is the same on every
+// platform (64-bit FNV-1a).
+uint64_t StableHash(const std::string& text) {
+  uint64_t result = 14695981039346656037ULL;
+  for (const char character : text) {
+    result ^= static_cast<unsigned char>(character);
+    result *= 1099511628211ULL;
+  }
+  return result;
+}
+
+// The standard distributions are implementation-defined, so random numbers are
+// derived directly from the output of the generator, which is not.
+size_t RandomIndex(std::mt19937_64& generator, size_t bound) {
+  assert(bound > 0 && "The bound must be positive.");
+  return static_cast<size_t>(generator() % bound);
+}
+
+double RandomFraction(std::mt19937_64& generator) {
+  // Use the top 53 bits, which is the precision of a double.
+  const int kBitsToDiscard = 11;
+  const double kScale = 1.0 / static_cast<double>(uint64_t{1} << 53U);
+  return static_cast<double>(generator() >> kBitsToDiscard) * kScale;
+}
+
+// Moves a random selection of |count| elements of |elements| to its front.
+void ShuffleToFront(std::vector<const Mutation*>& elements, size_t count,
+                    std::mt19937_64& generator) {
+  for (size_t index = 0; index < count; index++) {
+    const size_t other_index =
+        index + RandomIndex(generator, elements.size() - index);
+    std::swap(elements[index], elements[other_index]);
+  }
+}
+
+}  // namespace
+
+void MutationSampler::AddMutation(const Mutation& mutation,
+                                  const clang::Decl* enclosing_function) {
+  auto [iterator, inserted] = stratum_indices_.insert(
+      {{mutation.GetKind(), enclosing_function}, strata_.size()});
+  if (inserted) {
+    strata_.emplace_back();
+  }
+  strata_[iterator->second].push_back(&mutation);
+  num_mutations_++;
+}
+
+std::unordered_set<const Mutation*> MutationSampler::Select(
+    double sample_rate, int max_mutations, uint64_t seed,
+    const std::string& filename) const {
+  std::mt19937_64 generator(seed ^ StableHash(filename));
+  double effective_rate = sample_rate;
+  if (max_mutations > 0 &&
+      effective_rate * static_cast<double>(num_mutations_) >
+          static_cast<double>(max_mutations)) {
+    // Lower the rate so that the cap is met in expectation, which keeps the
+    // sample stratified.
+    effective_rate = static_cast<double>(max_mutations) /
+                     static_cast<double>(num_mutations_);
+  }
+
+  std::vector<const Mutation*> selected;
+  for (const auto& stratum : strata_) {
+    // The expected number of mutations selected from the stratum is exactly
+    // proportional to its size: the fractional part is handled randomly, so
+    // that small strata, such as those of short functions, still have a chance
+    // of being represented.
+    const double expected_count =
+        effective_rate * static_cast<double>(stratum.size());
+    auto count = static_cast<size_t>(expected_count);
+    if (RandomFraction(generator) <
+        expected_count - static_cast<double>(count)) {
+      count++;
+    }
+    count = std::min(count, stratum.size());
+    std::vector<const Mutation*> shuffled = stratum;
+    ShuffleToFront(shuffled, count, generator);
+    selected.insert(selected.end(), shuffled.begin(),
+                    shuffled.begin() + static_cast<std::ptrdiff_t>(count));
+  }
+
+  if (max_mutations > 0 &&
+      selected.size() > static_cast<size_t>(max_mutations)) {
+    // Random rounding can overshoot the cap slightly.
+    ShuffleToFront(selected, static_cast<size_t>(max_mutations), generator);
+    selected.resize(static_cast<size_t>(max_mutations));
+  }
+  return {selected.begin(), selected.end()};
+}
+
+}  // namespace dredd
@@ -14,71 +14,69 @@
 
 #include "libdredd/mutation_tree_node.h"
 
+#include <cassert>
+#include <cstddef>
 #include <utility>
 
 namespace dredd {
 
-void MutationTreeNode::AddChild(std::unique_ptr<MutationTreeNode> node) {
-  children_.push_back(std::move(node));
-}
-
-void MutationTreeNode::AddMutation(std::unique_ptr<Mutation> mutation) {
-  mutations_.push_back(std::move(mutation));
-}
+MutationTree::MutationTree() : nodes_(1), root_(0) { path_.push_back(0); }
 
-void MutationTreeNode::TidyUp() {
-  PruneEmptySubtrees();
-  Compress();
+void MutationTree::PushNode() {
+  const size_t index = nodes_.size();
+  nodes_[path_.back()].children_.push_back(index);
+  nodes_.emplace_back();
+  path_.push_back(index);
 }
 
-bool MutationTreeNode::IsEmpty() const {
-  if (!mutations_.empty()) {
-    return false;
+void MutationTree::PopNode() {
+  assert(path_.size() > 1 && "The root node cannot be popped.");
+  const size_t index = path_.back();
+  path_.pop_back();
+  MutationTreeNode& parent = nodes_[path_.back()];
+  assert(parent.children_.back() == index &&
+         "A node should be the last child of its parent when it is finished.");
+  MutationTreeNode& node = nodes_[index];
+  if (node.IsEmpty()) {
+    // Any descendants of the node were empty and have already been discarded,
+    // so the node is the last node to have been created and can be discarded
+    // too.
+    assert(index == nodes_.size() - 1 &&
+           "An empty node should be the last node in the tree.");
+    parent.children_.pop_back();
+    nodes_.pop_back();
+    return;
   }
-  for (const auto& child : children_) {
-    if (!child->IsEmpty()) {
-      return false;
-    }
+  if (node.mutations_.empty() && node.children_.size() == 1 &&
+      !node.IsMarkedForCopying()) {
+    // The node can be bypassed: its only child takes its place in the parent.
+    // The child has already been simplified, so there is no need to repeat
+    // this. The bypassed node remains in the tree, unreachable.
+    parent.children_.back() = node.children_[0];
+    node.children_.clear();
   }
-  return true;
 }
 
-void MutationTreeNode::Compress() {
-  while (mutations_.empty() && children_.size() == 1) {
-    std::vector<std::unique_ptr<Mutation>> child_mutations;
-    for (auto& child_mutation : children_[0]->mutations_) {
-      child_mutations.push_back(std::move(child_mutation));
-    }
-    std::vector<std::unique_ptr<MutationTreeNode>> child_children;
-    for (auto& child_child : children_[0]->children_) {
-      child_children.push_back(std::move(child_child));
-    }
-    mutations_ = std::move(child_mutations);
-    children_ = std::move(child_children);
-  }
-  for (auto& child : children_) {
-    child->Compress();
-  }
+void MutationTree::AddMutation(std::unique_ptr<Mutation> mutation) {
+  nodes_[path_.back()].mutations_.push_back(std::move(mutation));
 }
 
-void MutationTreeNode::PruneEmptySubtrees() {
-  auto child_iterator = children_.begin();
-  while (child_iterator != children_.end()) {
-    if ((*child_iterator)->IsEmpty()) {
-      child_iterator = children_.erase(child_iterator);
-    } else {
-      (*child_iterator)->PruneEmptySubtrees();
-      ++child_iterator;
-    }
-  }
+void MutationTree::SetCurrentStatementSchemaStmt(const clang::Stmt& stmt) {
+  nodes_[path_.back()].statement_schema_stmt_ = &stmt;
+}
+
+void MutationTree::SetCurrentFunctionDispatchBody(
+    const clang::CompoundStmt& body) {
+  nodes_[path_.back()].function_dispatch_body_ = &body;
 }
 
-std::vector<const MutationTreeNode*> MutationTreeNode::GetChildren() const {
-  std::vector<const MutationTreeNode*> result;
-  for (const auto& child : children_) {
-    result.push_back(child.get());
+void MutationTree::TidyUp() {
+  assert(path_.size() == 1 && "Every node but the root should be finished.");
+  while (nodes_[root_].mutations_.empty() &&
+         nodes_[root_].children_.size() == 1 &&
+         !nodes_[root_].IsMarkedForCopying()) {
+    root_ = nodes_[root_].children_[0];
   }
-  return result;
 }
 
 }  // namespace dredd
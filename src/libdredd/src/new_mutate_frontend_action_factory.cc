@@ -64,6 +64,10 @@ class MutateFrontendAction : public clang::ASTFrontendAction {
     // Record that this file has been processed so that duplicate processing
     // will be detected in the future.
     processed_files_->insert(getCurrentFile().str());
+
+    // Allow the bodies of functions outside the main file to be skipped during
+    // parsing; MutateAstConsumer decides which bodies are skipped.
+    compiler_instance.getFrontendOpts().SkipFunctionBodies = true;
     return true;
   }
 
@@ -16,6 +16,8 @@
 
 #include <algorithm>
 #include <cassert>
+#include <optional>
+#include <string>
 #include <utility>
 
 #include "clang/AST/ASTContext.h"
@@ -25,7 +27,10 @@
 #include "clang/Lex/Lexer.h"
 #include "clang/Lex/Preprocessor.h"
 #include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
 
 namespace dredd {
 
@@ -96,6 +101,30 @@ std::string SpaceToUnderscore(const std::string& input) {
   return result;
 }
 
+std::string GetMutatorFunctionFastPath(int num_mutations,
+                                       const std::string& original) {
+  return "  if (!__dredd_some_mutation_enabled || local_mutation_id >= "
+         "__dredd_enabled_mutation_range_end || local_mutation_id + " +
+         std::to_string(num_mutations) +
+         " <= __dredd_enabled_mutation_range_begin) return " + original +
+         ";\n";
+}
+
+std::string GetNormalisedAbsolutePath(const std::string& filename) {
+  llvm::SmallString<256> absolute_path(filename);
+  llvm::sys::fs::make_absolute(absolute_path);
+  llvm::sys::path::remove_dots(absolute_path, true);
+  return llvm::sys::path::convert_to_slash(absolute_path.str());
+}
+
+bool MatchesReportPath(const std::string& path,
+                       const std::string& report_path) {
+  return path == report_path ||
+         (llvm::StringRef(path).ends_with(report_path) &&
+          path.size() > report_path.size() &&
+          path[path.size() - report_path.size() - 1] == '/');
+}
+
 bool SourceRangeConsistencyCheck(clang::SourceRange source_range,
                                  const clang::ASTContext& ast_context) {
   const auto& source_manager = ast_context.getSourceManager();
@@ -184,6 +213,66 @@ bool EvaluateAsFloat(const clang::Expr& expr,
   return !expr.isValueDependent() && expr.EvaluateAsFloat(result, ast_context);
 }
 
+bool ExprEvaluationCache::EvaluateAsBooleanCondition(
+    const clang::Expr& expr, const clang::ASTContext& ast_context,
+    bool& result) {
+  auto& cached = entries_[&expr].boolean_condition;
+  if (!cached.has_value()) {
+    bool value = false;
+    cached = dredd::EvaluateAsBooleanCondition(expr, ast_context, value)
+                 ? std::optional<bool>(value)
+                 : std::nullopt;
+  }
+  if (!cached->has_value()) {
+    return false;
+  }
+  result = cached->value();
+  return true;
+}
+
+bool ExprEvaluationCache::EvaluateAsInt(const clang::Expr& expr,
+                                        const clang::ASTContext& ast_context,
+                                        clang::Expr::EvalResult& result) {
+  auto& cached = entries_[&expr].int_result;
+  if (!cached.has_value()) {
+    clang::Expr::EvalResult value;
+    cached = dredd::EvaluateAsInt(expr, ast_context, value)
+                 ? std::optional<clang::Expr::EvalResult>(value)
+                 : std::nullopt;
+  }
+  if (!cached->has_value()) {
+    return false;
+  }
+  result = cached->value();
+  return true;
+}
+
+bool ExprEvaluationCache::EvaluateAsFloat(const clang::Expr& expr,
+                                          const clang::ASTContext& ast_context,
+                                          llvm::APFloat& result) {
+  auto& cached = entries_[&expr].float_result;
+  if (!cached.has_value()) {
+    llvm::APFloat value(static_cast<double>(0));
+    cached = dredd::EvaluateAsFloat(expr, ast_context, value)
+                 ? std::optional<llvm::APFloat>(value)
+                 : std::nullopt;
+  }
+  if (!cached->has_value()) {
+    return false;
+  }
+  result = cached->value();
+  return true;
+}
+
+bool ExprEvaluationCache::HasSideEffects(
+    const clang::Expr& expr, const clang::ASTContext& ast_context) {
+  auto& cached = entries_[&expr].has_side_effects;
+  if (!cached.has_value()) {
+    cached = expr.HasSideEffects(ast_context);
+  }
+  return cached.value();
+}
+
 bool IsCxx11ConstantExpr(const clang::Expr& expr,
                          const clang::ASTContext& ast_context) {
   return !expr.isValueDependent() && expr.isCXX11ConstantExpr(ast_context);
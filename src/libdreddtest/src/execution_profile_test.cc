@@ -0,0 +1,96 @@
+// Copyright 2024 The Dredd Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libdredd/execution_profile.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "libdreddtest/gtest.h"
+
+namespace dredd {
+namespace {
+
+TEST(ExecutionProfileTest, ParseLlvmCovExportAndGetCount) {
+  const std::string json =
+      R"({"data":[{"files":[)"
+      R"({"filename":"/src/a.c","segments":[)"
+      R"([1,12,1,true,true,false],[3,3,1000,true,true,false],)"
+      R"([3,20,1,true,false,false],[5,1,0,false,false,false],)"
+      R"([7,3,2,true,true,false],[7,9,3,true,false,true],)"
+      R"([8,1,0,false,false,false]]})"
+      R"(]}],"type":"llvm.coverage.json.export","version":"2.0.1"})";
+  std::string error_message;
+  const std::optional<ExecutionProfile> execution_profile =
+      ExecutionProfile::ParseLlvmCovExport(json, error_message);
+  ASSERT_TRUE(execution_profile.has_value()) << error_message;
+  ASSERT_EQ(nullptr,
+            execution_profile->GetSegmentsForFile("/src/b.c", error_message));
+  const std::vector<ExecutionProfile::Segment>* segments =
+      execution_profile->GetSegmentsForFile("/src/a.c", error_message);
+  ASSERT_NE(nullptr, segments);
+  ASSERT_EQ(7U, segments->size());
+
+  // Before the first segment.
+  ASSERT_FALSE(ExecutionProfile::GetCount(*segments, 1, 1).has_value());
+  ASSERT_EQ(1U, ExecutionProfile::GetCount(*segments, 1, 12).value());
+  ASSERT_EQ(1U, ExecutionProfile::GetCount(*segments, 2, 40).value());
+  // A region that starts part-way through a line.
+  ASSERT_EQ(1000U, ExecutionProfile::GetCount(*segments, 3, 3).value());
+  ASSERT_EQ(1000U, ExecutionProfile::GetCount(*segments, 3, 19).value());
+  ASSERT_EQ(1U, ExecutionProfile::GetCount(*segments, 3, 20).value());
+  // Between functions.
+  ASSERT_FALSE(ExecutionProfile::GetCount(*segments, 6, 1).has_value());
+  ASSERT_EQ(2U, ExecutionProfile::GetCount(*segments, 7, 5).value());
+  // Gap regions have no count.
+  ASSERT_FALSE(ExecutionProfile::GetCount(*segments, 7, 10).has_value());
+}
+
+TEST(ExecutionProfileTest, ParseLlvmCovExportMalformed) {
+  std::string error_message;
+  ASSERT_FALSE(ExecutionProfile::ParseLlvmCovExport(
+                   R"({"data":[{"files":[{"filename":"/src/a.c"}]}]})",
+                   error_message)
+                   .has_value());
+  ASSERT_FALSE(error_message.empty());
+  error_message.clear();
+  ASSERT_FALSE(ExecutionProfile::ParseLlvmCovExport(
+                   R"({"data":[{"files":[{"filename":"/src/a.c",)"
+                   R"("segments":[[0,1,1,true]]}]}]})",
+                   error_message)
+                   .has_value());
+  ASSERT_FALSE(error_message.empty());
+}
+
+TEST(ExecutionProfileTest, AmbiguousReportPaths) {
+  const std::string json =
+      R"({"data":[{"files":[)"
+      R"({"filename":"src/a.c","segments":[[1,1,1,true,true,false]]},)"
+      R"({"filename":"a.c","segments":[[1,1,2,true,true,false]]})"
+      R"(]}],"type":"llvm.coverage.json.export","version":"2.0.1"})";
+  std::string error_message;
+  const std::optional<ExecutionProfile> execution_profile =
+      ExecutionProfile::ParseLlvmCovExport(json, error_message);
+  ASSERT_TRUE(execution_profile.has_value()) << error_message;
+  ASSERT_NE(nullptr,
+            execution_profile->GetSegmentsForFile("/b/a.c", error_message));
+  ASSERT_TRUE(error_message.empty());
+  ASSERT_EQ(nullptr,
+            execution_profile->GetSegmentsForFile("/b/src/a.c", error_message));
+  ASSERT_FALSE(error_message.empty());
+}
+
+}  // namespace
+}  // namespace dredd
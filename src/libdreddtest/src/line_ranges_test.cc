@@ -0,0 +1,264 @@
+// Copyright 2024 The Dredd Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libdredd/line_ranges.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "libdreddtest/gtest.h"
+
+namespace dredd {
+namespace {
+
+TEST(LineRangesTest, ParseGitDiff) {
+  const std::string diff =
+      "diff --git a/src/a.cc b/src/a.cc\n"
+      "index 1111111..2222222 100644\n"
+      "--- a/src/a.cc\n"
+      "+++ b/src/a.cc\n"
+      "@@ -3 +3 @@ int main() {\n"
+      "-  return 0;\n"
+      "+  return 1;\n"
+      "@@ -10,0 +11,2 @@ void f() {\n"
+      "+++ x;\n"
+      "+  y++;\n"
+      "@@ -20,2 +22,0 @@\n"
+      "-  z++;\n"
+      "-  w++;\n"
+      "@@ -30 +30,3 @@\n"
+      "-  v++;\n"
+      "+  v--;\n"
+      "+  u--;\n"
+      "+  t--;\n"
+      "diff --git a/src/b.cc b/src/b.cc\n"
+      "deleted file mode 100644\n"
+      "--- a/src/b.cc\n"
+      "+++ /dev/null\n"
+      "@@ -1 +0,0 @@\n"
+      "-int b;\n";
+  std::string error_message;
+  const std::optional<LineRanges> line_ranges =
+      LineRanges::ParseGitDiff(diff, error_message);
+  ASSERT_TRUE(line_ranges.has_value()) << error_message;
+  const std::vector<LineRanges::Range>* ranges =
+      line_ranges->GetRangesForFile("/path/to/repo/src/a.cc", error_message);
+  ASSERT_NE(nullptr, ranges);
+  // The line added by the second hunk is not mistaken for a file header, and
+  // the third hunk, which only deletes lines, contributes nothing.
+  ASSERT_EQ(3U, ranges->size());
+  ASSERT_EQ(3U, (*ranges)[0].first_line);
+  ASSERT_EQ(3U, (*ranges)[0].last_line);
+  ASSERT_EQ(11U, (*ranges)[1].first_line);
+  ASSERT_EQ(12U, (*ranges)[1].last_line);
+  ASSERT_EQ(30U, (*ranges)[2].first_line);
+  ASSERT_EQ(32U, (*ranges)[2].last_line);
+  ASSERT_EQ(nullptr, line_ranges->GetRangesForFile("/path/to/repo/xsrc/a.cc",
+                                                   error_message));
+  ASSERT_EQ(nullptr, line_ranges->GetRangesForFile("/path/to/repo/src/b.cc",
+                                                   error_message));
+  ASSERT_TRUE(error_message.empty());
+}
+
+TEST(LineRangesTest, MalformedHunkHeader) {
+  std::string error_message;
+  ASSERT_FALSE(LineRanges::ParseGitDiff("+++ b/a.cc\n@@ -1 +x @@\n",
+                                        error_message)
+                   .has_value());
+  ASSERT_FALSE(error_message.empty());
+}
+
+TEST(LineRangesTest, ParseGitDiffWithContext) {
+  // A diff with context lines, as produced by 'git diff' without '-U0'. The
+  // removed line "-- x;" and the added line "++ y;" look like file headers.
+  const std::string diff =
+      "--- a/src/a.cc\n"
+      "+++ b/src/a.cc\n"
+      "@@ -4,6 +4,7 @@ void f() {\n"
+      " int a;\n"
+      "--- x;\n"
+      "+++ y;\n"
+      " int b;\n"
+      "\n"
+      "-  c--;\n"
+      "+  c++;\n"
+      "+  d++;\n"
+      " }\n"
+      "--- a/src/b.cc\n"
+      "+++ b/src/b.cc\n"
+      "@@ -1,2 +1,3 @@\n"
+      " int e;\n"
+      "+int f;\n"
+      " int g;\n";
+  std::string error_message;
+  const std::optional<LineRanges> line_ranges =
+      LineRanges::ParseGitDiff(diff, error_message);
+  ASSERT_TRUE(line_ranges.has_value()) << error_message;
+  // Only the added lines count; the context lines around them do not.
+  const std::vector<LineRanges::Range>* ranges =
+      line_ranges->GetRangesForFile("/path/to/repo/src/a.cc", error_message);
+  ASSERT_NE(nullptr, ranges);
+  ASSERT_EQ(2U, ranges->size());
+  ASSERT_EQ(5U, (*ranges)[0].first_line);
+  ASSERT_EQ(5U, (*ranges)[0].last_line);
+  ASSERT_EQ(8U, (*ranges)[1].first_line);
+  ASSERT_EQ(9U, (*ranges)[1].last_line);
+  ranges =
+      line_ranges->GetRangesForFile("/path/to/repo/src/b.cc", error_message);
+  ASSERT_NE(nullptr, ranges);
+  ASSERT_EQ(1U, ranges->size());
+  ASSERT_EQ(2U, (*ranges)[0].first_line);
+  ASSERT_EQ(2U, (*ranges)[0].last_line);
+}
+
+TEST(LineRangesTest, HunkDoesNotMatchHeader) {
+  std::string error_message;
+  // The hunk has more added lines than its header states.
+  ASSERT_FALSE(LineRanges::ParseGitDiff(
+                   "+++ b/a.cc\n@@ -1 +1 @@\n-int a;\n+int b;\n+int c;\n",
+                   error_message)
+                   .has_value());
+  ASSERT_FALSE(error_message.empty());
+  // The diff ends before the hunk is complete.
+  error_message.clear();
+  ASSERT_FALSE(LineRanges::ParseGitDiff(
+                   "+++ b/a.cc\n@@ -1,2 +1,2 @@\n int a;\n", error_message)
+                   .has_value());
+  ASSERT_FALSE(error_message.empty());
+  // A context line follows a hunk whose header counts no more lines.
+  error_message.clear();
+  ASSERT_FALSE(LineRanges::ParseGitDiff(
+                   "+++ b/a.cc\n@@ -1 +1 @@\n-int a;\n+int b;\n int c;\n",
+                   error_message)
+                   .has_value());
+  ASSERT_FALSE(error_message.empty());
+}
+
+TEST(LineRangesTest, ParseLlvmCovExport) {
+  const std::string json =
+      R"({"data":[{"files":[)"
+      R"({"filename":"/src/a.c","segments":[)"
+      R"([1,12,5,true,true,false],[3,2,0,false,false,false],)"
+      R"([4,5,0,true,true,false],[6,1,0,false,false,false],)"
+      R"([7,3,2,true,true,false],[7,9,3,true,false,true],)"
+      R"([8,1,0,false,false,false]]},)"
+      R"({"filename":"/src/b.c","segments":[)"
+      R"([1,12,0,true,true,false],[2,2,0,false,false,false]]})"
+      R"(]}],"type":"llvm.coverage.json.export","version":"2.0.1"})";
+  std::string error_message;
+  const std::optional<LineRanges> line_ranges =
+      LineRanges::ParseLlvmCovExport(json, error_message);
+  ASSERT_TRUE(line_ranges.has_value()) << error_message;
+  const std::vector<LineRanges::Range>* ranges =
+      line_ranges->GetRangesForFile("/src/a.c", error_message);
+  ASSERT_NE(nullptr, ranges);
+  // The first region ends part-way through line 3, and the gap region on line
+  // 7 is ignored.
+  ASSERT_EQ(2U, ranges->size());
+  ASSERT_EQ(1U, (*ranges)[0].first_line);
+  ASSERT_EQ(3U, (*ranges)[0].last_line);
+  ASSERT_EQ(7U, (*ranges)[1].first_line);
+  ASSERT_EQ(7U, (*ranges)[1].last_line);
+  ASSERT_EQ(nullptr, line_ranges->GetRangesForFile("/src/b.c", error_message));
+}
+
+TEST(LineRangesTest, ParseLlvmCovExportSummaryOnly) {
+  std::string error_message;
+  ASSERT_FALSE(LineRanges::ParseLlvmCovExport(
+                   R"({"data":[{"files":[{"filename":"/src/a.c"}]}]})",
+                   error_message)
+                   .has_value());
+  ASSERT_FALSE(error_message.empty());
+}
+
+TEST(LineRangesTest, ParseGcovAndAdd) {
+  const std::string gcov =
+      "        -:    0:Source:../src/b.c\n"
+      "        -:    0:Graph:b.gcno\n"
+      "        -:    1:#include <stdio.h>\n"
+      "        1:    2:int main() {\n"
+      "        1:    3:  int x = 0;\n"
+      "    #####:    4:  if (x) x++;\n"
+      "       2*:    5:  return x;\n"
+      "function main called 1 returned 100% blocks executed 80%\n"
+      "        -:    6:}\n";
+  std::string error_message;
+  std::optional<LineRanges> line_ranges =
+      LineRanges::ParseGcov(gcov, error_message);
+  ASSERT_TRUE(line_ranges.has_value()) << error_message;
+  const std::vector<LineRanges::Range>* ranges =
+      line_ranges->GetRangesForFile("/path/to/repo/src/b.c", error_message);
+  ASSERT_NE(nullptr, ranges);
+  ASSERT_EQ(2U, ranges->size());
+  ASSERT_EQ(2U, (*ranges)[0].first_line);
+  ASSERT_EQ(3U, (*ranges)[0].last_line);
+  ASSERT_EQ(5U, (*ranges)[1].first_line);
+  ASSERT_EQ(5U, (*ranges)[1].last_line);
+
+  // A second report that executes line 4 fills the gap.
+  const std::optional<LineRanges> other_line_ranges = LineRanges::ParseGcov(
+      "        -:    0:Source:../src/b.c\n"
+      "        3:    4:  if (x) x++;\n",
+      error_message);
+  ASSERT_TRUE(other_line_ranges.has_value()) << error_message;
+  line_ranges->Add(other_line_ranges.value());
+  ranges =
+      line_ranges->GetRangesForFile("/path/to/repo/src/b.c", error_message);
+  ASSERT_NE(nullptr, ranges);
+  ASSERT_EQ(1U, ranges->size());
+  ASSERT_EQ(2U, (*ranges)[0].first_line);
+  ASSERT_EQ(5U, (*ranges)[0].last_line);
+
+  ASSERT_FALSE(LineRanges::ParseGcov("        1:    2:int x;\n", error_message)
+                   .has_value());
+}
+
+TEST(LineRangesTest, Overlaps) {
+  const std::vector<LineRanges::Range> ranges = {{3, 3}, {11, 12}, {30, 32}};
+  ASSERT_FALSE(LineRanges::Overlaps(ranges, 1, 2));
+  ASSERT_TRUE(LineRanges::Overlaps(ranges, 1, 3));
+  ASSERT_TRUE(LineRanges::Overlaps(ranges, 3, 3));
+  ASSERT_FALSE(LineRanges::Overlaps(ranges, 4, 10));
+  ASSERT_TRUE(LineRanges::Overlaps(ranges, 5, 40));
+  ASSERT_TRUE(LineRanges::Overlaps(ranges, 12, 13));
+  ASSERT_FALSE(LineRanges::Overlaps(ranges, 33, 40));
+}
+
+TEST(LineRangesTest, AmbiguousReportPaths) {
+  const std::string diff =
+      "+++ b/src/a.cc\n"
+      "@@ -0,0 +1 @@\n"
+      "+int a;\n"
+      "+++ b/a.cc\n"
+      "@@ -0,0 +2 @@\n"
+      "+int b;\n";
+  std::string error_message;
+  const std::optional<LineRanges> line_ranges =
+      LineRanges::ParseGitDiff(diff, error_message);
+  ASSERT_TRUE(line_ranges.has_value()) << error_message;
+  // Only "a.cc" matches here, as "src/a.cc" must start at a directory.
+  const std::vector<LineRanges::Range>* ranges =
+      line_ranges->GetRangesForFile("/path/to/repo/xsrc/a.cc", error_message);
+  ASSERT_NE(nullptr, ranges);
+  ASSERT_EQ(2U, (*ranges)[0].first_line);
+  ASSERT_TRUE(error_message.empty());
+  // Both paths match, so it is unclear which lines are meant.
+  ASSERT_EQ(nullptr, line_ranges->GetRangesForFile("/path/to/repo/src/a.cc",
+                                                   error_message));
+  ASSERT_FALSE(error_message.empty());
+}
+
+}  // namespace
+}  // namespace dredd
@@ -0,0 +1,145 @@
+// Copyright 2024 The Dredd Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libdredd/main_file_rewriter.h"
+
+#include <memory>
+#include <string>
+
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/SourceLocation.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Frontend/ASTUnit.h"
+#include "clang/Tooling/Tooling.h"
+#include "libdreddtest/gtest.h"
+
+namespace dredd {
+namespace {
+
+TEST(MainFileRewriterTest, OrderOfEditsAtSameLocation) {
+  auto ast_unit =
+      clang::tooling::buildASTFromCodeWithArgs("int x = 12;", {"-w"});
+  ASSERT_FALSE(ast_unit->getDiagnostics().hasErrorOccurred());
+  const clang::SourceManager& source_manager = ast_unit->getSourceManager();
+  const clang::SourceLocation location =
+      source_manager.translateLineCol(source_manager.getMainFileID(), 1, 9);
+  MainFileRewriter rewriter(source_manager, ast_unit->getLangOpts());
+  ASSERT_FALSE(rewriter.InsertTextAfterToken(location, ")"));
+  ASSERT_FALSE(rewriter.ReplaceText(location, 2, "34"));
+  ASSERT_FALSE(rewriter.InsertTextBefore(location, "("));
+  ASSERT_FALSE(rewriter.InsertTextAfterToken(location, "]"));
+  ASSERT_FALSE(rewriter.InsertTextBefore(location, "["));
+  ASSERT_EQ("int x = [(34)];", rewriter.GetRewrittenText());
+}
+
+TEST(MainFileRewriterTest, ReplaceTokenRange) {
+  auto ast_unit =
+      clang::tooling::buildASTFromCodeWithArgs("int x = 1 + 2;", {"-w"});
+  ASSERT_FALSE(ast_unit->getDiagnostics().hasErrorOccurred());
+  const clang::SourceManager& source_manager = ast_unit->getSourceManager();
+  const clang::SourceRange range(
+      source_manager.translateLineCol(source_manager.getMainFileID(), 1, 9),
+      source_manager.translateLineCol(source_manager.getMainFileID(), 1, 13));
+  MainFileRewriter rewriter(source_manager, ast_unit->getLangOpts());
+  ASSERT_FALSE(rewriter.ReplaceText(range, "3"));
+  ASSERT_FALSE(rewriter.InsertTextBefore(range.getBegin(), "/*a*/"));
+  ASSERT_FALSE(rewriter.InsertTextAfterToken(range.getEnd(), "/*b*/"));
+  ASSERT_EQ("int x = /*a*/3/*b*/;", rewriter.GetRewrittenText());
+}
+
+TEST(MainFileRewriterTest, ReplaceWithSwitch) {
+  auto ast_unit = clang::tooling::buildASTFromCodeWithArgs(
+      "void f(int a) { a = a + 1; }", {"-w"});
+  ASSERT_FALSE(ast_unit->getDiagnostics().hasErrorOccurred());
+  const clang::SourceManager& source_manager = ast_unit->getSourceManager();
+  auto location = [&source_manager](unsigned column) -> clang::SourceLocation {
+    return source_manager.translateLineCol(source_manager.getMainFileID(), 1,
+                                           column);
+  };
+  MainFileRewriter rewriter(source_manager, ast_unit->getLangOpts());
+  const int first_alternative = rewriter.StartAlternative();
+  ASSERT_FALSE(rewriter.InsertTextBefore(location(21), "f("));
+  ASSERT_FALSE(rewriter.InsertTextAfterToken(location(25), ")"));
+  rewriter.EndAlternative();
+  const int second_alternative = rewriter.StartAlternative();
+  ASSERT_FALSE(rewriter.ReplaceText(location(23), 1, "-"));
+  rewriter.EndAlternative();
+  ASSERT_FALSE(rewriter.InsertTextBefore(location(17), "if (x) { "));
+  ASSERT_FALSE(rewriter.InsertTextAfterToken(location(26), " }"));
+  ASSERT_FALSE(rewriter.ReplaceWithSwitch(
+      clang::SourceRange(location(17), location(25)), "s",
+      {{0, 2, first_alternative}, {2, 1, second_alternative}}, ";"));
+  ASSERT_EQ(
+      "void f(int a) { if (x) { switch (s) { case 0: case 1: { a = f(a + 1); "
+      "} break; case 2: { a = a - 1; } break; default: { a = a + 1; } }; } }",
+      rewriter.GetRewrittenText());
+}
+
+TEST(MainFileRewriterTest, ReplaceWithTwoCopies) {
+  auto ast_unit = clang::tooling::buildASTFromCodeWithArgs(
+      "int f(int a) { return a + 1; }", {"-w"});
+  ASSERT_FALSE(ast_unit->getDiagnostics().hasErrorOccurred());
+  const clang::SourceManager& source_manager = ast_unit->getSourceManager();
+  auto location = [&source_manager](unsigned column) -> clang::SourceLocation {
+    return source_manager.translateLineCol(source_manager.getMainFileID(), 1,
+                                           column);
+  };
+  MainFileRewriter rewriter(source_manager, ast_unit->getLangOpts());
+  const int alternative = rewriter.StartAlternative();
+  ASSERT_FALSE(rewriter.ReplaceText(location(25), 1, "-"));
+  rewriter.EndAlternative();
+  ASSERT_FALSE(rewriter.ReplaceText(location(16), 6, "throw"));
+  ASSERT_FALSE(rewriter.ReplaceWithTwoCopies(
+      clang::SourceRange(location(14), location(30)), "{ if (c) ", " else ",
+      alternative, " }"));
+  ASSERT_EQ(
+      "int f(int a) { if (c) { return a + 2; } else { return a - 2; } }",
+      rewriter.GetRewrittenText());
+}
+
+TEST(MainFileRewriterTest, RejectConflictingEdits) {
+  auto ast_unit = clang::tooling::buildASTFromCodeWithArgs(
+      "int f(int a) { return a + 1; }", {"-w"});
+  ASSERT_FALSE(ast_unit->getDiagnostics().hasErrorOccurred());
+  const clang::SourceManager& source_manager = ast_unit->getSourceManager();
+  auto location = [&source_manager](unsigned column) -> clang::SourceLocation {
+    return source_manager.translateLineCol(source_manager.getMainFileID(), 1,
+                                           column);
+  };
+  MainFileRewriter rewriter(source_manager, ast_unit->getLangOpts());
+  ASSERT_FALSE(rewriter.ReplaceText(location(23), 5, "b"));
+  // Edits inside the replaced text are rejected, while edits at its ends are
+  // not.
+  ASSERT_TRUE(rewriter.InsertTextBefore(location(25), "("));
+  ASSERT_TRUE(rewriter.ReplaceText(location(25), 3, "-"));
+  ASSERT_FALSE(rewriter.InsertTextBefore(location(23), "("));
+  ASSERT_FALSE(rewriter.InsertTextBefore(location(28), ")"));
+  // An alternative copy of the text also contains the edits to the main file.
+  const int alternative = rewriter.StartAlternative();
+  ASSERT_TRUE(rewriter.ReplaceText(location(21), 3, "c"));
+  ASSERT_FALSE(rewriter.ReplaceText(location(16), 6, "throw"));
+  rewriter.EndAlternative();
+  // A copied region must not split an edit.
+  ASSERT_TRUE(rewriter.ReplaceWithTwoCopies(
+      clang::SourceRange(location(14), location(23)), "{ if (c) ", " else ",
+      alternative, " }"));
+  ASSERT_FALSE(rewriter.ReplaceWithTwoCopies(
+      clang::SourceRange(location(14), location(30)), "{ if (c) ", " else ",
+      alternative, " }"));
+  ASSERT_EQ("int f(int a) { if (c) { return (b); } else { throw (b); } }",
+            rewriter.GetRewrittenText());
+}
+
+}  // namespace
+}  // namespace dredd
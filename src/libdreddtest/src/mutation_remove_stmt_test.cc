@@ -29,34 +29,30 @@
 #include "clang/Basic/SourceManager.h"
 #include "clang/Frontend/ASTUnit.h"
 #include "clang/Lex/Preprocessor.h"
-#include "clang/Rewrite/Core/RewriteBuffer.h"
-#include "clang/Rewrite/Core/Rewriter.h"
 #include "clang/Tooling/Tooling.h"
+#include "libdredd/dredd_declarations.h"
+#include "libdredd/main_file_rewriter.h"
 #include "libdreddtest/gtest.h"
 #include "llvm/ADT/SmallVector.h"
 
 namespace dredd {
 namespace {
 
-void TestRemoval(const std::string& original, const std::string& expected,
-                 std::function<MutationRemoveStmt(const clang::Preprocessor&,
-                                                  clang::ASTContext&)>
-                     mutation_supplier) {
+void TestRemoval(
+    const std::string& original, const std::string& expected,
+    std::function<MutationRemoveStmt(clang::ASTContext&)> mutation_supplier) {
   auto ast_unit = clang::tooling::buildASTFromCodeWithArgs(original, {"-w"});
   ASSERT_FALSE(ast_unit->getDiagnostics().hasErrorOccurred());
-  clang::Rewriter rewriter(ast_unit->getSourceManager(),
-                           ast_unit->getLangOpts());
+  MainFileRewriter rewriter(ast_unit->getSourceManager(),
+                            ast_unit->getLangOpts());
   int mutation_id = 0;
-  std::unordered_set<std::string> dredd_declarations;
-  mutation_supplier(ast_unit->getPreprocessor(), ast_unit->getASTContext())
+  DreddDeclarations dredd_declarations;
+  mutation_supplier(ast_unit->getASTContext())
       .Apply(ast_unit->getASTContext(), ast_unit->getPreprocessor(), Options(),
              0, mutation_id, rewriter, dredd_declarations);
   ASSERT_EQ(1, mutation_id);
-  ASSERT_EQ(0, dredd_declarations.size());
-  const clang::RewriteBuffer* rewrite_buffer = rewriter.getRewriteBufferFor(
-      ast_unit->getSourceManager().getMainFileID());
-  const std::string rewritten_text(rewrite_buffer->begin(),
-                                   rewrite_buffer->end());
+  ASSERT_TRUE(dredd_declarations.GetSortedDeclarations().empty());
+  const std::string rewritten_text = rewriter.GetRewrittenText();
   ASSERT_EQ(expected, rewritten_text);
 }
 
@@ -64,16 +60,14 @@ TEST(MutationRemoveStmtTest, BasicTest) {
   const std::string original = "void foo() { 1 + 2; }";
   const std::string expected =
       R"(void foo() { if (!__dredd_enabled_mutation(0)) { 1 + 2; } })";
-  const std::function<MutationRemoveStmt(const clang::Preprocessor&,
-                                         clang::ASTContext&)>
+  const std::function<MutationRemoveStmt(clang::ASTContext&)>
       mutation_supplier =
-          [](const clang::Preprocessor& preprocessor,
-             clang::ASTContext& ast_context) -> MutationRemoveStmt {
+          [](clang::ASTContext& ast_context) -> MutationRemoveStmt {
     auto statement = clang::ast_matchers::match(
         clang::ast_matchers::binaryOperator().bind("op"), ast_context);
     EXPECT_EQ(1, statement.size());
-    return {*statement[0].getNodeAs<clang::BinaryOperator>("op"), preprocessor,
-            ast_context};
+    return MutationRemoveStmt(
+        *statement[0].getNodeAs<clang::BinaryOperator>("op"));
   };
   TestRemoval(original, expected, mutation_supplier);
 }
@@ -82,16 +76,13 @@ TEST(MutationRemoveStmtTest, RemoveIfStatement) {
   const std::string original = "void foo() { if (true) { } }";
   const std::string expected =
       R"(void foo() { if (!__dredd_enabled_mutation(0)) { if (true) { } } })";
-  const std::function<MutationRemoveStmt(const clang::Preprocessor&,
-                                         clang::ASTContext&)>
+  const std::function<MutationRemoveStmt(clang::ASTContext&)>
       mutation_supplier =
-          [](const clang::Preprocessor& preprocessor,
-             clang::ASTContext& ast_context) -> MutationRemoveStmt {
+          [](clang::ASTContext& ast_context) -> MutationRemoveStmt {
     auto statement = clang::ast_matchers::match(
         clang::ast_matchers::ifStmt().bind("if"), ast_context);
     EXPECT_EQ(1, statement.size());
-    return {*statement[0].getNodeAs<clang::IfStmt>("if"), preprocessor,
-            ast_context};
+    return MutationRemoveStmt(*statement[0].getNodeAs<clang::IfStmt>("if"));
   };
   TestRemoval(original, expected, mutation_supplier);
 }
@@ -100,16 +91,13 @@ TEST(MutationRemoveStmtTest, RemoveIfStatementWithTrailingSemi) {
   const std::string original = "void foo() { if (true) { }; }";
   const std::string expected =
       R"(void foo() { if (!__dredd_enabled_mutation(0)) { if (true) { }; } })";
-  const std::function<MutationRemoveStmt(const clang::Preprocessor&,
-                                         clang::ASTContext&)>
+  const std::function<MutationRemoveStmt(clang::ASTContext&)>
       mutation_supplier =
-          [](const clang::Preprocessor& preprocessor,
-             clang::ASTContext& ast_context) -> MutationRemoveStmt {
+          [](clang::ASTContext& ast_context) -> MutationRemoveStmt {
     auto statement = clang::ast_matchers::match(
         clang::ast_matchers::ifStmt().bind("if"), ast_context);
     EXPECT_EQ(1, statement.size());
-    return {*statement[0].getNodeAs<clang::IfStmt>("if"), preprocessor,
-            ast_context};
+    return MutationRemoveStmt(*statement[0].getNodeAs<clang::IfStmt>("if"));
   };
   TestRemoval(original, expected, mutation_supplier);
 }
@@ -118,16 +106,13 @@ TEST(MutationRemoveStmtTest, RemoveIfStatementWithTrailingSemis) {
   const std::string original = "void foo() { if (true) { };; }";
   const std::string expected =
       R"(void foo() { if (!__dredd_enabled_mutation(0)) { if (true) { }; }; })";
-  const std::function<MutationRemoveStmt(const clang::Preprocessor&,
-                                         clang::ASTContext&)>
+  const std::function<MutationRemoveStmt(clang::ASTContext&)>
       mutation_supplier =
-          [](const clang::Preprocessor& preprocessor,
-             clang::ASTContext& ast_context) -> MutationRemoveStmt {
+          [](clang::ASTContext& ast_context) -> MutationRemoveStmt {
     auto statement = clang::ast_matchers::match(
         clang::ast_matchers::ifStmt().bind("if"), ast_context);
     EXPECT_EQ(1, statement.size());
-    return {*statement[0].getNodeAs<clang::IfStmt>("if"), preprocessor,
-            ast_context};
+    return MutationRemoveStmt(*statement[0].getNodeAs<clang::IfStmt>("if"));
   };
   TestRemoval(original, expected, mutation_supplier);
 }
@@ -136,16 +121,13 @@ TEST(MutationRemoveStmtTest, RemoveIfStatementWithoutBraces) {
   const std::string original = "void foo() { if (true) return; }";
   const std::string expected =
       R"(void foo() { if (!__dredd_enabled_mutation(0)) { if (true) return; } })";
-  const std::function<MutationRemoveStmt(const clang::Preprocessor&,
-                                         clang::ASTContext&)>
+  const std::function<MutationRemoveStmt(clang::ASTContext&)>
       mutation_supplier =
-          [](const clang::Preprocessor& preprocessor,
-             clang::ASTContext& ast_context) -> MutationRemoveStmt {
+          [](clang::ASTContext& ast_context) -> MutationRemoveStmt {
     auto statement = clang::ast_matchers::match(
         clang::ast_matchers::ifStmt().bind("if"), ast_context);
     EXPECT_EQ(1, statement.size());
-    return {*statement[0].getNodeAs<clang::IfStmt>("if"), preprocessor,
-            ast_context};
+    return MutationRemoveStmt(*statement[0].getNodeAs<clang::IfStmt>("if"));
   };
   TestRemoval(original, expected, mutation_supplier);
 }
@@ -154,16 +136,14 @@ TEST(MutationRemoveStmtTest, RemoveReturnStmt) {
   const std::string original = "void foo() { return; }";
   const std::string expected =
       R"(void foo() { if (!__dredd_enabled_mutation(0)) { return; } })";
-  const std::function<MutationRemoveStmt(const clang::Preprocessor&,
-                                         clang::ASTContext&)>
+  const std::function<MutationRemoveStmt(clang::ASTContext&)>
       mutation_supplier =
-          [](const clang::Preprocessor& preprocessor,
-             clang::ASTContext& ast_context) -> MutationRemoveStmt {
+          [](clang::ASTContext& ast_context) -> MutationRemoveStmt {
     auto statement = clang::ast_matchers::match(
         clang::ast_matchers::returnStmt().bind("return"), ast_context);
     EXPECT_EQ(1, statement.size());
-    return {*statement[0].getNodeAs<clang::ReturnStmt>("return"), preprocessor,
-            ast_context};
+    return MutationRemoveStmt(
+        *statement[0].getNodeAs<clang::ReturnStmt>("return"));
   };
   TestRemoval(original, expected, mutation_supplier);
 }
@@ -172,16 +152,14 @@ TEST(MutationRemoveStmtTest, RemoveBreakStmt) {
   const std::string original = "void foo() { while (true) { break; } }";
   const std::string expected =
       R"(void foo() { while (true) { if (!__dredd_enabled_mutation(0)) { break; } } })";
-  const std::function<MutationRemoveStmt(const clang::Preprocessor&,
-                                         clang::ASTContext&)>
+  const std::function<MutationRemoveStmt(clang::ASTContext&)>
       mutation_supplier =
-          [](const clang::Preprocessor& preprocessor,
-             clang::ASTContext& ast_context) -> MutationRemoveStmt {
+          [](clang::ASTContext& ast_context) -> MutationRemoveStmt {
     auto statement = clang::ast_matchers::match(
         clang::ast_matchers::breakStmt().bind("break"), ast_context);
     EXPECT_EQ(1, statement.size());
-    return {*statement[0].getNodeAs<clang::BreakStmt>("break"), preprocessor,
-            ast_context};
+    return MutationRemoveStmt(
+        *statement[0].getNodeAs<clang::BreakStmt>("break"));
   };
   TestRemoval(original, expected, mutation_supplier);
 }
@@ -193,16 +171,14 @@ TEST(MutationRemoveStmtTest, RemoveMacroStmt) {
   const std::string expected =
       R"(#define ASSIGN(A, B) A = B
 void foo() { int x; if (!__dredd_enabled_mutation(0)) { ASSIGN(x, 1); } })";
-  const std::function<MutationRemoveStmt(const clang::Preprocessor&,
-                                         clang::ASTContext&)>
+  const std::function<MutationRemoveStmt(clang::ASTContext&)>
       mutation_supplier =
-          [](const clang::Preprocessor& preprocessor,
-             clang::ASTContext& ast_context) -> MutationRemoveStmt {
+          [](clang::ASTContext& ast_context) -> MutationRemoveStmt {
     auto statement = clang::ast_matchers::match(
         clang::ast_matchers::binaryOperator().bind("assign"), ast_context);
     EXPECT_EQ(1, statement.size());
-    return {*statement[0].getNodeAs<clang::BinaryOperator>("assign"),
-            preprocessor, ast_context};
+    return MutationRemoveStmt(
+        *statement[0].getNodeAs<clang::BinaryOperator>("assign"));
   };
   TestRemoval(original, expected, mutation_supplier);
 }
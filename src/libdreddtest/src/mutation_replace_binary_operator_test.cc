@@ -16,6 +16,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "clang/AST/Decl.h"
 #include "clang/AST/DeclBase.h"
@@ -27,9 +28,10 @@
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Frontend/ASTUnit.h"
-#include "clang/Rewrite/Core/RewriteBuffer.h"
-#include "clang/Rewrite/Core/Rewriter.h"
 #include "clang/Tooling/Tooling.h"
+#include "libdredd/dredd_declarations.h"
+#include "libdredd/main_file_rewriter.h"
+#include "libdredd/util.h"
 #include "libdreddtest/gtest.h"
 #include "llvm/ADT/SmallVector.h"
 
@@ -52,25 +54,26 @@ void TestReplacement(const std::string& original, const std::string& expected,
       ast_unit->getASTContext());
   ASSERT_EQ(1, binary_operator.size());
 
+  ExprEvaluationCache expr_evaluation_cache;
   const MutationReplaceBinaryOperator mutation(
       *binary_operator[0].getNodeAs<clang::BinaryOperator>("op"),
-      ast_unit->getPreprocessor(), ast_unit->getASTContext());
+      expr_evaluation_cache);
 
-  clang::Rewriter rewriter(ast_unit->getSourceManager(),
-                           ast_unit->getLangOpts());
+  MainFileRewriter rewriter(ast_unit->getSourceManager(),
+                            ast_unit->getLangOpts());
   int mutation_id = 0;
-  std::unordered_set<std::string> dredd_declarations;
-  mutation.Apply(ast_unit->getASTContext(), ast_unit->getPreprocessor(),
-                 Options(optimise_mutations, false, false, false), 0,
-                 mutation_id, rewriter, dredd_declarations);
+  DreddDeclarations dredd_declarations;
+  mutation.Apply(
+      ast_unit->getASTContext(), ast_unit->getPreprocessor(),
+      Options().SetOptimiseMutations(optimise_mutations),
+      0, mutation_id, rewriter, dredd_declarations);
   ASSERT_EQ(num_replacements, mutation_id);
-  ASSERT_EQ(1, dredd_declarations.size());
-  ASSERT_EQ(expected_dredd_declaration, *dredd_declarations.begin());
+  const std::vector<const std::string*> sorted_dredd_declarations =
+      dredd_declarations.GetSortedDeclarations();
+  ASSERT_EQ(1, sorted_dredd_declarations.size());
+  ASSERT_EQ(expected_dredd_declaration, *sorted_dredd_declarations[0]);
 
-  const clang::RewriteBuffer* rewrite_buffer = rewriter.getRewriteBufferFor(
-      ast_unit->getSourceManager().getMainFileID());
-  const std::string rewritten_text(rewrite_buffer->begin(),
-                                   rewrite_buffer->end());
+  const std::string rewritten_text = rewriter.GetRewrittenText();
   ASSERT_EQ(expected, rewritten_text);
 }
 
@@ -83,7 +86,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateAdd) {
       "}";
   const std::string expected_dredd_declaration_opt =
       R"(static int __dredd_replace_binary_operator_Add_arg1_int_arg2_int_lhs_one(int arg1, int arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 + arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 4 <= __dredd_enabled_mutation_range_begin) return arg1 + arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 / arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 % arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1 - arg2;
@@ -103,7 +106,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateAdd) {
       "}";
   const std::string expected_dredd_declaration_no_opt =
       R"(static int __dredd_replace_binary_operator_Add_arg1_int_arg2_int(int arg1, int arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 + arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 6 <= __dredd_enabled_mutation_range_begin) return arg1 + arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 / arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 * arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1 % arg2;
@@ -132,7 +135,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateLAnd) {
 )";
   const std::string expected_dredd_declaration_opt =
       R"(static bool __dredd_replace_binary_operator_LAnd_arg1_bool_arg2_bool(bool arg1, std::function<bool()> arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 && arg2();
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 3 <= __dredd_enabled_mutation_range_begin) return arg1 && arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 == arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg2();
@@ -152,7 +155,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateLAnd) {
 )";
   const std::string expected_dredd_declaration_no_opt =
       R"(static bool __dredd_replace_binary_operator_LAnd_arg1_bool_arg2_bool(bool arg1, std::function<bool()> arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 && arg2();
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 5 <= __dredd_enabled_mutation_range_begin) return arg1 && arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 || arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 == arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1 != arg2();
@@ -180,7 +183,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateLOr) {
 )";
   const std::string expected_dredd_declaration_opt =
       R"(static bool __dredd_replace_binary_operator_LOr_arg1_bool_arg2_bool(bool arg1, std::function<bool()> arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 || arg2();
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 3 <= __dredd_enabled_mutation_range_begin) return arg1 || arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 != arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg2();
@@ -200,7 +203,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateLOr) {
 )";
   const std::string expected_dredd_declaration_no_opt =
       R"(static bool __dredd_replace_binary_operator_LOr_arg1_bool_arg2_bool(bool arg1, std::function<bool()> arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 || arg2();
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 5 <= __dredd_enabled_mutation_range_begin) return arg1 || arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 && arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 == arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1 != arg2();
@@ -228,7 +231,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateGT) {
 )";
   const std::string expected_dredd_declaration_opt =
       R"(static bool __dredd_replace_binary_operator_GT_arg1_int_arg2_int(int arg1, int arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 > arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 2 <= __dredd_enabled_mutation_range_begin) return arg1 > arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 != arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 >= arg2;
   return arg1 > arg2;
@@ -247,7 +250,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateGT) {
 )";
   const std::string expected_dredd_declaration_no_opt =
       R"(static bool __dredd_replace_binary_operator_GT_arg1_int_arg2_int(int arg1, int arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 > arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 7 <= __dredd_enabled_mutation_range_begin) return arg1 > arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 == arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 != arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1 >= arg2;
@@ -277,7 +280,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateLT) {
 )";
   const std::string expected_dredd_declaration_opt =
       R"(static bool __dredd_replace_binary_operator_LT_arg1_int_arg2_int(int arg1, int arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 < arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 2 <= __dredd_enabled_mutation_range_begin) return arg1 < arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 != arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 <= arg2;
   return arg1 < arg2;
@@ -296,7 +299,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateLT) {
 )";
   const std::string expected_dredd_declaration_no_opt =
       R"(static bool __dredd_replace_binary_operator_LT_arg1_int_arg2_int(int arg1, int arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 < arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 7 <= __dredd_enabled_mutation_range_begin) return arg1 < arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 == arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 != arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1 >= arg2;
@@ -326,7 +329,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateEQ) {
 )";
   const std::string expected_dredd_declaration_opt =
       R"(static bool __dredd_replace_binary_operator_EQ_arg1_int_arg2_int(int arg1, int arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 == arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 2 <= __dredd_enabled_mutation_range_begin) return arg1 == arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 >= arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 <= arg2;
   return arg1 == arg2;
@@ -345,7 +348,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateEQ) {
 )";
   const std::string expected_dredd_declaration_no_opt =
       R"(static bool __dredd_replace_binary_operator_EQ_arg1_int_arg2_int(int arg1, int arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 == arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 7 <= __dredd_enabled_mutation_range_begin) return arg1 == arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 != arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 >= arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1 > arg2;
@@ -375,7 +378,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateGE) {
 )";
   const std::string expected_dredd_declaration_opt =
       R"(static bool __dredd_replace_binary_operator_GE_arg1_int_arg2_int(int arg1, int arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 >= arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 2 <= __dredd_enabled_mutation_range_begin) return arg1 >= arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 == arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 > arg2;
   return arg1 >= arg2;
@@ -394,7 +397,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateGE) {
 )";
   const std::string expected_dredd_declaration_no_opt =
       R"(static bool __dredd_replace_binary_operator_GE_arg1_int_arg2_int(int arg1, int arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 >= arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 7 <= __dredd_enabled_mutation_range_begin) return arg1 >= arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 == arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 != arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1 > arg2;
@@ -424,7 +427,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateLE) {
 )";
   const std::string expected_dredd_declaration_opt =
       R"(static bool __dredd_replace_binary_operator_LE_arg1_int_arg2_int(int arg1, int arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 <= arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 2 <= __dredd_enabled_mutation_range_begin) return arg1 <= arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 == arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 < arg2;
   return arg1 <= arg2;
@@ -443,7 +446,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateLE) {
 )";
   const std::string expected_dredd_declaration_no_opt =
       R"(static bool __dredd_replace_binary_operator_LE_arg1_int_arg2_int(int arg1, int arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 <= arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 7 <= __dredd_enabled_mutation_range_begin) return arg1 <= arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 == arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 != arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1 >= arg2;
@@ -473,7 +476,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateNE) {
 )";
   const std::string expected_dredd_declaration_opt =
       R"(static bool __dredd_replace_binary_operator_NE_arg1_int_arg2_int(int arg1, int arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 != arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 2 <= __dredd_enabled_mutation_range_begin) return arg1 != arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 > arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 < arg2;
   return arg1 != arg2;
@@ -492,7 +495,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateNE) {
 )";
   const std::string expected_dredd_declaration_no_opt =
       R"(static bool __dredd_replace_binary_operator_NE_arg1_int_arg2_int(int arg1, int arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 != arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 7 <= __dredd_enabled_mutation_range_begin) return arg1 != arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 == arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 >= arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1 > arg2;
@@ -524,7 +527,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateAssign) {
 )";
   const std::string expected_dredd_declaration_opt =
       R"(static int& __dredd_replace_binary_operator_Assign_arg1_int_arg2_int(int& arg1, int arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 = arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 10 <= __dredd_enabled_mutation_range_begin) return arg1 = arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 += arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 &= arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1 /= arg2;
@@ -552,7 +555,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateAssign) {
 )";
   const std::string expected_dredd_declaration_no_opt =
       R"(static int& __dredd_replace_binary_operator_Assign_arg1_int_arg2_int(int& arg1, int arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 = arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 10 <= __dredd_enabled_mutation_range_begin) return arg1 = arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 += arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 &= arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1 /= arg2;
@@ -591,7 +594,7 @@ void foo() {
 )";
   const std::string expected_dredd_declaration_opt =
       R"(static int& __dredd_replace_binary_operator_Assign_arg1_int_arg2_int(int& arg1, int arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 = arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 10 <= __dredd_enabled_mutation_range_begin) return arg1 = arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 += arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 &= arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1 /= arg2;
@@ -621,7 +624,7 @@ void foo() {
 )";
   const std::string expected_dredd_declaration_no_opt =
       R"(static int& __dredd_replace_binary_operator_Assign_arg1_int_arg2_int(int& arg1, int arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 = arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 10 <= __dredd_enabled_mutation_range_begin) return arg1 = arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 += arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 &= arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1 /= arg2;
@@ -658,7 +661,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateFloatDiv) {
 )";
   const std::string expected_dredd_declaration_opt =
       R"(static float __dredd_replace_binary_operator_Div_arg1_float_arg2_float(float arg1, float arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 / arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 5 <= __dredd_enabled_mutation_range_begin) return arg1 / arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 + arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 * arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1 - arg2;
@@ -682,7 +685,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateFloatDiv) {
 )";
   const std::string expected_dredd_declaration_no_opt =
       R"(static float __dredd_replace_binary_operator_Div_arg1_float_arg2_float(float arg1, float arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 / arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 5 <= __dredd_enabled_mutation_range_begin) return arg1 / arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 + arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 * arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1 - arg2;
@@ -714,7 +717,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateFloatSubAssign) {
 )";
   const std::string expected_dredd_declaration_opt =
       R"(static double& __dredd_replace_binary_operator_SubAssign_arg1_double_arg2_double(double& arg1, double arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 -= arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 4 <= __dredd_enabled_mutation_range_begin) return arg1 -= arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 += arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 = arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1 /= arg2;
@@ -737,7 +740,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateFloatSubAssign) {
 )";
   const std::string expected_dredd_declaration_no_opt =
       R"(static double& __dredd_replace_binary_operator_SubAssign_arg1_double_arg2_double(double& arg1, double arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 -= arg2;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 4 <= __dredd_enabled_mutation_range_begin) return arg1 -= arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 += arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 = arg2;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1 /= arg2;
@@ -764,7 +767,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateLAndWithLhsSideEffect) {
 )";
   const std::string expected_dredd_declaration_opt =
       R"(static bool __dredd_replace_binary_operator_LAnd_arg1_bool_arg2_bool(std::function<bool()> arg1, std::function<bool()> arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1() && arg2();
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 3 <= __dredd_enabled_mutation_range_begin) return arg1() && arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1() == arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1();
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg2();
@@ -784,7 +787,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateLAndWithLhsSideEffect) {
 )";
   const std::string expected_dredd_declaration_no_opt =
       R"(static bool __dredd_replace_binary_operator_LAnd_arg1_bool_arg2_bool(std::function<bool()> arg1, std::function<bool()> arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1() && arg2();
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 5 <= __dredd_enabled_mutation_range_begin) return arg1() && arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1() || arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1() == arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1() != arg2();
@@ -812,7 +815,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateLAndWithRhsSideEffect) {
 )";
   const std::string expected_dredd_declaration_opt =
       R"(static bool __dredd_replace_binary_operator_LAnd_arg1_bool_arg2_bool(bool arg1, std::function<bool()> arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 && arg2();
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 3 <= __dredd_enabled_mutation_range_begin) return arg1 && arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 == arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg2();
@@ -832,7 +835,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateLAndWithRhsSideEffect) {
 )";
   const std::string expected_dredd_declaration_no_opt =
       R"(static bool __dredd_replace_binary_operator_LAnd_arg1_bool_arg2_bool(bool arg1, std::function<bool()> arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1 && arg2();
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 5 <= __dredd_enabled_mutation_range_begin) return arg1 && arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1 || arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1 == arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1 != arg2();
@@ -860,7 +863,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateLAndWithLhsRhsSideEffect) {
 )";
   const std::string expected_dredd_declaration_opt =
       R"(static bool __dredd_replace_binary_operator_LAnd_arg1_bool_arg2_bool(std::function<bool()> arg1, std::function<bool()> arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1() && arg2();
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 3 <= __dredd_enabled_mutation_range_begin) return arg1() && arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1() == arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1();
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg2();
@@ -880,7 +883,7 @@ TEST(MutationReplaceBinaryOperatorTest, MutateLAndWithLhsRhsSideEffect) {
 )";
   const std::string expected_dredd_declaration_no_opt =
       R"(static bool __dredd_replace_binary_operator_LAnd_arg1_bool_arg2_bool(std::function<bool()> arg1, std::function<bool()> arg2, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg1() && arg2();
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 5 <= __dredd_enabled_mutation_range_begin) return arg1() && arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg1() || arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg1() == arg2();
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg1() != arg2();
@@ -17,7 +17,6 @@
 #include <cstdint>
 #include <memory>
 #include <string>
-#include <unordered_set>
 #include <vector>
 
 #include "clang/AST/Decl.h"
@@ -30,9 +29,10 @@
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Frontend/ASTUnit.h"
-#include "clang/Rewrite/Core/RewriteBuffer.h"
-#include "clang/Rewrite/Core/Rewriter.h"
 #include "clang/Tooling/Tooling.h"
+#include "libdredd/dredd_declarations.h"
+#include "libdredd/main_file_rewriter.h"
+#include "libdredd/util.h"
 #include "libdreddtest/gtest.h"
 #include "llvm/ADT/SmallVector.h"
 
@@ -56,24 +56,24 @@ void TestReplacement(const std::string& original, const std::string& expected,
   ASSERT_GT(expression.size(), 0);
 
   ASSERT_LT(expression_to_replace, expression.size());
+  ExprEvaluationCache expr_evaluation_cache;
   const MutationReplaceExpr mutation(
       *expression[expression_to_replace].getNodeAs<clang::Expr>("expr"),
-      ast_unit->getPreprocessor(), ast_unit->getASTContext());
+      nullptr, nullptr, expr_evaluation_cache);
 
-  clang::Rewriter rewriter(ast_unit->getSourceManager(),
-                           ast_unit->getLangOpts());
+  MainFileRewriter rewriter(ast_unit->getSourceManager(),
+                            ast_unit->getLangOpts());
   int mutation_id = 0;
-  std::unordered_set<std::string> dredd_declarations;
+  DreddDeclarations dredd_declarations;
   mutation.Apply(ast_unit->getASTContext(), ast_unit->getPreprocessor(),
                  Options(), 0, mutation_id, rewriter, dredd_declarations);
   ASSERT_EQ(num_replacements, mutation_id);
-  ASSERT_EQ(1, dredd_declarations.size());
-  ASSERT_EQ(expected_dredd_declaration, *dredd_declarations.begin());
+  const std::vector<const std::string*> sorted_dredd_declarations =
+      dredd_declarations.GetSortedDeclarations();
+  ASSERT_EQ(1, sorted_dredd_declarations.size());
+  ASSERT_EQ(expected_dredd_declaration, *sorted_dredd_declarations[0]);
 
-  const clang::RewriteBuffer* rewrite_buffer = rewriter.getRewriteBufferFor(
-      ast_unit->getSourceManager().getMainFileID());
-  const std::string rewritten_text(rewrite_buffer->begin(),
-                                   rewrite_buffer->end());
+  const std::string rewritten_text = rewriter.GetRewrittenText();
   ASSERT_EQ(expected, rewritten_text);
 }
 
@@ -83,7 +83,7 @@ TEST(MutationReplaceExprTest, MutateSignedConstants) {
       "void foo() { __dredd_replace_expr_int_constant(2, 0); }";
   const std::string expected_dredd_declaration =
       R"(static int __dredd_replace_expr_int_constant(int arg, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 5 <= __dredd_enabled_mutation_range_begin) return arg;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return ~(arg);
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return -(arg);
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return 0;
@@ -105,7 +105,7 @@ TEST(MutationReplaceExprTest, MutateUnsignedConstants) {
       "__dredd_replace_expr_unsigned_int_constant(2, 0); }";
   const std::string expected_dredd_declaration =
       R"(static unsigned int __dredd_replace_expr_unsigned_int_constant(unsigned int arg, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 3 <= __dredd_enabled_mutation_range_begin) return arg;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return ~(arg);
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return 0;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return 1;
@@ -124,7 +124,7 @@ TEST(MutationReplaceExprTest, MutateFloatConstants) {
       "void foo() { __dredd_replace_expr_double(2.523, 0); }";
   const std::string expected_dredd_declaration =
       R"(static double __dredd_replace_expr_double(double arg, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 4 <= __dredd_enabled_mutation_range_begin) return arg;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return -(arg);
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return 0.0;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return 1.0;
@@ -153,7 +153,7 @@ TEST(MutationReplaceExprTest, MutateLValues) {
 )";
   const std::string expected_dredd_declaration =
       R"(static int __dredd_replace_expr_int_lvalue(int& arg, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 2 <= __dredd_enabled_mutation_range_begin) return arg;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return ++(arg);
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return --(arg);
   return arg;
@@ -194,7 +194,7 @@ int neg(int x) {
 )";
   const std::string expected_dredd_declaration =
       R"(static int __dredd_replace_expr_int(int arg, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 6 <= __dredd_enabled_mutation_range_begin) return arg;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return !(arg);
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return ~(arg);
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return -(arg);
@@ -225,7 +225,7 @@ bool foo(bool a, bool b) {
 )";
   const std::string expected_dredd_declaration =
       R"(static bool __dredd_replace_expr_bool_omit_true(bool arg, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 1 <= __dredd_enabled_mutation_range_begin) return arg;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return false;
   return arg;
 }
@@ -251,7 +251,7 @@ bool foo(bool a, bool b) {
 )";
   const std::string expected_dredd_declaration =
       R"(static bool __dredd_replace_expr_bool_omit_false(bool arg, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 1 <= __dredd_enabled_mutation_range_begin) return arg;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return true;
   return arg;
 }
@@ -28,9 +28,10 @@
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Frontend/ASTUnit.h"
-#include "clang/Rewrite/Core/RewriteBuffer.h"
-#include "clang/Rewrite/Core/Rewriter.h"
 #include "clang/Tooling/Tooling.h"
+#include "libdredd/dredd_declarations.h"
+#include "libdredd/main_file_rewriter.h"
+#include "libdredd/util.h"
 #include "libdreddtest/gtest.h"
 #include "llvm/ADT/SmallVector.h"
 
@@ -53,25 +54,26 @@ void TestReplacement(const std::string& original, const std::string& expected,
       ast_unit->getASTContext());
   ASSERT_EQ(1, unary_operator.size());
 
+  ExprEvaluationCache expr_evaluation_cache;
   const MutationReplaceUnaryOperator mutation(
       *unary_operator[0].getNodeAs<clang::UnaryOperator>("op"),
-      ast_unit->getPreprocessor(), ast_unit->getASTContext());
+      expr_evaluation_cache);
 
-  clang::Rewriter rewriter(ast_unit->getSourceManager(),
-                           ast_unit->getLangOpts());
+  MainFileRewriter rewriter(ast_unit->getSourceManager(),
+                            ast_unit->getLangOpts());
   int mutation_id = 0;
-  std::unordered_set<std::string> dredd_declarations;
-  mutation.Apply(ast_unit->getASTContext(), ast_unit->getPreprocessor(),
-                 Options(optimise_mutations, false, false, false), 0,
-                 mutation_id, rewriter, dredd_declarations);
+  DreddDeclarations dredd_declarations;
+  mutation.Apply(
+      ast_unit->getASTContext(), ast_unit->getPreprocessor(),
+      Options().SetOptimiseMutations(optimise_mutations),
+      0, mutation_id, rewriter, dredd_declarations);
   ASSERT_EQ(num_replacements, mutation_id);
-  ASSERT_EQ(1, dredd_declarations.size());
-  ASSERT_EQ(expected_dredd_declaration, *dredd_declarations.begin());
+  const std::vector<const std::string*> sorted_dredd_declarations =
+      dredd_declarations.GetSortedDeclarations();
+  ASSERT_EQ(1, sorted_dredd_declarations.size());
+  ASSERT_EQ(expected_dredd_declaration, *sorted_dredd_declarations[0]);
 
-  const clang::RewriteBuffer* rewrite_buffer = rewriter.getRewriteBufferFor(
-      ast_unit->getSourceManager().getMainFileID());
-  const std::string rewritten_text(rewrite_buffer->begin(),
-                                   rewrite_buffer->end());
+  const std::string rewritten_text = rewriter.GetRewrittenText();
   ASSERT_EQ(expected, rewritten_text);
 }
 
@@ -81,7 +83,7 @@ TEST(MutationReplaceUnaryOperatorTest, MutateMinus) {
       "void foo() { __dredd_replace_unary_operator_Minus_int(2, 0); }";
   const std::string expected_dredd_declaration_opt =
       R"(static int __dredd_replace_unary_operator_Minus_int(int arg, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return -arg;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 2 <= __dredd_enabled_mutation_range_begin) return -arg;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return ~arg;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return !arg;
   return -arg;
@@ -98,7 +100,7 @@ TEST(MutationReplaceUnaryOperatorTest, MutateMinus) {
       "void foo() { __dredd_replace_unary_operator_Minus_int(2, 0); }";
   const std::string expected_dredd_declaration_no_opt =
       R"(static int __dredd_replace_unary_operator_Minus_int(int arg, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return -arg;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 3 <= __dredd_enabled_mutation_range_begin) return -arg;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return ~arg;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return !arg;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg;
@@ -127,7 +129,7 @@ TEST(MutationReplaceUnaryOperatorTest, MutateNot) {
 )";
   const std::string expected_dredd_declaration_opt =
       R"(static bool __dredd_replace_unary_operator_LNot_bool(bool arg, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return !arg;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 2 <= __dredd_enabled_mutation_range_begin) return !arg;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return ~arg;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return -arg;
   return !arg;
@@ -148,7 +150,7 @@ TEST(MutationReplaceUnaryOperatorTest, MutateNot) {
 )";
   const std::string expected_dredd_declaration_no_opt =
       R"(static bool __dredd_replace_unary_operator_LNot_bool(bool arg, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return !arg;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 3 <= __dredd_enabled_mutation_range_begin) return !arg;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return ~arg;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return -arg;
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return arg;
@@ -177,7 +179,7 @@ TEST(MutationReplaceUnaryOperatorTest, MutateIncrement) {
 )";
   const std::string expected_dredd_declaration_opt =
       R"(static double& __dredd_replace_unary_operator_PreInc_double(std::function<double&()> arg, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return ++arg();
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 2 <= __dredd_enabled_mutation_range_begin) return ++arg();
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return --arg();
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg();
   return ++arg();
@@ -198,7 +200,7 @@ TEST(MutationReplaceUnaryOperatorTest, MutateIncrement) {
 )";
   const std::string expected_dredd_declaration_noopt =
       R"(static double& __dredd_replace_unary_operator_PreInc_double(std::function<double&()> arg, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return ++arg();
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 2 <= __dredd_enabled_mutation_range_begin) return ++arg();
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return --arg();
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg();
   return ++arg();
@@ -226,7 +228,7 @@ TEST(MutationReplaceUnaryOperatorTest, MutateDecrement) {
 )";
   const std::string expected_dredd_declaration_opt =
       R"(static int __dredd_replace_unary_operator_PostDec_int(std::function<int&()> arg, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg()--;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 5 <= __dredd_enabled_mutation_range_begin) return arg()--;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg()++;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return ~arg();
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return -arg();
@@ -250,7 +252,7 @@ TEST(MutationReplaceUnaryOperatorTest, MutateDecrement) {
 )";
   const std::string expected_dredd_declaration_no_opt =
       R"(static int __dredd_replace_unary_operator_PostDec_int(std::function<int&()> arg, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return arg()--;
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 5 <= __dredd_enabled_mutation_range_begin) return arg()--;
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return arg()++;
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return ~arg();
   if (__dredd_enabled_mutation(local_mutation_id + 2)) return -arg();
@@ -281,7 +283,7 @@ TEST(MutationReplaceUnaryOperatorTest, MutateDecrementAssign) {
 )";
   const std::string expected_dredd_declaration_opt =
       R"(static int& __dredd_replace_unary_operator_PreDec_int(std::function<int&()> arg, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return --arg();
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 2 <= __dredd_enabled_mutation_range_begin) return --arg();
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return ++arg();
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg();
   return --arg();
@@ -302,7 +304,7 @@ TEST(MutationReplaceUnaryOperatorTest, MutateDecrementAssign) {
 )";
   const std::string expected_dredd_declaration_no_opt =
       R"(static int& __dredd_replace_unary_operator_PreDec_int(std::function<int&()> arg, int local_mutation_id) {
-  if (!__dredd_some_mutation_enabled) return --arg();
+  if (!__dredd_some_mutation_enabled || local_mutation_id >= __dredd_enabled_mutation_range_end || local_mutation_id + 2 <= __dredd_enabled_mutation_range_begin) return --arg();
   if (__dredd_enabled_mutation(local_mutation_id + 0)) return ++arg();
   if (__dredd_enabled_mutation(local_mutation_id + 1)) return arg();
   return --arg();
@@ -0,0 +1,118 @@
+// Copyright 2024 The Dredd Project Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "libdredd/mutation_sampler.h"
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/DeclBase.h"
+#include "clang/Lex/Preprocessor.h"
+#include "libdredd/dredd_declarations.h"
+#include "libdredd/main_file_rewriter.h"
+#include "libdredd/mutation.h"
+#include "libdredd/options.h"
+#include "libdredd/protobufs/dredd_protobufs.h"
+#include "libdreddtest/gtest.h"
+
+namespace dredd {
+namespace {
+
+// A mutation that is only used for its kind.
+class FakeMutation : public Mutation {
+ public:
+  explicit FakeMutation(protobufs::MutationGroup::GroupCase kind)
+      : kind_(kind) {}
+
+  protobufs::MutationGroup Apply(
+      clang::ASTContext& /*unused*/, const clang::Preprocessor& /*unused*/,
+      const Options& /*unused*/, int /*unused*/, int& /*unused*/,
+      MainFileRewriter& /*unused*/,
+      DreddDeclarations& /*unused*/) const override {
+    return {};
+  }
+
+  [[nodiscard]] protobufs::MutationGroup::GroupCase GetKind() const override {
+    return kind_;
+  }
+
+ private:
+  protobufs::MutationGroup::GroupCase kind_;
+};
+
+// Records |num_mutations_per_stratum| mutations of each of two kinds in each
+// of |num_functions| functions. The functions are identified by the addresses
+// of the elements of |functions|, which are never dereferenced.
+void AddMutations(MutationSampler& sampler, const std::vector<char>& functions,
+                  size_t num_mutations_per_stratum,
+                  std::vector<std::unique_ptr<FakeMutation>>& mutations) {
+  for (const char& function : functions) {
+    for (const auto kind : {protobufs::MutationGroup::kRemoveStmt,
+                            protobufs::MutationGroup::kReplaceExpr}) {
+      for (size_t i = 0; i < num_mutations_per_stratum; i++) {
+        mutations.push_back(std::make_unique<FakeMutation>(kind));
+        sampler.AddMutation(*mutations.back(),
+                            reinterpret_cast<const clang::Decl*>(&function));
+      }
+    }
+  }
+}
+
+TEST(MutationSamplerTest, SampleIsDeterministic) {
+  MutationSampler sampler;
+  const std::vector<char> functions(10);
+  std::vector<std::unique_ptr<FakeMutation>> mutations;
+  AddMutations(sampler, functions, 50, mutations);
+  const auto first = sampler.Select(0.25, 0, 42, "a.cc");
+  const auto second = sampler.Select(0.25, 0, 42, "a.cc");
+  ASSERT_EQ(first, second);
+  ASSERT_NE(first, sampler.Select(0.25, 0, 43, "a.cc"));
+  ASSERT_NE(first, sampler.Select(0.25, 0, 42, "b.cc"));
+}
+
+TEST(MutationSamplerTest, SampleIsStratified) {
+  MutationSampler sampler;
+  const std::vector<char> functions(10);
+  std::vector<std::unique_ptr<FakeMutation>> mutations;
+  AddMutations(sampler, functions, 20, mutations);
+  const auto selected = sampler.Select(0.25, 0, 0, "a.cc");
+  // Each stratum has 20 mutations, a quarter of which are selected.
+  ASSERT_EQ(100U, selected.size());
+  for (size_t stratum = 0; stratum < mutations.size() / 20; stratum++) {
+    size_t num_selected_in_stratum = 0;
+    for (size_t i = 0; i < 20; i++) {
+      if (selected.contains(mutations[stratum * 20 + i].get())) {
+        num_selected_in_stratum++;
+      }
+    }
+    ASSERT_EQ(5U, num_selected_in_stratum);
+  }
+}
+
+TEST(MutationSamplerTest, SampleRespectsMaximum) {
+  MutationSampler sampler;
+  const std::vector<char> functions(7);
+  std::vector<std::unique_ptr<FakeMutation>> mutations;
+  AddMutations(sampler, functions, 13, mutations);
+  ASSERT_GE(100U, sampler.Select(1.0, 100, 0, "a.cc").size());
+  ASSERT_EQ(mutations.size(), sampler.Select(1.0, 0, 0, "a.cc").size());
+  ASSERT_TRUE(sampler.Select(0.0, 0, 0, "a.cc").empty());
+}
+
+}  // namespace
+}  // namespace dredd
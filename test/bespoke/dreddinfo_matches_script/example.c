@@ -0,0 +1,23 @@
+#include <stdio.h>
+
+static int clamp(int x, int lo, int hi) {
+  if (x < lo) {
+    return lo;
+  }
+  if (x > hi) {
+    return hi;
+  }
+  return x;
+}
+
+int main(int argc, char** argv) {
+  int total = 0;
+  for (int i = 0; i < argc; i++) {
+    total += clamp(i * 3 - 1, 0, 4);
+  }
+  if (total > 2 && !(argc == 1 || argc > 4)) {
+    total = -total;
+  }
+  printf("%d\n", total);
+  return 0;
+}
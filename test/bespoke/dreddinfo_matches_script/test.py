@@ -0,0 +1,88 @@
+import os
+import re
+import shutil
+import subprocess
+import sys
+from pathlib import Path
+
+DREDD_REPO_ROOT = os.environ['DREDD_REPO_ROOT']
+DREDD_EXECUTABLE = Path(DREDD_REPO_ROOT, 'temp', 'build-Debug', 'src', 'dredd', 'dredd') if 'DREDD_EXECUTABLE' not in os.environ else os.environ['DREDD_EXECUTABLE']
+DREDD_INFO_EXECUTABLE = Path(DREDD_REPO_ROOT, 'temp', 'build-Debug', 'src', 'dreddinfo', 'dredd-info') if 'DREDD_INFO_EXECUTABLE' not in os.environ else os.environ['DREDD_INFO_EXECUTABLE']
+QUERY_MUTANT_INFO_SCRIPT = Path(DREDD_REPO_ROOT, 'scripts', 'query_mutant_info.py')
+
+
+def run_successfully(cmd):
+    result = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    if result.returncode != 0:
+        print(f"Command exited with error code {result.returncode}: {' '.join([str(c) for c in cmd])}")
+        print(result.stdout.decode('utf-8'))
+        print(result.stderr.decode('utf-8'))
+        sys.exit(1)
+    return result.stdout.decode('utf-8')
+
+
+def check_same_output(query_args):
+    native_output = run_successfully([DREDD_INFO_EXECUTABLE] + query_args + ['mutant-info.json'])
+    script_output = run_successfully(["python", QUERY_MUTANT_INFO_SCRIPT] + query_args + ['mutant-info.json'])
+    if native_output != script_output:
+        print(f"dredd-info and query_mutant_info.py disagree for query {' '.join(query_args)}")
+        print("dredd-info output:")
+        print(native_output)
+        print("query_mutant_info.py output:")
+        print(script_output)
+        sys.exit(1)
+    return native_output
+
+
+def check_all_queries():
+    largest_mutant_id = int(check_same_output(['--largest-mutant-id']))
+    assert largest_mutant_id > 0
+    path_prefix_replacement = ['--path-prefix-replacement', os.path.abspath('mutated'),
+                               os.path.abspath('original')]
+    for mutant in range(0, largest_mutant_id + 1):
+        check_same_output(['--show-info-for-mutant', str(mutant)] + path_prefix_replacement)
+    return largest_mutant_id
+
+
+def main():
+    os.mkdir('original')
+    os.mkdir('mutated')
+    shutil.copyfile(src='example.c', dst=f'original{os.sep}example.c')
+    shutil.copyfile(src='example.c', dst=f'mutated{os.sep}example.c')
+
+    # Mutate the copy, so that source code must be looked up via the path prefix replacement.
+    run_successfully([DREDD_EXECUTABLE, '--mutation-info-file', 'mutant-info.json',
+                      f'mutated{os.sep}example.c', '--'])
+    # The first round of queries builds the index; the second uses it.
+    check_all_queries()
+    assert os.path.exists('mutant-info.json.index')
+    largest_mutant_id = check_all_queries()
+
+    # Regenerating the mutation info file with a different set of mutants must cause the stale index to be rebuilt.
+    shutil.copyfile(src='example.c', dst=f'mutated{os.sep}example.c')
+    run_successfully([DREDD_EXECUTABLE, '--no-mutation-opts', '--mutation-info-file', 'mutant-info.json',
+                      f'mutated{os.sep}example.c', '--'])
+    largest_mutant_id_no_opts = check_all_queries()
+    assert largest_mutant_id_no_opts != largest_mutant_id
+
+    # Swapping the ids of two mutants changes the mutation info file without changing its size, and the modification
+    # time is restored afterwards, so only the hash of the contents shows that the index is stale.
+    original_status = os.stat('mutant-info.json')
+    with open('mutant-info.json', 'r', newline='') as json_file:
+        contents = json_file.read()
+    path_prefix_replacement = ['--path-prefix-replacement', os.path.abspath('mutated'),
+                               os.path.abspath('original')]
+    assert (check_same_output(['--show-info-for-mutant', '1'] + path_prefix_replacement)
+            != check_same_output(['--show-info-for-mutant', '2'] + path_prefix_replacement))
+    swapped_ids = {'1': '2', '2': '1'}
+    contents = re.sub(r'("mutationId":\s*)([12])\b',
+                      lambda match: match.group(1) + swapped_ids[match.group(2)], contents)
+    with open('mutant-info.json', 'w', newline='') as json_file:
+        json_file.write(contents)
+    os.utime('mutant-info.json', ns=(original_status.st_atime_ns, original_status.st_mtime_ns))
+    assert os.stat('mutant-info.json').st_size == original_status.st_size
+    assert check_all_queries() == largest_mutant_id_no_opts
+
+
+if __name__ == '__main__':
+    sys.exit(main())
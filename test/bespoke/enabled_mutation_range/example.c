@@ -0,0 +1,13 @@
+#include <stdio.h>
+
+int first(int a, int b) { return a * b + (a - b); }
+
+int second(int a, int b) { return (a > b && b != 0) ? a / b : b - a; }
+
+int third(int a, int b) { return (a | b) ^ (a << 1); }
+
+int main(int argc, char** argv) {
+  printf("%d %d %d\n", first(argc + 1, argc + 3), second(argc + 6, argc + 1),
+         third(argc, argc + 4));
+  return 0;
+}
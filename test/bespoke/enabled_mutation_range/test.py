@@ -0,0 +1,76 @@
+import os
+import re
+import shutil
+import subprocess
+import sys
+from pathlib import Path
+
+DREDD_REPO_ROOT = os.environ['DREDD_REPO_ROOT']
+DREDD_CLANG_LLVM_DIR = os.environ['DREDD_CLANG_LLVM_DIR']
+DREDD_EXECUTABLE = Path(DREDD_REPO_ROOT, 'temp', 'build-Debug', 'src', 'dredd', 'dredd') if 'DREDD_EXECUTABLE' not in os.environ else os.environ['DREDD_EXECUTABLE']
+QUERY_MUTANT_INFO_SCRIPT = Path(DREDD_REPO_ROOT, 'scripts', 'query_mutant_info.py')
+CLANG_EXECUTABLE = Path(DREDD_CLANG_LLVM_DIR, 'bin', 'clang')
+EXECUTABLE_SUFFIX = '.exe' if os.name == 'nt' else ''
+
+
+def run_successfully(cmd):
+    result = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    if result.returncode != 0:
+        print(f"Command exited with error code {result.returncode}: {' '.join([str(x) for x in cmd])}")
+        print(result.stdout.decode('utf-8'))
+        print(result.stderr.decode('utf-8'))
+        sys.exit(1)
+    return result
+
+
+def mutate_and_compile(name, extra_dredd_args):
+    shutil.copyfile(src='example.c', dst=f'{name}.c')
+    run_successfully([DREDD_EXECUTABLE] + extra_dredd_args + ['--mutation-info-file', f'{name}.json', f'{name}.c',
+                                                              '--'])
+    executable = f'./{name}{EXECUTABLE_SUFFIX}'
+    run_successfully([CLANG_EXECUTABLE, f'{name}.c', '-o', executable])
+    return executable
+
+
+def run_with_mutants(executable, mutants, extra_env):
+    dredd_env = os.environ.copy()
+    dredd_env.update(extra_env)
+    if mutants is not None:
+        dredd_env['DREDD_ENABLED_MUTATION'] = mutants
+    result = subprocess.run([executable], env=dredd_env, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    return result.returncode, result.stdout
+
+
+def main():
+    default_executable = mutate_and_compile('default', [])
+    # With --runtime-budget, setting DREDD_MUTATION_CHECK_COUNT_FILE makes the program check every mutation that it
+    # reaches, so that the range of enabled mutations is not used to skip any mutator function.
+    budget_executable = mutate_and_compile('budget', ['--runtime-budget'])
+    every_check = {'DREDD_MUTATION_CHECK_COUNT_FILE': 'mutation_checks.count'}
+
+    # In the default mode, the prelude records the range of enabled mutations, and every mutator function that checks
+    # mutations returns the original value straight away if its mutations lie outside this range.
+    default_source = open('default.c', 'r').read()
+    assert 'static thread_local int __dredd_enabled_mutation_range_begin = 0;' in default_source
+    fast_paths = re.findall(r'\n  if \(!__dredd_some_mutation_enabled(.*)\) return ', default_source)
+    assert len(fast_paths) > 0
+    for fast_path in fast_paths:
+        assert re.fullmatch(r' \|\| local_mutation_id >= __dredd_enabled_mutation_range_end \|\| '
+                            r'local_mutation_id \+ \d+ <= __dredd_enabled_mutation_range_begin', fast_path)
+
+    # Skipping the mutator functions outside the range must not change the behaviour of any mutant, including when
+    # mutants at opposite ends of the file are enabled simultaneously.
+    largest_mutant_id = int(run_successfully(
+        ["python", QUERY_MUTANT_INFO_SCRIPT, "--largest-mutant-id", "default.json"]).stdout.decode('utf-8'))
+    for mutant in [None] + list(range(0, largest_mutant_id + 1)):
+        mutants = None if mutant is None else str(mutant)
+        assert run_with_mutants(default_executable, mutants, {}) == run_with_mutants(budget_executable, mutants,
+                                                                                   every_check)
+    for mutant in range(0, largest_mutant_id + 1):
+        mutants = f'{mutant},{largest_mutant_id - mutant}'
+        assert run_with_mutants(default_executable, mutants, {}) == run_with_mutants(budget_executable, mutants,
+                                                                                   every_check)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
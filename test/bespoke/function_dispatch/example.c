@@ -0,0 +1,28 @@
+#include <stdio.h>
+
+int compute(int a, int b, int c) {
+  int result = 0;
+  for (int i = 0; i < a + 3; i++) {
+    result += a * b + c - (a ^ i);
+  }
+  return result * (b - a) + (c | 1);
+}
+
+int count(int n) {
+  static int calls = 0;
+  calls += n;
+  return calls;
+}
+
+// The external declaration provides the external definition of this inline
+// function.
+inline int scale(int x) { return 2 * x + 1; }
+
+extern int scale(int x);
+
+int main(int argc, char** argv) {
+  count(argc);
+  printf("%d %d %d\n", compute(argc, argc + 2, argc + 5), count(2),
+         scale(argc));
+  return 0;
+}
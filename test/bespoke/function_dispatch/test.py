@@ -0,0 +1,68 @@
+import os
+import shutil
+import subprocess
+import sys
+from pathlib import Path
+
+DREDD_REPO_ROOT = os.environ['DREDD_REPO_ROOT']
+DREDD_CLANG_LLVM_DIR = os.environ['DREDD_CLANG_LLVM_DIR']
+DREDD_EXECUTABLE = Path(DREDD_REPO_ROOT, 'temp', 'build-Debug', 'src', 'dredd', 'dredd') if 'DREDD_EXECUTABLE' not in os.environ else os.environ['DREDD_EXECUTABLE']
+QUERY_MUTANT_INFO_SCRIPT = Path(DREDD_REPO_ROOT, 'scripts', 'query_mutant_info.py')
+CLANG_EXECUTABLE = Path(DREDD_CLANG_LLVM_DIR, 'bin', 'clang')
+EXECUTABLE_SUFFIX = '.exe' if os.name == 'nt' else ''
+
+
+def run_successfully(cmd):
+    result = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    if result.returncode != 0:
+        print(f"Command exited with error code {result.returncode}: {' '.join([str(x) for x in cmd])}")
+        print(result.stdout.decode('utf-8'))
+        print(result.stderr.decode('utf-8'))
+        sys.exit(1)
+    return result
+
+
+def mutate_and_compile(name, extra_dredd_args):
+    shutil.copyfile(src='example.c', dst=f'{name}.c')
+    run_successfully([DREDD_EXECUTABLE] + extra_dredd_args + ['--mutation-info-file', f'{name}.json', f'{name}.c',
+                                                              '--'])
+    executable = f'./{name}{EXECUTABLE_SUFFIX}'
+    run_successfully([CLANG_EXECUTABLE, f'{name}.c', '-o', executable])
+    return executable
+
+
+def run_with_mutant(executable, mutant):
+    dredd_env = os.environ.copy()
+    if mutant is not None:
+        dredd_env['DREDD_ENABLED_MUTATION'] = str(mutant)
+    result = subprocess.run([executable], env=dredd_env, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    return result.returncode, result.stdout
+
+
+def main():
+    in_place_executable = mutate_and_compile('in_place', [])
+    dispatch_executable = mutate_and_compile('dispatch', ['--function-dispatch'])
+
+    # The bodies of 'compute' and 'main' are copied, and each calls the function that the prelude defines. The body of
+    # 'count' is not copied, as each copy would have its own instance of the static variable. Nor is the body of the
+    # inline function 'scale', as C does not allow the static variable that the copy would declare.
+    dispatch_source = open('dispatch.c', 'r').read()
+    assert dispatch_source.count('__dredd_mutation_enabled_in_range(') == 3
+    assert '__dredd_mutation_enabled_in_range' not in open('in_place.c', 'r').read()
+
+    # Mutant ids are the same in both modes, so each mutant should behave in the same way in both modes.
+    largest_mutant_id = int(run_successfully(
+        ["python", QUERY_MUTANT_INFO_SCRIPT, "--largest-mutant-id", "in_place.json"]).stdout.decode('utf-8'))
+    assert largest_mutant_id == int(run_successfully(
+        ["python", QUERY_MUTANT_INFO_SCRIPT, "--largest-mutant-id", "dispatch.json"]).stdout.decode('utf-8'))
+    for mutant in [None] + list(range(0, largest_mutant_id + 1)):
+        assert run_with_mutant(in_place_executable, mutant) == run_with_mutant(dispatch_executable, mutant)
+
+    # The same holds when several mutants, possibly in different functions, are enabled simultaneously.
+    for mutant in range(0, largest_mutant_id + 1):
+        mutants = f'{mutant},{largest_mutant_id - mutant}'
+        assert run_with_mutant(in_place_executable, mutants) == run_with_mutant(dispatch_executable, mutants)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
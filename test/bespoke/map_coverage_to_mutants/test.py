@@ -0,0 +1,75 @@
+import os
+import shutil
+import subprocess
+import sys
+from pathlib import Path
+
+DREDD_REPO_ROOT = os.environ['DREDD_REPO_ROOT']
+DREDD_CLANG_LLVM_DIR = os.environ['DREDD_CLANG_LLVM_DIR']
+DREDD_EXECUTABLE = Path(DREDD_REPO_ROOT, 'temp', 'build-Debug', 'src', 'dredd', 'dredd') if 'DREDD_EXECUTABLE' not in os.environ else os.environ['DREDD_EXECUTABLE']
+MAP_COVERAGE_TO_MUTANTS_SCRIPT = Path(DREDD_REPO_ROOT, 'scripts', 'map_coverage_to_mutants.py')
+CLANG_EXECUTABLE = Path(DREDD_CLANG_LLVM_DIR, 'bin', 'clang')
+LLVM_PROFDATA_EXECUTABLE = Path(DREDD_CLANG_LLVM_DIR, 'bin', 'llvm-profdata')
+LLVM_COV_EXECUTABLE = Path(DREDD_CLANG_LLVM_DIR, 'bin', 'llvm-cov')
+EXECUTABLE_SUFFIX = '.exe' if os.name == 'nt' else ''
+
+
+def run_successfully(cmd, env=None):
+    result = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, env=env)
+    if result.returncode != 0:
+        print(f"Command exited with error code {result.returncode}: {' '.join([str(c) for c in cmd])}")
+        print(result.stdout.decode('utf-8'))
+        print(result.stderr.decode('utf-8'))
+        sys.exit(1)
+    return result
+
+
+def main():
+    # Obtain the mutants reached when the example is run with no arguments, so that the body of the "if" statement is
+    # not reached, using a mutant tracking build.
+    os.makedirs('mutated', exist_ok=True)
+    shutil.copyfile(src='example.c', dst=Path('mutated', 'example.c'))
+    run_successfully([DREDD_EXECUTABLE,
+                      '--mutation-info-file',
+                      'info.json',
+                      '--only-track-mutant-coverage',
+                      Path('mutated', 'example.c'),
+                      '--'])
+    tracking_executable = f'./tracking{EXECUTABLE_SUFFIX}'
+    run_successfully([CLANG_EXECUTABLE, Path('mutated', 'example.c'), '-o', tracking_executable])
+    dredd_env = os.environ.copy()
+    dredd_env['DREDD_MUTANT_TRACKING_FILE'] = 'tracked.mutants'
+    run_successfully([tracking_executable], env=dredd_env)
+    tracked = set([int(line.strip()) for line in open('tracked.mutants', 'r').readlines()])
+
+    # Obtain source-based coverage for the same run of an unmutated copy of the example, held in a different
+    # directory.
+    os.makedirs('original', exist_ok=True)
+    shutil.copyfile(src='example.c', dst=Path('original', 'example.c'))
+    coverage_executable = f'./coverage{EXECUTABLE_SUFFIX}'
+    run_successfully([CLANG_EXECUTABLE, '-fprofile-instr-generate', '-fcoverage-mapping', Path('original', 'example.c'),
+                      '-o', coverage_executable])
+    coverage_env = os.environ.copy()
+    coverage_env['LLVM_PROFILE_FILE'] = 'example.profraw'
+    run_successfully([coverage_executable], env=coverage_env)
+    run_successfully([LLVM_PROFDATA_EXECUTABLE, 'merge', '-o', 'example.profdata', 'example.profraw'])
+    with open('coverage.json', 'w') as coverage_output:
+        coverage_output.write(run_successfully([LLVM_COV_EXECUTABLE, 'export', coverage_executable,
+                                                '-instr-profile=example.profdata']).stdout.decode('utf-8'))
+
+    # Mapping the coverage to mutants should identify exactly the mutants that the tracking build reached.
+    output = run_successfully(
+        ["python", MAP_COVERAGE_TO_MUTANTS_SCRIPT, "info.json", "--coverage-exports", "no_arguments=coverage.json",
+         "--path-prefix-replacement", str(Path('mutated').absolute()), str(Path('original').absolute()),
+         "--covered-mutants-file", "covered.mutants"]).stdout.decode('utf-8')
+    covered = set([int(line.strip()) for line in open('covered.mutants', 'r').readlines()])
+    assert len(tracked) > 0
+    assert covered == tracked
+    statuses = dict([line.split(': ') for line in output.splitlines() if not line.startswith('Mutants:')])
+    assert all(statuses[str(mutant)] == 'no_arguments' for mutant in tracked)
+    assert all(status == 'not executed' for mutant, status in statuses.items() if int(mutant) not in tracked)
+    assert 'not executed' in statuses.values()
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,26 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+int difference(int a, int b) {
+  if (a > b) {
+    return a - b;
+  }
+  return b * 2 + a;
+}
+
+int unused(int a) {
+  return a + 7;
+}
+
+void report_exit(void) {
+  printf("exiting\n");
+}
+
+int main(int argc, char** argv) {
+  atexit(report_exit);
+  if (argc > 5) {
+    printf("%d\n", unused(argc));
+  }
+  printf("%d\n", difference(argc, 3));
+  return 0;
+}
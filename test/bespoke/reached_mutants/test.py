@@ -0,0 +1,80 @@
+import os
+import shutil
+import subprocess
+import sys
+from pathlib import Path
+
+DREDD_REPO_ROOT = os.environ['DREDD_REPO_ROOT']
+DREDD_CLANG_LLVM_DIR = os.environ['DREDD_CLANG_LLVM_DIR']
+DREDD_EXECUTABLE = Path(DREDD_REPO_ROOT, 'temp', 'build-Debug', 'src', 'dredd', 'dredd') if 'DREDD_EXECUTABLE' not in os.environ else os.environ['DREDD_EXECUTABLE']
+QUERY_MUTANT_INFO_SCRIPT = Path(DREDD_REPO_ROOT, 'scripts', 'query_mutant_info.py')
+CLANG_EXECUTABLE = Path(DREDD_CLANG_LLVM_DIR, 'bin', 'clang')
+EXECUTABLE_SUFFIX = '.exe' if os.name == 'nt' else ''
+
+
+def run_successfully(cmd):
+    result = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    if result.returncode != 0:
+        print(f"Command exited with error code {result.returncode}: {' '.join([str(x) for x in cmd])}")
+        print(result.stdout.decode('utf-8'))
+        print(result.stderr.decode('utf-8'))
+        sys.exit(1)
+    return result
+
+
+def mutate_and_compile(name, extra_dredd_args):
+    shutil.copyfile(src='example.c', dst=f'{name}.c')
+    run_successfully([DREDD_EXECUTABLE] + extra_dredd_args + ['--mutation-info-file', f'{name}.json', f'{name}.c',
+                                                              '--'])
+    executable = f'./{name}{EXECUTABLE_SUFFIX}'
+    run_successfully([CLANG_EXECUTABLE, f'{name}.c', '-o', executable])
+    return executable
+
+
+def read_mutant_ids(filename):
+    if not os.path.exists(filename):
+        return set()
+    return set([int(line.strip()) for line in open(filename, 'r').readlines()])
+
+
+def main():
+    tracking_executable = mutate_and_compile('tracking', ['--only-track-mutant-coverage'])
+    reporting_executable = mutate_and_compile('reporting', ['--report-reached-mutants'])
+
+    # The mutants reached by the original program.
+    dredd_env = os.environ.copy()
+    dredd_env['DREDD_MUTANT_TRACKING_FILE'] = 'covered.mutants'
+    assert subprocess.run([tracking_executable], env=dredd_env, stdout=subprocess.PIPE).returncode == 0
+    covered = read_mutant_ids('covered.mutants')
+
+    largest_mutant_id = int(run_successfully(
+        ["python", QUERY_MUTANT_INFO_SCRIPT, "--largest-mutant-id", "reporting.json"]).stdout.decode('utf-8'))
+    assert 0 < len(covered) < largest_mutant_id + 1
+
+    # Execution up to the point at which an enabled mutant is first reached is the same as for the original program,
+    # so each mutant should be reported as reached if and only if its code is covered by the original program.
+    for mutant in range(0, largest_mutant_id + 1):
+        reached_file = f'{mutant}.reached'
+        dredd_env = os.environ.copy()
+        dredd_env['DREDD_ENABLED_MUTATION'] = str(mutant)
+        dredd_env['DREDD_REACHED_MUTANTS_FILE'] = reached_file
+        result = subprocess.run([reporting_executable], env=dredd_env, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        if mutant in covered:
+            assert read_mutant_ids(reached_file) == {mutant}
+        else:
+            assert read_mutant_ids(reached_file) == set()
+            # An unreached mutant does not affect the program, including its exit status.
+            assert result.returncode == 0
+
+    # Exit handlers of the program still run when an enabled mutant is not reached.
+    dredd_env = os.environ.copy()
+    dredd_env['DREDD_ENABLED_MUTATION'] = str(min(set(range(0, largest_mutant_id + 1)).difference(covered)))
+    dredd_env['DREDD_REACHED_MUTANTS_FILE'] = 'unreached.reached'
+    result = subprocess.run([reporting_executable], env=dredd_env, stdout=subprocess.PIPE)
+    assert result.returncode == 0
+    assert b'exiting' in result.stdout
+    assert read_mutant_ids('unreached.reached') == set()
+
+
+if __name__ == '__main__':
+    sys.exit(main())
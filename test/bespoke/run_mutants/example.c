@@ -0,0 +1,7 @@
+int main(int argc, char** argv) {
+  int result = 0;
+  if (argc > 1) {
+    result = argc * 10 + 2;
+  }
+  return result;
+}
@@ -0,0 +1,95 @@
+import os
+import shutil
+import subprocess
+import sys
+from pathlib import Path
+
+DREDD_REPO_ROOT = os.environ['DREDD_REPO_ROOT']
+DREDD_CLANG_LLVM_DIR = os.environ['DREDD_CLANG_LLVM_DIR']
+DREDD_EXECUTABLE = Path(DREDD_REPO_ROOT, 'temp', 'build-Debug', 'src', 'dredd', 'dredd') if 'DREDD_EXECUTABLE' not in os.environ else os.environ['DREDD_EXECUTABLE']
+RUN_MUTANTS_SCRIPT = Path(DREDD_REPO_ROOT, 'scripts', 'run_mutants.py')
+CLANG_EXECUTABLE = Path(DREDD_CLANG_LLVM_DIR, 'bin', 'clang')
+COMPILED_EXECUTABLE_FILENAME = 'a.exe' if os.name == 'nt' else './a.out'
+
+
+def run_successfully(cmd, env=None):
+    result = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, env=env)
+    if result.returncode != 0:
+        print(f"Command exited with error code {result.returncode}: {' '.join([str(c) for c in cmd])}")
+        print(result.stdout.decode('utf-8'))
+        print(result.stderr.decode('utf-8'))
+        sys.exit(1)
+    return result
+
+
+def main():
+    # Build a mutant tracking version of the example, and run it with no arguments, so that the body of the "if"
+    # statement is not reached.
+    shutil.copyfile(src='example.c', dst='tomutate.c')
+    run_successfully([DREDD_EXECUTABLE,
+                      '--mutation-info-file',
+                      'info.json',
+                      '--only-track-mutant-coverage',
+                      'tomutate.c',
+                      '--'])
+    run_successfully([CLANG_EXECUTABLE, 'tomutate.c'])
+    dredd_env = os.environ.copy()
+    dredd_env['DREDD_MUTANT_TRACKING_FILE'] = 'covered.mutants'
+    run_successfully([COMPILED_EXECUTABLE_FILENAME], env=dredd_env)
+    covered = set([int(line.strip()) for line in open('covered.mutants', 'r').readlines()])
+    # Also record the coverage of a run with an argument, which reaches the body of the "if" statement. The program
+    # then returns a non-zero value.
+    dredd_env['DREDD_MUTANT_TRACKING_FILE'] = 'covered_with_argument.mutants'
+    subprocess.run([COMPILED_EXECUTABLE_FILENAME, 'argument'], env=dredd_env)
+
+    # Build a mutated version of the example.
+    shutil.copyfile(src='example.c', dst='tomutate.c')
+    run_successfully([DREDD_EXECUTABLE, '--mutation-info-file', 'info.json', 'tomutate.c', '--'])
+    run_successfully([CLANG_EXECUTABLE, 'tomutate.c'])
+
+    # Check that only covered mutants need to be run.
+    to_run = [int(line) for line in run_successfully(
+        ["python", RUN_MUTANTS_SCRIPT, "info.json", "--coverage-files", "covered.mutants",
+         "--list-mutants-to-run"]).stdout.decode('utf-8').splitlines()]
+    assert len(to_run) > 0
+    assert set(to_run) == covered
+
+    # The test checks that the program returns 0 when given no arguments.
+    output = run_successfully(
+        ["python", RUN_MUTANTS_SCRIPT, "info.json", "--coverage-files", "covered.mutants", "--",
+         COMPILED_EXECUTABLE_FILENAME]).stdout.decode('utf-8')
+    statuses = dict([line.split(': ') for line in output.splitlines() if not line.startswith('Mutants:')])
+
+    # The mutants inside the "if" statement are never reached; removal of the assignment statement should be pruned
+    # without being run, because its enclosing statement is not reached.
+    assert 'pruned' in statuses.values()
+    assert 'killed' in statuses.values()
+    assert all(statuses[str(mutant)] in ['killed', 'survived'] for mutant in to_run)
+    assert all(status in ['not covered', 'pruned'] for mutant, status in statuses.items() if int(mutant) not in to_run)
+
+    # With coverage that includes the body of the "if" statement, e.g. because it was gathered from a broader set of
+    # tests, the coverage filter runs the mutants inside the body, even though the test command does not reach them.
+    coverage_files = ["--coverage-files", "covered.mutants", "covered_with_argument.mutants"]
+    output = run_successfully(["python", RUN_MUTANTS_SCRIPT, "info.json"] + coverage_files + [
+        "--", COMPILED_EXECUTABLE_FILENAME]).stdout.decode('utf-8')
+    executed_with_coverage = int(output.splitlines()[-1].split('executed: ')[1].split(',')[0])
+
+    # Build a version of the example that reports whether the enabled mutant is reached. With --check-reached, the
+    # removal of the statement inside the "if" statement is run first, and as it is not reached, the mutants nested
+    # inside the statement are pruned without being run.
+    shutil.copyfile(src='example.c', dst='tomutate.c')
+    run_successfully([DREDD_EXECUTABLE, '--mutation-info-file', 'info.json', '--report-reached-mutants', 'tomutate.c',
+                      '--'])
+    run_successfully([CLANG_EXECUTABLE, 'tomutate.c'])
+    output = run_successfully(["python", RUN_MUTANTS_SCRIPT, "info.json"] + coverage_files + [
+        "--check-reached", "--", COMPILED_EXECUTABLE_FILENAME]).stdout.decode('utf-8')
+    executed_with_hierarchy = int(output.splitlines()[-1].split('executed: ')[1].split(',')[0])
+    statuses = dict([line.split(': ') for line in output.splitlines() if not line.startswith('Mutants:')])
+    assert 'not reached' in statuses.values()
+    assert 'pruned' in statuses.values()
+    assert 'killed' in statuses.values()
+    assert executed_with_hierarchy < executed_with_coverage
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,17 @@
+#include <stdio.h>
+
+int steps_to(int target, int step);
+
+int sum(int n) {
+  int total = 0;
+  for (int i = 0; i < n; i++) {
+    total += i;
+  }
+  return total;
+}
+
+int main(int argc, char** argv) {
+  printf("%d\n", sum(argc + 9));
+  printf("%d\n", steps_to(10, argc));
+  return 0;
+}
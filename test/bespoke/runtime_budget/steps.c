@@ -0,0 +1,9 @@
+int steps_to(int target, int step) {
+  int position = 0;
+  int steps = 0;
+  while (position < target) {
+    position += step;
+    steps++;
+  }
+  return steps;
+}
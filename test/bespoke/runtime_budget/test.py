@@ -0,0 +1,78 @@
+import os
+import shutil
+import subprocess
+import sys
+from pathlib import Path
+
+DREDD_REPO_ROOT = os.environ['DREDD_REPO_ROOT']
+DREDD_CLANG_LLVM_DIR = os.environ['DREDD_CLANG_LLVM_DIR']
+DREDD_EXECUTABLE = Path(DREDD_REPO_ROOT, 'temp', 'build-Debug', 'src', 'dredd', 'dredd') if 'DREDD_EXECUTABLE' not in os.environ else os.environ['DREDD_EXECUTABLE']
+QUERY_MUTANT_INFO_SCRIPT = Path(DREDD_REPO_ROOT, 'scripts', 'query_mutant_info.py')
+CLANG_EXECUTABLE = Path(DREDD_CLANG_LLVM_DIR, 'bin', 'clang')
+EXECUTABLE_SUFFIX = '.exe' if os.name == 'nt' else ''
+BUDGET_EXCEEDED_EXIT_CODE = 124
+TIMEOUT_SECONDS = 60
+
+
+def run_successfully(cmd, env=None):
+    result = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, env=env)
+    if result.returncode != 0:
+        print(f"Command exited with error code {result.returncode}: {' '.join([str(x) for x in cmd])}")
+        print(result.stdout.decode('utf-8'))
+        print(result.stderr.decode('utf-8'))
+        sys.exit(1)
+    return result
+
+
+def main():
+    # Two files are mutated, so that checks made by a file with no enabled mutation are counted along with those of
+    # the file that contains the enabled mutation.
+    shutil.copyfile(src='example.c', dst='budget.c')
+    shutil.copyfile(src='steps.c', dst='budget_steps.c')
+    run_successfully([DREDD_EXECUTABLE, '--runtime-budget', '--mutation-info-file', 'budget.json', 'budget.c',
+                      'budget_steps.c', '--'])
+    executable = f'./budget{EXECUTABLE_SUFFIX}'
+    run_successfully([CLANG_EXECUTABLE, 'budget.c', 'budget_steps.c', '-o', executable])
+
+    # Without the environment variables, the behaviour of the program is unchanged.
+    assert run_successfully([executable]).stdout.decode('utf-8').split() == ['45', '10']
+
+    # Count the mutation checks made by the original program, and derive a limit from them.
+    dredd_env = os.environ.copy()
+    dredd_env['DREDD_MUTATION_CHECK_COUNT_FILE'] = 'mutation_checks.count'
+    assert run_successfully([executable], env=dredd_env).stdout.decode('utf-8').split() == ['45', '10']
+    # The checks made by both files are reported once, as a single count for the process.
+    counts = [int(line) for line in open('mutation_checks.count', 'r').readlines()]
+    assert len(counts) == 1
+    mutation_checks = counts[0]
+    assert mutation_checks > 0
+    limit = 10 * mutation_checks
+
+    # The original program stays within the limit.
+    dredd_env = os.environ.copy()
+    dredd_env['DREDD_MUTATION_CHECK_LIMIT'] = str(limit)
+    run_successfully([executable], env=dredd_env)
+
+    # Mutants that loop forever, e.g. by replacing 'i < n' with 'true' or 'i++' with 'i--', exceed the limit quickly,
+    # and all other mutants terminate normally. This includes mutants that replace 'argc' with '0' in 'budget.c',
+    # which loop forever in 'budget_steps.c', where no mutation is enabled.
+    largest_mutant_id = int(run_successfully(
+        ["python", QUERY_MUTANT_INFO_SCRIPT, "--largest-mutant-id", "budget.json"]).stdout.decode('utf-8'))
+    num_exceeded = 0
+    for mutant in range(0, largest_mutant_id + 1):
+        dredd_env['DREDD_ENABLED_MUTATION'] = str(mutant)
+        result = subprocess.run([executable], env=dredd_env, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                                timeout=TIMEOUT_SECONDS)
+        if result.returncode == BUDGET_EXCEEDED_EXIT_CODE:
+            num_exceeded += 1
+    assert num_exceeded > 0
+
+    # The exit status used when the limit is exceeded can be changed.
+    dredd_env['DREDD_BUDGET_EXCEEDED_EXIT_CODE'] = '99'
+    dredd_env['DREDD_MUTATION_CHECK_LIMIT'] = '1'
+    dredd_env['DREDD_ENABLED_MUTATION'] = str(largest_mutant_id)
+    assert subprocess.run([executable], env=dredd_env, stdout=subprocess.PIPE).returncode == 99
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,17 @@
+#include <stdio.h>
+
+int combine(int a, int b) {
+  if (a > b) {
+    return a - b;
+  }
+  return b * 2 + a;
+}
+
+int main(int argc, char** argv) {
+  int x = argc << 1;
+  int y = combine(x - 1, 1);
+  printf("%d\n", y);
+  int z = combine(argc, 3) / 3;
+  printf("%d\n", z);
+  return y == 3 && z == 2 ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+import os
+import shutil
+import subprocess
+import sys
+from pathlib import Path
+
+DREDD_REPO_ROOT = os.environ['DREDD_REPO_ROOT']
+DREDD_CLANG_LLVM_DIR = os.environ['DREDD_CLANG_LLVM_DIR']
+DREDD_EXECUTABLE = Path(DREDD_REPO_ROOT, 'temp', 'build-Debug', 'src', 'dredd', 'dredd') if 'DREDD_EXECUTABLE' not in os.environ else os.environ['DREDD_EXECUTABLE']
+QUERY_MUTANT_INFO_SCRIPT = Path(DREDD_REPO_ROOT, 'scripts', 'query_mutant_info.py')
+CLANG_EXECUTABLE = Path(DREDD_CLANG_LLVM_DIR, 'bin', 'clang')
+EXECUTABLE_SUFFIX = '.exe' if os.name == 'nt' else ''
+TIMEOUT_SECONDS = 5
+
+
+def run_successfully(cmd, env=None):
+    result = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, env=env)
+    if result.returncode != 0:
+        print(f"Command exited with error code {result.returncode}: {' '.join([str(x) for x in cmd])}")
+        print(result.stdout.decode('utf-8'))
+        print(result.stderr.decode('utf-8'))
+        sys.exit(1)
+    return result
+
+
+def mutate_and_compile(name, extra_dredd_args):
+    shutil.copyfile(src='example.c', dst=f'{name}.c')
+    run_successfully([DREDD_EXECUTABLE] + extra_dredd_args + ['--mutation-info-file', f'{name}.json', f'{name}.c',
+                                                              '--'])
+    executable = f'./{name}{EXECUTABLE_SUFFIX}'
+    run_successfully([CLANG_EXECUTABLE, f'{name}.c', '-o', executable])
+    return executable
+
+
+def is_killed(executable, mutant):
+    dredd_env = os.environ.copy()
+    dredd_env['DREDD_ENABLED_MUTATION'] = str(mutant)
+    try:
+        return subprocess.run([executable], env=dredd_env, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                              timeout=TIMEOUT_SECONDS).returncode != 0
+    except subprocess.TimeoutExpired:
+        return True
+
+
+def main():
+    if os.name == 'nt':
+        # Split-stream execution relies on fork.
+        return 0
+
+    mutated_executable = mutate_and_compile('mutated', [])
+    split_stream_executable = mutate_and_compile('split_stream', ['--split-stream'])
+
+    # Split-stream execution does not change the behaviour of the program when it is run normally.
+    original_output = run_successfully([mutated_executable]).stdout
+    assert run_successfully([split_stream_executable]).stdout == original_output
+
+    # A single run splits off a child for each mutant that infects the program state. The output of the children is
+    # discarded.
+    dredd_env = os.environ.copy()
+    dredd_env['DREDD_SPLIT_STREAM_RESULTS_FILE'] = 'split_stream.results'
+    dredd_env['DREDD_SPLIT_STREAM_TIMEOUT'] = str(TIMEOUT_SECONDS)
+    assert run_successfully([split_stream_executable], env=dredd_env).stdout == original_output
+    exit_statuses = {}
+    for line in open('split_stream.results', 'r').readlines():
+        mutant, exit_status = line.split()
+        assert int(mutant) not in exit_statuses
+        exit_statuses[int(mutant)] = int(exit_status)
+
+    # Each mutant is killed according to split-stream execution if and only if it is killed when run on its own.
+    largest_mutant_id = int(run_successfully(
+        ["python", QUERY_MUTANT_INFO_SCRIPT, "--largest-mutant-id", "mutated.json"]).stdout.decode('utf-8'))
+    assert 0 < len(exit_statuses) < largest_mutant_id + 1
+    for mutant in range(0, largest_mutant_id + 1):
+        assert (exit_statuses.get(mutant, 0) != 0) == is_killed(mutated_executable, mutant)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
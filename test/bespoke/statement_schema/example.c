@@ -0,0 +1,12 @@
+#include <stdio.h>
+
+int compute(int a, int b, int c) {
+  int result = 0;
+  result += a * b + c - (a ^ c);
+  return result * (b - a) + (c | 1);
+}
+
+int main(int argc, char** argv) {
+  printf("%d\n", compute(argc, argc + 2, argc + 5));
+  return 0;
+}
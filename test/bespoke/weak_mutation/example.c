@@ -0,0 +1,25 @@
+#include <limits.h>
+#include <stdio.h>
+
+int scale(int a, int b) {
+  if (a > b) {
+    return a - b;
+  }
+  return b * 2 + a;
+}
+
+int distance(int a, int b) {
+  return a - b;
+}
+
+int main(int argc, char** argv) {
+  int x = argc << 1;
+  int negative = -argc;
+  printf("%d\n", scale(x - 1, 1));
+  printf("%d\n", scale(argc, 3) / 3);
+  // Replacing '-' with '+' or '*', or '>>' with '<<', would overflow, and the
+  // weak mutants must detect this without evaluating the replacement.
+  printf("%d\n", distance(INT_MAX, argc + 1));
+  printf("%d\n", negative >> 1);
+  return 0;
+}
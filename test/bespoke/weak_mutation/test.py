@@ -0,0 +1,69 @@
+import os
+import shutil
+import subprocess
+import sys
+from pathlib import Path
+
+DREDD_REPO_ROOT = os.environ['DREDD_REPO_ROOT']
+DREDD_CLANG_LLVM_DIR = os.environ['DREDD_CLANG_LLVM_DIR']
+DREDD_EXECUTABLE = Path(DREDD_REPO_ROOT, 'temp', 'build-Debug', 'src', 'dredd', 'dredd') if 'DREDD_EXECUTABLE' not in os.environ else os.environ['DREDD_EXECUTABLE']
+CLANG_EXECUTABLE = Path(DREDD_CLANG_LLVM_DIR, 'bin', 'clang')
+EXECUTABLE_SUFFIX = '.exe' if os.name == 'nt' else ''
+
+
+def run_successfully(cmd, env=None):
+    result = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, env=env)
+    if result.returncode != 0:
+        print(f"Command exited with error code {result.returncode}: {' '.join([str(x) for x in cmd])}")
+        print(result.stdout.decode('utf-8'))
+        print(result.stderr.decode('utf-8'))
+        sys.exit(1)
+    return result
+
+
+def mutate_and_compile(name, extra_dredd_args, extra_compiler_args=None):
+    shutil.copyfile(src='example.c', dst=f'{name}.c')
+    run_successfully([DREDD_EXECUTABLE] + extra_dredd_args + [f'{name}.c', '--'])
+    executable = f'./{name}{EXECUTABLE_SUFFIX}'
+    run_successfully([CLANG_EXECUTABLE, f'{name}.c', '-o', executable] + (extra_compiler_args or []))
+    return executable
+
+
+def covered_mutants(executable, tracking_file):
+    dredd_env = os.environ.copy()
+    dredd_env['DREDD_MUTANT_TRACKING_FILE'] = tracking_file
+    run_successfully([executable], env=dredd_env)
+    return set([int(line.strip()) for line in open(tracking_file, 'r').readlines()])
+
+
+def main():
+    # Weak mutation requires mutant tracking.
+    shutil.copyfile(src='example.c', dst='invalid.c')
+    assert subprocess.run([DREDD_EXECUTABLE, '--weak-mutation', 'invalid.c', '--'], stdout=subprocess.PIPE,
+                          stderr=subprocess.PIPE).returncode != 0
+
+    mutated_executable = mutate_and_compile('mutated', [])
+    tracking_executable = mutate_and_compile('tracking', ['--only-track-mutant-coverage'])
+    # Evaluating the weak mutants must not itself have undefined behaviour, such as signed overflow or an invalid shift,
+    # which the sanitizers turn into a failure of the program.
+    weak_executable = mutate_and_compile('weak', ['--only-track-mutant-coverage', '--weak-mutation'],
+                                         ['-fsanitize=signed-integer-overflow,shift', '-fno-sanitize-recover=all'])
+
+    reached = covered_mutants(tracking_executable, 'reached.mutants')
+    infected = covered_mutants(weak_executable, 'infected.mutants')
+
+    # A mutant can only infect the program state if it is reached, and some reached mutants, such as the replacement of
+    # 'argc' with 1, do not infect it.
+    assert infected.issubset(reached)
+    assert len(infected) < len(reached)
+
+    # A mutant that never infects the program state cannot change the behaviour of the program.
+    original_output = run_successfully([mutated_executable]).stdout
+    for mutant in reached.difference(infected):
+        dredd_env = os.environ.copy()
+        dredd_env['DREDD_ENABLED_MUTATION'] = str(mutant)
+        assert run_successfully([mutated_executable], env=dredd_env).stdout == original_output
+
+
+if __name__ == '__main__':
+    sys.exit(main())